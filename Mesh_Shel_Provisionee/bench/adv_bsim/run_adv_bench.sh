@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+#
+# Latency of locally originated mesh messages under relay load, in
+# BabbleSim.
+#
+# Build twice, with the shared advertising set and with separate sets:
+#   west build -b nrf52_bsim/native -d build_adv_shared
+#   west build -b nrf52_bsim/native -d build_adv_sets -- \
+#       -DEXTRA_CONF_FILE=../../adv_sets.conf
+# Then run each with the number of load generators and their interval:
+#   EXE=build_adv_sets/zephyr/zephyr.exe ./run_adv_bench.sh [loaders] [load_ms]
+#
+# Device 0 is the node under test, device 1 the receiver of its messages
+# and devices 2.. flood the network with messages the node relays. The
+# node prints the send-to-transmit latency percentiles of its own
+# messages and how many messages it relayed meanwhile.
+
+set -eu
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must point to the BabbleSim install}"
+
+loaders=${1:-3}
+load_ms=${2:-30}
+exe=${EXE:-$(pwd)/build_adv_shared/zephyr/zephyr.exe}
+sim_id="adv_bench_$$"
+devices=$((loaders + 2))
+
+cd "${BSIM_OUT_PATH}/bin"
+
+pids=()
+"${exe}" -s="${sim_id}" -d=0 -testid=adv_node &
+pids+=($!)
+
+"${exe}" -s="${sim_id}" -d=1 -testid=adv_sink &
+pids+=($!)
+
+for dev in $(seq 2 $((devices - 1))); do
+    "${exe}" -s="${sim_id}" -d="${dev}" -testid=adv_load -argstest interval="${load_ms}" &
+    pids+=($!)
+done
+
+./bs_2G4_phy_v1 -s="${sim_id}" -D="${devices}" -sim_length=90e6 &
+pids+=($!)
+
+status=0
+for pid in "${pids[@]}"; do
+    wait "${pid}" || status=1
+done
+
+exit ${status}
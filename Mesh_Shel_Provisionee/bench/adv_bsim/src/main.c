@@ -0,0 +1,346 @@
+/*
+ * main.c - BabbleSim benchmark of local send latency under relay load.
+ *
+ * Device 0 is the node under test: it relays everything it hears and
+ * sends its own messages to device 1 at a steady rate, measuring the
+ * time from bt_mesh_model_send() to the start of the first transmission.
+ * Devices 2..N flood the group address with messages that every node
+ * relays. Run the same scenario with the shared advertising set and with
+ * adv_sets.conf to see what separate relay sets buy local traffic.
+ *
+ * See run_adv_bench.sh for how to start a run.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/random/random.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/mesh.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bs_types.h"
+#include "bs_tracing.h"
+#include "bstests.h"
+#include "argparse.h"
+
+#define NODE_ADDR  0x0001
+#define SINK_ADDR  0x0002
+#define GROUP_ADDR 0xc000
+
+#define BENCH_MODEL_ID 0x0001
+#define OP_BENCH_MSG   BT_MESH_MODEL_OP_3(0x01, CONFIG_BT_COMPANY_ID)
+
+/* Local messages sent by the node, one every LOCAL_INTERVAL_MS */
+#define LOCAL_MSGS        200
+#define LOCAL_INTERVAL_MS 200
+#define SETUP_MS          5000
+#define LOAD_TTL          4
+
+#define FAIL(...)                                   \
+    do {                                            \
+        bst_result = Failed;                        \
+        bs_trace_error_time_line(__VA_ARGS__);      \
+    } while (0)
+
+#define PASS()                                      \
+    do {                                            \
+        bst_result = Passed;                        \
+        bs_trace_info_time(1, "PASSED\n");          \
+    } while (0)
+
+extern enum bst_result_t bst_result;
+
+static struct {
+    int load_interval_ms;
+} bench = {
+    .load_interval_ms = 30,
+};
+
+static const uint8_t net_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+static const uint8_t app_key[16] = {
+    0x3a, 0x4c, 0x9e, 0x01, 0x77, 0x52, 0xbd, 0x10,
+    0xf0, 0x1c, 0x6b, 0x2d, 0x8e, 0x5a, 0x41, 0x93,
+};
+
+static uint8_t dev_uuid[16] = { 0xad, 0xb0 };
+
+/* ---------------------------------------------------------------------
+ * Bench model: one unacknowledged message, counted by the receiver
+ * --------------------------------------------------------------------- */
+static uint32_t msgs_received;
+
+static int handle_bench_msg(const struct bt_mesh_model *model,
+                            struct bt_mesh_msg_ctx *ctx,
+                            struct net_buf_simple *buf)
+{
+    msgs_received++;
+    return 0;
+}
+
+static const struct bt_mesh_model_op bench_ops[] = {
+    { OP_BENCH_MSG, BT_MESH_LEN_MIN(0), handle_bench_msg },
+    BT_MESH_MODEL_OP_END,
+};
+
+/* ---------------------------------------------------------------------
+ * Local send latency: send call to start of the first transmission
+ * --------------------------------------------------------------------- */
+static int64_t send_ticks[LOCAL_MSGS];
+static uint32_t latency_us[LOCAL_MSGS];
+static uint32_t started;
+
+static void local_send_start(uint16_t duration, int err, void *cb_data)
+{
+    uint32_t i = POINTER_TO_UINT(cb_data);
+
+    if (!err && i < LOCAL_MSGS) {
+        latency_us[started++] = k_ticks_to_us_floor32(k_uptime_ticks() - send_ticks[i]);
+    }
+}
+
+static const struct bt_mesh_send_cb local_send_cb = {
+    .start = local_send_start,
+};
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, size_t count, unsigned int pct)
+{
+    size_t rank = DIV_ROUND_UP(count * pct, 100);
+
+    return sorted[CLAMP(rank, 1, count) - 1];
+}
+
+/* ---------------------------------------------------------------------
+ * Mesh setup: self-provisioned, configured through the local Config Client
+ * --------------------------------------------------------------------- */
+static struct bt_mesh_cfg_cli cfg_cli;
+
+static const struct bt_mesh_model root_models[] = {
+    BT_MESH_MODEL_CFG_SRV,
+    BT_MESH_MODEL_CFG_CLI(&cfg_cli),
+};
+
+static const struct bt_mesh_model vnd_models[] = {
+    BT_MESH_MODEL_VND(CONFIG_BT_COMPANY_ID, BENCH_MODEL_ID, bench_ops, NULL, NULL),
+};
+
+static const struct bt_mesh_elem elements[] = {
+    BT_MESH_ELEM(0, root_models, vnd_models),
+};
+
+static const struct bt_mesh_comp comp = {
+    .cid        = CONFIG_BT_COMPANY_ID,
+    .elem       = elements,
+    .elem_count = ARRAY_SIZE(elements),
+};
+
+static const struct bt_mesh_prov prov = {
+    .uuid = dev_uuid,
+};
+
+static int mesh_start(uint16_t addr)
+{
+    uint8_t dev_key[16] = { 0xdd, (uint8_t)(addr >> 8), (uint8_t)addr };
+    uint8_t status;
+    int err;
+
+    dev_uuid[15] = (uint8_t)addr;
+
+    err = bt_enable(NULL);
+    if (err) {
+        return err;
+    }
+
+    err = bt_mesh_init(&prov, &comp);
+    if (err) {
+        return err;
+    }
+
+    err = bt_mesh_provision(net_key, 0, 0, 0, addr, dev_key);
+    if (err) {
+        return err;
+    }
+
+    err = bt_mesh_cfg_cli_app_key_add(0, addr, 0, 0, app_key, &status);
+    if (err || status) {
+        return err ? err : -EIO;
+    }
+
+    err = bt_mesh_cfg_cli_mod_app_bind_vnd(0, addr, addr, 0, BENCH_MODEL_ID,
+                                           CONFIG_BT_COMPANY_ID, &status);
+    if (err || status) {
+        return err ? err : -EIO;
+    }
+
+    return 0;
+}
+
+static int bench_send(uint16_t dst, uint8_t ttl, const struct bt_mesh_send_cb *cb,
+                      void *cb_data)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = 0,
+        .app_idx = 0,
+        .addr = dst,
+        .send_ttl = ttl,
+    };
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_BENCH_MSG, 4);
+    bt_mesh_model_msg_init(&msg, OP_BENCH_MSG);
+    net_buf_simple_add_le32(&msg, sys_rand32_get());
+
+    return bt_mesh_model_send(&vnd_models[0], &ctx, &msg, cb, cb_data);
+}
+
+/* ---------------------------------------------------------------------
+ * Tests
+ * --------------------------------------------------------------------- */
+static void test_args_parse(int argc, char *argv[])
+{
+    for (int i = 0; i < argc; i++) {
+        if (!strncmp(argv[i], "interval=", 9)) {
+            bench.load_interval_ms = CLAMP(atoi(&argv[i][9]), 5, 10000);
+        }
+    }
+}
+
+static void test_init(void)
+{
+    bst_result = In_progress;
+}
+
+static void test_node(void)
+{
+    struct bt_mesh_statistic st;
+    uint32_t failed = 0;
+    int err;
+
+    err = mesh_start(NODE_ADDR);
+    if (err) {
+        FAIL("Node setup failed (err %d)\n", err);
+        return;
+    }
+
+    /* Let every device finish its setup and the load build up */
+    k_sleep(K_MSEC(SETUP_MS));
+    bt_mesh_stat_reset();
+
+    for (uint32_t i = 0; i < LOCAL_MSGS; i++) {
+        send_ticks[i] = k_uptime_ticks();
+        err = bench_send(SINK_ADDR, BT_MESH_TTL_DEFAULT, &local_send_cb, UINT_TO_POINTER(i));
+        if (err) {
+            failed++;
+        }
+        k_sleep(K_MSEC(LOCAL_INTERVAL_MS));
+    }
+
+    bt_mesh_stat_get(&st);
+
+    if (!started) {
+        FAIL("No local message was sent (%u failed)\n", failed);
+        return;
+    }
+
+    qsort(latency_us, started, sizeof(latency_us[0]), cmp_u32);
+
+    printk("ADV bench: %u relay sets, local send->start p50 %u us p90 %u us "
+           "p99 %u us max %u us, %u/%u sent, %u failed, relayed %u/%u\n",
+           CONFIG_BT_MESH_RELAY_ADV_SETS,
+           percentile(latency_us, started, 50), percentile(latency_us, started, 90),
+           percentile(latency_us, started, 99), latency_us[started - 1],
+           started, LOCAL_MSGS, failed,
+           st.tx_adv_relay_succeeded, st.tx_adv_relay_planned);
+
+    PASS();
+}
+
+static void test_sink(void)
+{
+    int err;
+
+    err = mesh_start(SINK_ADDR);
+    if (err) {
+        FAIL("Sink setup failed (err %d)\n", err);
+        return;
+    }
+
+    k_sleep(K_MSEC(SETUP_MS + LOCAL_MSGS * LOCAL_INTERVAL_MS + 2000));
+    printk("ADV bench: sink received %u messages\n", msgs_received);
+    PASS();
+}
+
+static void test_load(void)
+{
+    int64_t end;
+    int err;
+
+    err = mesh_start(NODE_ADDR + get_device_nbr());
+    if (err) {
+        FAIL("Load setup failed (err %d)\n", err);
+        return;
+    }
+
+    /* Start a little earlier and stop a little later than the node */
+    k_sleep(K_MSEC(SETUP_MS / 2));
+    end = k_uptime_get() + SETUP_MS + LOCAL_MSGS * LOCAL_INTERVAL_MS;
+
+    while (k_uptime_get() < end) {
+        /* -ENOBUFS just means the load saturates this device too */
+        (void)bench_send(GROUP_ADDR, LOAD_TTL, NULL, NULL);
+        k_sleep(K_MSEC(bench.load_interval_ms));
+    }
+
+    PASS();
+}
+
+static const struct bst_test_instance test_adv[] = {
+    {
+        .test_id = "adv_node",
+        .test_descr = "Relay the load and report the latency of local sends",
+        .test_post_init_f = test_init,
+        .test_main_f = test_node,
+    },
+    {
+        .test_id = "adv_sink",
+        .test_descr = "Receive the node's local messages",
+        .test_post_init_f = test_init,
+        .test_main_f = test_sink,
+    },
+    {
+        .test_id = "adv_load",
+        .test_descr = "Flood the group address to load the relays",
+        .test_args_f = test_args_parse,
+        .test_post_init_f = test_init,
+        .test_main_f = test_load,
+    },
+    BSTEST_END_MARKER
+};
+
+static struct bst_test_list *test_adv_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, test_adv);
+}
+
+bst_test_install_t test_installers[] = {
+    test_adv_install,
+    NULL
+};
+
+int main(void)
+{
+    bst_main();
+    return 0;
+}
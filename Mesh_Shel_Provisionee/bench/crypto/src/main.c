@@ -0,0 +1,542 @@
+/*
+ * main.c - Microbenchmark for the crypto used by mesh provisioning.
+ *
+ * Measures P-256 key generation, ECDH, AES-CMAC and one complete
+ * provisioning exchange (both the provisioner and the device side)
+ * with whichever backend the build selected:
+ *
+ *   west build -b native_sim                                 (TinyCrypt)
+ *   west build -b native_sim -- -DEXTRA_CONF_FILE=psa.conf   (PSA / mbed TLS)
+ *   west build -b native_sim -- -DEXTRA_CONF_FILE="psa.conf;psa_p256m.conf"
+ *
+ * The same app runs on the dongle to compare the backends on real
+ * hardware; see crypto_psa.conf in the firmware directory.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/random/random.h>
+#include <string.h>
+
+#if defined(CONFIG_ARCH_POSIX)
+#include <time.h>
+#else
+#include <zephyr/timing/timing.h>
+#endif
+
+#if defined(CONFIG_MBEDTLS_PSA_CRYPTO_C)
+#include <psa/crypto.h>
+#define BACKEND_NAME "psa"
+#else
+#include <tinycrypt/constants.h>
+#include <tinycrypt/ecc.h>
+#include <tinycrypt/ecc_dh.h>
+#include <tinycrypt/aes.h>
+#include <tinycrypt/cmac_mode.h>
+#include <tinycrypt/ccm_mode.h>
+#define BACKEND_NAME "tinycrypt"
+#endif
+
+#define ECDH_ROUNDS 20
+#define CMAC_ROUNDS 2000
+#define PROV_ROUNDS 10
+
+/* Provisioning Data PDU: NetKey, KeyIndex, Flags, IV Index, Address. */
+#define PROV_DATA_LEN 25
+#define PROV_MIC_LEN  8
+
+/* ---------------------------------------------------------------------
+ * Clock
+ * --------------------------------------------------------------------- */
+static void bench_clock_init(void)
+{
+#if !defined(CONFIG_ARCH_POSIX)
+    timing_init();
+    timing_start();
+#endif
+}
+
+static uint64_t bench_now_ns(void)
+{
+#if defined(CONFIG_ARCH_POSIX)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+    return timing_cycles_to_ns(timing_counter_get());
+#endif
+}
+
+/* ---------------------------------------------------------------------
+ * Backend: one keypair per side, ECDH, CMAC and CCM
+ * --------------------------------------------------------------------- */
+struct ecdh_key {
+#if defined(CONFIG_MBEDTLS_PSA_CRYPTO_C)
+    psa_key_id_t id;
+#else
+    uint8_t priv[32];
+#endif
+    /* Uncompressed X || Y, the format carried in the Public Key PDU. */
+    uint8_t pub[64];
+};
+
+#if defined(CONFIG_MBEDTLS_PSA_CRYPTO_C)
+
+static int backend_init(void)
+{
+    return psa_crypto_init() == PSA_SUCCESS ? 0 : -EIO;
+}
+
+static int ecdh_keygen(struct ecdh_key *key)
+{
+    psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
+    uint8_t raw[65];
+    size_t len;
+
+    psa_set_key_type(&attr, PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&attr, 256);
+    psa_set_key_usage_flags(&attr, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_algorithm(&attr, PSA_ALG_ECDH);
+
+    if (psa_generate_key(&attr, &key->id) != PSA_SUCCESS) {
+        return -EIO;
+    }
+
+    if (psa_export_public_key(key->id, raw, sizeof(raw), &len) != PSA_SUCCESS ||
+        len != sizeof(raw)) {
+        psa_destroy_key(key->id);
+        return -EIO;
+    }
+
+    memcpy(key->pub, &raw[1], sizeof(key->pub));
+    return 0;
+}
+
+static void ecdh_key_free(struct ecdh_key *key)
+{
+    psa_destroy_key(key->id);
+}
+
+static int ecdh_shared(const struct ecdh_key *key, const uint8_t peer[64],
+                       uint8_t secret[32])
+{
+    uint8_t raw[65] = { 0x04 };
+    size_t len;
+
+    memcpy(&raw[1], peer, 64);
+
+    if (psa_raw_key_agreement(PSA_ALG_ECDH, key->id, raw, sizeof(raw),
+                              secret, 32, &len) != PSA_SUCCESS) {
+        return -EIO;
+    }
+    return 0;
+}
+
+static int aes_key_import(const uint8_t key[16], psa_key_usage_t usage,
+                          psa_algorithm_t alg, psa_key_id_t *id)
+{
+    psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
+
+    psa_set_key_type(&attr, PSA_KEY_TYPE_AES);
+    psa_set_key_bits(&attr, 128);
+    psa_set_key_usage_flags(&attr, usage);
+    psa_set_key_algorithm(&attr, alg);
+
+    return psa_import_key(&attr, key, 16, id) == PSA_SUCCESS ? 0 : -EIO;
+}
+
+static int cmac(const uint8_t key[16], const uint8_t *msg, size_t len,
+                uint8_t out[16])
+{
+    psa_key_id_t id;
+    psa_status_t status;
+    size_t olen;
+
+    if (aes_key_import(key, PSA_KEY_USAGE_SIGN_MESSAGE, PSA_ALG_CMAC, &id)) {
+        return -EIO;
+    }
+
+    status = psa_mac_compute(id, PSA_ALG_CMAC, msg, len, out, 16, &olen);
+    psa_destroy_key(id);
+
+    return status == PSA_SUCCESS ? 0 : -EIO;
+}
+
+#define CCM_ALG PSA_ALG_AEAD_WITH_SHORTENED_TAG(PSA_ALG_CCM, PROV_MIC_LEN)
+
+static int ccm_encrypt(const uint8_t key[16], const uint8_t nonce[13],
+                       const uint8_t *in, size_t len, uint8_t *out)
+{
+    psa_key_id_t id;
+    psa_status_t status;
+    size_t olen;
+
+    if (aes_key_import(key, PSA_KEY_USAGE_ENCRYPT, CCM_ALG, &id)) {
+        return -EIO;
+    }
+
+    status = psa_aead_encrypt(id, CCM_ALG, nonce, 13, NULL, 0, in, len,
+                              out, len + PROV_MIC_LEN, &olen);
+    psa_destroy_key(id);
+
+    return status == PSA_SUCCESS ? 0 : -EIO;
+}
+
+static int ccm_decrypt(const uint8_t key[16], const uint8_t nonce[13],
+                       const uint8_t *in, size_t len, uint8_t *out)
+{
+    psa_key_id_t id;
+    psa_status_t status;
+    size_t olen;
+
+    if (aes_key_import(key, PSA_KEY_USAGE_DECRYPT, CCM_ALG, &id)) {
+        return -EIO;
+    }
+
+    status = psa_aead_decrypt(id, CCM_ALG, nonce, 13, NULL, 0, in,
+                              len + PROV_MIC_LEN, out, len, &olen);
+    psa_destroy_key(id);
+
+    return status == PSA_SUCCESS ? 0 : -EBADMSG;
+}
+
+#else /* TinyCrypt */
+
+static int bench_rng(uint8_t *dst, unsigned int size)
+{
+    sys_rand_get(dst, size);
+    return 1;
+}
+
+static int backend_init(void)
+{
+    uECC_set_rng(bench_rng);
+    return 0;
+}
+
+static int ecdh_keygen(struct ecdh_key *key)
+{
+    if (uECC_make_key(key->pub, key->priv, uECC_secp256r1()) != TC_CRYPTO_SUCCESS) {
+        return -EIO;
+    }
+    return 0;
+}
+
+static void ecdh_key_free(struct ecdh_key *key)
+{
+    memset(key->priv, 0, sizeof(key->priv));
+}
+
+static int ecdh_shared(const struct ecdh_key *key, const uint8_t peer[64],
+                       uint8_t secret[32])
+{
+    if (uECC_shared_secret(peer, key->priv, secret, uECC_secp256r1()) !=
+        TC_CRYPTO_SUCCESS) {
+        return -EIO;
+    }
+    return 0;
+}
+
+static int cmac(const uint8_t key[16], const uint8_t *msg, size_t len,
+                uint8_t out[16])
+{
+    struct tc_aes_key_sched_struct sched;
+    struct tc_cmac_struct state;
+
+    if (tc_cmac_setup(&state, key, &sched) != TC_CRYPTO_SUCCESS ||
+        tc_cmac_update(&state, msg, len) != TC_CRYPTO_SUCCESS ||
+        tc_cmac_final(out, &state) != TC_CRYPTO_SUCCESS) {
+        return -EIO;
+    }
+    return 0;
+}
+
+static int ccm_setup(struct tc_ccm_mode_struct *ccm,
+                     struct tc_aes_key_sched_struct *sched,
+                     const uint8_t key[16], const uint8_t nonce[13])
+{
+    if (tc_aes128_set_encrypt_key(sched, key) != TC_CRYPTO_SUCCESS ||
+        tc_ccm_config(ccm, sched, (uint8_t *)nonce, 13, PROV_MIC_LEN) !=
+        TC_CRYPTO_SUCCESS) {
+        return -EIO;
+    }
+    return 0;
+}
+
+static int ccm_encrypt(const uint8_t key[16], const uint8_t nonce[13],
+                       const uint8_t *in, size_t len, uint8_t *out)
+{
+    struct tc_aes_key_sched_struct sched;
+    struct tc_ccm_mode_struct ccm;
+
+    if (ccm_setup(&ccm, &sched, key, nonce) ||
+        tc_ccm_generation_encryption(out, len + PROV_MIC_LEN, NULL, 0, in,
+                                     len, &ccm) != TC_CRYPTO_SUCCESS) {
+        return -EIO;
+    }
+    return 0;
+}
+
+static int ccm_decrypt(const uint8_t key[16], const uint8_t nonce[13],
+                       const uint8_t *in, size_t len, uint8_t *out)
+{
+    struct tc_aes_key_sched_struct sched;
+    struct tc_ccm_mode_struct ccm;
+
+    if (ccm_setup(&ccm, &sched, key, nonce) ||
+        tc_ccm_decryption_verification(out, len, NULL, 0, in,
+                                       len + PROV_MIC_LEN, &ccm) !=
+        TC_CRYPTO_SUCCESS) {
+        return -EBADMSG;
+    }
+    return 0;
+}
+
+#endif /* CONFIG_MBEDTLS_PSA_CRYPTO_C */
+
+/* ---------------------------------------------------------------------
+ * Mesh key derivation (s1/k1) on top of the backend CMAC
+ * --------------------------------------------------------------------- */
+static int s1(const uint8_t *m, size_t len, uint8_t salt[16])
+{
+    static const uint8_t zero[16];
+
+    return cmac(zero, m, len, salt);
+}
+
+static int k1(const uint8_t *n, size_t n_len, const uint8_t salt[16],
+              const char *info, uint8_t out[16])
+{
+    uint8_t t[16];
+    int err;
+
+    err = cmac(salt, n, n_len, t);
+    if (err) {
+        return err;
+    }
+    return cmac(t, (const uint8_t *)info, strlen(info), out);
+}
+
+/* ---------------------------------------------------------------------
+ * One provisioning exchange, both ends, as done by PB-ADV/PB-GATT
+ * --------------------------------------------------------------------- */
+struct prov_side {
+    struct ecdh_key key;
+    uint8_t dhkey[32];
+    uint8_t random[16];
+    uint8_t confirm[16];
+};
+
+static int prov_confirm(const uint8_t conf_key[16], const struct prov_side *side,
+                        const uint8_t auth[16], uint8_t out[16])
+{
+    uint8_t m[32];
+
+    memcpy(m, side->random, 16);
+    memcpy(&m[16], auth, 16);
+    return cmac(conf_key, m, sizeof(m), out);
+}
+
+static int prov_exchange(void)
+{
+    /* Invite (1) + Capabilities (11) + Start (5) + both public keys. */
+    uint8_t conf_inputs[17 + 64 + 64] = { 0 };
+    uint8_t conf_salt[16], conf_key[16], check[16];
+    uint8_t prov_salt_in[48], prov_salt[16];
+    uint8_t session_key[16], nonce[16], dev_key[16];
+    uint8_t data[PROV_DATA_LEN];
+    uint8_t enc[PROV_DATA_LEN + PROV_MIC_LEN], dec[PROV_DATA_LEN];
+    static const uint8_t auth[16];
+    struct prov_side prov, dev;
+    int err;
+
+    /* Public Key exchange. */
+    err = ecdh_keygen(&prov.key);
+    if (err) {
+        return err;
+    }
+    err = ecdh_keygen(&dev.key);
+    if (err) {
+        ecdh_key_free(&prov.key);
+        return err;
+    }
+
+    err = ecdh_shared(&prov.key, dev.key.pub, prov.dhkey) ||
+          ecdh_shared(&dev.key, prov.key.pub, dev.dhkey);
+    if (err || memcmp(prov.dhkey, dev.dhkey, 32)) {
+        err = -EIO;
+        goto done;
+    }
+
+    /* Authentication: ConfirmationSalt, ConfirmationKey, Confirmations. */
+    memcpy(&conf_inputs[17], prov.key.pub, 64);
+    memcpy(&conf_inputs[17 + 64], dev.key.pub, 64);
+    sys_rand_get(prov.random, sizeof(prov.random));
+    sys_rand_get(dev.random, sizeof(dev.random));
+
+    err = s1(conf_inputs, sizeof(conf_inputs), conf_salt) ||
+          k1(prov.dhkey, 32, conf_salt, "prck", conf_key) ||
+          prov_confirm(conf_key, &prov, auth, prov.confirm) ||
+          prov_confirm(conf_key, &dev, auth, dev.confirm);
+    if (err) {
+        err = -EIO;
+        goto done;
+    }
+
+    /* Each side checks the confirmation of the other after Random. */
+    err = prov_confirm(conf_key, &dev, auth, check);
+    if (err || memcmp(check, dev.confirm, 16)) {
+        err = -EIO;
+        goto done;
+    }
+    err = prov_confirm(conf_key, &prov, auth, check);
+    if (err || memcmp(check, prov.confirm, 16)) {
+        err = -EIO;
+        goto done;
+    }
+
+    /* Distribution: session key/nonce, encrypted Provisioning Data. */
+    memcpy(prov_salt_in, conf_salt, 16);
+    memcpy(&prov_salt_in[16], prov.random, 16);
+    memcpy(&prov_salt_in[32], dev.random, 16);
+    sys_rand_get(data, sizeof(data));
+
+    err = s1(prov_salt_in, sizeof(prov_salt_in), prov_salt) ||
+          k1(prov.dhkey, 32, prov_salt, "prsk", session_key) ||
+          k1(prov.dhkey, 32, prov_salt, "prsn", nonce) ||
+          ccm_encrypt(session_key, &nonce[3], data, sizeof(data), enc) ||
+          ccm_decrypt(session_key, &nonce[3], enc, sizeof(data), dec) ||
+          k1(dev.dhkey, 32, prov_salt, "prdk", dev_key) ||
+          k1(prov.dhkey, 32, prov_salt, "prdk", check);
+    /* The device must get back the data and derive the same key */
+    if (err || memcmp(dec, data, sizeof(data)) || memcmp(dev_key, check, 16)) {
+        err = -EIO;
+    }
+
+done:
+    ecdh_key_free(&prov.key);
+    ecdh_key_free(&dev.key);
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Benchmarks
+ * --------------------------------------------------------------------- */
+static void bench_report(const char *name, int rounds, uint64_t elapsed_ns)
+{
+    uint32_t per_op_us = (uint32_t)(elapsed_ns / rounds / NSEC_PER_USEC);
+
+    printk("BENCH %s %-10s %5d rounds  %8u us/op\n", BACKEND_NAME, name,
+           rounds, per_op_us);
+}
+
+static int bench_ecdh(void)
+{
+    struct ecdh_key a, b;
+    uint8_t secret[32];
+    uint64_t keygen_ns = 0, ecdh_ns = 0, start;
+    int err = 0;
+
+    for (int i = 0; i < ECDH_ROUNDS && !err; i++) {
+        start = bench_now_ns();
+        err = ecdh_keygen(&a);
+        keygen_ns += bench_now_ns() - start;
+        if (err) {
+            break;
+        }
+
+        err = ecdh_keygen(&b);
+        if (err) {
+            ecdh_key_free(&a);
+            break;
+        }
+
+        start = bench_now_ns();
+        err = ecdh_shared(&a, b.pub, secret);
+        ecdh_ns += bench_now_ns() - start;
+
+        ecdh_key_free(&a);
+        ecdh_key_free(&b);
+    }
+
+    if (err) {
+        printk("ECDH benchmark failed (err %d)\n", err);
+        return err;
+    }
+
+    bench_report("keygen", ECDH_ROUNDS, keygen_ns);
+    bench_report("ecdh", ECDH_ROUNDS, ecdh_ns);
+    return 0;
+}
+
+static int bench_cmac(void)
+{
+    /* ConfirmationInputs is the largest CMAC input of provisioning. */
+    uint8_t key[16], msg[145], out[16];
+    uint64_t start;
+    int err = 0;
+
+    sys_rand_get(key, sizeof(key));
+    sys_rand_get(msg, sizeof(msg));
+
+    start = bench_now_ns();
+    for (int i = 0; i < CMAC_ROUNDS && !err; i++) {
+        err = cmac(key, msg, sizeof(msg), out);
+    }
+
+    if (err) {
+        printk("CMAC benchmark failed (err %d)\n", err);
+        return err;
+    }
+
+    bench_report("cmac", CMAC_ROUNDS, bench_now_ns() - start);
+    return 0;
+}
+
+static int bench_prov(void)
+{
+    uint64_t start;
+    int err = 0;
+
+    start = bench_now_ns();
+    for (int i = 0; i < PROV_ROUNDS && !err; i++) {
+        err = prov_exchange();
+    }
+
+    if (err) {
+        printk("Provisioning benchmark failed (err %d)\n", err);
+        return err;
+    }
+
+    bench_report("prov", PROV_ROUNDS, bench_now_ns() - start);
+    return 0;
+}
+
+int main(void)
+{
+    int err;
+
+    printk("Crypto benchmark, backend: %s\n", BACKEND_NAME);
+
+    bench_clock_init();
+
+    err = backend_init();
+    if (err) {
+        printk("Backend init failed (err %d)\n", err);
+        return 0;
+    }
+
+    err = bench_ecdh();
+    if (!err) {
+        err = bench_cmac();
+    }
+    if (!err) {
+        err = bench_prov();
+    }
+
+    printk("BENCH done (err %d)\n", err);
+    return 0;
+}
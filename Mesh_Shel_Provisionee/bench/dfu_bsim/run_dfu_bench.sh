@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+# SPDX-License-Identifier: Apache-2.0
+#
+# Multicast firmware update benchmark in BabbleSim.
+#
+# Build once:
+#   west build -b nrf52_bsim/native -d build_dfu_bench
+# Then run with the number of targets and the BLOB transfer mode:
+#   ./run_dfu_bench.sh [targets] [push|pull] [image_bytes]
+#
+# The distributor prints the total transfer time and throughput, every
+# target prints its own completion time (all in simulated time).
+
+set -eu
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must point to the BabbleSim install}"
+
+targets=${1:-4}
+mode=${2:-pull}
+size=${3:-16384}
+exe=${EXE:-$(pwd)/build_dfu_bench/zephyr/zephyr.exe}
+sim_id="dfu_bench_$$"
+devices=$((targets + 1))
+
+cd "${BSIM_OUT_PATH}/bin"
+
+pids=()
+"${exe}" -s="${sim_id}" -d=0 -testid=dfu_distributor \
+    -argstest targets="${targets}" mode="${mode}" size="${size}" &
+pids+=($!)
+
+for dev in $(seq 1 "${targets}"); do
+    "${exe}" -s="${sim_id}" -d="${dev}" -testid=dfu_target &
+    pids+=($!)
+done
+
+./bs_2G4_phy_v1 -s="${sim_id}" -D="${devices}" -sim_length=1200e6 &
+pids+=($!)
+
+status=0
+for pid in "${pids[@]}"; do
+    wait "${pid}" || status=1
+done
+
+exit ${status}
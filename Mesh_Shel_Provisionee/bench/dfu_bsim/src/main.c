@@ -0,0 +1,434 @@
+/*
+ * main.c - BabbleSim benchmark of a multicast firmware update.
+ *
+ * Device 0 runs the Firmware Update Client as distributor and sends one
+ * image to every target through the group address; devices 1..N run the
+ * Firmware Update Server the node firmware uses (see dfu_target.c), with
+ * RAM instead of flash behind the BLOB stream. All times are simulated
+ * time, so the numbers include airtime, relaying and retransmissions.
+ *
+ * See run_dfu_bench.sh for how to start a run.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/mesh.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bs_types.h"
+#include "bs_tracing.h"
+#include "bstests.h"
+#include "argparse.h"
+
+#define TARGETS_MAX      32
+#define GROUP_ADDR       0xc000
+#define DISTRIBUTOR_ADDR 0x0001
+#define BLOB_ID          0x0123456789abcdefULL
+
+#define FAIL(...)                                   \
+    do {                                            \
+        bst_result = Failed;                        \
+        bs_trace_error_time_line(__VA_ARGS__);      \
+    } while (0)
+
+#define PASS()                                      \
+    do {                                            \
+        bst_result = Passed;                        \
+        bs_trace_info_time(1, "PASSED\n");          \
+    } while (0)
+
+extern enum bst_result_t bst_result;
+
+static struct {
+    int targets;
+    enum bt_mesh_blob_xfer_mode mode;
+    size_t size;
+} bench = {
+    .targets = 4,
+    .mode = BT_MESH_BLOB_XFER_MODE_PULL,
+    .size = 16384,
+};
+
+static const uint8_t net_key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+static const uint8_t app_key[16] = {
+    0x3a, 0x4c, 0x9e, 0x01, 0x77, 0x52, 0xbd, 0x10,
+    0xf0, 0x1c, 0x6b, 0x2d, 0x8e, 0x5a, 0x41, 0x93,
+};
+/* Firmware the targets run, and the one being distributed. */
+static const uint8_t cur_fwid[] = { 'm', 'e', 's', 'h', '_', 's', 'h', 'e', 'l', 'l', 0x01 };
+static const uint8_t new_fwid[] = { 'm', 'e', 's', 'h', '_', 's', 'h', 'e', 'l', 'l', 0x02 };
+
+static uint8_t dev_uuid[16] = { 0xdf, 0xb0 };
+
+/* ---------------------------------------------------------------------
+ * Image: generated from the offset so every target can verify it
+ * --------------------------------------------------------------------- */
+static uint32_t bytes_received;
+static uint32_t bytes_corrupt;
+
+static uint8_t img_byte(size_t offset)
+{
+    return (uint8_t)(offset * 31 + 7);
+}
+
+static int img_open(const struct bt_mesh_blob_io *io,
+                    const struct bt_mesh_blob_xfer *xfer,
+                    enum bt_mesh_blob_io_mode mode)
+{
+    return 0;
+}
+
+static int img_rd(const struct bt_mesh_blob_io *io,
+                  const struct bt_mesh_blob_xfer *xfer,
+                  const struct bt_mesh_blob_block *block,
+                  const struct bt_mesh_blob_chunk *chunk)
+{
+    for (size_t i = 0; i < chunk->size; i++) {
+        chunk->data[i] = img_byte(block->offset + chunk->offset + i);
+    }
+    return 0;
+}
+
+static int img_wr(const struct bt_mesh_blob_io *io,
+                  const struct bt_mesh_blob_xfer *xfer,
+                  const struct bt_mesh_blob_block *block,
+                  const struct bt_mesh_blob_chunk *chunk)
+{
+    for (size_t i = 0; i < chunk->size; i++) {
+        if (chunk->data[i] != img_byte(block->offset + chunk->offset + i)) {
+            bytes_corrupt++;
+        }
+    }
+    bytes_received += chunk->size;
+    return 0;
+}
+
+static const struct bt_mesh_blob_io img_io = {
+    .open = img_open,
+    .rd = img_rd,
+    .wr = img_wr,
+};
+
+/* ---------------------------------------------------------------------
+ * Firmware Update Server (targets)
+ * --------------------------------------------------------------------- */
+static int64_t xfer_start;
+
+static struct bt_mesh_dfu_img dfu_imgs[] = {
+    {
+        .fwid = cur_fwid,
+        .fwid_len = sizeof(cur_fwid),
+    },
+};
+
+static int dfu_meta_check(struct bt_mesh_dfu_srv *srv,
+                          const struct bt_mesh_dfu_img *img,
+                          struct net_buf_simple *metadata,
+                          enum bt_mesh_dfu_effect *effect)
+{
+    *effect = BT_MESH_DFU_EFFECT_NONE;
+    return 0;
+}
+
+static int dfu_start(struct bt_mesh_dfu_srv *srv,
+                     const struct bt_mesh_dfu_img *img,
+                     struct net_buf_simple *metadata,
+                     const struct bt_mesh_blob_io **io)
+{
+    xfer_start = k_uptime_get();
+    *io = &img_io;
+    return 0;
+}
+
+static void dfu_end(struct bt_mesh_dfu_srv *srv,
+                    const struct bt_mesh_dfu_img *img, bool success)
+{
+    int64_t now = k_uptime_get();
+
+    printk("DFU bench: target 0x%04x %s at %lld ms (%lld ms transfer), "
+           "%u bytes, %u corrupt\n",
+           bt_mesh_primary_addr(), success ? "done" : "failed", now,
+           now - xfer_start, bytes_received, bytes_corrupt);
+
+    if (success && bytes_corrupt == 0) {
+        bt_mesh_dfu_srv_verified(srv);
+        PASS();
+    } else {
+        bt_mesh_dfu_srv_rejected(srv);
+        FAIL("Target transfer failed\n");
+    }
+}
+
+static int dfu_apply(struct bt_mesh_dfu_srv *srv,
+                     const struct bt_mesh_dfu_img *img)
+{
+    return 0;
+}
+
+static const struct bt_mesh_dfu_srv_cb dfu_handlers = {
+    .check = dfu_meta_check,
+    .start = dfu_start,
+    .end   = dfu_end,
+    .apply = dfu_apply,
+};
+
+static struct bt_mesh_dfu_srv dfu_srv =
+    BT_MESH_DFU_SRV_INIT(&dfu_handlers, dfu_imgs, ARRAY_SIZE(dfu_imgs));
+
+/* ---------------------------------------------------------------------
+ * Firmware Update Client (distributor)
+ * --------------------------------------------------------------------- */
+static K_SEM_DEFINE(xfer_ended, 0, 1);
+static enum bt_mesh_dfu_status xfer_status;
+
+static void dfu_cli_ended(struct bt_mesh_dfu_cli *cli,
+                          enum bt_mesh_dfu_status reason)
+{
+    xfer_status = reason;
+    k_sem_give(&xfer_ended);
+}
+
+static void dfu_cli_lost_target(struct bt_mesh_dfu_cli *cli,
+                                struct bt_mesh_dfu_target *target)
+{
+    printk("DFU bench: lost target 0x%04x at %lld ms\n",
+           target->blob.addr, k_uptime_get());
+}
+
+static const struct bt_mesh_dfu_cli_cb dfu_cli_cb = {
+    .ended = dfu_cli_ended,
+    .lost_target = dfu_cli_lost_target,
+};
+
+static struct bt_mesh_dfu_cli dfu_cli = BT_MESH_DFU_CLI_INIT(&dfu_cli_cb);
+
+static struct bt_mesh_dfu_target targets[TARGETS_MAX];
+static struct bt_mesh_blob_target_pull pull_ctx[TARGETS_MAX];
+static struct bt_mesh_dfu_slot slot;
+
+/* ---------------------------------------------------------------------
+ * Mesh setup: self-provisioned, configured through the local Config Client
+ * --------------------------------------------------------------------- */
+static struct bt_mesh_cfg_cli cfg_cli;
+
+static const struct bt_mesh_model root_models[] = {
+    BT_MESH_MODEL_CFG_SRV,
+    BT_MESH_MODEL_CFG_CLI(&cfg_cli),
+    BT_MESH_MODEL_DFU_CLI(&dfu_cli),
+    BT_MESH_MODEL_DFU_SRV(&dfu_srv),
+};
+
+static const struct bt_mesh_elem elements[] = {
+    BT_MESH_ELEM(0, root_models, BT_MESH_MODEL_NONE),
+};
+
+static const struct bt_mesh_comp comp = {
+    .cid        = CONFIG_BT_COMPANY_ID,
+    .elem       = elements,
+    .elem_count = ARRAY_SIZE(elements),
+};
+
+static const struct bt_mesh_prov prov = {
+    .uuid = dev_uuid,
+};
+
+static int mesh_start(uint16_t addr, const uint16_t *mods, size_t mod_count,
+                      bool subscribe)
+{
+    uint8_t dev_key[16] = { 0xdd, (uint8_t)(addr >> 8), (uint8_t)addr };
+    uint8_t status;
+    int err;
+
+    dev_uuid[15] = (uint8_t)addr;
+
+    err = bt_enable(NULL);
+    if (err) {
+        return err;
+    }
+
+    err = bt_mesh_init(&prov, &comp);
+    if (err) {
+        return err;
+    }
+
+    err = bt_mesh_provision(net_key, 0, 0, 0, addr, dev_key);
+    if (err) {
+        return err;
+    }
+
+    err = bt_mesh_cfg_cli_app_key_add(0, addr, 0, 0, app_key, &status);
+    if (err || status) {
+        return err ? err : -EIO;
+    }
+
+    for (size_t i = 0; i < mod_count; i++) {
+        err = bt_mesh_cfg_cli_mod_app_bind(0, addr, addr, 0, mods[i], &status);
+        if (err || status) {
+            return err ? err : -EIO;
+        }
+
+        if (!subscribe) {
+            continue;
+        }
+
+        err = bt_mesh_cfg_cli_mod_sub_add(0, addr, addr, GROUP_ADDR, mods[i], &status);
+        if (err || status) {
+            return err ? err : -EIO;
+        }
+    }
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Tests
+ * --------------------------------------------------------------------- */
+static void test_args_parse(int argc, char *argv[])
+{
+    for (int i = 0; i < argc; i++) {
+        if (!strncmp(argv[i], "targets=", 8)) {
+            bench.targets = CLAMP(atoi(&argv[i][8]), 1, TARGETS_MAX);
+        } else if (!strncmp(argv[i], "mode=", 5)) {
+            bench.mode = strcmp(&argv[i][5], "push") ? BT_MESH_BLOB_XFER_MODE_PULL :
+                                                       BT_MESH_BLOB_XFER_MODE_PUSH;
+        } else if (!strncmp(argv[i], "size=", 5)) {
+            bench.size = CLAMP(atoi(&argv[i][5]), 1, CONFIG_BT_MESH_BLOB_SIZE_MAX);
+        }
+    }
+}
+
+static void test_init(void)
+{
+    bst_result = In_progress;
+}
+
+static void test_target(void)
+{
+    static const uint16_t mods[] = {
+        BT_MESH_MODEL_ID_BLOB_SRV,
+        BT_MESH_MODEL_ID_DFU_SRV,
+    };
+    int err;
+
+    err = mesh_start(DISTRIBUTOR_ADDR + get_device_nbr(), mods, ARRAY_SIZE(mods), true);
+    if (err) {
+        FAIL("Target setup failed (err %d)\n", err);
+    }
+}
+
+static void test_distributor(void)
+{
+    static const uint16_t mods[] = {
+        BT_MESH_MODEL_ID_BLOB_CLI,
+        BT_MESH_MODEL_ID_DFU_CLI,
+    };
+    struct bt_mesh_blob_cli_inputs inputs = {
+        .app_idx = 0,
+        .group = GROUP_ADDR,
+        .ttl = BT_MESH_TTL_DEFAULT,
+        .timeout_base = 10,
+    };
+    struct bt_mesh_dfu_cli_xfer xfer = {
+        .blob_id = BLOB_ID,
+        .slot = &slot,
+        .mode = bench.mode,
+    };
+    int64_t start, elapsed;
+    int done = 0;
+    int err;
+
+    err = mesh_start(DISTRIBUTOR_ADDR, mods, ARRAY_SIZE(mods), false);
+    if (err) {
+        FAIL("Distributor setup failed (err %d)\n", err);
+        return;
+    }
+
+    /* Let every target finish its own setup. */
+    k_sleep(K_SECONDS(5));
+
+    sys_slist_init(&inputs.targets);
+    for (int i = 0; i < bench.targets; i++) {
+        targets[i].blob.addr = DISTRIBUTOR_ADDR + 1 + i;
+        targets[i].img_idx = 0;
+        if (bench.mode == BT_MESH_BLOB_XFER_MODE_PULL) {
+            targets[i].blob.pull = &pull_ctx[i];
+        }
+        sys_slist_append(&inputs.targets, &targets[i].blob.n);
+    }
+
+    slot.size = bench.size;
+    slot.fwid_len = sizeof(new_fwid);
+    memcpy(slot.fwid, new_fwid, sizeof(new_fwid));
+
+    start = k_uptime_get();
+    err = bt_mesh_dfu_cli_send(&dfu_cli, &inputs, &img_io, &xfer);
+    if (err) {
+        FAIL("DFU send failed (err %d)\n", err);
+        return;
+    }
+
+    if (k_sem_take(&xfer_ended, K_SECONDS(1000))) {
+        FAIL("DFU transfer timed out\n");
+        return;
+    }
+    elapsed = MAX(k_uptime_get() - start, 1);
+
+    for (int i = 0; i < bench.targets; i++) {
+        if (targets[i].status == BT_MESH_DFU_SUCCESS) {
+            done++;
+        }
+    }
+
+    printk("DFU bench: %s mode, %d targets, %u bytes, %lld ms, %u B/s, "
+           "%d/%d targets complete\n",
+           bench.mode == BT_MESH_BLOB_XFER_MODE_PULL ? "pull" : "push",
+           bench.targets, (uint32_t)bench.size, elapsed,
+           (uint32_t)(bench.size * MSEC_PER_SEC / elapsed), done, bench.targets);
+
+    if (xfer_status == BT_MESH_DFU_SUCCESS && done == bench.targets) {
+        PASS();
+    } else {
+        FAIL("DFU ended with status %u, %d/%d targets\n", xfer_status, done,
+             bench.targets);
+    }
+}
+
+static const struct bst_test_instance test_dfu[] = {
+    {
+        .test_id = "dfu_distributor",
+        .test_descr = "Multicast one image to all targets and report throughput",
+        .test_args_f = test_args_parse,
+        .test_post_init_f = test_init,
+        .test_main_f = test_distributor,
+    },
+    {
+        .test_id = "dfu_target",
+        .test_descr = "Receive the image and report the completion time",
+        .test_post_init_f = test_init,
+        .test_main_f = test_target,
+    },
+    BSTEST_END_MARKER
+};
+
+static struct bst_test_list *test_dfu_install(struct bst_test_list *tests)
+{
+    return bst_add_tests(tests, test_dfu);
+}
+
+bst_test_install_t test_installers[] = {
+    test_dfu_install,
+    NULL
+};
+
+int main(void)
+{
+    bst_main();
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * app_state.c - Deferred persistence of application state.
+ *
+ * Group commands can toggle a node many times a second, and every NVS
+ * write wears the flash and eventually forces a sector erase. Changes
+ * therefore only mark the state dirty; a store runs on the telemetry
+ * queue APP_STATE_STORE_DELAY_MS after the first change of a burst and
+ * writes the value as it is then. A value that ends up where it started
+ * (on, off, on) is not written at all.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#if defined(CONFIG_SETTINGS_NVS)
+#include <zephyr/fs/nvs.h>
+#endif
+
+#include "app_state.h"
+#include "app_wq.h"
+
+#define APP_STATE_MAX 4
+
+/* NVS writes an 8-byte allocation table entry per value and pads the
+ * data to the flash write block (4 bytes on the nRF52).
+ */
+#define NVS_ATE_SIZE   8
+#define NVS_WRITE_SIZE 4
+
+static struct app_state *states[APP_STATE_MAX];
+static size_t state_count;
+static atomic_t dirty;      /* bit per registered state */
+static bool loaded;
+
+static struct app_work store_work;
+static struct app_state_stats stats;
+
+static bool state_unchanged(const struct app_state *state)
+{
+    return state->valid && !memcmp(state->stored, state->data, state->len);
+}
+
+static void state_store(struct app_state *state)
+{
+    char name[24];
+    int err;
+
+    if (state_unchanged(state)) {
+        stats.unchanged++;
+        return;
+    }
+
+    snprintk(name, sizeof(name), "app/%s", state->key);
+    err = settings_save_one(name, state->data, state->len);
+    if (err) {
+        stats.errors++;
+        printk("APPSTATE %s store failed (err %d)\n", state->key, err);
+        return;
+    }
+
+    memcpy(state->stored, state->data, state->len);
+    state->valid = true;
+    stats.writes++;
+    stats.flash_bytes += NVS_ATE_SIZE + ROUND_UP(state->len, NVS_WRITE_SIZE);
+}
+
+static void store_work_handler(struct k_work *work)
+{
+    uint32_t pending = atomic_set(&dirty, 0);
+
+    for (size_t i = 0; i < state_count; i++) {
+        if (pending & BIT(i)) {
+            state_store(states[i]);
+        }
+    }
+}
+
+int app_state_register(struct app_state *state)
+{
+    if (state_count >= APP_STATE_MAX) {
+        return -ENOMEM;
+    }
+
+    if (state->len > APP_STATE_LEN_MAX) {
+        return -EINVAL;
+    }
+
+    if (!state_count) {
+        app_work_init(&store_work, APP_WQ_TELEMETRY, store_work_handler);
+    }
+
+    states[state_count++] = state;
+    return 0;
+}
+
+void app_state_changed(struct app_state *state)
+{
+    for (size_t i = 0; i < state_count; i++) {
+        if (states[i] == state) {
+            atomic_or(&dirty, BIT(i));
+            break;
+        }
+    }
+
+    stats.changes++;
+
+    /* Keep the first schedule of a burst, so a node toggled without a
+     * pause is still stored every APP_STATE_STORE_DELAY_MS.
+     */
+    if (!k_work_delayable_is_pending(&store_work.dwork)) {
+        app_work_reschedule(&store_work, APP_STATE_STORE_DELAY_MS);
+    }
+}
+
+void app_state_flush(void)
+{
+    app_work_submit(&store_work);
+}
+
+void app_state_stats_get(struct app_state_stats *out)
+{
+    *out = stats;
+    out->nvs_free = -1;
+
+#if defined(CONFIG_SETTINGS_NVS)
+    struct nvs_fs *fs;
+
+    if (!settings_storage_get((void **)&fs)) {
+        out->nvs_free = nvs_calc_free_space(fs);
+    }
+#endif
+}
+
+/* ---------------------------------------------------------------------
+ * Settings handler for the "app" subtree
+ * --------------------------------------------------------------------- */
+static int app_state_set(const char *name, size_t len, settings_read_cb read_cb,
+                         void *cb_arg)
+{
+    ssize_t read;
+
+    /* The full settings_load() at mesh start sees the subtree again;
+     * the values read at boot may have changed since.
+     */
+    if (loaded) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < state_count; i++) {
+        struct app_state *state = states[i];
+
+        if (!settings_name_steq(name, state->key, NULL)) {
+            continue;
+        }
+
+        /* A value from an older layout is ignored and rewritten */
+        if (len != state->len) {
+            return 0;
+        }
+
+        read = read_cb(cb_arg, state->stored, state->len);
+        if (read != (ssize_t)state->len) {
+            return read < 0 ? read : -EINVAL;
+        }
+
+        memcpy(state->data, state->stored, state->len);
+        state->valid = true;
+        return 0;
+    }
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(app_state, "app", NULL, app_state_set, NULL, NULL);
+
+int app_state_load(void)
+{
+    uint32_t start = k_cycle_get_32();
+    int err;
+
+    err = settings_subsys_init();
+    if (err) {
+        return err;
+    }
+
+    err = settings_load_subtree("app");
+    loaded = true;
+    stats.load_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    return err;
+}
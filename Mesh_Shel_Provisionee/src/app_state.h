@@ -0,0 +1,59 @@
+/*
+ * app_state.h - Deferred persistence of application state.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_STATE_H__
+#define APP_STATE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define APP_STATE_LEN_MAX 16
+
+/* Coalescing window: only the last value of a burst of changes is written. */
+#define APP_STATE_STORE_DELAY_MS 3000
+
+/* One piece of state persisted as "app/<key>". data points at the live
+ * value; it is copied when the store runs, not when it changes.
+ */
+struct app_state {
+    const char *key;
+    void *data;
+    size_t len;
+
+    /* Private */
+    uint8_t stored[APP_STATE_LEN_MAX];
+    bool valid;             /* stored[] matches flash */
+};
+
+struct app_state_stats {
+    uint32_t changes;       /* app_state_changed() calls */
+    uint32_t writes;        /* values written to flash */
+    uint32_t unchanged;     /* stores skipped, value already in flash */
+    uint32_t errors;
+    uint32_t flash_bytes;   /* estimate, including NVS entry overhead */
+    int32_t nvs_free;       /* free bytes in the settings area, -1 unknown */
+    uint32_t load_us;       /* time taken by app_state_load() */
+};
+
+/* Register the state before app_state_load(). */
+int app_state_register(struct app_state *state);
+
+/* Read the registered state from flash. Only the "app" subtree is
+ * loaded, so this is fast enough to run before the LEDs are configured
+ * and long before the mesh stack loads its own settings.
+ */
+int app_state_load(void);
+
+/* The live value changed: schedule a store after the coalescing window. */
+void app_state_changed(struct app_state *state);
+
+/* Write every pending value now. */
+void app_state_flush(void);
+
+void app_state_stats_get(struct app_state_stats *stats);
+
+#endif /* APP_STATE_H__ */
@@ -0,0 +1,104 @@
+/*
+ * app_wq.c - Application work queues.
+ *
+ * The mesh stack runs in the cooperative BT RX thread and the system work
+ * queue. Application work runs in its own preemptible threads instead,
+ * so the mesh always preempts it and a slow handler (flash, printk over
+ * UART) never holds up mesh processing. Actuation outranks telemetry so
+ * a sweep in progress does not delay a button press or LED change.
+ *
+ * Each queue records how long items wait past their due time.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "app_wq.h"
+
+#define APP_WQ_STACK_SIZE 2048
+
+static const struct {
+    const char *name;
+    int prio;
+} wq_cfg[APP_WQ_COUNT] = {
+    [APP_WQ_ACTUATION] = { "app_act", K_PRIO_PREEMPT(2) },
+    [APP_WQ_TELEMETRY] = { "app_tlm", K_PRIO_PREEMPT(6) },
+};
+
+static K_THREAD_STACK_ARRAY_DEFINE(wq_stacks, APP_WQ_COUNT, APP_WQ_STACK_SIZE);
+static struct k_work_q wq[APP_WQ_COUNT];
+
+static struct {
+    uint32_t runs;
+    uint64_t total_us;
+    uint32_t max_us;
+} wq_stats[APP_WQ_COUNT];
+
+static void app_work_run(struct k_work *item)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(item);
+    struct app_work *work = CONTAINER_OF(dwork, struct app_work, dwork);
+    int32_t late = (int32_t)(k_cycle_get_32() - work->due);
+    uint32_t late_us = late > 0 ? k_cyc_to_us_floor32(late) : 0;
+    unsigned int key;
+
+    /* Queue threads are preemptible; keep the update consistent for
+     * readers on other threads.
+     */
+    key = irq_lock();
+    wq_stats[work->prio].runs++;
+    wq_stats[work->prio].total_us += late_us;
+    wq_stats[work->prio].max_us = MAX(wq_stats[work->prio].max_us, late_us);
+    irq_unlock(key);
+
+    work->handler(item);
+}
+
+void app_wq_init(void)
+{
+    for (int i = 0; i < APP_WQ_COUNT; i++) {
+        struct k_work_queue_config cfg = {
+            .name = wq_cfg[i].name,
+        };
+
+        k_work_queue_start(&wq[i], wq_stacks[i], K_THREAD_STACK_SIZEOF(wq_stacks[i]),
+                           wq_cfg[i].prio, &cfg);
+    }
+}
+
+void app_work_init(struct app_work *work, enum app_wq_prio prio,
+                   k_work_handler_t handler)
+{
+    k_work_init_delayable(&work->dwork, app_work_run);
+    work->handler = handler;
+    work->prio = prio;
+}
+
+int app_work_reschedule(struct app_work *work, uint32_t delay_ms)
+{
+    work->due = k_cycle_get_32() + k_ms_to_cyc_ceil32(delay_ms);
+    return k_work_reschedule_for_queue(&wq[work->prio], &work->dwork, K_MSEC(delay_ms));
+}
+
+void app_wq_stats_get(enum app_wq_prio prio, struct app_wq_stats *stats, bool reset)
+{
+    unsigned int key = irq_lock();
+
+    stats->runs = wq_stats[prio].runs;
+    stats->avg_us = wq_stats[prio].runs ? wq_stats[prio].total_us / wq_stats[prio].runs : 0;
+    stats->max_us = wq_stats[prio].max_us;
+
+    if (reset) {
+        memset(&wq_stats[prio], 0, sizeof(wq_stats[prio]));
+    }
+
+    irq_unlock(key);
+}
+
+const char *app_wq_name(enum app_wq_prio prio)
+{
+    return wq_cfg[prio].name;
+}
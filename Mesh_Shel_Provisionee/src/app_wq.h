@@ -0,0 +1,54 @@
+/*
+ * app_wq.h - Application work queues.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_WQ_H__
+#define APP_WQ_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+enum app_wq_prio {
+    APP_WQ_ACTUATION,       /* LEDs, button sends: user visible */
+    APP_WQ_TELEMETRY,       /* probes, sweeps, persistence */
+    APP_WQ_COUNT,
+};
+
+/* A delayable work item bound to one of the application queues. The
+ * handler gets &dwork.work, as for a plain k_work_delayable.
+ */
+struct app_work {
+    struct k_work_delayable dwork;
+    k_work_handler_t handler;
+    enum app_wq_prio prio;
+    uint32_t due;           /* cycle count the item should run at */
+};
+
+struct app_wq_stats {
+    uint32_t runs;
+    uint32_t avg_us;        /* queueing delay: run start - due time */
+    uint32_t max_us;
+};
+
+/* Start the queue threads. Call before any work is submitted. */
+void app_wq_init(void);
+
+void app_work_init(struct app_work *work, enum app_wq_prio prio,
+                   k_work_handler_t handler);
+
+/* Run the item delay_ms from now, replacing any pending schedule. */
+int app_work_reschedule(struct app_work *work, uint32_t delay_ms);
+
+static inline int app_work_submit(struct app_work *work)
+{
+    return app_work_reschedule(work, 0);
+}
+
+void app_wq_stats_get(enum app_wq_prio prio, struct app_wq_stats *stats, bool reset);
+
+const char *app_wq_name(enum app_wq_prio prio);
+
+#endif /* APP_WQ_H__ */
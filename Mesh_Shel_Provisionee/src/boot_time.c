@@ -0,0 +1,58 @@
+/*
+ * boot_time.c - Boot phase timestamps.
+ *
+ * Times are kernel uptime, so they start when the kernel starts and
+ * leave out the bootloader and the pre-kernel init. That part is fixed
+ * per image; everything after it depends on the application.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#include "boot_time.h"
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+    [BOOT_MAIN] = "main",
+    [BOOT_STATE] = "state",
+    [BOOT_BOARD] = "board",
+    [BOOT_BT] = "bt",
+    [BOOT_MESH_INIT] = "mesh_init",
+    [BOOT_SETTINGS] = "settings",
+    [BOOT_READY] = "ready",
+};
+
+static uint32_t phase_us[BOOT_PHASE_COUNT];
+
+void boot_mark(enum boot_phase phase)
+{
+    if (phase < BOOT_PHASE_COUNT && !phase_us[phase]) {
+        /* Never 0, that means "not reached" */
+        phase_us[phase] = MAX(k_ticks_to_us_floor32(k_uptime_ticks()), 1);
+    }
+}
+
+uint32_t boot_time_us(enum boot_phase phase)
+{
+    return phase < BOOT_PHASE_COUNT ? phase_us[phase] : 0;
+}
+
+const char *boot_phase_name(enum boot_phase phase)
+{
+    return phase < BOOT_PHASE_COUNT ? phase_names[phase] : "?";
+}
+
+void boot_print(void)
+{
+    uint32_t prev = 0;
+
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        if (!phase_us[i]) {
+            continue;
+        }
+        printk("BOOT %s %u us (+%u us)\n", phase_names[i], phase_us[i],
+               phase_us[i] - prev);
+        prev = phase_us[i];
+    }
+}
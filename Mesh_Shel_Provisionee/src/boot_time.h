@@ -0,0 +1,36 @@
+/*
+ * boot_time.h - Boot phase timestamps.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BOOT_TIME_H__
+#define BOOT_TIME_H__
+
+#include <stdint.h>
+
+enum boot_phase {
+    BOOT_MAIN,              /* main() entered */
+    BOOT_STATE,             /* application state restored */
+    BOOT_BOARD,             /* LED and button configured */
+    BOOT_BT,                /* controller and host up (bt_ready) */
+    BOOT_MESH_INIT,         /* bt_mesh_init() done */
+    BOOT_SETTINGS,          /* settings_load() done, mesh started if provisioned */
+    BOOT_READY,             /* relaying/serving, or open for provisioning */
+    BOOT_PHASE_COUNT,
+};
+
+/* Record the current uptime for a phase. Later marks of the same phase
+ * are ignored, so the first boot is what gets reported.
+ */
+void boot_mark(enum boot_phase phase);
+
+/* Microseconds since the kernel started, 0 if the phase was not reached. */
+uint32_t boot_time_us(enum boot_phase phase);
+
+const char *boot_phase_name(enum boot_phase phase);
+
+/* Print every phase as "BOOT <phase> <us> us (+<delta> us)". */
+void boot_print(void);
+
+#endif /* BOOT_TIME_H__ */
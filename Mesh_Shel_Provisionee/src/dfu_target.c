@@ -0,0 +1,153 @@
+/*
+ * dfu_target.c - Firmware Update Server for mesh nodes.
+ *
+ * Receives an image multicast by the distributor (push or pull BLOB
+ * transfer), streams it into slot1_partition and lets MCUboot swap to it
+ * when the distributor applies the update.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <app_version.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/reboot.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#if defined(CONFIG_MCUBOOT_IMG_MANAGER)
+#include <zephyr/dfu/mcuboot.h>
+#endif
+
+#include "dfu_target.h"
+
+#if defined(CONFIG_BT_MESH_DFU_SRV)
+
+/* Firmware ID the distributor compares against: "mesh_shell" followed
+ * by the major, minor, patch level and tweak of the VERSION file. MCUboot
+ * signs the image with the same version, so every release reports its
+ * own ID and a target that did not swap still reports the old one.
+ */
+static const uint8_t fwid[] = {
+    'm', 'e', 's', 'h', '_', 's', 'h', 'e', 'l', 'l',
+    APP_VERSION_MAJOR, APP_VERSION_MINOR, APP_PATCHLEVEL, APP_TWEAK,
+};
+
+/* Lets the server send its Apply Status and store the update state */
+#define DFU_REBOOT_DELAY_MS 1000
+
+static struct bt_mesh_blob_io_flash blob_flash_stream;
+static struct k_work_delayable reboot_work;
+static int64_t xfer_start;
+
+static struct bt_mesh_dfu_img dfu_imgs[] = {
+    {
+        .fwid = fwid,
+        .fwid_len = sizeof(fwid),
+    },
+};
+
+static int dfu_meta_check(struct bt_mesh_dfu_srv *srv,
+                          const struct bt_mesh_dfu_img *img,
+                          struct net_buf_simple *metadata,
+                          enum bt_mesh_dfu_effect *effect)
+{
+    /* Same composition before and after: no re-provisioning needed. */
+    *effect = BT_MESH_DFU_EFFECT_NONE;
+    return 0;
+}
+
+static int dfu_start(struct bt_mesh_dfu_srv *srv,
+                     const struct bt_mesh_dfu_img *img,
+                     struct net_buf_simple *metadata,
+                     const struct bt_mesh_blob_io **io)
+{
+    xfer_start = k_uptime_get();
+    printk("DFU: transfer started\n");
+
+    *io = &blob_flash_stream.io;
+    return 0;
+}
+
+static void dfu_end(struct bt_mesh_dfu_srv *srv,
+                    const struct bt_mesh_dfu_img *img, bool success)
+{
+    printk("DFU: transfer %s after %lld ms\n", success ? "done" : "failed",
+           k_uptime_get() - xfer_start);
+
+    if (!success) {
+        return;
+    }
+
+    /* Image integrity is checked by MCUboot at swap time. */
+    bt_mesh_dfu_srv_verified(srv);
+}
+
+static void reboot_work_handler(struct k_work *work)
+{
+    sys_reboot(SYS_REBOOT_COLD);
+}
+
+static int dfu_apply(struct bt_mesh_dfu_srv *srv,
+                     const struct bt_mesh_dfu_img *img)
+{
+#if defined(CONFIG_MCUBOOT_IMG_MANAGER)
+    int err = boot_request_upgrade(BOOT_UPGRADE_TEST);
+
+    if (err) {
+        printk("DFU: upgrade request failed (err %d)\n", err);
+        return err;
+    }
+
+    /* Reported applied by the new image, once it confirmed itself */
+    printk("DFU: applying, rebooting into the new image\n");
+    k_work_schedule(&reboot_work, K_MSEC(DFU_REBOOT_DELAY_MS));
+    return 0;
+#else
+    printk("DFU: no bootloader support, image kept in slot1\n");
+    return -ENOTSUP;
+#endif
+}
+
+static const struct bt_mesh_dfu_srv_cb dfu_handlers = {
+    .check = dfu_meta_check,
+    .start = dfu_start,
+    .end   = dfu_end,
+    .apply = dfu_apply,
+};
+
+struct bt_mesh_dfu_srv dfu_srv =
+    BT_MESH_DFU_SRV_INIT(&dfu_handlers, dfu_imgs, ARRAY_SIZE(dfu_imgs));
+
+int dfu_target_init(void)
+{
+    k_work_init_delayable(&reboot_work, reboot_work_handler);
+
+    return bt_mesh_blob_io_flash_init(&blob_flash_stream,
+                                      FIXED_PARTITION_ID(slot1_partition), 0);
+}
+
+void dfu_target_confirm(void)
+{
+#if defined(CONFIG_MCUBOOT_IMG_MANAGER)
+    int err;
+
+    /* Running a test image after an update: keep it, and let the server
+     * report the update applied to the distributor.
+     */
+    if (boot_is_img_confirmed()) {
+        return;
+    }
+
+    err = boot_write_img_confirmed();
+    if (err) {
+        printk("DFU: image confirm failed (err %d)\n", err);
+        return;
+    }
+
+    printk("DFU: new image confirmed\n");
+    bt_mesh_dfu_srv_applied(&dfu_srv);
+#endif
+}
+
+#endif /* CONFIG_BT_MESH_DFU_SRV */
@@ -0,0 +1,33 @@
+/*
+ * dfu_target.h - Firmware Update Server for mesh nodes.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DFU_TARGET_H__
+#define DFU_TARGET_H__
+
+#include <zephyr/bluetooth/mesh.h>
+
+#if defined(CONFIG_BT_MESH_DFU_SRV)
+extern struct bt_mesh_dfu_srv dfu_srv;
+
+/* Prepare the flash stream for incoming images. Call before bt_mesh_init(). */
+int dfu_target_init(void);
+
+/* Confirm a freshly swapped image and report the update applied. Call
+ * after settings_load(), which restores the server's update state.
+ */
+void dfu_target_confirm(void);
+#else
+static inline int dfu_target_init(void)
+{
+    return 0;
+}
+
+static inline void dfu_target_confirm(void)
+{
+}
+#endif
+
+#endif /* DFU_TARGET_H__ */
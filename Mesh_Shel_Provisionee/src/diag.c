@@ -0,0 +1,251 @@
+/*
+ * diag.c - Thread, stack and buffer pool instrumentation.
+ *
+ * Everything here depends on kernel options that cost RAM and cycles, so
+ * they are only enabled by instrumentation.conf. In a normal build the
+ * fields read as DIAG_UNKNOWN, or no entries are reported at all.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net_buf.h>
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#if defined(CONFIG_SYMTAB)
+#include <zephyr/debug/symtab.h>
+#endif
+
+#include "diag.h"
+
+static void diag_name(char *dst, const char *src)
+{
+    memset(dst, 0, DIAG_NAME_LEN);
+    if (src) {
+        strncpy(dst, src, DIAG_NAME_LEN);
+    }
+}
+
+/* ---------------------------------------------------------------------
+ * Threads
+ * --------------------------------------------------------------------- */
+#if defined(CONFIG_THREAD_MONITOR)
+
+/* Cycle counts of the previous query, to report CPU use per interval */
+static struct {
+    const struct k_thread *thread;
+    uint64_t cycles;
+} cpu_prev[DIAG_ENTRIES_MAX];
+static uint64_t cpu_prev_total;
+
+struct threads_ctx {
+    struct diag_thread *threads;
+    size_t max;
+    size_t count;
+    uint64_t total;             /* cycles since the previous query */
+    const struct k_thread *thread[DIAG_ENTRIES_MAX];
+    uint64_t cycles[DIAG_ENTRIES_MAX];
+};
+
+static uint16_t stack_used(struct k_thread *thread)
+{
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+    size_t unused;
+
+    if (k_thread_stack_space_get(thread, &unused) == 0) {
+        return MIN(thread->stack_info.size - unused, DIAG_UNKNOWN - 1);
+    }
+#endif
+    return DIAG_UNKNOWN;
+}
+
+static uint16_t cpu_permille(const struct threads_ctx *ctx, const struct k_thread *thread,
+                             uint64_t cycles)
+{
+    /* Not seen by the previous query: its cycles since boot would be
+     * compared with one interval, so this sample is skipped
+     */
+    for (size_t i = 0; i < ARRAY_SIZE(cpu_prev); i++) {
+        if (cpu_prev[i].thread != thread) {
+            continue;
+        }
+        if (!ctx->total || cycles < cpu_prev[i].cycles) {
+            return 0;
+        }
+        return MIN((cycles - cpu_prev[i].cycles) * 1000 / ctx->total, 1000);
+    }
+
+    return DIAG_UNKNOWN;
+}
+
+static void thread_cb(const struct k_thread *cthread, void *user_data)
+{
+    struct k_thread *thread = (struct k_thread *)cthread;
+    struct threads_ctx *ctx = user_data;
+    struct diag_thread *entry;
+
+    if (ctx->count >= ctx->max) {
+        return;
+    }
+
+    entry = &ctx->threads[ctx->count];
+    diag_name(entry->name, k_thread_name_get(thread));
+#if defined(CONFIG_THREAD_STACK_INFO)
+    entry->stack_size = MIN(thread->stack_info.size, DIAG_UNKNOWN - 1);
+#else
+    entry->stack_size = DIAG_UNKNOWN;
+#endif
+    entry->stack_used = stack_used(thread);
+    entry->cpu_permille = DIAG_UNKNOWN;
+
+#if defined(CONFIG_THREAD_RUNTIME_STATS)
+    k_thread_runtime_stats_t stats;
+
+    if (k_thread_runtime_stats_get(thread, &stats) == 0) {
+        entry->cpu_permille = cpu_permille(ctx, thread, stats.execution_cycles);
+        ctx->thread[ctx->count] = thread;
+        ctx->cycles[ctx->count] = stats.execution_cycles;
+    }
+#endif
+
+    ctx->count++;
+}
+
+#if defined(CONFIG_INIT_STACKS)
+K_KERNEL_STACK_ARRAY_DECLARE(z_interrupt_stacks, CONFIG_MP_MAX_NUM_CPUS,
+                             CONFIG_ISR_STACK_SIZE);
+
+/* The ISR stack is not a thread; count the untouched fill pattern from
+ * its low end like k_thread_stack_space_get() does for threads.
+ */
+static void isr_stack_get(struct diag_thread *entry)
+{
+    const uint8_t *stack = (const uint8_t *)K_KERNEL_STACK_BUFFER(z_interrupt_stacks[0]);
+    size_t size = K_KERNEL_STACK_SIZEOF(z_interrupt_stacks[0]);
+    size_t unused = 0;
+
+    while (unused < size && stack[unused] == 0xaa) {
+        unused++;
+    }
+
+    diag_name(entry->name, "isr");
+    entry->stack_size = MIN(size, DIAG_UNKNOWN - 1);
+    entry->stack_used = MIN(size - unused, DIAG_UNKNOWN - 1);
+    entry->cpu_permille = DIAG_UNKNOWN;
+}
+#endif
+
+size_t diag_threads_get(struct diag_thread *threads, size_t max)
+{
+    struct threads_ctx ctx = {
+        .threads = threads,
+        .max = MIN(max, DIAG_ENTRIES_MAX),
+    };
+
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+    k_thread_runtime_stats_t all;
+
+    if (k_thread_runtime_stats_all_get(&all) == 0) {
+        ctx.total = all.execution_cycles - cpu_prev_total;
+        cpu_prev_total = all.execution_cycles;
+    }
+#endif
+
+    k_thread_foreach_unlocked(thread_cb, &ctx);
+
+    /* Remember this query's cycles for the next one */
+    memset(cpu_prev, 0, sizeof(cpu_prev));
+    for (size_t i = 0; i < ctx.count; i++) {
+        cpu_prev[i].thread = ctx.thread[i];
+        cpu_prev[i].cycles = ctx.cycles[i];
+    }
+
+#if defined(CONFIG_INIT_STACKS)
+    if (ctx.count < ctx.max) {
+        isr_stack_get(&threads[ctx.count++]);
+    }
+#endif
+
+    return ctx.count;
+}
+
+#else
+
+size_t diag_threads_get(struct diag_thread *threads, size_t max)
+{
+    ARG_UNUSED(threads);
+    ARG_UNUSED(max);
+    return 0;
+}
+
+#endif /* CONFIG_THREAD_MONITOR */
+
+/* ---------------------------------------------------------------------
+ * Buffer pools
+ * --------------------------------------------------------------------- */
+
+/* Slabs have no name of their own. With the symbol table they are named
+ * after their variable ("local_adv_pool" for the mesh advertising
+ * buffers), otherwise numbered in link order.
+ */
+static void slab_name(const struct k_mem_slab *slab, unsigned int index, char *name,
+                      size_t len)
+{
+#if defined(CONFIG_SYMTAB)
+    uint32_t offset;
+    const char *symbol = symtab_find_symbol_name((uintptr_t)slab, &offset);
+
+    if (offset == 0 && strcmp(symbol, "?") != 0) {
+        snprintk(name, len, "%s", symbol);
+        return;
+    }
+#endif
+    snprintk(name, len, "slab%u", index);
+}
+
+size_t diag_pools_get(struct diag_pool *pools, size_t max)
+{
+    size_t count = 0;
+    unsigned int index = 0;
+
+    STRUCT_SECTION_FOREACH(k_mem_slab, slab) {
+        struct diag_pool *entry = &pools[count];
+        char name[DIAG_NAME_LEN + 1];
+
+        if (count >= max) {
+            return count;
+        }
+
+        slab_name(slab, index++, name, sizeof(name));
+        diag_name(entry->name, name);
+        entry->count = slab->info.num_blocks;
+        entry->used = k_mem_slab_num_used_get(slab);
+#if defined(CONFIG_MEM_SLAB_TRACE_MAX_UTILIZATION)
+        entry->max_used = k_mem_slab_max_used_get(slab);
+#else
+        entry->max_used = DIAG_UNKNOWN;
+#endif
+        count++;
+    }
+
+#if defined(CONFIG_NET_BUF_POOL_USAGE)
+    STRUCT_SECTION_FOREACH(net_buf_pool, pool) {
+        struct diag_pool *entry = &pools[count];
+
+        if (count >= max) {
+            return count;
+        }
+
+        diag_name(entry->name, pool->name);
+        entry->count = pool->buf_count;
+        entry->used = pool->buf_count - atomic_get(&pool->avail_count);
+        entry->max_used = pool->max_used;
+        count++;
+    }
+#endif
+
+    return count;
+}
@@ -0,0 +1,46 @@
+/*
+ * diag.h - Thread, stack and buffer pool instrumentation.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DIAG_H__
+#define DIAG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Names are truncated to fit the vendor Diag Status message */
+#define DIAG_NAME_LEN 8
+#define DIAG_ENTRIES_MAX 16
+
+/* Value of a field the current build does not track */
+#define DIAG_UNKNOWN UINT16_MAX
+
+struct diag_thread {
+    char name[DIAG_NAME_LEN];
+    uint16_t stack_size;
+    uint16_t stack_used;        /* high-water mark, bytes */
+    uint16_t cpu_permille;      /* share of cycles since the last query */
+};
+
+struct diag_pool {
+    char name[DIAG_NAME_LEN];
+    uint16_t count;
+    uint16_t used;
+    uint16_t max_used;
+};
+
+/* Fill up to max entries, one per thread plus the ISR stack. CPU use is
+ * measured since the previous call, and DIAG_UNKNOWN for a thread that
+ * call did not see (every thread on the first call).
+ * Returns the number of entries.
+ */
+size_t diag_threads_get(struct diag_thread *threads, size_t max);
+
+/* Fill up to max entries with the memory slabs (the mesh advertising
+ * buffers are slabs) followed by the net_buf pools, by name.
+ */
+size_t diag_pools_get(struct diag_pool *pools, size_t max);
+
+#endif /* DIAG_H__ */
@@ -0,0 +1,191 @@
+/*
+ * disc.c - Fast discovery of an unprovisioned node.
+ *
+ * A freshly reset node is usually waiting for someone at the host to
+ * press Refresh, so it should be heard right away: during the fast window
+ * it has both provisioning bearers on, with the unprovisioned beacon
+ * sent every CONFIG_BT_MESH_UNPROV_BEACON_INT (1 s in prj.conf). Nodes
+ * nobody provisioned then back off to short bursts with growing pauses,
+ * so a batch of forgotten nodes does not fill the channel forever.
+ *
+ * Only PB-ADV is cycled. Enabling it sends a beacon at once, so every
+ * burst is heard even when it is shorter than the beacon interval.
+ * Disabling PB-GATT would unregister the service under a provisioner
+ * that is connected at that moment; it stays on, and the stack already
+ * slows its connectable advertising down after the first minute.
+ *
+ * Disabling PB-ADV also stops the scanner, which would cut a PB-ADV or
+ * remote provisioning link in the middle of provisioning. While a link
+ * is open the pause waits for it to close.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/bluetooth/mesh.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#include "app_state.h"
+#include "app_wq.h"
+#include "disc.h"
+
+#define DISC_BEARERS  (BT_MESH_PROV_ADV | BT_MESH_PROV_GATT)
+#define DISC_FIRST_OFF_S 2
+
+static struct disc_cfg cfg = {
+    .fast_s = DISC_FAST_S,
+    .max_off_s = DISC_MAX_OFF_S,
+};
+
+static struct app_state cfg_persist = {
+    .key = "disc",
+    .data = &cfg,
+    .len = sizeof(cfg),
+};
+
+enum {
+    DISC_LINK_OPEN,         /* a provisioning link is up */
+    DISC_HELD,              /* a pause waits for the link to close */
+};
+
+static struct {
+    struct app_work work;
+    enum disc_state state;
+    uint16_t off_s;
+    int64_t started;
+    atomic_t flags;
+} disc;
+
+static const char *const state_names[] = {
+    [DISC_IDLE] = "idle",
+    [DISC_FAST] = "fast",
+    [DISC_BURST] = "burst",
+    [DISC_PAUSE] = "pause",
+    [DISC_DONE] = "done",
+};
+
+static int bearers_on(bt_mesh_prov_bearer_t bearers)
+{
+    int err = bt_mesh_prov_enable(bearers);
+
+    return err == -EALREADY ? 0 : err;
+}
+
+static void bearers_off(bt_mesh_prov_bearer_t bearers)
+{
+    (void)bt_mesh_prov_disable(bearers);
+}
+
+static void disc_work_handler(struct k_work *work)
+{
+    if (bt_mesh_is_provisioned()) {
+        disc.state = DISC_DONE;
+        printk("DISC provisioned after %lld ms\n", k_uptime_get() - disc.started);
+        return;
+    }
+
+    switch (disc.state) {
+    case DISC_FAST:
+    case DISC_BURST:
+        /* Held before the check, so a link closing in between sees it */
+        atomic_set_bit(&disc.flags, DISC_HELD);
+        if (atomic_test_bit(&disc.flags, DISC_LINK_OPEN)) {
+            return;
+        }
+        atomic_clear_bit(&disc.flags, DISC_HELD);
+
+        bearers_off(BT_MESH_PROV_ADV);
+        disc.state = DISC_PAUSE;
+        app_work_reschedule(&disc.work, disc.off_s * MSEC_PER_SEC);
+        disc.off_s = MIN(disc.off_s * 2, MAX(cfg.max_off_s, DISC_FIRST_OFF_S));
+        break;
+    case DISC_PAUSE:
+        if (bearers_on(BT_MESH_PROV_ADV)) {
+            disc.state = DISC_IDLE;
+            return;
+        }
+        disc.state = DISC_BURST;
+        app_work_reschedule(&disc.work, DISC_BURST_MS);
+        break;
+    default:
+        break;
+    }
+}
+
+void disc_init(void)
+{
+    app_work_init(&disc.work, APP_WQ_TELEMETRY, disc_work_handler);
+    app_state_register(&cfg_persist);
+}
+
+int disc_start(void)
+{
+    int err;
+
+    if (bt_mesh_is_provisioned()) {
+        return -EALREADY;
+    }
+
+    err = bearers_on(DISC_BEARERS);
+    if (err) {
+        return err;
+    }
+
+    atomic_clear_bit(&disc.flags, DISC_HELD);
+    disc.state = DISC_FAST;
+    disc.off_s = DISC_FIRST_OFF_S;
+    disc.started = k_uptime_get();
+    app_work_reschedule(&disc.work, cfg.fast_s * MSEC_PER_SEC);
+    return 0;
+}
+
+void disc_stop(void)
+{
+    (void)k_work_cancel_delayable(&disc.work.dwork);
+    if (disc.state != DISC_IDLE && disc.state != DISC_DONE) {
+        bearers_off(DISC_BEARERS);
+        disc.state = DISC_IDLE;
+    }
+}
+
+void disc_link_open(void)
+{
+    atomic_set_bit(&disc.flags, DISC_LINK_OPEN);
+}
+
+void disc_link_close(void)
+{
+    atomic_clear_bit(&disc.flags, DISC_LINK_OPEN);
+    if (atomic_test_and_clear_bit(&disc.flags, DISC_HELD)) {
+        app_work_submit(&disc.work);
+    }
+}
+
+void disc_cfg_get(struct disc_cfg *out)
+{
+    *out = cfg;
+}
+
+int disc_cfg_set(const struct disc_cfg *in)
+{
+    if (!in->fast_s || !in->max_off_s) {
+        return -EINVAL;
+    }
+
+    cfg = *in;
+    app_state_changed(&cfg_persist);
+    return 0;
+}
+
+enum disc_state disc_state_get(void)
+{
+    return disc.state;
+}
+
+const char *disc_state_name(enum disc_state state)
+{
+    return state < ARRAY_SIZE(state_names) ? state_names[state] : "?";
+}
@@ -0,0 +1,54 @@
+/*
+ * disc.h - Fast discovery of an unprovisioned node.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DISC_H__
+#define DISC_H__
+
+#include <stdint.h>
+
+/* Defaults, in seconds */
+#define DISC_FAST_S     30  /* both bearers on, beacon every second */
+#define DISC_MAX_OFF_S  60  /* longest pause between bursts after that */
+
+/* Length of one advertising burst during backoff */
+#define DISC_BURST_MS   2500
+
+struct disc_cfg {
+    uint16_t fast_s;
+    uint16_t max_off_s;
+};
+
+enum disc_state {
+    DISC_IDLE,
+    DISC_FAST,
+    DISC_BURST,
+    DISC_PAUSE,
+    DISC_DONE,              /* provisioned */
+};
+
+/* Register the persisted configuration. Call before app_state_load(). */
+void disc_init(void);
+
+/* Advertise for provisioning on PB-ADV and PB-GATT: continuously for
+ * fast_s seconds, then PB-ADV in bursts separated by pauses that double
+ * up to max_off_s. Stops by itself once the node is provisioned.
+ */
+int disc_start(void);
+void disc_stop(void);
+
+/* Provisioning link state, from the bt_mesh_prov link callbacks. A burst
+ * or the fast window only ends once the link has closed.
+ */
+void disc_link_open(void);
+void disc_link_close(void);
+
+void disc_cfg_get(struct disc_cfg *cfg);
+int disc_cfg_set(const struct disc_cfg *cfg);
+
+enum disc_state disc_state_get(void);
+const char *disc_state_name(enum disc_state state);
+
+#endif /* DISC_H__ */
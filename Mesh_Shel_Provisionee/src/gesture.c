@@ -0,0 +1,94 @@
+/*
+ * gesture.c - Debounced button gestures.
+ *
+ * Every edge restarts the debounce timer, so contact bounce collapses
+ * into one reading of the settled level. Presses are then grouped: a
+ * press held for GESTURE_LONG_MS is a long press, otherwise the presses
+ * ending within GESTURE_DOUBLE_MS of each other form one single or double
+ * press. Further presses in the same window are absorbed into the double
+ * press, so hammering the button still yields one gesture.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+
+#include "app_wq.h"
+#include "gesture.h"
+
+static struct {
+    gesture_read_t read;
+    gesture_cb_t cb;
+    struct app_work debounce_work;
+    struct app_work gesture_work;
+    bool pressed;           /* settled level */
+    bool long_fired;        /* current press already reported as long */
+    uint8_t presses;
+} btn;
+
+static const char *const gesture_names[GESTURE_COUNT] = {
+    [GESTURE_SINGLE] = "single",
+    [GESTURE_DOUBLE] = "double",
+    [GESTURE_LONG] = "long",
+};
+
+static void debounce_handler(struct k_work *work)
+{
+    bool pressed = btn.read();
+
+    if (pressed == btn.pressed) {
+        return;
+    }
+    btn.pressed = pressed;
+
+    if (pressed) {
+        if (btn.presses < UINT8_MAX) {
+            btn.presses++;
+        }
+        app_work_reschedule(&btn.gesture_work, GESTURE_LONG_MS);
+        return;
+    }
+
+    if (btn.long_fired) {
+        btn.long_fired = false;
+        btn.presses = 0;
+        return;
+    }
+
+    /* Wait for a second press before deciding */
+    app_work_reschedule(&btn.gesture_work, GESTURE_DOUBLE_MS);
+}
+
+static void gesture_handler(struct k_work *work)
+{
+    enum gesture gesture;
+
+    if (btn.pressed) {
+        /* Still held: long press, reported once while held */
+        btn.long_fired = true;
+        gesture = GESTURE_LONG;
+    } else {
+        gesture = btn.presses > 1 ? GESTURE_DOUBLE : GESTURE_SINGLE;
+    }
+
+    btn.presses = 0;
+    btn.cb(gesture);
+}
+
+void gesture_init(gesture_read_t read, gesture_cb_t cb)
+{
+    btn.read = read;
+    btn.cb = cb;
+    app_work_init(&btn.debounce_work, APP_WQ_ACTUATION, debounce_handler);
+    app_work_init(&btn.gesture_work, APP_WQ_ACTUATION, gesture_handler);
+}
+
+void gesture_edge(void)
+{
+    app_work_reschedule(&btn.debounce_work, GESTURE_DEBOUNCE_MS);
+}
+
+const char *gesture_name(enum gesture gesture)
+{
+    return gesture < GESTURE_COUNT ? gesture_names[gesture] : "?";
+}
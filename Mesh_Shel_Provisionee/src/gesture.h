@@ -0,0 +1,37 @@
+/*
+ * gesture.h - Debounced button gestures.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef GESTURE_H__
+#define GESTURE_H__
+
+#include <stdbool.h>
+
+enum gesture {
+    GESTURE_SINGLE,
+    GESTURE_DOUBLE,
+    GESTURE_LONG,
+    GESTURE_COUNT,
+};
+
+/* Debounce and gesture windows, in milliseconds */
+#define GESTURE_DEBOUNCE_MS 30
+#define GESTURE_DOUBLE_MS   350
+#define GESTURE_LONG_MS     800
+
+/* Returns true while the button is pressed. */
+typedef bool (*gesture_read_t)(void);
+
+/* Called on the actuation work queue, once per gesture. */
+typedef void (*gesture_cb_t)(enum gesture gesture);
+
+void gesture_init(gesture_read_t read, gesture_cb_t cb);
+
+/* Report a button edge; safe to call from the GPIO interrupt. */
+void gesture_edge(void);
+
+const char *gesture_name(enum gesture gesture);
+
+#endif /* GESTURE_H__ */
@@ -21,9 +21,22 @@
 
 #include <zephyr/shell/shell.h>
 #include <zephyr/shell/shell_uart.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/random/random.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
+#include "app_state.h"
+#include "app_wq.h"
+#include "boot_time.h"
+#include "dfu_target.h"
+#include "disc.h"
+#include "gesture.h"
+#include "scene.h"
+#include "unprov_scan.h"
+#include "vnd_model.h"
+
 /* ---------------------------------------------------------------------
  * OnOff opcodes
  * --------------------------------------------------------------------- */
@@ -61,7 +74,157 @@ static const struct device *btn_dev;
 /* ---------------------------------------------------------------------
  * Defines and values for multiple server and client models
  * --------------------------------------------------------------------- */
-static struct bt_mesh_cfg_cli cfg_cli; // optional if you want to do config ops
+/* Config Client status callbacks. Replies to requests sent without a
+ * status pointer (many nodes at once, see "txp") arrive here; print them
+ * in a fixed form the host can parse.
+ */
+static void cfg_net_transmit_status(struct bt_mesh_cfg_cli *cli, uint16_t addr,
+                                    uint8_t status)
+{
+    printk("TXP 0x%04x net count %u interval %u\n", addr,
+           BT_MESH_TRANSMIT_COUNT(status), BT_MESH_TRANSMIT_INT(status));
+}
+
+static void cfg_relay_status(struct bt_mesh_cfg_cli *cli, uint16_t addr,
+                             uint8_t status, uint8_t transmit)
+{
+    printk("TXP 0x%04x relay %u count %u interval %u\n", addr, status,
+           BT_MESH_TRANSMIT_COUNT(transmit), BT_MESH_TRANSMIT_INT(transmit));
+}
+
+/* Model ids as the host writes them: SIG models as 0xMMMM, vendor models
+ * as 0xCCCCMMMM with the company id in the upper half.
+ */
+static uint32_t cfg_model_key(uint16_t mod_id, uint16_t cid)
+{
+    return cid == BT_MESH_CID_NVAL ? mod_id : ((uint32_t)cid << 16) | mod_id;
+}
+
+/* Print a key index or address list as "a,b,c", or "-" when empty. A
+ * list that does not fit vals[] prints "error", so it is not read as an
+ * empty or shorter one.
+ */
+static void cfg_print_list(const char *prefix, struct net_buf_simple *buf, bool key_idx)
+{
+    char line[128];
+    uint16_t vals[CONFIG_BT_MESH_MODEL_GROUP_COUNT + CONFIG_BT_MESH_APP_KEY_COUNT];
+    size_t count = ARRAY_SIZE(vals);
+    int len;
+
+    if (key_idx) {
+        if (bt_mesh_key_idx_unpack_list(buf, vals, &count)) {
+            printk("%s error\n", prefix);
+            return;
+        }
+    } else {
+        if (buf->len / 2 > count) {
+            printk("%s error\n", prefix);
+            return;
+        }
+        count = buf->len / 2;
+        for (size_t i = 0; i < count; i++) {
+            vals[i] = net_buf_simple_pull_le16(buf);
+        }
+    }
+
+    len = snprintk(line, sizeof(line), "%s %s", prefix, count ? "" : "-");
+    for (size_t i = 0; i < count && len < (int)sizeof(line); i++) {
+        len += snprintk(&line[len], sizeof(line) - len, i ? ",0x%04x" : "0x%04x", vals[i]);
+    }
+
+    printk("%s\n", line);
+}
+
+static void cfg_app_key_list(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+                             uint16_t net_idx, struct net_buf_simple *buf)
+{
+    char prefix[40];
+
+    snprintk(prefix, sizeof(prefix), "CFG 0x%04x appkeys", addr);
+    cfg_print_list(prefix, buf, true);
+}
+
+static void cfg_mod_app_list(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+                             uint16_t elem_addr, uint16_t mod_id, uint16_t cid,
+                             struct net_buf_simple *buf)
+{
+    char prefix[40];
+
+    snprintk(prefix, sizeof(prefix), "CFG 0x%04x bind 0x%04x", addr,
+             cfg_model_key(mod_id, cid));
+    cfg_print_list(prefix, buf, true);
+}
+
+static void cfg_mod_sub_list(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+                             uint16_t elem_addr, uint16_t mod_id, uint16_t cid,
+                             struct net_buf_simple *buf)
+{
+    char prefix[40];
+
+    snprintk(prefix, sizeof(prefix), "CFG 0x%04x sub 0x%04x", addr,
+             cfg_model_key(mod_id, cid));
+    cfg_print_list(prefix, buf, false);
+}
+
+static void cfg_mod_pub_status(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+                               uint16_t elem_addr, uint16_t mod_id, uint16_t cid,
+                               struct bt_mesh_cfg_cli_mod_pub *pub)
+{
+    printk("CFG 0x%04x pub 0x%04x dst 0x%04x app %u period %u status %u\n", addr,
+           cfg_model_key(mod_id, cid), pub ? pub->addr : 0, pub ? pub->app_idx : 0,
+           pub ? pub->period : 0, status);
+}
+
+static void cfg_hb_pub_status(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+                              struct bt_mesh_cfg_cli_hb_pub *pub)
+{
+    printk("CFG 0x%04x hb dst 0x%04x period %u status %u\n", addr,
+           pub ? pub->dst : 0, pub ? pub->period : 0, status);
+}
+
+static void cfg_status(const char *what, uint16_t addr, uint8_t status)
+{
+    if (status) {
+        printk("CFG 0x%04x %s status %u\n", addr, what, status);
+    }
+}
+
+static void cfg_app_key_status(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+                               uint16_t net_idx, uint16_t app_idx)
+{
+    cfg_status("appkey", addr, status);
+}
+
+static void cfg_mod_app_status(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+                               uint16_t elem_addr, uint16_t app_idx, uint32_t mod_id)
+{
+    cfg_status("bind", addr, status);
+}
+
+static void cfg_mod_sub_status(struct bt_mesh_cfg_cli *cli, uint16_t addr, uint8_t status,
+                               uint16_t elem_addr, uint16_t sub_addr, uint32_t mod_id)
+{
+    cfg_status("sub", addr, status);
+}
+
+static const struct bt_mesh_cfg_cli_cb cfg_cli_cb = {
+    .network_transmit_status = cfg_net_transmit_status,
+    .relay_status = cfg_relay_status,
+    .app_key_list = cfg_app_key_list,
+    .app_key_status = cfg_app_key_status,
+    .mod_app_list = cfg_mod_app_list,
+    .mod_app_status = cfg_mod_app_status,
+    .mod_sub_list = cfg_mod_sub_list,
+    .mod_sub_status = cfg_mod_sub_status,
+    .mod_pub_status = cfg_mod_pub_status,
+    .hb_pub_status = cfg_hb_pub_status,
+};
+
+static struct bt_mesh_cfg_cli cfg_cli = {
+    .cb = &cfg_cli_cb,
+};
+
+static struct bt_mesh_sar_cfg_cli sar_cfg_cli;
 
 BT_MESH_SHELL_HEALTH_PUB_DEFINE(health_pub);
 
@@ -71,6 +234,21 @@ static struct {
     uint8_t tid;
 } g_onoff_state;
 
+/* A changed OnOff state is published as an OnOff Status, so the host
+ * learns about it without polling. See onoff_state_publish().
+ */
+static int onoff_pub_update(const struct bt_mesh_model *model);
+static void onoff_state_publish(void);
+
+BT_MESH_MODEL_PUB_DEFINE(onoff_pub, onoff_pub_update, 2 + 1);
+
+/* The OnOff state survives a reboot; stores are coalesced. */
+static struct app_state onoff_persist = {
+    .key = "onoff",
+    .data = &g_onoff_state.val,
+    .len = sizeof(g_onoff_state.val),
+};
+
 /* Health server callbacks (if you want them) */
 static const struct bt_mesh_health_srv_cb health_cb = {
     .attn_on = NULL,
@@ -81,12 +259,87 @@ static struct bt_mesh_health_srv health_srv = {
     .cb = &health_cb,
 };
 
+/* Remote Provisioning Client: print every device an RPR server reports,
+ * with the RSSI that server saw, so the host can pick the closest one.
+ */
+static void rpr_scan_report(struct bt_mesh_rpr_cli *cli,
+                            const struct bt_mesh_rpr_node *srv,
+                            struct bt_mesh_rpr_unprov *unprov,
+                            struct net_buf_simple *adv_data)
+{
+    char uuid_hex[32 + 1];
+
+    bin2hex(unprov->uuid, 16, uuid_hex, sizeof(uuid_hex));
+    printk("RPR scan: srv 0x%04x uuid %s oob 0x%04x rssi %d\n",
+           srv->addr, uuid_hex, unprov->oob, unprov->rssi);
+}
+
+static struct bt_mesh_rpr_cli rpr_cli = {
+    .scan_report = rpr_scan_report,
+};
+
+/* ---------------------------------------------------------------------
+ * Link probe: OnOff Get round trips to a set of nodes
+ * --------------------------------------------------------------------- */
+#define PROBE_TARGETS_MAX 16
+
+struct probe_target {
+    uint16_t addr;
+    uint16_t sent;
+    uint16_t received;
+    uint32_t rtt_sum;
+    uint32_t rtt_max;
+    int64_t sent_at;    /* 0 while no Get is outstanding */
+};
+
+static struct {
+    struct probe_target targets[PROBE_TARGETS_MAX];
+    size_t count;
+    size_t next;        /* Target of the next Get */
+    uint16_t rounds;
+    uint16_t round;
+    uint16_t interval_ms;
+    bool active;
+    struct app_work work;
+} probe;
+
+/* Match an OnOff Status to the outstanding Get of a probed node. */
+static bool probe_rx(uint16_t addr)
+{
+    if (!probe.active) {
+        return false;
+    }
+
+    for (size_t i = 0; i < probe.count; i++) {
+        struct probe_target *t = &probe.targets[i];
+        uint32_t rtt;
+
+        if (t->addr != addr || !t->sent_at) {
+            continue;
+        }
+
+        rtt = k_uptime_get() - t->sent_at;
+        t->sent_at = 0;
+        t->received++;
+        t->rtt_sum += rtt;
+        t->rtt_max = MAX(t->rtt_max, rtt);
+        return true;
+    }
+
+    return false;
+}
+
 /* OnOff Client model callback: we only handle the Status opcode. */
 static int onoff_client_status_cb(const struct bt_mesh_model *model,
                                   struct bt_mesh_msg_ctx *ctx,
                                   struct net_buf_simple *buf)
 {
     uint8_t state_val = net_buf_simple_pull_u8(buf);
+
+    if (probe_rx(ctx->addr)) {
+        return 0;
+    }
+
     printk("Received Led Status from 0x%04x: %u\n", ctx->addr, state_val);
     return 0;
 }
@@ -96,6 +349,15 @@ static const struct bt_mesh_model_op onoff_cli_op[] = {
     BT_MESH_MODEL_OP_END,
 };
 
+/* Drive the LED to the current OnOff state. */
+static struct app_work led_work;
+
+static void led_work_handler(struct k_work *work)
+{
+    gpio_pin_set(led_dev, LED0_PIN, g_onoff_state.val);
+    printk("Turning the led: new_val=%u\n", g_onoff_state.val);
+}
+
 /* OnOff Server callbacks (GET/SET ops). */
 static int onoff_srv_get_cb(const struct bt_mesh_model *model,
                             struct bt_mesh_msg_ctx *ctx,
@@ -117,11 +379,17 @@ static int onoff_srv_set_unack_cb(const struct bt_mesh_model *model,
     uint8_t new_val = net_buf_simple_pull_u8(buf);
     /* 2nd byte is TID typically, skip or store if you want. */
 
+    /* Any direct change leaves the recalled scene */
+    scene_srv_invalidate();
+
     if (new_val != g_onoff_state.val) {
         g_onoff_state.val = new_val;
-        /* Toggle local LED for demonstration. */
-        gpio_pin_set(led_dev, LED0_PIN, new_val);
-        printk("Turning the led: new_val=%u\n", new_val);
+        /* The GPIO write and print happen on the actuation queue, not
+         * in the mesh RX path.
+         */
+        app_work_submit(&led_work);
+        app_state_changed(&onoff_persist);
+        onoff_state_publish();
     }
     return 0;
 }
@@ -135,6 +403,31 @@ static int onoff_srv_set_cb(const struct bt_mesh_model *model,
     return onoff_srv_get_cb(model, ctx, buf);
 }
 
+/* Scenes capture and restore the OnOff state. */
+static size_t onoff_scene_store(uint8_t *data, size_t max)
+{
+    data[0] = g_onoff_state.val;
+    return 1;
+}
+
+/* Published after every recall, changed or not: the host only learns
+ * the states a group recall leaves behind from these publications.
+ */
+static void onoff_scene_recall(const uint8_t *data, size_t len)
+{
+    if (len >= 1 && data[0] != g_onoff_state.val) {
+        g_onoff_state.val = data[0];
+        app_work_submit(&led_work);
+        app_state_changed(&onoff_persist);
+    }
+    onoff_state_publish();
+}
+
+static const struct scene_state_cb onoff_scene_cb = {
+    .store = onoff_scene_store,
+    .recall = onoff_scene_recall,
+};
+
 static const struct bt_mesh_model_op onoff_srv_op[] = {
     { OP_ONOFF_GET,       BT_MESH_LEN_EXACT(0), onoff_srv_get_cb      },
     { OP_ONOFF_SET,       BT_MESH_LEN_MIN(2),   onoff_srv_set_cb      },
@@ -152,61 +445,253 @@ static struct bt_mesh_model root_models[] = {
     BT_MESH_MODEL_HEALTH_CLI(&bt_mesh_shell_health_cli),
 
     /* OnOff Server */
-    BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_ONOFF_SRV, onoff_srv_op, NULL, &g_onoff_state),
+    BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_ONOFF_SRV, onoff_srv_op, &onoff_pub, &g_onoff_state),
 
     /* OnOff Client */
     BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_ONOFF_CLI, onoff_cli_op, NULL, NULL),
+
+    /* Appended after the OnOff Client: send_onoff_message() uses root_models[5]. */
+    BT_MESH_MODEL_OP_AGG_SRV,
+    BT_MESH_MODEL_OP_AGG_CLI,
+    BT_MESH_MODEL_RPR_SRV,
+    BT_MESH_MODEL_RPR_CLI(&rpr_cli),
+    BT_MESH_MODEL_SAR_CFG_SRV,
+    BT_MESH_MODEL_SAR_CFG_CLI(&sar_cfg_cli),
+    SCENE_MODELS,
+
+    /* Firmware update: the host dongle distributes, the nodes receive. */
+#if defined(CONFIG_BT_MESH_SHELL_DFD_SRV)
+    BT_MESH_MODEL_DFD_SRV(&bt_mesh_shell_dfd_srv),
+#elif defined(CONFIG_BT_MESH_DFU_SRV)
+    BT_MESH_MODEL_DFU_SRV(&dfu_srv),
+#endif
+};
+
+static struct bt_mesh_model vnd_models[] = {
+    VND_MODEL,
 };
 
 static const struct bt_mesh_elem elements[] = {
-    BT_MESH_ELEM(0, root_models, BT_MESH_MODEL_NONE),
+    BT_MESH_ELEM(0, root_models, vnd_models),
 };
 
 static const struct bt_mesh_comp comp = {
     .cid        = CONFIG_BT_COMPANY_ID,
+    .pid        = VND_COMP_PID,
+    .vid        = VND_COMP_VID,
     .elem       = elements,
     .elem_count = ARRAY_SIZE(elements),
 };
 
+/* ---------------------------------------------------------------------
+ * OnOff Server publication
+ * --------------------------------------------------------------------- */
+static struct app_work onoff_pub_work;
+
+static int onoff_pub_update(const struct bt_mesh_model *model)
+{
+    bt_mesh_model_msg_init(model->pub->msg, OP_ONOFF_STATUS);
+    net_buf_simple_add_u8(model->pub->msg, g_onoff_state.val);
+    return 0;
+}
+
+static void onoff_pub_work_handler(struct k_work *work)
+{
+    const struct bt_mesh_model *srv =
+        bt_mesh_model_find(&elements[0], BT_MESH_MODEL_ID_GEN_ONOFF_SRV);
+    int err;
+
+    onoff_pub_update(srv);
+    err = bt_mesh_model_publish(srv);
+    if (err && err != -EADDRNOTAVAIL) {
+        printk("OnOff publish failed (err %d)\n", err);
+    }
+}
+
+/* Published after a random 20-500 ms, as the Mesh Model spec asks of
+ * servers answering a group message, so the nodes switched by one group
+ * Set do not all report in the same instant. A change within the delay
+ * leaves it alone: the pending publication reads the state when it runs,
+ * so a node that keeps toggling still publishes.
+ */
+static void onoff_state_publish(void)
+{
+    if (!k_work_delayable_is_pending(&onoff_pub_work.dwork)) {
+        app_work_reschedule(&onoff_pub_work, 20 + sys_rand32_get() % 481);
+    }
+}
+
 /* ---------------------------------------------------------------------
  * OnOff Client "send" function
  * --------------------------------------------------------------------- */
-static int send_onoff_message(bool new_state)
+static int send_onoff_message(uint16_t addr, bool new_state)
 {
     static uint8_t tid;
     struct bt_mesh_msg_ctx ctx = {
         /* Must have the OnOff Client model at root_models[5] bound to an AppKey index */
         .app_idx  = 0, /* We are using 0 for demonstration */
-        .addr     = BT_MESH_ADDR_ALL_NODES,
+        .addr     = addr,
         .send_ttl = BT_MESH_TTL_DEFAULT,
     };
+    /* A group Set is unacknowledged: the nodes report their new state
+     * through their publications instead of all replying at once.
+     */
+    uint32_t opcode = BT_MESH_ADDR_IS_UNICAST(addr) ? OP_ONOFF_SET : OP_ONOFF_SET_UNACK;
 
     BT_MESH_MODEL_BUF_DEFINE(msg, OP_ONOFF_SET, 2);
-    bt_mesh_model_msg_init(&msg, OP_ONOFF_SET);
+    bt_mesh_model_msg_init(&msg, opcode);
     net_buf_simple_add_u8(&msg, new_state);
-    net_buf_simple_add_u8(&msg, tid++);
+    net_buf_simple_add_u8(&msg, tid);
 
-    printk("Sending OnOff=%u\n", new_state);
+    /* The host's state cache keys its optimistic update on this line */
+    printk("Sending OnOff=%u to 0x%04x tid %u\n", new_state, addr, tid++);
 
     int err = bt_mesh_model_send(&root_models[5], &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
     if (err) {
         printk("bt_mesh_model_send() failed, err=%d\n", err);
     }
     return err;
 }
 
+static int send_onoff_get(uint16_t addr)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .app_idx  = 0,
+        .addr     = addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_ONOFF_GET, 0);
+    bt_mesh_model_msg_init(&msg, OP_ONOFF_GET);
+
+    int err = bt_mesh_model_send(&root_models[5], &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
+    if (err) {
+        printk("OnOff Get to 0x%04x failed (err %d)\n", addr, err);
+    }
+    return err;
+}
+
+/* One OnOff Get per work run; the Gets of a round are spread evenly over
+ * the probe interval so the probe itself does not congest the network.
+ * A Get still outstanding when its node is probed again counts as lost.
+ */
+static void probe_work_handler(struct k_work *work)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .app_idx  = 0,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    struct probe_target *t;
+    int err;
+
+    if (probe.round == probe.rounds) {
+        for (size_t i = 0; i < probe.count; i++) {
+            t = &probe.targets[i];
+            printk("PROBE 0x%04x sent %u recv %u avg %u max %u\n", t->addr,
+                   t->sent, t->received,
+                   t->received ? t->rtt_sum / t->received : 0, t->rtt_max);
+        }
+        printk("PROBE done\n");
+        probe.active = false;
+        return;
+    }
+
+    t = &probe.targets[probe.next];
+    ctx.addr = t->addr;
+    t->sent_at = 0;
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_ONOFF_GET, 0);
+    bt_mesh_model_msg_init(&msg, OP_ONOFF_GET);
+
+    err = bt_mesh_model_send(&root_models[5], &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
+    if (err) {
+        printk("PROBE 0x%04x send failed (err %d)\n", t->addr, err);
+    } else {
+        t->sent++;
+        t->sent_at = k_uptime_get();
+    }
+
+    if (++probe.next == probe.count) {
+        probe.next = 0;
+        probe.round++;
+    }
+
+    /* After the last round, wait one more interval for late replies. */
+    app_work_reschedule(&probe.work,
+                        probe.round == probe.rounds ?
+                        probe.interval_ms : probe.interval_ms / probe.count);
+}
+
 /* ---------------------------------------------------------------------
- * Work item for button press
+ * Button gestures
+ *
+ * Each gesture sends one message to its own address; the group the host
+ * subscribes nodes to by default. Change with the "btn" command.
  * --------------------------------------------------------------------- */
-static struct k_work button_work;
-/* We'll also track a toggle state in code. */
+#define BTN_GROUP_DEFAULT 0xc000
+
+enum btn_action {
+    BTN_ACTION_NONE,
+    BTN_ACTION_TOGGLE,
+    BTN_ACTION_ON,
+    BTN_ACTION_OFF,
+    BTN_ACTION_SCENE,
+    BTN_ACTION_COUNT,
+};
+
+static const char *const btn_action_names[BTN_ACTION_COUNT] = {
+    [BTN_ACTION_NONE] = "none",
+    [BTN_ACTION_TOGGLE] = "toggle",
+    [BTN_ACTION_ON] = "on",
+    [BTN_ACTION_OFF] = "off",
+    [BTN_ACTION_SCENE] = "scene",
+};
+
+static struct {
+    uint8_t action;
+    uint16_t addr;
+    uint16_t scene;
+} btn_map[GESTURE_COUNT] = {
+    [GESTURE_SINGLE] = { BTN_ACTION_TOGGLE, BTN_GROUP_DEFAULT },
+    [GESTURE_DOUBLE] = { BTN_ACTION_ON,     BTN_GROUP_DEFAULT },
+    [GESTURE_LONG]   = { BTN_ACTION_OFF,    BTN_GROUP_DEFAULT },
+};
+
+/* Last state sent; a toggle sends the opposite. */
 static bool toggle_state;
 
-static void button_work_handler(struct k_work *work)
+static bool button_read(void)
+{
+    return gpio_pin_get(btn_dev, BUTTON_PIN) == 1;
+}
+
+/* Runs on the actuation queue, once per debounced gesture. */
+static void button_gesture(enum gesture gesture)
 {
-    toggle_state = !toggle_state;
-    /* Actually do the mesh send in normal (thread) context. */
-    send_onoff_message(toggle_state);
+    printk("Button %s press\n", gesture_name(gesture));
+
+    switch (btn_map[gesture].action) {
+    case BTN_ACTION_TOGGLE:
+        toggle_state = !toggle_state;
+        break;
+    case BTN_ACTION_ON:
+        toggle_state = true;
+        break;
+    case BTN_ACTION_OFF:
+        toggle_state = false;
+        break;
+    case BTN_ACTION_SCENE:
+        scene_cli_send(0, 0, btn_map[gesture].addr, OP_SCENE_RECALL_UNACK,
+                       btn_map[gesture].scene);
+        return;
+    default:
+        return;
+    }
+
+    send_onoff_message(btn_map[gesture].addr, toggle_state);
 }
 
 /* ---------------------------------------------------------------------
@@ -216,13 +701,52 @@ static struct gpio_callback button_cb_data;
 
 static void button_isr_cb(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
 {
-    /* Defer the mesh call to the work handler. */
-    k_work_submit(&button_work);
+    /* Both edges; the gesture layer debounces and defers the mesh send. */
+    gesture_edge();
 }
 
 /* ---------------------------------------------------------------------
  * Bluetooth / Mesh initialization callback
  * --------------------------------------------------------------------- */
+/* UUID a reset node advertises, as "mesh prov uuid effeeffe" set it */
+static const uint8_t reset_uuid[] = { 0xef, 0xfe, 0xef, 0xfe };
+
+/* Forget the network and advertise for provisioning again. */
+static int node_reset_local(void)
+{
+    /* The UUID buffer belongs to the mesh shell; bt_mesh_shell_prov only
+     * exposes it as const. Same write as its "mesh prov uuid" command.
+     */
+    uint8_t *uuid = (uint8_t *)bt_mesh_shell_prov.uuid;
+
+    bt_mesh_reset();
+
+    memset(uuid, 0, 16);
+    memcpy(uuid, reset_uuid, sizeof(reset_uuid));
+
+    return disc_start();
+}
+
+/* The mesh shell's link callbacks, chained behind the discovery hooks */
+static void (*shell_link_open)(bt_mesh_prov_bearer_t bearer);
+static void (*shell_link_close)(bt_mesh_prov_bearer_t bearer);
+
+static void prov_link_open(bt_mesh_prov_bearer_t bearer)
+{
+    disc_link_open();
+    if (shell_link_open) {
+        shell_link_open(bearer);
+    }
+}
+
+static void prov_link_close(bt_mesh_prov_bearer_t bearer)
+{
+    disc_link_close();
+    if (shell_link_close) {
+        shell_link_close(bearer);
+    }
+}
+
 static void bt_ready(int err)
 {
     if (err) {
@@ -230,53 +754,66 @@ static void bt_ready(int err)
         return;
     }
 
+    boot_mark(BOOT_BT);
     printk("Bluetooth initialized\n");
 
+    err = dfu_target_init();
+    if (err) {
+        printk("DFU target init failed (err %d)\n", err);
+        return;
+    }
+
+    shell_link_open = bt_mesh_shell_prov.link_open;
+    shell_link_close = bt_mesh_shell_prov.link_close;
+    bt_mesh_shell_prov.link_open = prov_link_open;
+    bt_mesh_shell_prov.link_close = prov_link_close;
+
     err = bt_mesh_init(&bt_mesh_shell_prov, &comp);
     if (err) {
         printk("Mesh init failed (err %d)\n", err);
         return;
     }
 
+    boot_mark(BOOT_MESH_INIT);
+
+    /* A provisioned node is started by the settings commit, before
+     * settings_load() returns.
+     */
     if (IS_ENABLED(CONFIG_SETTINGS)) {
         settings_load();
     }
 
-    printk("Mesh initialized (shell provisioning)\n");
-
-    const struct shell *shell = shell_backend_uart_get_ptr();
-    if (shell) {
-
-        /* -------------------------------------------------------------
-         * Check if button is pressed at startup. If so, reset locally.
-         * -------------------------------------------------------------
-         */
-        /* Note: Depending on board wiring, a "pressed" state might be
-         * read as 0 instead of 1. Adjust accordingly if the logic is
-         * inverted on your hardware.
-         */
-
-        int val = gpio_pin_get(btn_dev, BUTTON_PIN);
-        printk("Button pin read: %d\n", val);
-
-        if (val == 1) {
-
-            k_sleep(K_MSEC(6000));
-            shell_execute_cmd(shell, "mesh init");
-            k_sleep(K_MSEC(200));
+    dfu_target_confirm();
 
-            /* If button is pressed at power on, reset local mesh state. */
-            shell_execute_cmd(shell, "mesh reset-local");
+    boot_mark(BOOT_SETTINGS);
+    printk("Mesh initialized (shell provisioning)\n");
 
-            k_sleep(K_MSEC(200));
-            shell_execute_cmd(shell, "mesh prov uuid effeeffe");
-            k_sleep(K_MSEC(200));
-            shell_execute_cmd(shell, "mesh prov pb-gatt on");
+    /* Note: Depending on board wiring, a "pressed" state might be
+     * read as 0 instead of 1. Adjust accordingly if the logic is
+     * inverted on your hardware.
+     */
+    int val = gpio_pin_get(btn_dev, BUTTON_PIN);
+    printk("Button pin read: %d\n", val);
+
+    /* Button held at power on: reset the local mesh state. The stack is
+     * ready at this point, so there is nothing to wait for.
+     */
+    if (val == 1) {
+        err = node_reset_local();
+        if (err) {
+            printk("Local reset failed (err %d)\n", err);
+        }
+    } else if (!bt_mesh_is_provisioned()) {
+        /* Reset or never provisioned: advertise for provisioning again */
+        err = disc_start();
+        if (err) {
+            printk("Discovery start failed (err %d)\n", err);
         }
-
-    } else {
-        printk("Shell backend not initialized\n");
     }
+
+    boot_mark(BOOT_READY);
+    printk("Node %s\n", bt_mesh_is_provisioned() ? "provisioned" : "unprovisioned");
+    boot_print();
 }
 
 /* ---------------------------------------------------------------------
@@ -291,7 +828,10 @@ static int board_init(void)
         printk("LED device not ready\n");
         return -ENODEV;
     }
-    err = gpio_pin_configure(led_dev, LED0_PIN, GPIO_OUTPUT_INACTIVE | LED0_FLAGS);
+    /* Start from the restored state, without a blink through off */
+    err = gpio_pin_configure(led_dev, LED0_PIN,
+                             (g_onoff_state.val ? GPIO_OUTPUT_ACTIVE : GPIO_OUTPUT_INACTIVE) |
+                             LED0_FLAGS);
     if (err) {
         printk("Failed to configure LED0 pin (err %d)\n", err);
         return err;
@@ -308,7 +848,7 @@ static int board_init(void)
         printk("Failed to configure button pin (err %d)\n", err);
         return err;
     }
-    err = gpio_pin_interrupt_configure(btn_dev, BUTTON_PIN, GPIO_INT_EDGE_TO_ACTIVE);
+    err = gpio_pin_interrupt_configure(btn_dev, BUTTON_PIN, GPIO_INT_EDGE_BOTH);
     if (err) {
         printk("Failed to configure button interrupt (err %d)\n", err);
         return err;
@@ -352,24 +892,1566 @@ SHELL_CMD_REGISTER(leds, NULL,
     "Set LED on/off: leds <0|1>",
     cmd_leds);
 
-/* ---------------------------------------------------------------------
- * main()
- * --------------------------------------------------------------------- */
-int main(void)
+static int parse_u16(const char *str, uint16_t *val)
+{
+    char *endptr;
+    unsigned long v = strtoul(str, &endptr, 0);
+
+    if (*endptr != '\0' || v > UINT16_MAX) {
+        return -EINVAL;
+    }
+    *val = v;
+    return 0;
+}
+
+/* Configure a freshly provisioned node with one Opcodes Aggregator
+ * Sequence: AppKey Add, bind the OnOff, Scene, firmware update and
+ * vendor diagnostics models to the AppKey, subscribe the OnOff models and
+ * the Scene Server to the group and, if given, make the vendor model
+ * publish a Beat to beat_dst every beat_s seconds and the OnOff Server
+ * publish its state changes there too. The Config Client calls are not
+ * sent individually while the sequence is open; they are appended to it
+ * and go out as a single (segmented) message with a single status reply.
+ * The last line is "NODECFG <addr> ok" or "NODECFG <addr> failed (err n)".
+ */
+static int cmd_nodecfg(const struct shell *sh, size_t argc, char **argv)
 {
+    static const uint16_t mod_ids[] = {
+        BT_MESH_MODEL_ID_GEN_ONOFF_SRV,
+        BT_MESH_MODEL_ID_GEN_ONOFF_CLI,
+        BT_MESH_MODEL_ID_SCENE_SRV,
+        BT_MESH_MODEL_ID_SCENE_SETUP_SRV,
+        BT_MESH_MODEL_ID_SCENE_CLI,
+        /* Firmware update targets; an image without them answers
+         * Invalid Model inside the aggregated status and the other
+         * items still apply.
+         */
+        BT_MESH_MODEL_ID_BLOB_SRV,
+        BT_MESH_MODEL_ID_DFU_SRV,
+#if defined(CONFIG_BT_MESH_DFD_SRV)
+        /* The distributor configures itself with this command too */
+        BT_MESH_MODEL_ID_BLOB_CLI,
+        BT_MESH_MODEL_ID_DFU_CLI,
+        BT_MESH_MODEL_ID_DFD_SRV,
+#endif
+    };
+    /* The Setup Server shares the Scene Server's subscriptions */
+    static const uint16_t sub_ids[] = {
+        BT_MESH_MODEL_ID_GEN_ONOFF_SRV,
+        BT_MESH_MODEL_ID_GEN_ONOFF_CLI,
+        BT_MESH_MODEL_ID_SCENE_SRV,
+    };
+    struct bt_mesh_cdb_app_key *app;
+    uint8_t app_key[16];
+    struct bt_mesh_cfg_cli_mod_pub beat_pub = {
+        .ttl = BT_MESH_TTL_DEFAULT,
+        .transmit = BT_MESH_TRANSMIT(0, 20),
+    };
+    uint16_t addr, app_idx, group, net_idx, beat_s = 0;
     int err;
 
-    printk("Initializing...\n");
+    if (parse_u16(argv[1], &addr) || parse_u16(argv[2], &app_idx) ||
+        parse_u16(argv[3], &group) ||
+        (argc > 4 && (argc != 6 || parse_u16(argv[4], &beat_pub.addr) ||
+                      parse_u16(argv[5], &beat_s) || beat_s > 63))) {
+        shell_print(sh, "Usage: nodecfg <addr> <app_idx> <group> [beat_dst beat_s(1-63)]");
+        return -EINVAL;
+    }
 
-    /* Initialize board-level hardware: LED & button. */
-    err = board_init();
+    app = bt_mesh_cdb_app_key_get(app_idx);
+    if (!app) {
+        shell_print(sh, "NODECFG 0x%04x failed (err %d)", addr, -ENOENT);
+        return -ENOENT;
+    }
+
+    err = bt_mesh_cdb_app_key_export(app, 0, app_key);
     if (err) {
-        printk("board_init failed (err %d)\n", err);
-        return 0;
+        shell_print(sh, "NODECFG 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+    net_idx = app->net_idx;
+
+    err = bt_mesh_op_agg_cli_seq_start(net_idx, BT_MESH_KEY_DEV_REMOTE, addr, addr);
+    if (err) {
+        shell_print(sh, "NODECFG 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+
+    /* NULL status pointers: the replies come back inside the aggregated
+     * status, so nothing waits per message.
+     */
+    err = bt_mesh_cfg_cli_app_key_add(net_idx, addr, net_idx, app_idx, app_key, NULL);
+    for (size_t i = 0; !err && i < ARRAY_SIZE(mod_ids); i++) {
+        err = bt_mesh_cfg_cli_mod_app_bind(net_idx, addr, addr, app_idx,
+                                           mod_ids[i], NULL);
+    }
+    if (!err) {
+        err = bt_mesh_cfg_cli_mod_app_bind_vnd(net_idx, addr, addr, app_idx,
+                                               VND_MODEL_ID, CONFIG_BT_COMPANY_ID,
+                                               NULL);
+    }
+    for (size_t i = 0; !err && i < ARRAY_SIZE(sub_ids); i++) {
+        err = bt_mesh_cfg_cli_mod_sub_add(net_idx, addr, addr, group,
+                                          sub_ids[i], NULL);
+    }
+    if (!err && beat_s) {
+        beat_pub.app_idx = app_idx;
+        beat_pub.period = BT_MESH_PUB_PERIOD_SEC(beat_s);
+        err = bt_mesh_cfg_cli_mod_pub_set_vnd(net_idx, addr, addr, VND_MODEL_ID,
+                                              CONFIG_BT_COMPANY_ID, &beat_pub, NULL);
+    }
+    if (!err && beat_s) {
+        /* Only on change, no period */
+        beat_pub.period = 0;
+        err = bt_mesh_cfg_cli_mod_pub_set(net_idx, addr, addr,
+                                          BT_MESH_MODEL_ID_GEN_ONOFF_SRV, &beat_pub, NULL);
     }
 
-    /* Initialize the work item that handles the button logic. */
-    k_work_init(&button_work, button_work_handler);
+    if (err) {
+        bt_mesh_op_agg_cli_seq_abort();
+        shell_print(sh, "NODECFG 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+
+    err = bt_mesh_op_agg_cli_seq_send();
+    if (err) {
+        shell_print(sh, "NODECFG 0x%04x failed (err %d)", addr, err);
+    } else {
+        shell_print(sh, "NODECFG 0x%04x ok", addr);
+    }
+
+    return err;
+}
+
+SHELL_CMD_ARG_REGISTER(nodecfg, NULL,
+    "Configure a node in one aggregated message: "
+    "nodecfg <addr> <app_idx> <group> [beat_dst beat_s]",
+    cmd_nodecfg, 4, 2);
+
+/* Models the host reconciles. Every node runs this image, so the list is
+ * the same for all of them.
+ */
+static const uint32_t cfg_models[] = {
+    BT_MESH_MODEL_ID_GEN_ONOFF_SRV,
+    BT_MESH_MODEL_ID_GEN_ONOFF_CLI,
+    BT_MESH_MODEL_ID_SCENE_SRV,
+    BT_MESH_MODEL_ID_SCENE_SETUP_SRV,
+    BT_MESH_MODEL_ID_SCENE_CLI,
+    ((uint32_t)CONFIG_BT_COMPANY_ID << 16) | VND_MODEL_ID,
+};
+
+static int parse_u32(const char *str, char **end, uint32_t *val)
+{
+    *val = strtoul(str, end, 0);
+    return *end == str ? -EINVAL : 0;
+}
+
+/* Parse "<model>[@<elem_addr>]"; the element defaults to the node's
+ * primary element.
+ */
+static int parse_model(const char *str, char **end, uint16_t addr, uint32_t *model,
+                       uint16_t *elem)
+{
+    uint32_t val = addr;
+
+    if (parse_u32(str, end, model) ||
+        (**end == '@' && (parse_u32(*end + 1, end, &val) || val > UINT16_MAX))) {
+        return -EINVAL;
+    }
+    *elem = val;
+    return 0;
+}
+
+/* Queue the reads of one model's binds, subscriptions and publication. */
+static int cfgread_model(uint16_t addr, uint16_t elem, uint32_t model)
+{
+    uint16_t mod_id = model & 0xffff;
+    uint16_t cid = model >> 16;
+    int err;
+
+    if (model <= UINT16_MAX) {
+        err = bt_mesh_cfg_cli_mod_app_get(0, addr, elem, mod_id, NULL, NULL, NULL);
+        if (!err) {
+            err = bt_mesh_cfg_cli_mod_sub_get(0, addr, elem, mod_id, NULL, NULL, NULL);
+        }
+        if (!err) {
+            err = bt_mesh_cfg_cli_mod_pub_get(0, addr, elem, mod_id, NULL, NULL);
+        }
+        return err;
+    }
+
+    err = bt_mesh_cfg_cli_mod_app_get_vnd(0, addr, elem, mod_id, cid, NULL, NULL, NULL);
+    if (!err) {
+        err = bt_mesh_cfg_cli_mod_sub_get_vnd(0, addr, elem, mod_id, cid, NULL, NULL, NULL);
+    }
+    if (!err) {
+        err = bt_mesh_cfg_cli_mod_pub_get_vnd(0, addr, elem, mod_id, cid, NULL, NULL);
+    }
+    return err;
+}
+
+/* Read back a node's configuration in one aggregated message: AppKeys,
+ * binds, subscriptions and publications of the listed models (every
+ * model in cfg_models on the primary element if none are listed), relay
+ * and heartbeat publication. The replies are
+ * printed as "CFG <addr> ..." (relay as "TXP <addr> relay ...") by the
+ * Config Client callbacks, then "CFGREAD <addr> done". A list that could
+ * not be unpacked reads "error" and makes the read incomplete.
+ */
+static int cmd_cfgread(const struct shell *sh, size_t argc, char **argv)
+{
+    uint16_t addr, elem;
+    uint32_t model;
+    char *end;
+    int err;
+
+    if (parse_u16(argv[1], &addr)) {
+        shell_print(sh, "Usage: cfgread <addr> [model[@elem]...]");
+        return -EINVAL;
+    }
+
+    for (size_t i = 2; i < argc; i++) {
+        if (parse_model(argv[i], &end, addr, &model, &elem) || *end) {
+            shell_print(sh, "Invalid model %s", argv[i]);
+            return -EINVAL;
+        }
+    }
+
+    err = bt_mesh_op_agg_cli_seq_start(0, BT_MESH_KEY_DEV_REMOTE, addr, addr);
+    if (err) {
+        shell_print(sh, "CFGREAD 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+
+    err = bt_mesh_cfg_cli_app_key_get(0, addr, 0, NULL, NULL, NULL);
+    if (argc > 2) {
+        for (size_t i = 2; !err && i < argc; i++) {
+            (void)parse_model(argv[i], &end, addr, &model, &elem);
+            err = cfgread_model(addr, elem, model);
+        }
+    } else {
+        for (size_t i = 0; !err && i < ARRAY_SIZE(cfg_models); i++) {
+            err = cfgread_model(addr, addr, cfg_models[i]);
+        }
+    }
+    if (!err) {
+        err = bt_mesh_cfg_cli_relay_get(0, addr, NULL, NULL);
+    }
+    if (!err) {
+        err = bt_mesh_cfg_cli_hb_pub_get(0, addr, NULL, NULL);
+    }
+
+    if (err) {
+        bt_mesh_op_agg_cli_seq_abort();
+    } else {
+        err = bt_mesh_op_agg_cli_seq_send();
+    }
+
+    if (err) {
+        shell_print(sh, "CFGREAD 0x%04x failed (err %d)", addr, err);
+    } else {
+        shell_print(sh, "CFGREAD 0x%04x done", addr);
+    }
+    return err;
+}
+
+SHELL_CMD_ARG_REGISTER(cfgread, NULL,
+    "Read back a node's configuration: cfgread <addr> [model[@elem]...]",
+    cmd_cfgread, 2, 10);
+
+/* Queue one cfgset operation; see cmd_cfgset for the forms. */
+static int cfgset_op(uint16_t addr, const char *op)
+{
+    char *p = strchr(op, ':');
+    uint32_t model, a, b = 0, c = 0;
+    uint16_t mod_id, cid, elem;
+    bool vnd;
+    size_t verb_len;
+
+    if (!p) {
+        return -EINVAL;
+    }
+    verb_len = p - op;
+
+#define VERB(name) (verb_len == sizeof(name) - 1 && !strncmp(op, name, verb_len))
+
+    if (VERB("ak") || VERB("ak-")) {
+        struct bt_mesh_cdb_app_key *app;
+        uint8_t app_key[16];
+
+        if (parse_u32(p + 1, &p, &a) || *p) {
+            return -EINVAL;
+        }
+        if (VERB("ak-")) {
+            return bt_mesh_cfg_cli_app_key_del(0, addr, 0, a, NULL);
+        }
+        app = bt_mesh_cdb_app_key_get(a);
+        if (!app || bt_mesh_cdb_app_key_export(app, 0, app_key)) {
+            return -ENOENT;
+        }
+        return bt_mesh_cfg_cli_app_key_add(0, addr, app->net_idx, a, app_key, NULL);
+    }
+
+    if (VERB("relay")) {
+        if (parse_u32(p + 1, &p, &a) || *p != ':' || parse_u32(p + 1, &p, &b) ||
+            *p != ':' || parse_u32(p + 1, &p, &c) || *p || a > 1 || b > 7 ||
+            c < 10 || c > 320) {
+            return -EINVAL;
+        }
+        return bt_mesh_cfg_cli_relay_set(0, addr, a, BT_MESH_TRANSMIT(b, c), NULL, NULL);
+    }
+
+    if (VERB("hb")) {
+        struct bt_mesh_cfg_cli_hb_pub hb = {
+            .ttl = BT_MESH_TTL_DEFAULT,
+        };
+
+        if (parse_u32(p + 1, &p, &a) || *p != ':' || parse_u32(p + 1, &p, &b) || *p ||
+            b > 0x11) {
+            return -EINVAL;
+        }
+        hb.dst = a;
+        hb.period = b;
+        hb.count = a ? 0xff : 0;
+        return bt_mesh_cfg_cli_hb_pub_set(0, addr, &hb, NULL);
+    }
+
+    /* The remaining forms start with a model */
+    if (parse_model(p + 1, &p, addr, &model, &elem) || *p != ':' ||
+        parse_u32(p + 1, &p, &a)) {
+        return -EINVAL;
+    }
+    vnd = model > UINT16_MAX;
+    mod_id = model & 0xffff;
+    cid = model >> 16;
+
+    if (VERB("pub")) {
+        struct bt_mesh_cfg_cli_mod_pub pub = {
+            .addr = a,
+            .ttl = BT_MESH_TTL_DEFAULT,
+            .transmit = BT_MESH_TRANSMIT(0, 20),
+        };
+
+        if (*p != ':' || parse_u32(p + 1, &p, &b) || *p != ':' ||
+            parse_u32(p + 1, &p, &c) || *p || c > 63) {
+            return -EINVAL;
+        }
+        pub.app_idx = b;
+        pub.period = BT_MESH_PUB_PERIOD_SEC(c);
+        return vnd ? bt_mesh_cfg_cli_mod_pub_set_vnd(0, addr, elem, mod_id, cid, &pub, NULL)
+                   : bt_mesh_cfg_cli_mod_pub_set(0, addr, elem, mod_id, &pub, NULL);
+    }
+
+    if (*p) {
+        return -EINVAL;
+    }
+
+    if (VERB("bind")) {
+        return vnd ? bt_mesh_cfg_cli_mod_app_bind_vnd(0, addr, elem, a, mod_id, cid, NULL)
+                   : bt_mesh_cfg_cli_mod_app_bind(0, addr, elem, a, mod_id, NULL);
+    }
+    if (VERB("unbind")) {
+        return vnd ? bt_mesh_cfg_cli_mod_app_unbind_vnd(0, addr, elem, a, mod_id, cid, NULL)
+                   : bt_mesh_cfg_cli_mod_app_unbind(0, addr, elem, a, mod_id, NULL);
+    }
+    if (VERB("sub")) {
+        return vnd ? bt_mesh_cfg_cli_mod_sub_add_vnd(0, addr, elem, a, mod_id, cid, NULL)
+                   : bt_mesh_cfg_cli_mod_sub_add(0, addr, elem, a, mod_id, NULL);
+    }
+    if (VERB("unsub")) {
+        return vnd ? bt_mesh_cfg_cli_mod_sub_del_vnd(0, addr, elem, a, mod_id, cid, NULL)
+                   : bt_mesh_cfg_cli_mod_sub_del(0, addr, elem, a, mod_id, NULL);
+    }
+
+#undef VERB
+
+    return -EINVAL;
+}
+
+/* Apply a list of configuration changes to one node in one aggregated
+ * message. Operations:
+ *   ak:<app_idx>  ak-:<app_idx>          AppKey add (from the CDB) / delete
+ *   bind:<model>:<app_idx>  unbind:...   model AppKey binding
+ *   sub:<model>:<group>  unsub:...       model subscription
+ *   pub:<model>:<dst>:<app_idx>:<sec>    model publication, dst 0 disables
+ *   relay:<0|1>:<count>:<interval_ms>    relay feature and retransmissions
+ *   hb:<dst>:<period_log>                heartbeat publication, dst 0 disables
+ * A model on another element than the primary one is written
+ * <model>@<elem_addr>. Failed items are printed as "CFG <addr> <what> status <n>".
+ */
+static int cmd_cfgset(const struct shell *sh, size_t argc, char **argv)
+{
+    uint16_t addr;
+    int err;
+
+    if (parse_u16(argv[1], &addr)) {
+        shell_print(sh, "Usage: cfgset <addr> <op> [op...]");
+        return -EINVAL;
+    }
+
+    err = bt_mesh_op_agg_cli_seq_start(0, BT_MESH_KEY_DEV_REMOTE, addr, addr);
+    if (err) {
+        shell_print(sh, "CFGSET 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+
+    for (size_t i = 2; !err && i < argc; i++) {
+        err = cfgset_op(addr, argv[i]);
+        if (err) {
+            shell_print(sh, "CFGSET 0x%04x bad op %s (err %d)", addr, argv[i], err);
+        }
+    }
+
+    if (err) {
+        bt_mesh_op_agg_cli_seq_abort();
+    } else {
+        err = bt_mesh_op_agg_cli_seq_send();
+    }
+
+    if (err) {
+        shell_print(sh, "CFGSET 0x%04x failed (err %d)", addr, err);
+    } else {
+        shell_print(sh, "CFGSET 0x%04x ok %u", addr, (unsigned int)(argc - 2));
+    }
+    return err;
+}
+
+SHELL_CMD_ARG_REGISTER(cfgset, NULL,
+    "Apply configuration changes in one aggregated message: cfgset <addr> <op> [op...]",
+    cmd_cfgset, 3, 10);
+
+/* Print one Composition Data element as "COMP <addr> elem <i> loc <loc>
+ * sig <id>,... vnd <cid:id>,..." with vendor models written the same way
+ * as for cfgset.
+ */
+static void comp_print_elem(uint16_t addr, int idx, struct bt_mesh_comp_p0_elem *elem)
+{
+    char line[192];
+    int len;
+
+    len = snprintk(line, sizeof(line), "COMP 0x%04x elem %d loc 0x%04x sig", addr, idx,
+                   elem->loc);
+    for (int i = 0; i < elem->nsig && len < (int)sizeof(line); i++) {
+        len += snprintk(&line[len], sizeof(line) - len, "%s0x%04x", i ? "," : " ",
+                        bt_mesh_comp_p0_elem_mod(elem, i));
+    }
+    if (!elem->nsig && len < (int)sizeof(line)) {
+        len += snprintk(&line[len], sizeof(line) - len, " -");
+    }
+
+    if (len < (int)sizeof(line)) {
+        len += snprintk(&line[len], sizeof(line) - len, " vnd");
+    }
+    for (int i = 0; i < elem->nvnd && len < (int)sizeof(line); i++) {
+        struct bt_mesh_mod_id_vnd mod = bt_mesh_comp_p0_elem_mod_vnd(elem, i);
+
+        len += snprintk(&line[len], sizeof(line) - len, "%s0x%04x%04x", i ? "," : " ",
+                        mod.company, mod.id);
+    }
+    if (!elem->nvnd && len < (int)sizeof(line)) {
+        len += snprintk(&line[len], sizeof(line) - len, " -");
+    }
+
+    printk("%s\n", line);
+}
+
+/* Read Composition Data page 0 of a node. The host reads it once per
+ * CID/PID/VID and plans binds and subscriptions from it, so it is
+ * printed in full: "COMP <addr> cid .. pid .. vid .. crpl .. feat ..",
+ * one line per element and "COMP <addr> done".
+ */
+static int cmd_comp(const struct shell *sh, size_t argc, char **argv)
+{
+    /* Large enough for a fully segmented reply; kept off the shell stack */
+    NET_BUF_SIMPLE_DEFINE_STATIC(buf, BT_MESH_RX_SDU_MAX);
+    struct bt_mesh_comp_p0_elem elem;
+    struct bt_mesh_comp_p0 p0;
+    uint16_t addr;
+    uint8_t page;
+    int err;
+
+    if (parse_u16(argv[1], &addr)) {
+        shell_print(sh, "Usage: comp <addr>");
+        return -EINVAL;
+    }
+
+    net_buf_simple_reset(&buf);
+    err = bt_mesh_cfg_cli_comp_data_get(0, addr, 0, &page, &buf);
+    if (!err && page != 0) {
+        err = -EIO;
+    }
+    if (!err) {
+        err = bt_mesh_comp_p0_get(&p0, &buf);
+    }
+    if (err) {
+        shell_print(sh, "COMP 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+
+    printk("COMP 0x%04x cid 0x%04x pid 0x%04x vid 0x%04x crpl %u feat 0x%04x\n",
+           addr, p0.cid, p0.pid, p0.vid, p0.crpl, p0.feat);
+    for (int i = 0; bt_mesh_comp_p0_elem_pull(&p0, &elem); i++) {
+        comp_print_elem(addr, i, &elem);
+    }
+
+    shell_print(sh, "COMP 0x%04x done", addr);
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(comp, NULL,
+    "Read a node's Composition Data page 0: comp <addr>",
+    cmd_comp, 2, 0);
+
+static uint8_t cdb_node_print(struct bt_mesh_cdb_node *node, void *user_data)
+{
+    size_t *count = user_data;
+
+    printk("CDB node 0x%04x elems %u\n", node->addr, node->num_elem);
+    (*count)++;
+    return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+/* List the nodes of the provisioner's CDB with their element counts, so
+ * the host can check its address allocation against them.
+ */
+static int cmd_cdbnodes(const struct shell *sh, size_t argc, char **argv)
+{
+    size_t count = 0;
+
+    bt_mesh_cdb_node_foreach(cdb_node_print, &count);
+    shell_print(sh, "CDB done %u", (unsigned int)count);
+    return 0;
+}
+
+SHELL_CMD_REGISTER(cdbnodes, NULL, "List the CDB nodes and their element counts",
+                   cmd_cdbnodes);
+
+/* Reset a node with Config Node Reset and remove it from the CDB, which
+ * frees its addresses. With "force" the node is removed from the CDB
+ * even if it does not answer, e.g. because it is gone for good.
+ */
+static int cmd_noderst(const struct shell *sh, size_t argc, char **argv)
+{
+    struct bt_mesh_cdb_node *node;
+    bool force = argc > 2 && !strcmp(argv[2], "force");
+    bool status = false;
+    uint16_t addr;
+    uint8_t elems;
+    int err;
+
+    if (parse_u16(argv[1], &addr) || (argc > 2 && !force)) {
+        shell_print(sh, "Usage: noderst <addr> [force]");
+        return -EINVAL;
+    }
+
+    node = bt_mesh_cdb_node_get(addr);
+    if (!node) {
+        shell_print(sh, "NODERST 0x%04x failed (err %d)", addr, -ENOENT);
+        return -ENOENT;
+    }
+    elems = node->num_elem;
+
+    err = bt_mesh_cfg_cli_node_reset(0, addr, &status);
+    if (err && !force) {
+        shell_print(sh, "NODERST 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+
+    bt_mesh_cdb_node_del(node, true);
+    shell_print(sh, "NODERST 0x%04x elems %u ok%s", addr, elems, err ? " (forced)" : "");
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(noderst, NULL,
+    "Reset a node and remove it from the CDB: noderst <addr> [force]",
+    cmd_noderst, 2, 1);
+
+/* Models one groupsub can subscribe; keeps the line in the shell buffer */
+#define GROUPSUB_MODELS_MAX 4
+
+/* Replace the group subscriptions of a node's server models, in one
+ * aggregated message. The first group overwrites each model's list, the
+ * others are added to it. Models are written as for cfgset,
+ * <model>[@<elem_addr>]: an argument that is not a group address names a
+ * model. Without models, the OnOff and Scene Servers of the primary
+ * element are subscribed. The last line is "GROUPSUB <addr> <n> groups"
+ * or "GROUPSUB <addr> failed (err n)".
+ */
+static int cmd_groupsub(const struct shell *sh, size_t argc, char **argv)
+{
+    uint16_t addr, groups[CONFIG_BT_MESH_MODEL_GROUP_COUNT];
+    uint32_t models[GROUPSUB_MODELS_MAX] = {
+        BT_MESH_MODEL_ID_GEN_ONOFF_SRV,
+        BT_MESH_MODEL_ID_SCENE_SRV,
+    };
+    uint16_t elems[GROUPSUB_MODELS_MAX];
+    size_t count = 0, model_count = 0;
+    char *end;
+    int err;
+
+    if (parse_u16(argv[1], &addr)) {
+        shell_print(sh, "Usage: groupsub <addr> [model[@elem]...] <group> [group...]");
+        return -EINVAL;
+    }
+
+    for (size_t i = 2; i < argc; i++) {
+        uint16_t group;
+
+        if (!parse_u16(argv[i], &group) && BT_MESH_ADDR_IS_GROUP(group)) {
+            if (count == ARRAY_SIZE(groups)) {
+                shell_print(sh, "At most %u groups", (unsigned int)ARRAY_SIZE(groups));
+                return -EINVAL;
+            }
+            groups[count++] = group;
+        } else if (model_count == ARRAY_SIZE(models) ||
+                   parse_model(argv[i], &end, addr, &models[model_count],
+                               &elems[model_count]) || *end) {
+            shell_print(sh, "Invalid group or model %s", argv[i]);
+            return -EINVAL;
+        } else {
+            model_count++;
+        }
+    }
+
+    if (!count) {
+        shell_print(sh, "Usage: groupsub <addr> [model[@elem]...] <group> [group...]");
+        return -EINVAL;
+    }
+
+    if (!model_count) {
+        model_count = 2;
+        elems[0] = addr;
+        elems[1] = addr;
+    }
+
+    err = bt_mesh_op_agg_cli_seq_start(0, BT_MESH_KEY_DEV_REMOTE, addr, addr);
+    if (err) {
+        shell_print(sh, "GROUPSUB 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+
+    for (size_t m = 0; !err && m < model_count; m++) {
+        uint16_t mod_id = models[m] & 0xffff;
+        uint16_t cid = models[m] >> 16;
+        bool vnd = models[m] > UINT16_MAX;
+
+        for (size_t i = 0; !err && i < count; i++) {
+            if (i == 0) {
+                err = vnd ? bt_mesh_cfg_cli_mod_sub_overwrite_vnd(0, addr, elems[m], groups[i],
+                                                                  mod_id, cid, NULL)
+                          : bt_mesh_cfg_cli_mod_sub_overwrite(0, addr, elems[m], groups[i],
+                                                              mod_id, NULL);
+            } else {
+                err = vnd ? bt_mesh_cfg_cli_mod_sub_add_vnd(0, addr, elems[m], groups[i],
+                                                            mod_id, cid, NULL)
+                          : bt_mesh_cfg_cli_mod_sub_add(0, addr, elems[m], groups[i],
+                                                        mod_id, NULL);
+            }
+        }
+    }
+
+    if (err) {
+        bt_mesh_op_agg_cli_seq_abort();
+        shell_print(sh, "GROUPSUB 0x%04x failed (err %d)", addr, err);
+        return err;
+    }
+
+    err = bt_mesh_op_agg_cli_seq_send();
+    if (err) {
+        shell_print(sh, "GROUPSUB 0x%04x failed (err %d)", addr, err);
+    } else {
+        shell_print(sh, "GROUPSUB 0x%04x %u groups", addr, (unsigned int)count);
+    }
+
+    return err;
+}
+
+SHELL_CMD_ARG_REGISTER(groupsub, NULL,
+    "Set the server group subscriptions: "
+    "groupsub <addr> [model[@elem]...] <group> [group...]",
+    cmd_groupsub, 3, CONFIG_BT_MESH_MODEL_GROUP_COUNT - 1 + GROUPSUB_MODELS_MAX);
+
+/* Start an unprovisioned-device scan on every listed RPR server. Only the
+ * Scan Start/Status exchange is sequential; once started, all servers
+ * scan at the same time and their reports arrive through rpr_scan_report().
+ * "RPR scan: started on <n> of <m> servers" follows the last start, so the
+ * host times the scan from there. The host sends at most 12 servers per
+ * command to stay inside CONFIG_SHELL_CMD_BUFF_SIZE.
+ */
+static int cmd_rpr_scan(const struct shell *sh, size_t argc, char **argv)
+{
+    struct bt_mesh_rpr_scan_status status;
+    struct bt_mesh_rpr_node srv = {
+        .net_idx = 0,
+        .ttl = BT_MESH_TTL_DEFAULT,
+    };
+    uint16_t timeout;
+    int started = 0;
+    int err;
+
+    if (parse_u16(argv[1], &timeout) || timeout == 0 || timeout > UINT8_MAX) {
+        shell_print(sh, "Invalid timeout: %s", argv[1]);
+        return -EINVAL;
+    }
+
+    for (size_t i = 2; i < argc; i++) {
+        if (parse_u16(argv[i], &srv.addr)) {
+            shell_print(sh, "Invalid server address: %s", argv[i]);
+            continue;
+        }
+
+        err = bt_mesh_rpr_scan_start(&rpr_cli, &srv, NULL, timeout,
+                                     BT_MESH_RPR_SCAN_MAX_DEVS_ANY, &status);
+        if (err || status.status != BT_MESH_RPR_SUCCESS) {
+            shell_print(sh, "RPR scan: srv 0x%04x failed (err %d status %u)",
+                        srv.addr, err, err ? 0 : status.status);
+            continue;
+        }
+
+        started++;
+    }
+
+    shell_print(sh, "RPR scan: started on %d of %u servers", started,
+                (unsigned int)(argc - 2));
+    return started ? 0 : -EIO;
+}
+
+/* Provision one device through an RPR server. The stack has a single
+ * provisioning link, so the host runs these one after another while the
+ * servers keep scanning.
+ */
+static int cmd_rpr_prov(const struct shell *sh, size_t argc, char **argv)
+{
+    struct bt_mesh_rpr_node srv = {
+        .ttl = BT_MESH_TTL_DEFAULT,
+    };
+    uint8_t uuid[16];
+    uint16_t net_idx, addr;
+    size_t len;
+    int err;
+
+    if (parse_u16(argv[1], &srv.addr) || parse_u16(argv[3], &net_idx) ||
+        parse_u16(argv[4], &addr)) {
+        shell_print(sh, "Usage: rpr prov <srv> <uuid> <net_idx> <addr>");
+        return -EINVAL;
+    }
+
+    len = hex2bin(argv[2], strlen(argv[2]), uuid, sizeof(uuid));
+    if (len == 0) {
+        shell_print(sh, "Invalid UUID: %s", argv[2]);
+        return -EINVAL;
+    }
+    memset(&uuid[len], 0, sizeof(uuid) - len);
+    srv.net_idx = net_idx;
+
+    err = bt_mesh_provision_remote(&rpr_cli, &srv, uuid, net_idx, addr);
+    if (err) {
+        shell_print(sh, "RPR prov: srv 0x%04x addr 0x%04x failed (err %d)",
+                    srv.addr, addr, err);
+    } else {
+        shell_print(sh, "RPR prov: srv 0x%04x addr 0x%04x started", srv.addr, addr);
+    }
+
+    return err;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(rpr_cmds,
+    SHELL_CMD_ARG(scan, NULL, "Scan on RPR servers: scan <timeout_s> <srv>...",
+                  cmd_rpr_scan, 3, CONFIG_SHELL_ARGC_MAX - 3),
+    SHELL_CMD_ARG(prov, NULL, "Provision via RPR server: prov <srv> <uuid> <net_idx> <addr>",
+                  cmd_rpr_prov, 5, 0),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(rpr, &rpr_cmds, "Remote Provisioning commands", NULL);
+
+/* Request the mesh statistics of one node (the dongle itself included,
+ * over loopback). The host paces these across the network.
+ */
+static int cmd_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    uint16_t addr, reset = 0;
+    int err;
+
+    if (parse_u16(argv[1], &addr) || (argc > 2 && parse_u16(argv[2], &reset))) {
+        shell_print(sh, "Usage: stats <addr> [reset]");
+        return -EINVAL;
+    }
+
+    err = vnd_stats_get(0, 0, addr, reset);
+    if (err) {
+        shell_print(sh, "STATS 0x%04x failed (err %d)", addr, err);
+    }
+
+    return err;
+}
+
+SHELL_CMD_ARG_REGISTER(stats, NULL,
+    "Read a node's mesh statistics: stats <addr> [reset]",
+    cmd_stats, 2, 1);
+
+/* Neighbor discovery: one request to all nodes starts a Hello round,
+ * then each node's table is read back on its own.
+ */
+static int cmd_nbr_hello(const struct shell *sh, size_t argc, char **argv)
+{
+    uint16_t spread_ms = 2000;
+    int err;
+
+    if (argc > 1 && parse_u16(argv[1], &spread_ms)) {
+        shell_print(sh, "Usage: nbr hello [spread_ms]");
+        return -EINVAL;
+    }
+
+    err = vnd_nbr_hello(0, 0, spread_ms);
+    if (err) {
+        shell_print(sh, "NBR hello failed (err %d)", err);
+    } else {
+        shell_print(sh, "NBR hello sent, spread %u ms", spread_ms);
+    }
+
+    return err;
+}
+
+static int cmd_nbr_get(const struct shell *sh, size_t argc, char **argv)
+{
+    uint16_t addr;
+    int err;
+
+    if (parse_u16(argv[1], &addr)) {
+        shell_print(sh, "Usage: nbr get <addr>");
+        return -EINVAL;
+    }
+
+    err = vnd_nbr_get(0, 0, addr);
+    if (err) {
+        shell_print(sh, "NBR 0x%04x failed (err %d)", addr, err);
+    }
+
+    return err;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(nbr_cmds,
+    SHELL_CMD_ARG(hello, NULL, "Start a neighbor discovery round: hello [spread_ms]",
+                  cmd_nbr_hello, 1, 1),
+    SHELL_CMD_ARG(get, NULL, "Read a node's neighbor table: get <addr>",
+                  cmd_nbr_get, 2, 0),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(nbr, &nbr_cmds, "Neighbor discovery commands", NULL);
+
+/* Latency sweep: Echo requests to every target in turn, pipelined (the
+ * next request goes out after interval_ms whether or not the previous
+ * one was answered).
+ */
+static int cmd_ping(const struct shell *sh, size_t argc, char **argv)
+{
+    uint16_t addrs[VND_PING_TARGETS_MAX];
+    uint16_t rounds, size, interval_ms;
+    size_t count = 0;
+    int err;
+
+    if (parse_u16(argv[1], &rounds) || parse_u16(argv[2], &size) ||
+        parse_u16(argv[3], &interval_ms) || size > UINT8_MAX) {
+        shell_print(sh, "Usage: ping <rounds> <size %u-%u> <interval_ms> <addr>...",
+                    VND_ECHO_SIZE_MIN, VND_ECHO_SIZE_MAX);
+        return -EINVAL;
+    }
+
+    for (size_t i = 4; i < argc; i++) {
+        if (count == ARRAY_SIZE(addrs) || parse_u16(argv[i], &addrs[count])) {
+            shell_print(sh, "Invalid or too many targets: %s", argv[i]);
+            return -EINVAL;
+        }
+        count++;
+    }
+
+    err = vnd_ping_start(0, 0, addrs, count, rounds, size, interval_ms);
+    if (err) {
+        shell_print(sh, "PING failed to start (err %d)", err);
+    } else {
+        shell_print(sh, "PING started: %u rounds of %u bytes to %u nodes", rounds,
+                    size, (unsigned int)count);
+    }
+
+    return err;
+}
+
+SHELL_CMD_ARG_REGISTER(ping, NULL,
+    "Echo latency sweep: ping <rounds> <size> <interval_ms> <addr>...",
+    cmd_ping, 5, CONFIG_SHELL_ARGC_MAX - 5);
+
+/* Stack, CPU and buffer watermarks of one node (the dongle itself over
+ * loopback). Meaningful on nodes built with instrumentation.conf.
+ */
+static int cmd_diag(const struct shell *sh, size_t argc, char **argv, uint8_t kind)
+{
+    uint16_t addr;
+    int err;
+
+    if (parse_u16(argv[1], &addr)) {
+        shell_print(sh, "Usage: diag %s <addr>", argv[0]);
+        return -EINVAL;
+    }
+
+    err = vnd_diag_get(0, 0, addr, kind);
+    if (err) {
+        shell_print(sh, "DIAG 0x%04x failed (err %d)", addr, err);
+    }
+
+    return err;
+}
+
+static int cmd_diag_threads(const struct shell *sh, size_t argc, char **argv)
+{
+    return cmd_diag(sh, argc, argv, VND_DIAG_THREADS);
+}
+
+static int cmd_diag_pools(const struct shell *sh, size_t argc, char **argv)
+{
+    return cmd_diag(sh, argc, argv, VND_DIAG_POOLS);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(diag_cmds,
+    SHELL_CMD_ARG(threads, NULL, "Stack high-water mark and CPU share per thread: threads <addr>",
+                  cmd_diag_threads, 2, 0),
+    SHELL_CMD_ARG(pools, NULL, "Buffer pool use and high-water mark: pools <addr>",
+                  cmd_diag_pools, 2, 0),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(diag, &diag_cmds, "Node instrumentation", NULL);
+
+/* OnOff Set to one node or group, or OnOff Get. The Status replies and
+ * publications are printed as "Received Led Status from <addr>: <state>".
+ */
+static int cmd_onoff(const struct shell *sh, size_t argc, char **argv)
+{
+    bool get = !strcmp(argv[2], "get");
+    uint16_t addr, state = 0;
+
+    if (parse_u16(argv[1], &addr) ||
+        (!get && (parse_u16(argv[2], &state) || state > 1))) {
+        shell_print(sh, "Usage: onoff <addr> <0|1|get>");
+        return -EINVAL;
+    }
+
+    return get ? send_onoff_get(addr) : send_onoff_message(addr, state);
+}
+
+SHELL_CMD_ARG_REGISTER(onoff, NULL,
+    "Set or get the OnOff state of a node or group: onoff <addr> <0|1|get>",
+    cmd_onoff, 3, 0);
+
+/* Scene Client: the replies are printed as "SCENE <addr> ..." lines. */
+static int cmd_scene_send(const struct shell *sh, size_t argc, char **argv,
+                          uint32_t opcode)
+{
+    uint16_t addr, number = 0;
+    int err;
+
+    if (parse_u16(argv[1], &addr) || (argc > 2 && parse_u16(argv[2], &number))) {
+        shell_print(sh, "Usage: scene %s <addr>%s", argv[0], argc > 2 ? " <scene>" : "");
+        return -EINVAL;
+    }
+
+    /* Recall to a group address is unacknowledged: one message, no
+     * reply storm from every node in the group.
+     */
+    if (opcode == OP_SCENE_RECALL && !BT_MESH_ADDR_IS_UNICAST(addr)) {
+        opcode = OP_SCENE_RECALL_UNACK;
+    }
+
+    err = scene_cli_send(0, 0, addr, opcode, number);
+    if (err) {
+        shell_print(sh, "SCENE 0x%04x failed (err %d)", addr, err);
+    }
+
+    return err;
+}
+
+static int cmd_scene_get(const struct shell *sh, size_t argc, char **argv)
+{
+    return cmd_scene_send(sh, argc, argv, OP_SCENE_GET);
+}
+
+static int cmd_scene_reg(const struct shell *sh, size_t argc, char **argv)
+{
+    return cmd_scene_send(sh, argc, argv, OP_SCENE_REGISTER_GET);
+}
+
+static int cmd_scene_store(const struct shell *sh, size_t argc, char **argv)
+{
+    return cmd_scene_send(sh, argc, argv, OP_SCENE_STORE);
+}
+
+static int cmd_scene_delete(const struct shell *sh, size_t argc, char **argv)
+{
+    return cmd_scene_send(sh, argc, argv, OP_SCENE_DELETE);
+}
+
+static int cmd_scene_recall(const struct shell *sh, size_t argc, char **argv)
+{
+    return cmd_scene_send(sh, argc, argv, OP_SCENE_RECALL);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(scene_cmds,
+    SHELL_CMD_ARG(get, NULL, "Current scene: get <addr>", cmd_scene_get, 2, 0),
+    SHELL_CMD_ARG(reg, NULL, "Stored scenes: reg <addr>", cmd_scene_reg, 2, 0),
+    SHELL_CMD_ARG(store, NULL, "Store the current state: store <addr> <scene>",
+                  cmd_scene_store, 3, 0),
+    SHELL_CMD_ARG(recall, NULL, "Recall a scene: recall <addr|group> <scene>",
+                  cmd_scene_recall, 3, 0),
+    SHELL_CMD_ARG(delete, NULL, "Delete a scene: delete <addr> <scene>",
+                  cmd_scene_delete, 3, 0),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(scene, &scene_cmds, "Scene commands", NULL);
+
+/* Show or change the button gesture actions. */
+static int cmd_btn(const struct shell *sh, size_t argc, char **argv)
+{
+    int gesture = -1, action = -1;
+    uint16_t addr, number;
+
+    if (argc == 1) {
+        for (int i = 0; i < GESTURE_COUNT; i++) {
+            shell_print(sh, "BTN %s %s 0x%04x scene %u", gesture_name(i),
+                        btn_action_names[btn_map[i].action], btn_map[i].addr,
+                        btn_map[i].scene);
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < GESTURE_COUNT; i++) {
+        if (!strcmp(argv[1], gesture_name(i))) {
+            gesture = i;
+        }
+    }
+    for (int i = 0; argc > 2 && i < BTN_ACTION_COUNT; i++) {
+        if (!strcmp(argv[2], btn_action_names[i])) {
+            action = i;
+        }
+    }
+
+    addr = btn_map[MAX(gesture, 0)].addr;
+    number = btn_map[MAX(gesture, 0)].scene;
+    if (gesture < 0 || action < 0 || (argc > 3 && parse_u16(argv[3], &addr)) ||
+        (argc > 4 && parse_u16(argv[4], &number)) ||
+        (action == BTN_ACTION_SCENE && !number)) {
+        shell_print(sh, "Usage: btn [<single|double|long> "
+                    "<none|toggle|on|off|scene> [addr] [scene]]");
+        return -EINVAL;
+    }
+
+    btn_map[gesture].action = action;
+    btn_map[gesture].addr = addr;
+    btn_map[gesture].scene = number;
+    shell_print(sh, "BTN %s %s 0x%04x scene %u", gesture_name(gesture),
+                btn_action_names[action], addr, number);
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(btn, NULL,
+    "Button gesture actions: btn [<single|double|long> <none|toggle|on|off|scene> [addr] [scene]]",
+    cmd_btn, 1, 4);
+
+/* Provisioning advertising of an unprovisioned node. */
+static int cmd_disc(const struct shell *sh, size_t argc, char **argv)
+{
+    struct disc_cfg cfg;
+    int err = 0;
+
+    disc_cfg_get(&cfg);
+
+    if (argc == 2 && !strcmp(argv[1], "start")) {
+        err = disc_start();
+    } else if (argc == 2 && !strcmp(argv[1], "stop")) {
+        disc_stop();
+    } else if (argc == 3) {
+        if (parse_u16(argv[1], &cfg.fast_s) || parse_u16(argv[2], &cfg.max_off_s) ||
+            disc_cfg_set(&cfg)) {
+            shell_print(sh, "Usage: disc [start|stop|<fast_s> <max_off_s>]");
+            return -EINVAL;
+        }
+    } else if (argc != 1) {
+        shell_print(sh, "Usage: disc [start|stop|<fast_s> <max_off_s>]");
+        return -EINVAL;
+    }
+
+    if (err) {
+        shell_print(sh, "DISC failed (err %d)", err);
+        return err;
+    }
+
+    shell_print(sh, "DISC %s fast_s %u max_off_s %u", disc_state_name(disc_state_get()),
+                cfg.fast_s, cfg.max_off_s);
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(disc, NULL,
+    "Fast discovery: disc [start|stop|<fast_s> <max_off_s>]",
+    cmd_disc, 1, 2);
+
+/* Unprovisioned devices in direct range, with RSSI. */
+static int cmd_unprov(const struct shell *sh, size_t argc, char **argv)
+{
+    if (argc > 1) {
+        if (!strcmp(argv[1], "on")) {
+            unprov_scan_enable(true);
+        } else if (!strcmp(argv[1], "off")) {
+            unprov_scan_enable(false);
+        } else {
+            shell_print(sh, "Usage: unprov [on|off]");
+            return -EINVAL;
+        }
+    }
+
+    shell_print(sh, "UNPROV reports %s", unprov_scan_enabled() ? "on" : "off");
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(unprov, NULL,
+    "Report unprovisioned devices with RSSI: unprov [on|off]",
+    cmd_unprov, 1, 1);
+
+/* Boot phase timestamps of this boot. */
+static int cmd_boot(const struct shell *sh, size_t argc, char **argv)
+{
+    uint32_t prev = 0;
+
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        uint32_t us = boot_time_us(i);
+
+        if (!us) {
+            shell_print(sh, "BOOT %s -", boot_phase_name(i));
+            continue;
+        }
+        shell_print(sh, "BOOT %s %u us (+%u us)", boot_phase_name(i), us, us - prev);
+        prev = us;
+    }
+
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(boot, NULL, "Boot phase timestamps", cmd_boot, 1, 0);
+
+/* Persistence counters since boot; "flush" writes pending state now. */
+static int cmd_appstate(const struct shell *sh, size_t argc, char **argv)
+{
+    struct app_state_stats st;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "flush")) {
+            shell_print(sh, "Usage: appstate [flush]");
+            return -EINVAL;
+        }
+        app_state_flush();
+    }
+
+    app_state_stats_get(&st);
+    shell_print(sh, "APPSTATE changes %u writes %u unchanged %u errors %u "
+                "flash_bytes %u nvs_free %d load_us %u",
+                st.changes, st.writes, st.unchanged, st.errors,
+                st.flash_bytes, st.nvs_free, st.load_us);
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(appstate, NULL,
+    "Persistence counters: appstate [flush]",
+    cmd_appstate, 1, 1);
+
+/* Queueing delay of the application work queues since the last reset. */
+static int cmd_appwq(const struct shell *sh, size_t argc, char **argv)
+{
+    bool reset = argc > 1 && !strcmp(argv[1], "reset");
+
+    for (int i = 0; i < APP_WQ_COUNT; i++) {
+        struct app_wq_stats stats;
+
+        app_wq_stats_get(i, &stats, reset);
+        shell_print(sh, "APPWQ %s runs %u avg_us %u max_us %u", app_wq_name(i),
+                    stats.runs, stats.avg_us, stats.max_us);
+    }
+
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(appwq, NULL,
+    "Application work queue latency: appwq [reset]",
+    cmd_appwq, 1, 1);
+
+/* Transport tuning: read or set Network Transmit, Relay and SAR
+ * Transmitter/Receiver states on a list of nodes. Network Transmit and
+ * Relay requests go out to every node back to back and the replies are
+ * printed by the Config Client callbacks as they arrive. The SAR
+ * Configuration Client has a single pending request, so SAR states are
+ * exchanged one node at a time.
+ */
+#define TXP_SEND_RETRIES 5
+
+typedef int (*txp_op_t)(uint16_t addr, const void *arg);
+
+static void txp_print_sar_tx(uint16_t addr, const struct bt_mesh_sar_tx *tx)
+{
+    printk("TXP 0x%04x sar-tx %u,%u,%u,%u,%u,%u,%u\n", addr,
+           tx->seg_int_step, tx->unicast_retrans_count,
+           tx->unicast_retrans_without_prog_count,
+           tx->unicast_retrans_int_step, tx->unicast_retrans_int_inc,
+           tx->multicast_retrans_count, tx->multicast_retrans_int);
+}
+
+static void txp_print_sar_rx(uint16_t addr, const struct bt_mesh_sar_rx *rx)
+{
+    printk("TXP 0x%04x sar-rx %u,%u,%u,%u,%u\n", addr,
+           rx->seg_thresh, rx->ack_delay_inc, rx->discard_timeout,
+           rx->rx_seg_int_step, rx->ack_retrans_count);
+}
+
+/* Run op on every address in argv[first..], backing off briefly when
+ * the advertising buffers are exhausted by the previous requests.
+ * Returns the number of nodes the request went out to.
+ */
+static int txp_for_each(const struct shell *sh, size_t argc, char **argv,
+                        size_t first, txp_op_t op, const void *arg)
+{
+    int sent = 0;
+    uint16_t addr;
+    int err = 0;
+
+    for (size_t i = first; i < argc; i++) {
+        if (parse_u16(argv[i], &addr)) {
+            shell_print(sh, "Invalid address: %s", argv[i]);
+            continue;
+        }
+
+        for (int retry = 0; retry < TXP_SEND_RETRIES; retry++) {
+            err = op(addr, arg);
+            if (err != -ENOBUFS) {
+                break;
+            }
+            k_sleep(K_MSEC(50));
+        }
+
+        if (err) {
+            printk("TXP 0x%04x failed (err %d)\n", addr, err);
+            continue;
+        }
+
+        sent++;
+    }
+
+    return sent;
+}
+
+/* Every txp command ends with this line; the host waits for it before
+ * sending the next one.
+ */
+static int txp_done(const struct shell *sh, int sent, size_t nodes)
+{
+    shell_print(sh, "TXP done: %d of %u nodes", sent, (unsigned int)nodes);
+    return sent ? 0 : -EIO;
+}
+
+static int txp_get_op(uint16_t addr, const void *arg)
+{
+    int err;
+
+    err = bt_mesh_cfg_cli_net_transmit_get(0, addr, NULL);
+    if (err) {
+        return err;
+    }
+
+    return bt_mesh_cfg_cli_relay_get(0, addr, NULL, NULL);
+}
+
+static int txp_sar_get_op(uint16_t addr, const void *arg)
+{
+    struct bt_mesh_sar_tx tx;
+    struct bt_mesh_sar_rx rx;
+    int err;
+
+    err = bt_mesh_sar_cfg_cli_transmitter_get(0, addr, &tx);
+    if (err) {
+        return err;
+    }
+    txp_print_sar_tx(addr, &tx);
+
+    err = bt_mesh_sar_cfg_cli_receiver_get(0, addr, &rx);
+    if (err) {
+        return err;
+    }
+    txp_print_sar_rx(addr, &rx);
+
+    return 0;
+}
+
+static int txp_net_op(uint16_t addr, const void *arg)
+{
+    return bt_mesh_cfg_cli_net_transmit_set(0, addr, *(const uint8_t *)arg, NULL);
+}
+
+static int txp_relay_op(uint16_t addr, const void *arg)
+{
+    const uint8_t *relay = arg;
+
+    return bt_mesh_cfg_cli_relay_set(0, addr, relay[0], relay[1], NULL, NULL);
+}
+
+static int txp_sar_tx_op(uint16_t addr, const void *arg)
+{
+    struct bt_mesh_sar_tx rsp;
+    int err;
+
+    err = bt_mesh_sar_cfg_cli_transmitter_set(0, addr, arg, &rsp);
+    if (!err) {
+        txp_print_sar_tx(addr, &rsp);
+    }
+
+    return err;
+}
+
+static int txp_sar_rx_op(uint16_t addr, const void *arg)
+{
+    struct bt_mesh_sar_rx rsp;
+    int err;
+
+    err = bt_mesh_sar_cfg_cli_receiver_set(0, addr, arg, &rsp);
+    if (!err) {
+        txp_print_sar_rx(addr, &rsp);
+    }
+
+    return err;
+}
+
+/* Parse "a,b,c" into exactly n byte values. */
+static int parse_u8_list(const char *str, uint8_t *vals, size_t n)
+{
+    char *endptr;
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned long v = strtoul(str, &endptr, 0);
+
+        if (endptr == str || v > UINT8_MAX ||
+            *endptr != (i == n - 1 ? '\0' : ',')) {
+            return -EINVAL;
+        }
+        vals[i] = v;
+        str = endptr + 1;
+    }
+
+    return 0;
+}
+
+/* Parse a transmit count and interval into a Network Transmit / Relay
+ * Retransmit state: 3-bit count, interval in 10 ms steps up to 320 ms.
+ */
+static int parse_transmit(const char *count_str, const char *int_str, uint8_t *transmit)
+{
+    uint16_t count, interval;
+
+    if (parse_u16(count_str, &count) || parse_u16(int_str, &interval) ||
+        count > 7 || interval < 10 || interval > 320 || interval % 10) {
+        return -EINVAL;
+    }
+
+    *transmit = BT_MESH_TRANSMIT(count, interval);
+    return 0;
+}
+
+static int cmd_txp_get(const struct shell *sh, size_t argc, char **argv)
+{
+    int sent;
+
+    sent = txp_for_each(sh, argc, argv, 1, txp_get_op, NULL);
+    if (sent) {
+        txp_for_each(sh, argc, argv, 1, txp_sar_get_op, NULL);
+    }
+
+    return txp_done(sh, sent, argc - 1);
+}
+
+static int cmd_txp_net(const struct shell *sh, size_t argc, char **argv)
+{
+    uint8_t transmit;
+
+    if (parse_transmit(argv[1], argv[2], &transmit)) {
+        shell_print(sh, "Usage: txp net <count 0-7> <interval_ms 10-320> <addr>...");
+        return -EINVAL;
+    }
+
+    return txp_done(sh, txp_for_each(sh, argc, argv, 3, txp_net_op, &transmit), argc - 3);
+}
+
+static int cmd_txp_relay(const struct shell *sh, size_t argc, char **argv)
+{
+    uint8_t relay[2];
+    uint16_t enable;
+
+    if (parse_u16(argv[1], &enable) || enable > 1 ||
+        parse_transmit(argv[2], argv[3], &relay[1])) {
+        shell_print(sh, "Usage: txp relay <0|1> <count 0-7> <interval_ms 10-320> <addr>...");
+        return -EINVAL;
+    }
+    relay[0] = enable;
+
+    return txp_done(sh, txp_for_each(sh, argc, argv, 4, txp_relay_op, relay), argc - 4);
+}
+
+static int cmd_txp_sar_tx(const struct shell *sh, size_t argc, char **argv)
+{
+    struct bt_mesh_sar_tx tx;
+    uint8_t v[7];
+
+    if (parse_u8_list(argv[1], v, ARRAY_SIZE(v))) {
+        shell_print(sh, "Usage: txp sar-tx <seg_int_step,uni_cnt,uni_wo_prog_cnt,"
+                    "uni_int_step,uni_int_inc,multi_cnt,multi_int> <addr>...");
+        return -EINVAL;
+    }
+
+    tx = (struct bt_mesh_sar_tx){
+        .seg_int_step = v[0],
+        .unicast_retrans_count = v[1],
+        .unicast_retrans_without_prog_count = v[2],
+        .unicast_retrans_int_step = v[3],
+        .unicast_retrans_int_inc = v[4],
+        .multicast_retrans_count = v[5],
+        .multicast_retrans_int = v[6],
+    };
+
+    return txp_done(sh, txp_for_each(sh, argc, argv, 2, txp_sar_tx_op, &tx), argc - 2);
+}
+
+static int cmd_txp_sar_rx(const struct shell *sh, size_t argc, char **argv)
+{
+    struct bt_mesh_sar_rx rx;
+    uint8_t v[5];
+
+    if (parse_u8_list(argv[1], v, ARRAY_SIZE(v))) {
+        shell_print(sh, "Usage: txp sar-rx <seg_thresh,ack_delay_inc,discard_timeout,"
+                    "seg_int_step,ack_retrans_cnt> <addr>...");
+        return -EINVAL;
+    }
+
+    rx = (struct bt_mesh_sar_rx){
+        .seg_thresh = v[0],
+        .ack_delay_inc = v[1],
+        .discard_timeout = v[2],
+        .rx_seg_int_step = v[3],
+        .ack_retrans_count = v[4],
+    };
+
+    return txp_done(sh, txp_for_each(sh, argc, argv, 2, txp_sar_rx_op, &rx), argc - 2);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(txp_cmds,
+    SHELL_CMD_ARG(get, NULL, "Read transport states: get <addr>...",
+                  cmd_txp_get, 2, CONFIG_SHELL_ARGC_MAX - 2),
+    SHELL_CMD_ARG(net, NULL, "Network Transmit: net <count> <interval_ms> <addr>...",
+                  cmd_txp_net, 4, CONFIG_SHELL_ARGC_MAX - 4),
+    SHELL_CMD_ARG(relay, NULL, "Relay: relay <0|1> <count> <interval_ms> <addr>...",
+                  cmd_txp_relay, 5, CONFIG_SHELL_ARGC_MAX - 5),
+    SHELL_CMD_ARG(sar-tx, NULL, "SAR Transmitter: sar-tx <v1,...,v7> <addr>...",
+                  cmd_txp_sar_tx, 3, CONFIG_SHELL_ARGC_MAX - 3),
+    SHELL_CMD_ARG(sar-rx, NULL, "SAR Receiver: sar-rx <v1,...,v5> <addr>...",
+                  cmd_txp_sar_rx, 3, CONFIG_SHELL_ARGC_MAX - 3),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(txp, &txp_cmds, "Transport parameter tuning", NULL);
+
+/* Measure delivery ratio and round-trip time to a list of nodes with
+ * OnOff Gets. Per-node results are printed when the probe completes.
+ */
+static int cmd_probe(const struct shell *sh, size_t argc, char **argv)
+{
+    uint16_t rounds, interval_ms;
+
+    if (probe.active) {
+        shell_print(sh, "Probe already running");
+        return -EBUSY;
+    }
+
+    if (parse_u16(argv[1], &rounds) || rounds == 0 ||
+        parse_u16(argv[2], &interval_ms) || interval_ms < 50) {
+        shell_print(sh, "Usage: probe <rounds> <interval_ms> <addr>...");
+        return -EINVAL;
+    }
+
+    if (argc - 3 > PROBE_TARGETS_MAX) {
+        shell_print(sh, "At most %d nodes per probe", PROBE_TARGETS_MAX);
+        return -EINVAL;
+    }
+
+    memset(probe.targets, 0, sizeof(probe.targets));
+    probe.count = 0;
+    for (size_t i = 3; i < argc; i++) {
+        if (parse_u16(argv[i], &probe.targets[probe.count].addr)) {
+            shell_print(sh, "Invalid address: %s", argv[i]);
+            return -EINVAL;
+        }
+        probe.count++;
+    }
+
+    probe.rounds = rounds;
+    probe.round = 0;
+    probe.next = 0;
+    probe.interval_ms = interval_ms;
+    probe.active = true;
+    app_work_submit(&probe.work);
+
+    shell_print(sh, "PROBE started: %u rounds to %u nodes", rounds,
+                (unsigned int)probe.count);
+    return 0;
+}
+
+SHELL_CMD_ARG_REGISTER(probe, NULL,
+    "Measure delivery and RTT: probe <rounds> <interval_ms> <addr>...",
+    cmd_probe, 4, CONFIG_SHELL_ARGC_MAX - 4);
+
+/* ---------------------------------------------------------------------
+ * main()
+ * --------------------------------------------------------------------- */
+int main(void)
+{
+    int err;
+
+    boot_mark(BOOT_MAIN);
+    printk("Initializing...\n");
+
+    /* Application work runs on its own queues, apart from the mesh
+     * stack's system work queue. Ready before the button interrupt is.
+     */
+    app_wq_init();
+    scene_srv_init(&onoff_scene_cb);
+    gesture_init(button_read, button_gesture);
+    app_work_init(&led_work, APP_WQ_ACTUATION, led_work_handler);
+    app_work_init(&onoff_pub_work, APP_WQ_ACTUATION, onoff_pub_work_handler);
+    app_work_init(&probe.work, APP_WQ_TELEMETRY, probe_work_handler);
+
+    /* Restore the application state before the LED is configured. */
+    app_state_register(&onoff_persist);
+    disc_init();
+    err = app_state_load();
+    if (err) {
+        printk("App state load failed (err %d)\n", err);
+    } else {
+        struct app_state_stats st;
+
+        app_state_stats_get(&st);
+        printk("App state restored in %u us (onoff %u)\n", st.load_us, g_onoff_state.val);
+    }
+    boot_mark(BOOT_STATE);
+
+    /* Initialize board-level hardware: LED & button. */
+    err = board_init();
+    if (err) {
+        printk("board_init failed (err %d)\n", err);
+        return 0;
+    }
+    boot_mark(BOOT_BOARD);
 
     /* Initialize Bluetooth. Provide the callback that sets up mesh. */
     err = bt_enable(bt_ready);
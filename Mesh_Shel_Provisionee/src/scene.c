@@ -0,0 +1,417 @@
+/*
+ * scene.c - Scene Server, Scene Setup Server and Scene Client.
+ *
+ * A scene is a snapshot of the node's state under a 16-bit number. The
+ * host stores the same scene number on every node after setting each
+ * node to its own state; one Scene Recall to a group then restores the
+ * whole layout with a single message. The register is kept in the model
+ * settings, so stored scenes survive a reboot; the flash write runs on
+ * the application work queue, not in the mesh RX path.
+ *
+ * Transition times are not supported (this node has no Default
+ * Transition Time Server): a recall applies immediately and the
+ * optional transition fields are ignored.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#include "app_wq.h"
+#include "scene.h"
+
+/* Status codes */
+#define SCENE_SUCCESS        0x00
+#define SCENE_REGISTER_FULL  0x01
+#define SCENE_NOT_FOUND      0x02
+
+/* A repeated Recall with the same TID from the same source within this
+ * time is a retransmission.
+ */
+#define SCENE_TID_TIMEOUT_MS 6000
+
+struct scene_entry {
+    uint16_t number;        /* 0: free */
+    uint8_t len;
+    uint8_t data[SCENE_DATA_MAX];
+};
+
+static struct {
+    const struct scene_state_cb *cb;
+    const struct bt_mesh_model *srv_model;
+    const struct bt_mesh_model *cli_model;
+    struct scene_entry entries[SCENE_COUNT];
+    uint16_t current;
+    uint16_t last_src;
+    uint8_t last_tid;
+    int64_t last_recall;
+    struct app_work store_work;
+} scene;
+
+static struct scene_entry *scene_find(uint16_t number)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(scene.entries); i++) {
+        if (scene.entries[i].number == number) {
+            return &scene.entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void scene_store_work_handler(struct k_work *work)
+{
+    int err;
+
+    err = bt_mesh_model_data_store(scene.srv_model, false, NULL, scene.entries,
+                                   sizeof(scene.entries));
+    if (err) {
+        printk("Scene register store failed (err %d)\n", err);
+    }
+}
+
+/* A store already pending writes the register as it is when it runs */
+static void scene_save(void)
+{
+    if (!k_work_delayable_is_pending(&scene.store_work.dwork)) {
+        app_work_submit(&scene.store_work);
+    }
+}
+
+void scene_srv_init(const struct scene_state_cb *cb)
+{
+    scene.cb = cb;
+    app_work_init(&scene.store_work, APP_WQ_TELEMETRY, scene_store_work_handler);
+}
+
+void scene_srv_invalidate(void)
+{
+    scene.current = 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Scene Server
+ * --------------------------------------------------------------------- */
+static int scene_status_send(const struct bt_mesh_model *model,
+                             struct bt_mesh_msg_ctx *ctx, uint8_t status)
+{
+    BT_MESH_MODEL_BUF_DEFINE(rsp, OP_SCENE_STATUS, 3);
+
+    bt_mesh_model_msg_init(&rsp, OP_SCENE_STATUS);
+    net_buf_simple_add_u8(&rsp, status);
+    net_buf_simple_add_le16(&rsp, scene.current);
+    return bt_mesh_model_send(model, ctx, &rsp, NULL, NULL);
+}
+
+static int scene_register_status_send(const struct bt_mesh_model *model,
+                                      struct bt_mesh_msg_ctx *ctx, uint8_t status)
+{
+    BT_MESH_MODEL_BUF_DEFINE(rsp, OP_SCENE_REGISTER_STATUS, 3 + SCENE_COUNT * 2);
+
+    bt_mesh_model_msg_init(&rsp, OP_SCENE_REGISTER_STATUS);
+    net_buf_simple_add_u8(&rsp, status);
+    net_buf_simple_add_le16(&rsp, scene.current);
+    for (size_t i = 0; i < ARRAY_SIZE(scene.entries); i++) {
+        if (scene.entries[i].number) {
+            net_buf_simple_add_le16(&rsp, scene.entries[i].number);
+        }
+    }
+
+    return bt_mesh_model_send(model, ctx, &rsp, NULL, NULL);
+}
+
+static int handle_scene_get(const struct bt_mesh_model *model,
+                            struct bt_mesh_msg_ctx *ctx,
+                            struct net_buf_simple *buf)
+{
+    return scene_status_send(model, ctx, SCENE_SUCCESS);
+}
+
+static uint8_t scene_recall(struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
+{
+    uint16_t number = net_buf_simple_pull_le16(buf);
+    uint8_t tid = net_buf_simple_pull_u8(buf);
+    int64_t now = k_uptime_get();
+    struct scene_entry *entry;
+
+    if (!number) {
+        return SCENE_NOT_FOUND;
+    }
+
+    if (ctx->addr == scene.last_src && tid == scene.last_tid &&
+        now - scene.last_recall < SCENE_TID_TIMEOUT_MS) {
+        return SCENE_SUCCESS;
+    }
+    scene.last_src = ctx->addr;
+    scene.last_tid = tid;
+    scene.last_recall = now;
+
+    entry = scene_find(number);
+    if (!entry) {
+        return SCENE_NOT_FOUND;
+    }
+
+    if (scene.cb) {
+        scene.cb->recall(entry->data, entry->len);
+    }
+    scene.current = number;
+    return SCENE_SUCCESS;
+}
+
+static int handle_scene_recall(const struct bt_mesh_model *model,
+                               struct bt_mesh_msg_ctx *ctx,
+                               struct net_buf_simple *buf)
+{
+    return scene_status_send(model, ctx, scene_recall(ctx, buf));
+}
+
+static int handle_scene_recall_unack(const struct bt_mesh_model *model,
+                                     struct bt_mesh_msg_ctx *ctx,
+                                     struct net_buf_simple *buf)
+{
+    scene_recall(ctx, buf);
+    return 0;
+}
+
+static int handle_scene_register_get(const struct bt_mesh_model *model,
+                                     struct bt_mesh_msg_ctx *ctx,
+                                     struct net_buf_simple *buf)
+{
+    return scene_register_status_send(model, ctx, SCENE_SUCCESS);
+}
+
+/* Recall: scene (le16), TID (u8), optionally transition time and delay */
+const struct bt_mesh_model_op scene_srv_ops[] = {
+    { OP_SCENE_GET,          BT_MESH_LEN_EXACT(0), handle_scene_get          },
+    { OP_SCENE_RECALL,       BT_MESH_LEN_MIN(3),   handle_scene_recall       },
+    { OP_SCENE_RECALL_UNACK, BT_MESH_LEN_MIN(3),   handle_scene_recall_unack },
+    { OP_SCENE_REGISTER_GET, BT_MESH_LEN_EXACT(0), handle_scene_register_get },
+    BT_MESH_MODEL_OP_END,
+};
+
+static int scene_srv_init_cb(const struct bt_mesh_model *model)
+{
+    scene.srv_model = model;
+    return 0;
+}
+
+static int scene_srv_settings_set(const struct bt_mesh_model *model,
+                                  const char *name, size_t len_rd,
+                                  settings_read_cb read_cb, void *cb_arg)
+{
+    ssize_t len;
+
+    if (name) {
+        return -ENOENT;
+    }
+
+    memset(scene.entries, 0, sizeof(scene.entries));
+    len = read_cb(cb_arg, scene.entries, MIN(len_rd, sizeof(scene.entries)));
+    return len < 0 ? len : 0;
+}
+
+static void scene_srv_reset(const struct bt_mesh_model *model)
+{
+    (void)k_work_cancel_delayable(&scene.store_work.dwork);
+    memset(scene.entries, 0, sizeof(scene.entries));
+    scene.current = 0;
+    (void)bt_mesh_model_data_store(model, false, NULL, NULL, 0);
+}
+
+const struct bt_mesh_model_cb scene_srv_cb = {
+    .init = scene_srv_init_cb,
+    .settings_set = scene_srv_settings_set,
+    .reset = scene_srv_reset,
+};
+
+/* ---------------------------------------------------------------------
+ * Scene Setup Server
+ * --------------------------------------------------------------------- */
+static uint8_t scene_store(uint16_t number)
+{
+    struct scene_entry *entry;
+
+    if (!number) {
+        return SCENE_NOT_FOUND;
+    }
+
+    entry = scene_find(number);
+    if (!entry) {
+        entry = scene_find(0);
+    }
+    if (!entry) {
+        return SCENE_REGISTER_FULL;
+    }
+
+    entry->number = number;
+    entry->len = scene.cb ? scene.cb->store(entry->data, sizeof(entry->data)) : 0;
+    scene.current = number;
+    scene_save();
+    return SCENE_SUCCESS;
+}
+
+static uint8_t scene_delete(uint16_t number)
+{
+    struct scene_entry *entry = number ? scene_find(number) : NULL;
+
+    if (entry) {
+        memset(entry, 0, sizeof(*entry));
+        scene_save();
+    }
+    if (scene.current == number) {
+        scene.current = 0;
+    }
+
+    /* Deleting a scene that does not exist is not an error */
+    return SCENE_SUCCESS;
+}
+
+static int handle_scene_store(const struct bt_mesh_model *model,
+                              struct bt_mesh_msg_ctx *ctx,
+                              struct net_buf_simple *buf)
+{
+    uint8_t status = scene_store(net_buf_simple_pull_le16(buf));
+
+    return scene_register_status_send(model, ctx, status);
+}
+
+static int handle_scene_store_unack(const struct bt_mesh_model *model,
+                                    struct bt_mesh_msg_ctx *ctx,
+                                    struct net_buf_simple *buf)
+{
+    scene_store(net_buf_simple_pull_le16(buf));
+    return 0;
+}
+
+static int handle_scene_delete(const struct bt_mesh_model *model,
+                               struct bt_mesh_msg_ctx *ctx,
+                               struct net_buf_simple *buf)
+{
+    uint8_t status = scene_delete(net_buf_simple_pull_le16(buf));
+
+    return scene_register_status_send(model, ctx, status);
+}
+
+static int handle_scene_delete_unack(const struct bt_mesh_model *model,
+                                     struct bt_mesh_msg_ctx *ctx,
+                                     struct net_buf_simple *buf)
+{
+    scene_delete(net_buf_simple_pull_le16(buf));
+    return 0;
+}
+
+const struct bt_mesh_model_op scene_setup_srv_ops[] = {
+    { OP_SCENE_STORE,        BT_MESH_LEN_EXACT(2), handle_scene_store        },
+    { OP_SCENE_STORE_UNACK,  BT_MESH_LEN_EXACT(2), handle_scene_store_unack  },
+    { OP_SCENE_DELETE,       BT_MESH_LEN_EXACT(2), handle_scene_delete       },
+    { OP_SCENE_DELETE_UNACK, BT_MESH_LEN_EXACT(2), handle_scene_delete_unack },
+    BT_MESH_MODEL_OP_END,
+};
+
+/* The Setup Server extends the Scene Server; models are initialized in
+ * element order, so the Scene Server is known by now.
+ */
+static int scene_setup_srv_init_cb(const struct bt_mesh_model *model)
+{
+    if (!scene.srv_model) {
+        return -EINVAL;
+    }
+
+    return bt_mesh_model_extend(model, scene.srv_model);
+}
+
+const struct bt_mesh_model_cb scene_setup_srv_cb = {
+    .init = scene_setup_srv_init_cb,
+};
+
+/* ---------------------------------------------------------------------
+ * Scene Client
+ * --------------------------------------------------------------------- */
+static int handle_scene_status(const struct bt_mesh_model *model,
+                               struct bt_mesh_msg_ctx *ctx,
+                               struct net_buf_simple *buf)
+{
+    uint8_t status = net_buf_simple_pull_u8(buf);
+    uint16_t current = net_buf_simple_pull_le16(buf);
+
+    printk("SCENE 0x%04x status %u current %u\n", ctx->addr, status, current);
+    return 0;
+}
+
+static int handle_scene_register_status(const struct bt_mesh_model *model,
+                                        struct bt_mesh_msg_ctx *ctx,
+                                        struct net_buf_simple *buf)
+{
+    char line[160];
+    uint8_t status = net_buf_simple_pull_u8(buf);
+    uint16_t current = net_buf_simple_pull_le16(buf);
+    int len;
+
+    len = snprintk(line, sizeof(line), "SCENE 0x%04x status %u current %u scenes",
+                   ctx->addr, status, current);
+    for (char sep = ' '; buf->len >= 2 && len < (int)sizeof(line); sep = ',') {
+        len += snprintk(&line[len], sizeof(line) - len, "%c%u", sep,
+                        net_buf_simple_pull_le16(buf));
+    }
+
+    printk("%s\n", line);
+    return 0;
+}
+
+const struct bt_mesh_model_op scene_cli_ops[] = {
+    { OP_SCENE_STATUS,          BT_MESH_LEN_MIN(3), handle_scene_status          },
+    { OP_SCENE_REGISTER_STATUS, BT_MESH_LEN_MIN(3), handle_scene_register_status },
+    BT_MESH_MODEL_OP_END,
+};
+
+static int scene_cli_init_cb(const struct bt_mesh_model *model)
+{
+    scene.cli_model = model;
+    return 0;
+}
+
+const struct bt_mesh_model_cb scene_cli_cb = {
+    .init = scene_cli_init_cb,
+};
+
+int scene_cli_send(uint16_t net_idx, uint16_t app_idx, uint16_t addr,
+                   uint32_t opcode, uint16_t number)
+{
+    static uint8_t tid;
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = net_idx,
+        .app_idx = app_idx,
+        .addr = addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+
+    if (!scene.cli_model) {
+        return -ENODEV;
+    }
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_SCENE_RECALL, 3);
+    bt_mesh_model_msg_init(&msg, opcode);
+
+    switch (opcode) {
+    case OP_SCENE_RECALL:
+    case OP_SCENE_RECALL_UNACK:
+        net_buf_simple_add_le16(&msg, number);
+        net_buf_simple_add_u8(&msg, tid++);
+        break;
+    case OP_SCENE_STORE:
+    case OP_SCENE_STORE_UNACK:
+    case OP_SCENE_DELETE:
+    case OP_SCENE_DELETE_UNACK:
+        net_buf_simple_add_le16(&msg, number);
+        break;
+    default:
+        break;
+    }
+
+    return bt_mesh_model_send(scene.cli_model, &ctx, &msg, NULL, NULL);
+}
@@ -0,0 +1,70 @@
+/*
+ * scene.h - Scene Server, Scene Setup Server and Scene Client.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SCENE_H__
+#define SCENE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#define OP_SCENE_GET             BT_MESH_MODEL_OP_2(0x82, 0x41)
+#define OP_SCENE_RECALL          BT_MESH_MODEL_OP_2(0x82, 0x42)
+#define OP_SCENE_RECALL_UNACK    BT_MESH_MODEL_OP_2(0x82, 0x43)
+#define OP_SCENE_STATUS          BT_MESH_MODEL_OP_1(0x5e)
+#define OP_SCENE_REGISTER_GET    BT_MESH_MODEL_OP_2(0x82, 0x44)
+#define OP_SCENE_REGISTER_STATUS BT_MESH_MODEL_OP_2(0x82, 0x45)
+#define OP_SCENE_STORE           BT_MESH_MODEL_OP_2(0x82, 0x46)
+#define OP_SCENE_STORE_UNACK     BT_MESH_MODEL_OP_2(0x82, 0x47)
+#define OP_SCENE_DELETE          BT_MESH_MODEL_OP_2(0x82, 0x9e)
+#define OP_SCENE_DELETE_UNACK    BT_MESH_MODEL_OP_2(0x82, 0x9f)
+
+/* Scene register size and the state bytes kept per scene */
+#define SCENE_COUNT    16
+#define SCENE_DATA_MAX 4
+
+/* The application's state a scene captures and restores. */
+struct scene_state_cb {
+    /* Write the current state to data, return its length. */
+    size_t (*store)(uint8_t *data, size_t max);
+    /* Apply a stored state. */
+    void (*recall)(const uint8_t *data, size_t len);
+};
+
+extern const struct bt_mesh_model_op scene_srv_ops[];
+extern const struct bt_mesh_model_op scene_setup_srv_ops[];
+extern const struct bt_mesh_model_op scene_cli_ops[];
+extern const struct bt_mesh_model_cb scene_srv_cb;
+extern const struct bt_mesh_model_cb scene_setup_srv_cb;
+extern const struct bt_mesh_model_cb scene_cli_cb;
+
+/* Scene Server with its Setup Server, plus the client the provisioner
+ * uses. All three on the same element.
+ */
+#define SCENE_MODELS                                                          \
+    BT_MESH_MODEL_CB(BT_MESH_MODEL_ID_SCENE_SRV, scene_srv_ops, NULL, NULL,   \
+                     &scene_srv_cb),                                          \
+    BT_MESH_MODEL_CB(BT_MESH_MODEL_ID_SCENE_SETUP_SRV, scene_setup_srv_ops,   \
+                     NULL, NULL, &scene_setup_srv_cb),                        \
+    BT_MESH_MODEL_CB(BT_MESH_MODEL_ID_SCENE_CLI, scene_cli_ops, NULL, NULL,   \
+                     &scene_cli_cb)
+
+/* Register the state callbacks. Call after app_wq_init() and before
+ * settings_load().
+ */
+void scene_srv_init(const struct scene_state_cb *cb);
+
+/* The state changed outside a scene recall: no scene is current. */
+void scene_srv_invalidate(void);
+
+/* Send a Scene Client message; the reply is printed as a
+ * "SCENE <addr> status <s> current <n> [scenes <n>,...]" line. Scene is
+ * ignored for Get and Register Get.
+ */
+int scene_cli_send(uint16_t net_idx, uint16_t app_idx, uint16_t addr,
+                   uint32_t opcode, uint16_t scene);
+
+#endif /* SCENE_H__ */
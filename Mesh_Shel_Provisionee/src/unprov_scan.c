@@ -0,0 +1,134 @@
+/*
+ * unprov_scan.c - Unprovisioned device reports with RSSI.
+ *
+ * The mesh shell's beacon-listen prints the UUID of every device but not
+ * how well it was heard. This listens to the same scanner (the mesh stack
+ * keeps it running) through a scan callback of its own and adds the RSSI,
+ * so the host can provision the strongest devices first.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+#include "unprov_scan.h"
+
+#define BEACON_TYPE_UNPROVISIONED 0x00
+
+struct unprov_info {
+    const uint8_t *uuid;
+    uint16_t oob;
+    bool gatt;
+};
+
+static struct {
+    uint8_t uuid[16];
+    bool gatt;
+    int64_t last_ms;
+} seen[UNPROV_SCAN_TRACKED];
+
+static bool enabled;
+static bool registered;
+
+/* True if the device was reported too recently to report it again. */
+static bool rate_limited(const struct unprov_info *info)
+{
+    int64_t now = k_uptime_get();
+    size_t oldest = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(seen); i++) {
+        if (seen[i].gatt == info->gatt && !memcmp(seen[i].uuid, info->uuid, 16)) {
+            if (now - seen[i].last_ms < UNPROV_SCAN_REPORT_MS) {
+                return true;
+            }
+            seen[i].last_ms = now;
+            return false;
+        }
+        if (seen[i].last_ms < seen[oldest].last_ms) {
+            oldest = i;
+        }
+    }
+
+    memcpy(seen[oldest].uuid, info->uuid, 16);
+    seen[oldest].gatt = info->gatt;
+    seen[oldest].last_ms = now;
+    return false;
+}
+
+static bool ad_parse(struct bt_data *data, void *user_data)
+{
+    struct unprov_info *info = user_data;
+
+    /* Unprovisioned Device beacon: type, UUID, OOB, [URI hash] */
+    if (data->type == BT_DATA_MESH_BEACON && data->data_len >= 19 &&
+        data->data[0] == BEACON_TYPE_UNPROVISIONED) {
+        info->uuid = &data->data[1];
+        info->oob = sys_get_be16(&data->data[17]);
+        info->gatt = false;
+        return false;
+    }
+
+    /* Mesh Provisioning Service data: service UUID, UUID, OOB */
+    if (data->type == BT_DATA_SVC_DATA16 && data->data_len >= 20 &&
+        sys_get_le16(data->data) == BT_UUID_MESH_PROV_VAL) {
+        info->uuid = &data->data[2];
+        info->oob = sys_get_be16(&data->data[18]);
+        info->gatt = true;
+        return false;
+    }
+
+    return true;
+}
+
+static void scan_recv(const struct bt_le_scan_recv_info *recv, struct net_buf_simple *buf)
+{
+    struct unprov_info info = { 0 };
+    struct net_buf_simple_state state;
+    char uuid_hex[32 + 1];
+
+    if (!enabled) {
+        return;
+    }
+
+    /* The buffer is shared with the mesh stack's own scan callback */
+    net_buf_simple_save(buf, &state);
+    bt_data_parse(buf, ad_parse, &info);
+    net_buf_simple_restore(buf, &state);
+
+    if (!info.uuid || rate_limited(&info)) {
+        return;
+    }
+
+    bin2hex(info.uuid, 16, uuid_hex, sizeof(uuid_hex));
+    printk("UNPROV uuid %s oob 0x%04x rssi %d bearer %s\n", uuid_hex, info.oob,
+           recv->rssi, info.gatt ? "gatt" : "adv");
+}
+
+static struct bt_le_scan_cb scan_cb = {
+    .recv = scan_recv,
+};
+
+void unprov_scan_enable(bool enable)
+{
+    if (enable && !registered) {
+        bt_le_scan_cb_register(&scan_cb);
+        registered = true;
+    }
+
+    if (enable && !enabled) {
+        memset(seen, 0, sizeof(seen));
+    }
+
+    enabled = enable;
+}
+
+bool unprov_scan_enabled(void)
+{
+    return enabled;
+}
@@ -0,0 +1,25 @@
+/*
+ * unprov_scan.h - Unprovisioned device reports with RSSI.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef UNPROV_SCAN_H__
+#define UNPROV_SCAN_H__
+
+#include <stdbool.h>
+
+/* Devices tracked for rate limiting; more are still reported, just
+ * without the limit.
+ */
+#define UNPROV_SCAN_TRACKED   16
+#define UNPROV_SCAN_REPORT_MS 1000
+
+/* Print "UNPROV uuid <hex> oob 0x<oob> rssi <dBm> bearer <adv|gatt>" for
+ * unprovisioned beacons and PB-GATT advertising the dongle hears, at
+ * most once per UNPROV_SCAN_REPORT_MS per device and bearer.
+ */
+void unprov_scan_enable(bool enable);
+bool unprov_scan_enabled(void);
+
+#endif /* UNPROV_SCAN_H__ */
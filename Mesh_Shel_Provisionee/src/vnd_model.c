@@ -0,0 +1,780 @@
+/*
+ * vnd_model.c - Vendor diagnostics model.
+ *
+ * Both roles in one model: every node answers the Get messages and
+ * publishes Beats, the provisioner dongle sends the Gets and prints the
+ * Status replies and received Beats for the host to parse.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#include "app_wq.h"
+#include "diag.h"
+#include "vnd_model.h"
+
+static const struct bt_mesh_model *vnd_model;
+
+/* Application sends that failed for lack of advertising buffers; the
+ * stack does not count these itself.
+ */
+static atomic_t enobufs_count;
+
+/* ---------------------------------------------------------------------
+ * Statistics
+ * --------------------------------------------------------------------- */
+
+/* Stats Status parameters, all little-endian uint16, saturated: */
+enum {
+    STAT_RX_ADV,
+    STAT_RX_LOOPBACK,
+    STAT_RX_PROXY,
+    STAT_RX_UNKNOWN,
+    STAT_RELAY_PLANNED,
+    STAT_RELAY_SUCCEEDED,
+    STAT_LOCAL_PLANNED,
+    STAT_LOCAL_SUCCEEDED,
+    STAT_FRIEND_PLANNED,
+    STAT_FRIEND_SUCCEEDED,
+    STAT_ENOBUFS,
+    STAT_COUNT,
+};
+
+static const char *const stat_names[STAT_COUNT] = {
+    [STAT_RX_ADV] = "rx_adv",
+    [STAT_RX_LOOPBACK] = "rx_loopback",
+    [STAT_RX_PROXY] = "rx_proxy",
+    [STAT_RX_UNKNOWN] = "rx_unknown",
+    [STAT_RELAY_PLANNED] = "relay_planned",
+    [STAT_RELAY_SUCCEEDED] = "relay_succeeded",
+    [STAT_LOCAL_PLANNED] = "local_planned",
+    [STAT_LOCAL_SUCCEEDED] = "local_succeeded",
+    [STAT_FRIEND_PLANNED] = "friend_planned",
+    [STAT_FRIEND_SUCCEEDED] = "friend_succeeded",
+    [STAT_ENOBUFS] = "enobufs",
+};
+
+void vnd_stats_send_result(int err)
+{
+    if (err == -ENOBUFS) {
+        atomic_inc(&enobufs_count);
+    }
+}
+
+static void stats_add(struct net_buf_simple *buf, uint32_t val)
+{
+    net_buf_simple_add_le16(buf, MIN(val, UINT16_MAX));
+}
+
+/* Stats Get: one optional byte, non-zero to reset after reporting. The
+ * host polls with reset and accumulates, so 16 bits per counter are
+ * enough between two polls.
+ */
+static int handle_stats_get(const struct bt_mesh_model *model,
+                            struct bt_mesh_msg_ctx *ctx,
+                            struct net_buf_simple *buf)
+{
+    BT_MESH_MODEL_BUF_DEFINE(rsp, OP_VND_STATS_STATUS, STAT_COUNT * 2);
+    struct bt_mesh_statistic st;
+    bool reset = buf->len && net_buf_simple_pull_u8(buf);
+    int err;
+
+    bt_mesh_stat_get(&st);
+
+    bt_mesh_model_msg_init(&rsp, OP_VND_STATS_STATUS);
+    stats_add(&rsp, st.rx_adv);
+    stats_add(&rsp, st.rx_loopback);
+    stats_add(&rsp, st.rx_proxy);
+    stats_add(&rsp, st.rx_uknown);
+    stats_add(&rsp, st.tx_adv_relay_planned);
+    stats_add(&rsp, st.tx_adv_relay_succeeded);
+    stats_add(&rsp, st.tx_local_planned);
+    stats_add(&rsp, st.tx_local_succeeded);
+    stats_add(&rsp, st.tx_friend_planned);
+    stats_add(&rsp, st.tx_friend_succeeded);
+    stats_add(&rsp, atomic_get(&enobufs_count));
+
+    if (reset) {
+        bt_mesh_stat_reset();
+        atomic_clear(&enobufs_count);
+    }
+
+    err = bt_mesh_model_send(model, ctx, &rsp, NULL, NULL);
+    vnd_stats_send_result(err);
+    return err;
+}
+
+static int handle_stats_status(const struct bt_mesh_model *model,
+                               struct bt_mesh_msg_ctx *ctx,
+                               struct net_buf_simple *buf)
+{
+    char line[256];
+    int len;
+
+    len = snprintk(line, sizeof(line), "STATS 0x%04x", ctx->addr);
+    for (int i = 0; i < STAT_COUNT && len < (int)sizeof(line); i++) {
+        len += snprintk(&line[len], sizeof(line) - len, " %s=%u",
+                        stat_names[i], net_buf_simple_pull_le16(buf));
+    }
+
+    printk("%s\n", line);
+    return 0;
+}
+
+int vnd_stats_get(uint16_t net_idx, uint16_t app_idx, uint16_t addr, bool reset)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = net_idx,
+        .app_idx = app_idx,
+        .addr = addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    int err;
+
+    if (!vnd_model) {
+        return -ENODEV;
+    }
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_STATS_GET, 1);
+    bt_mesh_model_msg_init(&msg, OP_VND_STATS_GET);
+    net_buf_simple_add_u8(&msg, reset);
+
+    err = bt_mesh_model_send(vnd_model, &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Beat: liveness and hop count
+ *
+ * The Heartbeat Subscription state tracks a single source address, so
+ * the provisioner cannot follow every node's Heartbeat messages. Nodes
+ * instead publish a Beat carrying the same fields (initial TTL and
+ * features) periodically to the provisioner, and the hop count is
+ * derived from the received TTL exactly as for Heartbeat. The Beat also
+ * carries the PID and VID of the Composition Data, which still fits an
+ * unsegmented message.
+ * --------------------------------------------------------------------- */
+static int vnd_pub_update(const struct bt_mesh_model *model)
+{
+    struct net_buf_simple *msg = model->pub->msg;
+    uint8_t ttl = model->pub->ttl;
+    uint16_t feat = 0;
+
+    if (ttl == BT_MESH_TTL_DEFAULT) {
+        ttl = bt_mesh_default_ttl_get();
+    }
+
+    if (bt_mesh_relay_get() == BT_MESH_FEATURE_ENABLED) {
+        feat |= VND_BEAT_FEAT_RELAY;
+    }
+    if (bt_mesh_gatt_proxy_get() == BT_MESH_FEATURE_ENABLED) {
+        feat |= VND_BEAT_FEAT_PROXY;
+    }
+    if (bt_mesh_friend_get() == BT_MESH_FEATURE_ENABLED) {
+        feat |= VND_BEAT_FEAT_FRIEND;
+    }
+
+    bt_mesh_model_msg_init(msg, OP_VND_BEAT);
+    net_buf_simple_add_u8(msg, ttl);
+    net_buf_simple_add_le16(msg, feat);
+    net_buf_simple_add_le16(msg, VND_COMP_PID);
+    net_buf_simple_add_le16(msg, VND_COMP_VID);
+    return 0;
+}
+
+BT_MESH_MODEL_PUB_DEFINE(vnd_pub, vnd_pub_update, 3 + 7);
+
+static int handle_beat(const struct bt_mesh_model *model,
+                       struct bt_mesh_msg_ctx *ctx,
+                       struct net_buf_simple *buf)
+{
+    uint8_t init_ttl = net_buf_simple_pull_u8(buf) & BIT_MASK(7);
+    uint16_t feat = net_buf_simple_pull_le16(buf);
+    uint16_t pid, vid;
+
+    if (ctx->recv_ttl > init_ttl) {
+        return -EINVAL;
+    }
+
+    /* Nodes running older firmware send the Beat without PID and VID */
+    if (buf->len < 4) {
+        printk("HB 0x%04x hops %u ttl %u feat 0x%04x rssi %d\n", ctx->addr,
+               init_ttl - ctx->recv_ttl + 1, init_ttl, feat, ctx->recv_rssi);
+        return 0;
+    }
+
+    pid = net_buf_simple_pull_le16(buf);
+    vid = net_buf_simple_pull_le16(buf);
+    printk("HB 0x%04x hops %u ttl %u feat 0x%04x rssi %d pid 0x%04x vid 0x%04x\n",
+           ctx->addr, init_ttl - ctx->recv_ttl + 1, init_ttl, feat, ctx->recv_rssi,
+           pid, vid);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Neighbor discovery
+ *
+ * Hellos are sent with TTL 0 so they are never relayed: every node that
+ * hears one is a direct neighbor of the sender. Each discovery round has
+ * a number; the table is cleared when a node first sees a newer round,
+ * whether through the request or through an early neighbor's Hello.
+ * --------------------------------------------------------------------- */
+#define NBR_MAX 16
+
+struct nbr_entry {
+    uint16_t addr;
+    int8_t rssi;        /* Running average */
+    uint8_t count;
+};
+
+static struct {
+    struct nbr_entry entries[NBR_MAX];
+    uint8_t round;
+    uint16_t net_idx;
+    uint16_t app_idx;
+    struct app_work hello_work;
+} nbr;
+
+static void nbr_round_start(uint8_t round)
+{
+    if (round == nbr.round) {
+        return;
+    }
+
+    nbr.round = round;
+    memset(nbr.entries, 0, sizeof(nbr.entries));
+}
+
+static void nbr_record(uint16_t addr, int8_t rssi)
+{
+    struct nbr_entry *weakest = &nbr.entries[0];
+
+    for (int i = 0; i < NBR_MAX; i++) {
+        struct nbr_entry *e = &nbr.entries[i];
+
+        if (e->addr == addr) {
+            e->rssi = (e->rssi * e->count + rssi) / (e->count + 1);
+            e->count = MIN(e->count + 1, UINT8_MAX);
+            return;
+        }
+
+        if (!e->addr || (weakest->addr && e->rssi < weakest->rssi)) {
+            weakest = e;
+        }
+    }
+
+    /* Full table: a stronger neighbor replaces the weakest one */
+    if (weakest->addr && weakest->rssi >= rssi) {
+        return;
+    }
+
+    *weakest = (struct nbr_entry){
+        .addr = addr,
+        .rssi = rssi,
+        .count = 1,
+    };
+}
+
+static void nbr_hello_send(struct k_work *work)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = nbr.net_idx,
+        .app_idx = nbr.app_idx,
+        .addr = BT_MESH_ADDR_ALL_NODES,
+        .send_ttl = 0,
+    };
+    int err;
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_NBR_HELLO, 1);
+    bt_mesh_model_msg_init(&msg, OP_VND_NBR_HELLO);
+    net_buf_simple_add_u8(&msg, nbr.round);
+
+    err = bt_mesh_model_send(vnd_model, &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
+    if (err) {
+        printk("Neighbor hello failed (err %d)\n", err);
+    }
+}
+
+/* Hello Request: round, spread in ms (le16). */
+static int handle_nbr_hello_req(const struct bt_mesh_model *model,
+                                struct bt_mesh_msg_ctx *ctx,
+                                struct net_buf_simple *buf)
+{
+    uint8_t round = net_buf_simple_pull_u8(buf);
+    uint16_t spread_ms = net_buf_simple_pull_le16(buf);
+
+    nbr_round_start(round);
+    nbr.net_idx = ctx->net_idx;
+    nbr.app_idx = ctx->app_idx;
+
+    /* Random start so neighbors do not all transmit at once */
+    app_work_reschedule(&nbr.hello_work, spread_ms ? sys_rand32_get() % spread_ms : 0);
+    return 0;
+}
+
+static int handle_nbr_hello(const struct bt_mesh_model *model,
+                            struct bt_mesh_msg_ctx *ctx,
+                            struct net_buf_simple *buf)
+{
+    uint8_t round = net_buf_simple_pull_u8(buf);
+
+    /* Only single-hop Hellos from other nodes (our own loops back); a
+     * newer round clears the table first.
+     */
+    if (ctx->recv_ttl != 0 || ctx->addr == bt_mesh_model_elem(model)->rt->addr ||
+        (int8_t)(round - nbr.round) < 0) {
+        return 0;
+    }
+
+    nbr_round_start(round);
+    nbr_record(ctx->addr, ctx->recv_rssi);
+    return 0;
+}
+
+/* Neighbor Status: round, then per neighbor addr (le16), rssi, count. */
+static int handle_nbr_get(const struct bt_mesh_model *model,
+                          struct bt_mesh_msg_ctx *ctx,
+                          struct net_buf_simple *buf)
+{
+    BT_MESH_MODEL_BUF_DEFINE(rsp, OP_VND_NBR_STATUS, 1 + NBR_MAX * 4);
+    int err;
+
+    bt_mesh_model_msg_init(&rsp, OP_VND_NBR_STATUS);
+    net_buf_simple_add_u8(&rsp, nbr.round);
+
+    for (int i = 0; i < NBR_MAX; i++) {
+        if (!nbr.entries[i].addr) {
+            continue;
+        }
+
+        net_buf_simple_add_le16(&rsp, nbr.entries[i].addr);
+        net_buf_simple_add_u8(&rsp, nbr.entries[i].rssi);
+        net_buf_simple_add_u8(&rsp, nbr.entries[i].count);
+    }
+
+    err = bt_mesh_model_send(model, ctx, &rsp, NULL, NULL);
+    vnd_stats_send_result(err);
+    return err;
+}
+
+static int handle_nbr_status(const struct bt_mesh_model *model,
+                             struct bt_mesh_msg_ctx *ctx,
+                             struct net_buf_simple *buf)
+{
+    char line[320];
+    int len;
+
+    len = snprintk(line, sizeof(line), "NBR 0x%04x round %u", ctx->addr,
+                   net_buf_simple_pull_u8(buf));
+
+    while (buf->len >= 4 && len < (int)sizeof(line)) {
+        uint16_t addr = net_buf_simple_pull_le16(buf);
+        int8_t rssi = net_buf_simple_pull_u8(buf);
+        uint8_t count = net_buf_simple_pull_u8(buf);
+
+        len += snprintk(&line[len], sizeof(line) - len, " 0x%04x:%d:%u",
+                        addr, rssi, count);
+    }
+
+    printk("%s\n", line);
+    return 0;
+}
+
+int vnd_nbr_hello(uint16_t net_idx, uint16_t app_idx, uint16_t spread_ms)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = net_idx,
+        .app_idx = app_idx,
+        .addr = BT_MESH_ADDR_ALL_NODES,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    int err;
+
+    if (!vnd_model) {
+        return -ENODEV;
+    }
+
+    /* The request loops back, so this node starts the round too */
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_NBR_HELLO_REQ, 3);
+    bt_mesh_model_msg_init(&msg, OP_VND_NBR_HELLO_REQ);
+    net_buf_simple_add_u8(&msg, nbr.round + 1);
+    net_buf_simple_add_le16(&msg, spread_ms);
+
+    err = bt_mesh_model_send(vnd_model, &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
+    return err;
+}
+
+int vnd_nbr_get(uint16_t net_idx, uint16_t app_idx, uint16_t addr)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = net_idx,
+        .app_idx = app_idx,
+        .addr = addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    int err;
+
+    if (!vnd_model) {
+        return -ENODEV;
+    }
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_NBR_GET, 0);
+    bt_mesh_model_msg_init(&msg, OP_VND_NBR_GET);
+
+    err = bt_mesh_model_send(vnd_model, &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Echo and ping sweep
+ *
+ * Echo:       seq (le16), timestamp (le32), TTL (u8), padding
+ * Echo Reply: seq (le16), timestamp (le32), request hops (u8),
+ *             reply TTL (u8), padding
+ *
+ * The timestamp is the sender's cycle counter and is only interpreted
+ * by the sender, so the nodes' clocks need no synchronization. The
+ * sender keeps the TTL of its recent requests by seq.
+ * --------------------------------------------------------------------- */
+
+/* Time for the last replies to come back after the last request */
+#define PING_GRACE_MS 2000
+
+/* Requests whose TTL is remembered; a power of two */
+#define PING_TTL_SLOTS 32
+
+static struct {
+    uint16_t addrs[VND_PING_TARGETS_MAX];
+    uint16_t sent[VND_PING_TARGETS_MAX];
+    size_t count;
+    size_t next;
+    uint16_t rounds;
+    uint16_t round;
+    uint16_t seq;
+    uint8_t size;
+    uint16_t interval_ms;
+    uint16_t net_idx;
+    uint16_t app_idx;
+    bool active;
+    struct app_work work;
+    struct {
+        uint16_t seq;
+        uint8_t ttl;        /* 0: slot unused */
+    } sent_ttl[PING_TTL_SLOTS];
+} ping;
+
+static uint8_t resolve_ttl(uint8_t ttl)
+{
+    return ttl == BT_MESH_TTL_DEFAULT ? bt_mesh_default_ttl_get() : ttl;
+}
+
+static void echo_pad(struct net_buf_simple *buf, size_t size)
+{
+    /* Parameters start after the 3-byte vendor opcode */
+    size_t len = buf->len - 3;
+
+    if (size > len) {
+        memset(net_buf_simple_add(buf, size - len), 0, size - len);
+    }
+}
+
+static int handle_echo(const struct bt_mesh_model *model,
+                       struct bt_mesh_msg_ctx *ctx,
+                       struct net_buf_simple *buf)
+{
+    BT_MESH_MODEL_BUF_DEFINE(rsp, OP_VND_ECHO_REPLY, VND_ECHO_SIZE_MAX);
+    size_t size = MIN(buf->len, VND_ECHO_SIZE_MAX);
+    uint16_t seq = net_buf_simple_pull_le16(buf);
+    uint32_t timestamp = net_buf_simple_pull_le32(buf);
+    uint8_t ttl = net_buf_simple_pull_u8(buf);
+    int err;
+
+    /* Reply with the same size so both directions carry the same load */
+    ctx->send_ttl = BT_MESH_TTL_DEFAULT;
+    bt_mesh_model_msg_init(&rsp, OP_VND_ECHO_REPLY);
+    net_buf_simple_add_le16(&rsp, seq);
+    net_buf_simple_add_le32(&rsp, timestamp);
+    /* Hops, not the request TTL: the requester knows that one, and
+     * leaving it out keeps the smallest reply unsegmented
+     */
+    net_buf_simple_add_u8(&rsp, ttl >= ctx->recv_ttl ? ttl - ctx->recv_ttl + 1 : 0);
+    net_buf_simple_add_u8(&rsp, resolve_ttl(BT_MESH_TTL_DEFAULT));
+    echo_pad(&rsp, MAX(size, VND_ECHO_SIZE_MIN));
+
+    err = bt_mesh_model_send(model, ctx, &rsp, NULL, NULL);
+    vnd_stats_send_result(err);
+    return err;
+}
+
+static int handle_echo_reply(const struct bt_mesh_model *model,
+                             struct bt_mesh_msg_ctx *ctx,
+                             struct net_buf_simple *buf)
+{
+    size_t size = buf->len;
+    uint16_t seq = net_buf_simple_pull_le16(buf);
+    uint32_t rtt_us = k_cyc_to_us_floor32(k_cycle_get_32() - net_buf_simple_pull_le32(buf));
+    uint8_t req_ttl = 0;
+    uint8_t req_hops = net_buf_simple_pull_u8(buf);
+    uint8_t rsp_ttl = net_buf_simple_pull_u8(buf);
+
+    /* Unknown (0) once the slot has been reused by a later request */
+    if (ping.sent_ttl[seq % PING_TTL_SLOTS].seq == seq) {
+        req_ttl = ping.sent_ttl[seq % PING_TTL_SLOTS].ttl;
+    }
+
+    printk("PING 0x%04x seq %u size %u rtt_us %u ttl %u hops %u back %u rssi %d\n",
+           ctx->addr, seq, (unsigned int)size, rtt_us, req_ttl, req_hops,
+           rsp_ttl >= ctx->recv_ttl ? rsp_ttl - ctx->recv_ttl + 1 : 0,
+           ctx->recv_rssi);
+    return 0;
+}
+
+static void ping_work_handler(struct k_work *work)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = ping.net_idx,
+        .app_idx = ping.app_idx,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    size_t i = ping.next;
+    uint16_t seq;
+    uint8_t ttl;
+    int err;
+
+    if (ping.round == ping.rounds) {
+        for (i = 0; i < ping.count; i++) {
+            printk("PING 0x%04x size %u sent %u\n", ping.addrs[i], ping.size,
+                   ping.sent[i]);
+        }
+        printk("PING done\n");
+        ping.active = false;
+        return;
+    }
+
+    ctx.addr = ping.addrs[i];
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_ECHO, VND_ECHO_SIZE_MAX);
+    seq = ping.seq++;
+    ttl = resolve_ttl(ctx.send_ttl);
+    bt_mesh_model_msg_init(&msg, OP_VND_ECHO);
+    net_buf_simple_add_le16(&msg, seq);
+    net_buf_simple_add_le32(&msg, k_cycle_get_32());
+    net_buf_simple_add_u8(&msg, ttl);
+    echo_pad(&msg, ping.size);
+
+    err = bt_mesh_model_send(vnd_model, &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
+    if (err) {
+        printk("PING 0x%04x send failed (err %d)\n", ctx.addr, err);
+    } else {
+        ping.sent[i]++;
+        ping.sent_ttl[seq % PING_TTL_SLOTS].seq = seq;
+        ping.sent_ttl[seq % PING_TTL_SLOTS].ttl = ttl;
+    }
+
+    if (++ping.next == ping.count) {
+        ping.next = 0;
+        ping.round++;
+    }
+
+    app_work_reschedule(&ping.work, ping.round == ping.rounds ?
+                                    PING_GRACE_MS : ping.interval_ms);
+}
+
+int vnd_ping_start(uint16_t net_idx, uint16_t app_idx, const uint16_t *addrs,
+                   size_t count, uint16_t rounds, uint8_t size, uint16_t interval_ms)
+{
+    if (!vnd_model) {
+        return -ENODEV;
+    }
+
+    if (ping.active) {
+        return -EBUSY;
+    }
+
+    if (!count || count > VND_PING_TARGETS_MAX || !rounds ||
+        size < VND_ECHO_SIZE_MIN || size > VND_ECHO_SIZE_MAX) {
+        return -EINVAL;
+    }
+
+    memcpy(ping.addrs, addrs, count * sizeof(addrs[0]));
+    memset(ping.sent, 0, sizeof(ping.sent));
+    ping.count = count;
+    ping.next = 0;
+    ping.rounds = rounds;
+    ping.round = 0;
+    ping.size = size;
+    ping.interval_ms = interval_ms;
+    ping.net_idx = net_idx;
+    ping.app_idx = app_idx;
+    ping.active = true;
+
+    app_work_submit(&ping.work);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Diagnostics: stack, CPU and buffer watermarks
+ *
+ * Diag Get:    kind (u8)
+ * Diag Status: kind (u8), then per entry a name (8 bytes, NUL padded)
+ *              and three le16 fields:
+ *              threads: stack size, stack used, CPU permille
+ *              pools:   count, used, max used
+ * --------------------------------------------------------------------- */
+#define DIAG_ENTRY_LEN (DIAG_NAME_LEN + 6)
+#define DIAG_STATUS_LEN (1 + DIAG_ENTRIES_MAX * DIAG_ENTRY_LEN)
+
+static void diag_add(struct net_buf_simple *buf, const char *name,
+                     uint16_t a, uint16_t b, uint16_t c)
+{
+    net_buf_simple_add_mem(buf, name, DIAG_NAME_LEN);
+    net_buf_simple_add_le16(buf, a);
+    net_buf_simple_add_le16(buf, b);
+    net_buf_simple_add_le16(buf, c);
+}
+
+static int handle_diag_get(const struct bt_mesh_model *model,
+                           struct bt_mesh_msg_ctx *ctx,
+                           struct net_buf_simple *buf)
+{
+    BT_MESH_MODEL_BUF_DEFINE(rsp, OP_VND_DIAG_STATUS, DIAG_STATUS_LEN);
+    uint8_t kind = net_buf_simple_pull_u8(buf);
+    size_t count;
+    int err;
+
+    bt_mesh_model_msg_init(&rsp, OP_VND_DIAG_STATUS);
+    net_buf_simple_add_u8(&rsp, kind);
+
+    if (kind == VND_DIAG_THREADS) {
+        struct diag_thread threads[DIAG_ENTRIES_MAX];
+
+        count = diag_threads_get(threads, ARRAY_SIZE(threads));
+        for (size_t i = 0; i < count; i++) {
+            diag_add(&rsp, threads[i].name, threads[i].stack_size,
+                     threads[i].stack_used, threads[i].cpu_permille);
+        }
+    } else if (kind == VND_DIAG_POOLS) {
+        struct diag_pool pools[DIAG_ENTRIES_MAX];
+
+        count = diag_pools_get(pools, ARRAY_SIZE(pools));
+        for (size_t i = 0; i < count; i++) {
+            diag_add(&rsp, pools[i].name, pools[i].count, pools[i].used,
+                     pools[i].max_used);
+        }
+    } else {
+        return -EINVAL;
+    }
+
+    err = bt_mesh_model_send(model, ctx, &rsp, NULL, NULL);
+    vnd_stats_send_result(err);
+    return err;
+}
+
+static const char *diag_value(char *str, size_t size, uint16_t val)
+{
+    if (val == DIAG_UNKNOWN) {
+        return "-";
+    }
+
+    snprintk(str, size, "%u", val);
+    return str;
+}
+
+static int handle_diag_status(const struct bt_mesh_model *model,
+                              struct bt_mesh_msg_ctx *ctx,
+                              struct net_buf_simple *buf)
+{
+    uint8_t kind = net_buf_simple_pull_u8(buf);
+
+    while (buf->len >= DIAG_ENTRY_LEN) {
+        char name[DIAG_NAME_LEN + 1] = { 0 };
+        char a[6], b[6], c[8];
+        uint16_t va, vb, vc;
+
+        memcpy(name, net_buf_simple_pull_mem(buf, DIAG_NAME_LEN), DIAG_NAME_LEN);
+        va = net_buf_simple_pull_le16(buf);
+        vb = net_buf_simple_pull_le16(buf);
+        vc = net_buf_simple_pull_le16(buf);
+
+        if (kind == VND_DIAG_THREADS) {
+            if (vc != DIAG_UNKNOWN) {
+                snprintk(c, sizeof(c), "%u.%u", vc / 10, vc % 10);
+            }
+            printk("DIAG 0x%04x thread %s stack %s/%s cpu %s\n", ctx->addr, name,
+                   diag_value(b, sizeof(b), vb), diag_value(a, sizeof(a), va),
+                   vc == DIAG_UNKNOWN ? "-" : c);
+        } else {
+            printk("DIAG 0x%04x pool %s used %s max %s of %s\n", ctx->addr, name,
+                   diag_value(b, sizeof(b), vb), diag_value(c, sizeof(c), vc),
+                   diag_value(a, sizeof(a), va));
+        }
+    }
+
+    printk("DIAG 0x%04x done\n", ctx->addr);
+    return 0;
+}
+
+int vnd_diag_get(uint16_t net_idx, uint16_t app_idx, uint16_t addr, uint8_t kind)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = net_idx,
+        .app_idx = app_idx,
+        .addr = addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    int err;
+
+    if (!vnd_model) {
+        return -ENODEV;
+    }
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_DIAG_GET, 1);
+    bt_mesh_model_msg_init(&msg, OP_VND_DIAG_GET);
+    net_buf_simple_add_u8(&msg, kind);
+
+    err = bt_mesh_model_send(vnd_model, &ctx, &msg, NULL, NULL);
+    vnd_stats_send_result(err);
+    return err;
+}
+
+/* ---------------------------------------------------------------------
+ * Model definition
+ * --------------------------------------------------------------------- */
+const struct bt_mesh_model_op vnd_ops[] = {
+    { OP_VND_STATS_GET,     BT_MESH_LEN_MIN(0),                handle_stats_get     },
+    { OP_VND_STATS_STATUS,  BT_MESH_LEN_EXACT(STAT_COUNT * 2), handle_stats_status  },
+    { OP_VND_BEAT,          BT_MESH_LEN_MIN(3),                handle_beat          },
+    { OP_VND_NBR_HELLO_REQ, BT_MESH_LEN_EXACT(3),              handle_nbr_hello_req },
+    { OP_VND_NBR_HELLO,     BT_MESH_LEN_EXACT(1),              handle_nbr_hello     },
+    { OP_VND_NBR_GET,       BT_MESH_LEN_EXACT(0),              handle_nbr_get       },
+    { OP_VND_NBR_STATUS,    BT_MESH_LEN_MIN(1),                handle_nbr_status    },
+    { OP_VND_ECHO,          BT_MESH_LEN_MIN(7),                handle_echo          },
+    { OP_VND_ECHO_REPLY,    BT_MESH_LEN_MIN(VND_ECHO_SIZE_MIN), handle_echo_reply    },
+    { OP_VND_DIAG_GET,      BT_MESH_LEN_EXACT(1),              handle_diag_get      },
+    { OP_VND_DIAG_STATUS,   BT_MESH_LEN_MIN(1),                handle_diag_status   },
+    BT_MESH_MODEL_OP_END,
+};
+
+static int vnd_init(const struct bt_mesh_model *model)
+{
+    vnd_model = model;
+    app_work_init(&nbr.hello_work, APP_WQ_TELEMETRY, nbr_hello_send);
+    app_work_init(&ping.work, APP_WQ_TELEMETRY, ping_work_handler);
+    return 0;
+}
+
+const struct bt_mesh_model_cb vnd_cb = {
+    .init = vnd_init,
+};
@@ -0,0 +1,95 @@
+/*
+ * vnd_model.h - Vendor diagnostics model.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VND_MODEL_H__
+#define VND_MODEL_H__
+
+#include <stdbool.h>
+#include <zephyr/bluetooth/mesh.h>
+
+#define VND_MODEL_ID 0x0001
+
+#define OP_VND_STATS_GET     BT_MESH_MODEL_OP_3(0x01, CONFIG_BT_COMPANY_ID)
+#define OP_VND_STATS_STATUS  BT_MESH_MODEL_OP_3(0x02, CONFIG_BT_COMPANY_ID)
+#define OP_VND_BEAT          BT_MESH_MODEL_OP_3(0x03, CONFIG_BT_COMPANY_ID)
+#define OP_VND_NBR_HELLO_REQ BT_MESH_MODEL_OP_3(0x04, CONFIG_BT_COMPANY_ID)
+#define OP_VND_NBR_HELLO     BT_MESH_MODEL_OP_3(0x05, CONFIG_BT_COMPANY_ID)
+#define OP_VND_NBR_GET       BT_MESH_MODEL_OP_3(0x06, CONFIG_BT_COMPANY_ID)
+#define OP_VND_NBR_STATUS    BT_MESH_MODEL_OP_3(0x07, CONFIG_BT_COMPANY_ID)
+#define OP_VND_ECHO          BT_MESH_MODEL_OP_3(0x08, CONFIG_BT_COMPANY_ID)
+#define OP_VND_ECHO_REPLY    BT_MESH_MODEL_OP_3(0x09, CONFIG_BT_COMPANY_ID)
+#define OP_VND_DIAG_GET      BT_MESH_MODEL_OP_3(0x0a, CONFIG_BT_COMPANY_ID)
+#define OP_VND_DIAG_STATUS   BT_MESH_MODEL_OP_3(0x0b, CONFIG_BT_COMPANY_ID)
+
+/* Echo parameter sizes: the fixed fields, padded up to the requested
+ * size. Above 8 bytes (11 with the opcode) the message is segmented, so
+ * the minimum is the largest size that still goes in one segment.
+ */
+#define VND_ECHO_SIZE_MIN 8
+#define VND_ECHO_SIZE_MAX 128
+#define VND_PING_TARGETS_MAX 16
+
+/* Diag Get kinds */
+#define VND_DIAG_THREADS 0
+#define VND_DIAG_POOLS   1
+
+/* Product and firmware version in the Composition Data. Bump
+ * VND_COMP_VID with every release that changes the elements or models:
+ * the Beat carries both, so the host knows when to read the composition
+ * again.
+ */
+#define VND_COMP_PID 0x0001
+#define VND_COMP_VID 0x0001
+
+/* Beat feature bits, same layout as the Heartbeat Features field */
+#define VND_BEAT_FEAT_RELAY  BIT(0)
+#define VND_BEAT_FEAT_PROXY  BIT(1)
+#define VND_BEAT_FEAT_FRIEND BIT(2)
+
+extern const struct bt_mesh_model_op vnd_ops[];
+extern const struct bt_mesh_model_cb vnd_cb;
+extern struct bt_mesh_model_pub vnd_pub;
+
+#define VND_MODEL BT_MESH_MODEL_VND_CB(CONFIG_BT_COMPANY_ID, VND_MODEL_ID, \
+                                       vnd_ops, &vnd_pub, NULL, &vnd_cb)
+
+/* Ask a node for its mesh statistics; the reply is printed as a
+ * "STATS <addr> key=value ..." line. With reset the node clears its
+ * counters after reporting them.
+ */
+int vnd_stats_get(uint16_t net_idx, uint16_t app_idx, uint16_t addr, bool reset);
+
+/* Start a neighbor discovery round: every node broadcasts a single-hop
+ * Hello at a random time within spread_ms, and records the RSSI of the
+ * Hellos it hears from its direct neighbors.
+ */
+int vnd_nbr_hello(uint16_t net_idx, uint16_t app_idx, uint16_t spread_ms);
+
+/* Ask a node for its neighbor table; the reply is printed as a
+ * "NBR <addr> round <n> <nbr>:<rssi>:<count> ..." line.
+ */
+int vnd_nbr_get(uint16_t net_idx, uint16_t app_idx, uint16_t addr);
+
+/* Send rounds Echo requests of size bytes to every target, one every
+ * interval_ms across all targets, without waiting for the replies. Each
+ * reply is printed as a "PING <addr> seq .. size .. rtt_us .." line and
+ * the sweep ends with per-target "PING <addr> size .. sent .." lines and
+ * "PING done".
+ */
+int vnd_ping_start(uint16_t net_idx, uint16_t app_idx, const uint16_t *addrs,
+                   size_t count, uint16_t rounds, uint8_t size, uint16_t interval_ms);
+
+/* Ask a node for its thread (stack, CPU) or buffer pool watermarks; the
+ * reply is printed as one "DIAG <addr> thread|pool <name> ..." line per
+ * entry and a closing "DIAG <addr> done". Nodes built without
+ * instrumentation.conf report no or partial entries.
+ */
+int vnd_diag_get(uint16_t net_idx, uint16_t app_idx, uint16_t addr, uint8_t kind);
+
+/* Count a failed application send; -ENOBUFS is reported in the stats. */
+void vnd_stats_send_result(int err);
+
+#endif /* VND_MODEL_H__ */
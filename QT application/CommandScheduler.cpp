@@ -0,0 +1,237 @@
+#include "CommandScheduler.h"
+#include "TimingWheel.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QStringList>
+#include <cmath>
+
+// Until the network is measured
+static const double DefaultRate = 5.0;
+static const int DefaultBurst = 4;
+
+// Bounds of the derived rate. Above the maximum the dongle's UART and
+// shell, not the mesh, are the limit.
+static const double MinRate = 1.0;
+static const double MaxRate = 20.0;
+
+// Acknowledged exchanges in flight at once (a message and its status
+// cross the mesh while the dongle sends the next one)
+static const double ExchangesInFlight = 2.0;
+
+// A waiting command climbs one lane per step
+static const qint64 AgingStepMs = 5000;
+
+// The Config and Opcodes Aggregator Clients give up well before this; it
+// only unblocks the queue when the last line of a command was lost.
+static const int BlockingTimeoutMs = 20000;
+
+// Shell commands that wait for the mesh before they return
+static const QStringList BlockingVerbs = {
+    "nodecfg", "cfgset", "cfgread", "comp", "noderst", "groupsub"
+};
+
+// "rpr scan" starts its servers one after another, each waiting for a
+// Scan Status
+static const QString ScanVerb = QStringLiteral("rpr scan");
+static const int ScanStartTimeoutMs = 5000;
+
+CommandScheduler::CommandScheduler(QObject *parent)
+    : QObject(parent),
+      m_rate(DefaultRate),
+      m_burst(DefaultBurst),
+      m_tokens(DefaultBurst)
+{
+    m_clock.start();
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &CommandScheduler::dispatch);
+}
+
+CommandScheduler::~CommandScheduler()
+{
+    TimingWheel::shared()->cancel(m_blockingDeadline);
+}
+
+void CommandScheduler::enqueue(const QString &command, Lane lane, const QString &key)
+{
+    QList<Entry> &queue = m_lanes[lane];
+
+    // Superseded: the waiting command takes the new text but keeps its place
+    if (!key.isEmpty()) {
+        for (Entry &entry : queue) {
+            if (entry.key == key) {
+                entry.command = command;
+                return;
+            }
+        }
+    }
+
+    queue.append({ command, key, m_clock.elapsed() });
+    if (!m_timer.isActive()) {
+        dispatch();
+    }
+}
+
+void CommandScheduler::clear()
+{
+    QList<Entry> dropped;
+    for (QList<Entry> &queue : m_lanes) {
+        dropped += queue;
+        queue.clear();
+    }
+    m_timer.stop();
+    release();
+
+    // Their requesters time out as if the dongle had not answered
+    for (const Entry &entry : std::as_const(dropped)) {
+        emit dispatched(entry.command);
+    }
+}
+
+int CommandScheduler::pending(Lane lane) const
+{
+    return m_lanes[lane].size();
+}
+
+void CommandScheduler::setRate(double perSecond, int burst)
+{
+    refill();
+    m_rate = qBound(MinRate, perSecond, MaxRate);
+    m_burst = qMax(1, burst);
+    m_tokens = qMin(m_tokens, m_burst);
+    qDebug() << "Command rate" << m_rate << "/s, burst" << m_burst;
+}
+
+double CommandScheduler::rate() const
+{
+    return m_rate;
+}
+
+void CommandScheduler::setCapacity(double deliveryRatio, double avgRttMs)
+{
+    if (avgRttMs <= 0.0 || deliveryRatio <= 0.0) {
+        return;
+    }
+
+    double perSecond = deliveryRatio * ExchangesInFlight * 1000.0 / avgRttMs;
+    setRate(perSecond, qBound(2, int(std::ceil(perSecond / 2)), 8));
+}
+
+void CommandScheduler::refill()
+{
+    qint64 now = m_clock.elapsed();
+    m_tokens = qMin(m_burst, m_tokens + (now - m_lastRefillMs) * m_rate / 1000.0);
+    m_lastRefillMs = now;
+}
+
+QList<CommandScheduler::Entry> *CommandScheduler::nextLane()
+{
+    // Interactive commands never wait behind anything
+    if (!m_lanes[Interactive].isEmpty()) {
+        return &m_lanes[Interactive];
+    }
+
+    // Otherwise the lowest lane, less one lane per AgingStepMs its head
+    // has waited
+    qint64 now = m_clock.elapsed();
+    QList<Entry> *best = nullptr;
+    qint64 bestRank = 0;
+
+    for (int lane = Control; lane < LaneCount; lane++) {
+        if (m_lanes[lane].isEmpty()) {
+            continue;
+        }
+        qint64 rank = lane * AgingStepMs - (now - m_lanes[lane].first().enqueuedMs);
+        if (!best || rank < bestRank) {
+            best = &m_lanes[lane];
+            bestRank = rank;
+        }
+    }
+    return best;
+}
+
+void CommandScheduler::dispatch()
+{
+    refill();
+
+    // Nothing is written until the blocking command has returned
+    while (m_blockingVerb.isEmpty()) {
+        QList<Entry> *queue = nextLane();
+        if (!queue) {
+            return;
+        }
+
+        if (m_tokens < 1.0) {
+            m_timer.start(int(std::ceil((1.0 - m_tokens) * 1000.0 / m_rate)));
+            return;
+        }
+
+        m_tokens -= 1.0;
+        QString command = queue->takeFirst().command;
+        block(command);
+        emit write(command);
+        emit dispatched(command);
+    }
+}
+
+void CommandScheduler::block(const QString &command)
+{
+    const QStringList words = command.trimmed().split(' ', Qt::SkipEmptyParts);
+    int timeoutMs = BlockingTimeoutMs;
+
+    if (words.size() > 2 && words[0] + ' ' + words[1] == ScanVerb) {
+        m_blockingVerb = ScanVerb;
+        m_blockingAddress = 0;
+        timeoutMs += (words.size() - 3) * ScanStartTimeoutMs;
+    } else if (words.size() >= 2 && BlockingVerbs.contains(words[0])) {
+        m_blockingVerb = words[0];
+        m_blockingAddress = words[1].toUShort(nullptr, 0);
+    } else {
+        return;
+    }
+
+    m_blockingDeadline = TimingWheel::shared()->schedule(timeoutMs, [this]() {
+        qDebug() << "No reply to" << m_blockingVerb << "in time";
+        m_blockingDeadline = 0;
+        release();
+        dispatch();
+    });
+}
+
+void CommandScheduler::release()
+{
+    TimingWheel::shared()->cancel(m_blockingDeadline);
+    m_blockingDeadline = 0;
+    m_blockingVerb.clear();
+}
+
+void CommandScheduler::handleLine(const QString &line)
+{
+    // "CFGSET 0x0005 ok 3", "COMP 0x0005 done", "NODERST 0x0005 elems 1 ok",
+    // "GROUPSUB 0x0005 2 groups", "... failed (err n)", "RPR scan: started
+    // on 3 of 4 servers", or the usage text
+    static const QRegularExpression lastRegex(
+        R"(^([A-Z]+) (0x[0-9a-fA-F]+) (ok|done|failed|elems|\d+ groups)\b)");
+    static const QRegularExpression usageRegex(R"(^Usage: (\w+))");
+
+    if (m_blockingVerb.isEmpty()) {
+        return;
+    }
+
+    QRegularExpressionMatch match = lastRegex.match(line);
+    bool last = match.hasMatch() && match.captured(1).toLower() == m_blockingVerb &&
+                match.captured(2).toUShort(nullptr, 16) == m_blockingAddress;
+    if (!last && m_blockingVerb == ScanVerb) {
+        last = line.startsWith(QLatin1String("RPR scan: started on"));
+    }
+    if (!last) {
+        match = usageRegex.match(line);
+        last = match.hasMatch() && match.captured(1) == m_blockingVerb;
+    }
+
+    if (last) {
+        release();
+        dispatch();
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef COMMANDSCHEDULER_H
+#define COMMANDSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include <QTimer>
+
+// Every command for the dongle goes through here. Commands wait in one
+// of four priority lanes and leave at the pace of a token bucket sized
+// from the measured capacity of the network, so an interactive OnOff is
+// never stuck behind minutes of configuration and bulk work cannot
+// flood the mesh. A command queued with a key replaces the one still
+// waiting with the same key (repeated toggles of one target, ...).
+//
+// The Interactive lane always leaves first. The lanes below it are not
+// strictly ordered: a command climbs one lane for every AgingStepMs it
+// waits, so telemetry still leaves under steady control traffic, but it
+// never climbs above Control.
+//
+// Some shell commands (nodecfg, cfgset, cfgread, comp, noderst, groupsub,
+// rpr scan) hold the dongle's shell until their reply is in. Only one of them is
+// written at a time, and nothing else follows it until its last line
+// ("CFGSET <addr> ok", ...) arrives, so commands never pile up in the
+// UART where the lanes no longer apply.
+//
+// Helpers queue many commands at once, so their replies are timed from
+// dispatched(), when the command is actually written, not from the
+// moment they emit it (see RequestTimer::startOnDispatch). Commands
+// dropped by clear() are reported as dispatched, so they time out.
+class CommandScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Lane {
+        Interactive,        // LED switches, typed commands
+        Control,            // setup steps, groups, scenes, tuning
+        Bulk,               // provisioning, configuration, firmware update
+        Telemetry,          // statistics and latency sweeps
+        LaneCount
+    };
+
+    explicit CommandScheduler(QObject *parent = nullptr);
+    ~CommandScheduler() override;
+
+    void enqueue(const QString &command, Lane lane, const QString &key = QString());
+    void clear();
+    int pending(Lane lane) const;
+
+    // Commands per second and how many may leave back to back.
+    void setRate(double perSecond, int burst);
+    double rate() const;
+
+    // Derive the rate from a probe: acknowledged exchanges the network
+    // completes per second at the measured delivery ratio and round trip.
+    void setCapacity(double deliveryRatio, double avgRttMs);
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+
+signals:
+    void write(const QString &command);
+    void dispatched(const QString &command);
+
+private:
+    struct Entry {
+        QString command;
+        QString key;
+        qint64 enqueuedMs = 0;
+    };
+
+    void refill();
+    void dispatch();
+    QList<Entry> *nextLane();
+    void block(const QString &command);
+    void release();
+
+    QList<Entry> m_lanes[LaneCount];
+    double m_rate;
+    double m_burst;
+    double m_tokens;
+    QElapsedTimer m_clock;
+    qint64 m_lastRefillMs = 0;
+    QTimer m_timer;
+
+    // The blocking command in flight, if any
+    QString m_blockingVerb;
+    quint16 m_blockingAddress = 0;
+    quint64 m_blockingDeadline = 0;     // wheel handle
+};
+
+#endif // COMMANDSCHEDULER_H
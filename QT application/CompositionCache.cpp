@@ -0,0 +1,313 @@
+#include "CompositionCache.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+
+// A fully segmented Composition Data Status within the Config Client
+// timeout (6 s), plus the UART round trip.
+static const int FetchTimeoutMs = 10000;
+
+// Reading the composition changes nothing, so a lost reply is asked again
+static const int FetchRetries = 1;
+
+static QString hex(quint32 value)
+{
+    return QString("0x%1").arg(value, 4, 16, QChar('0'));
+}
+
+static QString identityName(quint64 key)
+{
+    return QString("%1:%2:%3").arg(hex(quint16(key >> 32)), hex(quint16(key >> 16)), hex(quint16(key)));
+}
+
+int CompositionCache::Composition::elementOf(quint32 model) const
+{
+    for (int i = 0; i < elements.size(); i++) {
+        if (elements.at(i).models.contains(model)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool CompositionCache::Composition::hasModel(quint32 model) const
+{
+    return elementOf(model) >= 0;
+}
+
+CompositionCache::CompositionCache(const QString &registryPath, QObject *parent)
+    : QObject(parent),
+      m_path(registryPath)
+{
+    m_timeout.setRetries(FetchRetries);
+    connect(&m_timeout, &RequestTimer::retry, this, [this]() {
+        m_reading = Composition();
+        emit sendCommand(QString("comp %1\n").arg(hex(m_current)));
+    });
+    connect(&m_timeout, &RequestTimer::timeout, this, [this]() {
+        qDebug() << "No composition from" << hex(m_current);
+        fetchDone(false);
+    });
+
+    load();
+}
+
+quint64 CompositionCache::identity(quint16 cid, quint16 pid, quint16 vid)
+{
+    return (quint64(cid) << 32) | (quint64(pid) << 16) | vid;
+}
+
+void CompositionCache::fetch(quint16 node)
+{
+    if (!contains(node)) {
+        enqueue(node);
+    }
+}
+
+void CompositionCache::enqueue(quint16 node)
+{
+    if (m_queue.contains(node) || (m_current == node && m_timeout.isActive())) {
+        return;
+    }
+
+    m_queue.enqueue(node);
+    if (!m_timeout.isActive()) {
+        sendNext();
+    }
+}
+
+bool CompositionCache::contains(quint16 node) const
+{
+    return m_nodes.contains(node);
+}
+
+CompositionCache::Composition CompositionCache::composition(quint16 node) const
+{
+    return m_registry.value(m_nodes.value(node));
+}
+
+void CompositionCache::forget(quint16 node)
+{
+    if (m_nodes.remove(node)) {
+        save();
+    }
+}
+
+int CompositionCache::maxElementCount() const
+{
+    int count = 1;
+    for (const Composition &composition : m_registry) {
+        count = qMax(count, int(composition.elements.size()));
+    }
+    return count;
+}
+
+QString CompositionCache::modelToken(quint16 node, quint32 model) const
+{
+    if (!contains(node)) {
+        return hex(model);
+    }
+
+    int element = composition(node).elementOf(model);
+    if (element < 0) {
+        return QString();
+    }
+    return element ? QString("%1@%2").arg(hex(model), hex(node + element)) : hex(model);
+}
+
+void CompositionCache::sendNext()
+{
+    if (m_queue.isEmpty()) {
+        return;
+    }
+
+    m_current = m_queue.dequeue();
+    m_reading = Composition();
+    const QString command = QString("comp %1\n").arg(hex(m_current));
+    m_timeout.startOnDispatch(command, FetchTimeoutMs);
+    emit sendCommand(command);
+}
+
+void CompositionCache::fetchDone(bool ok)
+{
+    quint16 node = m_current;
+
+    m_timeout.stop();
+
+    if (ok) {
+        quint64 key = identity(m_reading.cid, m_reading.pid, m_reading.vid);
+        m_registry.insert(key, m_reading);
+        setIdentity(node, key);
+        emit compositionReady(node);
+    } else {
+        emit fetchFailed(node);
+    }
+
+    sendNext();
+}
+
+void CompositionCache::setIdentity(quint16 node, quint64 key)
+{
+    bool changed = m_nodes.contains(node) && m_nodes.value(node) != key;
+
+    m_nodes.insert(node, key);
+    save();
+
+    if (changed) {
+        qDebug() << "Node" << hex(node) << "now runs" << identityName(key);
+        emit compositionChanged(node);
+    }
+}
+
+void CompositionCache::commandDispatched(const QString &command)
+{
+    m_timeout.dispatched(command);
+}
+
+void CompositionCache::handleLine(const QString &line)
+{
+    static const QRegularExpression headerRegex(
+        R"(^COMP (0x[0-9a-fA-F]+) cid (0x[0-9a-fA-F]+) pid (0x[0-9a-fA-F]+) vid (0x[0-9a-fA-F]+) crpl (\d+) feat (0x[0-9a-fA-F]+))");
+    static const QRegularExpression elemRegex(
+        R"(^COMP (0x[0-9a-fA-F]+) elem \d+ loc (0x[0-9a-fA-F]+) sig (\S+) vnd (\S+))");
+    static const QRegularExpression doneRegex(R"(^COMP (0x[0-9a-fA-F]+) (done|failed))");
+    static const QRegularExpression beatRegex(
+        R"(^HB (0x[0-9a-fA-F]+) .* pid (0x[0-9a-fA-F]+) vid (0x[0-9a-fA-F]+))");
+
+    QRegularExpressionMatch match = beatRegex.match(line);
+    if (match.hasMatch()) {
+        quint16 node = match.captured(1).toUShort(nullptr, 16);
+        if (!contains(node)) {
+            fetch(node);
+            return;
+        }
+
+        // The Beat comes from our vendor model, so the CID stays the same
+        quint64 key = m_nodes.value(node);
+        quint64 reported = identity(quint16(key >> 32), match.captured(2).toUShort(nullptr, 16),
+                                    match.captured(3).toUShort(nullptr, 16));
+        if (reported == key) {
+            return;
+        }
+
+        // Until the new composition is read, the node keeps the old one
+        if (m_registry.contains(reported)) {
+            setIdentity(node, reported);
+        } else {
+            enqueue(node);
+        }
+        return;
+    }
+
+    if (!line.startsWith(QLatin1String("COMP ")) || !m_timeout.isActive() ||
+        line.section(' ', 1, 1).toUShort(nullptr, 16) != m_current) {
+        return;
+    }
+
+    if ((match = headerRegex.match(line)).hasMatch()) {
+        m_reading.cid = match.captured(2).toUShort(nullptr, 16);
+        m_reading.pid = match.captured(3).toUShort(nullptr, 16);
+        m_reading.vid = match.captured(4).toUShort(nullptr, 16);
+        m_reading.crpl = match.captured(5).toInt();
+        m_reading.features = match.captured(6).toUShort(nullptr, 16);
+    } else if ((match = elemRegex.match(line)).hasMatch()) {
+        Element element;
+        element.location = match.captured(2).toUShort(nullptr, 16);
+        for (const QString &list : { match.captured(3), match.captured(4) }) {
+            for (const QString &model : list.split(',', Qt::SkipEmptyParts)) {
+                if (model != QLatin1String("-")) {
+                    element.models << model.toUInt(nullptr, 16);
+                }
+            }
+        }
+        m_reading.elements << element;
+    } else if ((match = doneRegex.match(line)).hasMatch()) {
+        fetchDone(match.captured(2) == QLatin1String("done") && !m_reading.elements.isEmpty());
+    }
+}
+
+void CompositionCache::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+    for (const QJsonValue &value : root.value("compositions").toArray()) {
+        QJsonObject object = value.toObject();
+        Composition composition;
+        composition.cid = object.value("cid").toString().toUShort(nullptr, 16);
+        composition.pid = object.value("pid").toString().toUShort(nullptr, 16);
+        composition.vid = object.value("vid").toString().toUShort(nullptr, 16);
+        composition.crpl = object.value("crpl").toInt();
+        composition.features = object.value("features").toString().toUShort(nullptr, 16);
+        for (const QJsonValue &elementValue : object.value("elements").toArray()) {
+            QJsonObject elementObject = elementValue.toObject();
+            Element element;
+            element.location = elementObject.value("location").toString().toUShort(nullptr, 16);
+            for (const QJsonValue &model : elementObject.value("models").toArray()) {
+                element.models << model.toString().toUInt(nullptr, 16);
+            }
+            composition.elements << element;
+        }
+        m_registry.insert(identity(composition.cid, composition.pid, composition.vid), composition);
+    }
+
+    const QJsonObject nodes = root.value("nodes").toObject();
+    for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        QStringList parts = it.value().toString().split(':');
+        if (parts.size() != 3) {
+            continue;
+        }
+        quint64 key = identity(parts.at(0).toUShort(nullptr, 16), parts.at(1).toUShort(nullptr, 16),
+                               parts.at(2).toUShort(nullptr, 16));
+        if (m_registry.contains(key)) {
+            m_nodes.insert(it.key().toUShort(nullptr, 16), key);
+        }
+    }
+}
+
+void CompositionCache::save() const
+{
+    QJsonArray compositions;
+    for (const Composition &composition : m_registry) {
+        QJsonArray elements;
+        for (const Element &element : composition.elements) {
+            QJsonArray models;
+            for (quint32 model : element.models) {
+                models << hex(model);
+            }
+            elements << QJsonObject{ { "location", hex(element.location) }, { "models", models } };
+        }
+        compositions << QJsonObject{
+            { "cid", hex(composition.cid) },
+            { "pid", hex(composition.pid) },
+            { "vid", hex(composition.vid) },
+            { "crpl", composition.crpl },
+            { "features", hex(composition.features) },
+            { "elements", elements },
+        };
+    }
+
+    QJsonObject nodes;
+    for (auto it = m_nodes.cbegin(); it != m_nodes.cend(); ++it) {
+        nodes.insert(hex(it.key()), identityName(it.value()));
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Cannot write" << m_path << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject{ { "compositions", compositions }, { "nodes", nodes } }).toJson());
+}
@@ -0,0 +1,103 @@
+#ifndef COMPOSITIONCACHE_H
+#define COMPOSITIONCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QString>
+#include <QVector>
+#include "RequestTimer.h"
+
+// Composition Data page 0 of every node, read with the dongle's "comp"
+// command. Compositions are kept in a registry file keyed by CID/PID/VID
+// and survive restarts. Every node not mapped to an entry yet is read;
+// nodes of the same firmware then share its entry.
+// Nodes report their PID and VID in every Beat; a node is mapped to
+// another entry when they change, and read again only if the registry
+// does not know the new firmware yet.
+class CompositionCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Models the host configures. Vendor models are 0xCCCCMMMM.
+    static constexpr quint32 GenOnOffSrv = 0x1000;
+    static constexpr quint32 GenOnOffCli = 0x1001;
+    static constexpr quint32 SceneSrv = 0x1203;
+    static constexpr quint32 SceneSetupSrv = 0x1204;
+    static constexpr quint32 SceneCli = 0x1205;
+    static constexpr quint32 BlobSrv = 0x1400;
+    static constexpr quint32 BlobCli = 0x1401;
+    static constexpr quint32 DfuSrv = 0x1402;
+    static constexpr quint32 DfuCli = 0x1403;
+    static constexpr quint32 DfdSrv = 0x1404;
+    static constexpr quint32 VendorModel = 0x05f10001;
+
+    struct Element {
+        quint16 location = 0;
+        QList<quint32> models;
+    };
+
+    struct Composition {
+        quint16 cid = 0;
+        quint16 pid = 0;
+        quint16 vid = 0;
+        int crpl = 0;
+        quint16 features = 0;
+        QVector<Element> elements;
+
+        // Index of the first element with the model, or -1.
+        int elementOf(quint32 model) const;
+        bool hasModel(quint32 model) const;
+    };
+
+    CompositionCache(const QString &registryPath, QObject *parent = nullptr);
+
+    // Read the node's composition unless it is known already.
+    void fetch(quint16 node);
+    bool contains(quint16 node) const;
+    Composition composition(quint16 node) const;
+
+    // A node that was reset; its address may come back with other firmware.
+    void forget(quint16 node);
+
+    // Most elements of any known firmware, at least 1.
+    int maxElementCount() const;
+
+    // How cfgset and cfgread address a model of the node: "0x1000", or
+    // "0x1000@0x0005" on a secondary element. Empty if the node does not
+    // have the model; the plain id if its composition is not known.
+    QString modelToken(quint16 node, quint32 model) const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void compositionReady(quint16 node);
+    void compositionChanged(quint16 node);  // new firmware on a known node
+    void fetchFailed(quint16 node);
+
+private:
+    static quint64 identity(quint16 cid, quint16 pid, quint16 vid);
+
+    void enqueue(quint16 node);
+    void sendNext();
+    void fetchDone(bool ok);
+    void setIdentity(quint16 node, quint64 key);
+    void load();
+    void save() const;
+
+    QString m_path;
+    QHash<quint64, Composition> m_registry;
+    QHash<quint16, quint64> m_nodes;
+    QQueue<quint16> m_queue;
+    quint16 m_current = 0;
+    Composition m_reading;
+    RequestTimer m_timeout;
+};
+
+#endif // COMPOSITIONCACHE_H
@@ -0,0 +1,325 @@
+#include "ConfigReconciler.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+
+// cfgread takes at most 10 models
+static const int MaxReadModels = 10;
+
+// The aggregated status can take the Config Client timeout (6 s) plus
+// the segmented transfer.
+static const int CommandTimeoutMs = 10000;
+
+// Reads are sent again when the reply is lost. Writes are not: a key
+// added twice is refused the second time.
+static const int ReadRetries = 1;
+
+static QSet<quint16> parseList(const QString &list)
+{
+    QSet<quint16> values;
+    if (list != QLatin1String("-")) {
+        for (const QString &value : list.split(',', Qt::SkipEmptyParts)) {
+            values.insert(value.toUShort(nullptr, 16));
+        }
+    }
+    return values;
+}
+
+static QSet<int> toIntSet(const QSet<quint16> &values)
+{
+    QSet<int> result;
+    for (quint16 value : values) {
+        result.insert(value);
+    }
+    return result;
+}
+
+// Publish Period: 6-bit step count, 2-bit resolution (100 ms, 1 s, 10 s, 10 min)
+static int periodSeconds(int period)
+{
+    static const int resolutionMs[] = { 100, 1000, 10000, 600000 };
+    return (period & 0x3f) * resolutionMs[(period >> 6) & 0x3] / 1000;
+}
+
+ConfigReconciler::ConfigReconciler(CompositionCache *compositions, QObject *parent)
+    : QObject(parent),
+      m_compositions(compositions)
+{
+    connect(&m_timeout, &RequestTimer::retry, this, [this]() {
+        m_reading = NetworkSpec::NodeConfig();
+        m_readError = false;
+        emit sendCommand(m_current.line);
+    });
+    connect(&m_timeout, &RequestTimer::timeout, this, [this]() {
+        qDebug() << "No reply from" << QString("0x%1").arg(m_current.node, 4, 16, QChar('0'))
+                 << "to" << m_current.line.section(' ', 0, 0);
+        commandDone(false);
+    });
+
+    // The composition is read by the cache, which reports back by signal
+    auto compositionDone = [this](quint16 node, bool ok) {
+        if (m_waiting && m_current.step == Step::Composition && m_current.node == node) {
+            commandDone(ok);
+        }
+    };
+    connect(m_compositions, &CompositionCache::compositionReady, this, [compositionDone](quint16 node) {
+        compositionDone(node, true);
+    });
+    connect(m_compositions, &CompositionCache::fetchFailed, this, [compositionDone](quint16 node) {
+        compositionDone(node, false);
+    });
+    connect(m_compositions, &CompositionCache::compositionChanged, this, &ConfigReconciler::invalidate);
+}
+
+bool ConfigReconciler::reconcile(const NetworkSpec &spec, const QList<quint16> &nodes)
+{
+    if (m_running || nodes.isEmpty()) {
+        return false;
+    }
+
+    m_spec = spec;
+    m_queue.clear();
+    m_remaining.clear();
+    m_failed.clear();
+    m_total = nodes.size();
+    m_changedNodes = 0;
+    m_operations = 0;
+    m_running = true;
+
+    for (quint16 node : nodes) {
+        if (!m_compositions->contains(node)) {
+            m_remaining[node] = 1;
+            m_queue.enqueue({ node, Step::Composition, QString() });
+        } else if (m_actual.contains(node)) {
+            queueChanges(node);
+        } else {
+            m_remaining[node] = 1;
+            m_queue.enqueue({ node, Step::Read, readCommand(node) });
+        }
+    }
+
+    emit progress(m_total - m_remaining.size(), m_total);
+    sendNext();
+    return true;
+}
+
+void ConfigReconciler::stop()
+{
+    m_queue.clear();
+    m_timeout.stop();
+    if (m_running) {
+        m_running = false;
+        m_waiting = false;
+        emit finished(m_changedNodes, m_operations, m_failed.size());
+    }
+}
+
+bool ConfigReconciler::isRunning() const
+{
+    return m_running;
+}
+
+void ConfigReconciler::invalidate(quint16 node)
+{
+    m_actual.remove(node);
+}
+
+QString ConfigReconciler::readCommand(quint16 node) const
+{
+    // Only the models the spec manages and the node has
+    QStringList models;
+    const NetworkSpec::NodeConfig desired = m_spec.configFor(node);
+    for (auto it = desired.models.cbegin(); it != desired.models.cend() && models.size() < MaxReadModels; ++it) {
+        QString model = m_compositions->modelToken(node, it.key());
+        if (!model.isEmpty()) {
+            models << model;
+        }
+    }
+
+    QString command = QString("cfgread 0x%1").arg(node, 4, 16, QChar('0'));
+    if (!models.isEmpty()) {
+        command += ' ' + models.join(' ');
+    }
+    return command + '\n';
+}
+
+void ConfigReconciler::queueChanges(quint16 node)
+{
+    const QStringList ops = NetworkSpec::diff(m_spec.configFor(node), m_actual.value(node),
+                                              [this, node](quint32 model) {
+        return m_compositions->modelToken(node, model);
+    });
+    if (ops.isEmpty()) {
+        nodeDone(node);
+        return;
+    }
+
+    // Queued right after anything already queued for this node, so nodes
+    // finish one by one
+    const QStringList commands = NetworkSpec::cfgsetCommands(node, ops);
+    for (int i = commands.size() - 1; i >= 0; i--) {
+        m_queue.prepend({ node, Step::Set, commands.at(i) });
+    }
+    m_remaining[node] += commands.size();
+    m_changedNodes++;
+    m_operations += ops.size();
+}
+
+void ConfigReconciler::nodeDone(quint16 node)
+{
+    m_remaining.remove(node);
+    emit progress(m_total - m_remaining.size(), m_total);
+}
+
+void ConfigReconciler::sendNext()
+{
+    if (!m_running || m_waiting) {
+        return;
+    }
+
+    if (m_queue.isEmpty()) {
+        stop();
+        return;
+    }
+
+    m_current = m_queue.dequeue();
+    m_reading = NetworkSpec::NodeConfig();
+    m_readError = false;
+    m_waiting = true;
+
+    if (m_current.step == Step::Composition) {
+        // The cache has its own timeout and always reports back
+        m_compositions->fetch(m_current.node);
+        if (m_compositions->contains(m_current.node)) {
+            commandDone(true);
+        }
+        return;
+    }
+
+    m_timeout.setRetries(m_current.step == Step::Read ? ReadRetries : 0);
+    m_timeout.startOnDispatch(m_current.line, CommandTimeoutMs);
+    emit sendCommand(m_current.line);
+}
+
+void ConfigReconciler::commandDone(bool ok)
+{
+    quint16 node = m_current.node;
+
+    m_timeout.stop();
+    m_waiting = false;
+
+    if (!ok) {
+        m_failed.insert(node);
+        invalidate(node);
+        for (int i = m_queue.size() - 1; i >= 0; i--) {
+            if (m_queue.at(i).node == node) {
+                m_queue.removeAt(i);
+            }
+        }
+        nodeDone(node);
+        sendNext();
+        return;
+    }
+
+    if (m_current.step == Step::Composition) {
+        m_queue.prepend({ node, Step::Read, readCommand(node) });
+    } else if (m_current.step == Step::Read) {
+        m_actual[node] = m_reading;
+        m_remaining[node]--;
+        queueChanges(node);
+    } else if (--m_remaining[node] == 0) {
+        if (m_failed.contains(node)) {
+            // Some item was refused: read the node again next time
+            invalidate(node);
+        } else {
+            m_actual[node] = NetworkSpec::applied(m_spec.configFor(node), m_actual.value(node));
+        }
+        nodeDone(node);
+    }
+
+    sendNext();
+}
+
+void ConfigReconciler::commandDispatched(const QString &command)
+{
+    m_timeout.dispatched(command);
+}
+
+void ConfigReconciler::handleLine(const QString &line)
+{
+    static const QRegularExpression listRegex(
+        R"(^CFG (0x[0-9a-fA-F]+) (appkeys|bind (0x[0-9a-fA-F]+)|sub (0x[0-9a-fA-F]+)) (\S+))");
+    static const QRegularExpression pubRegex(
+        R"(^CFG (0x[0-9a-fA-F]+) pub (0x[0-9a-fA-F]+) dst (0x[0-9a-fA-F]+) app (\d+) period (\d+) status (\d+))");
+    static const QRegularExpression hbRegex(
+        R"(^CFG (0x[0-9a-fA-F]+) hb dst (0x[0-9a-fA-F]+) period (\d+) status (\d+))");
+    static const QRegularExpression statusRegex(R"(^CFG (0x[0-9a-fA-F]+) (\w+) status (\d+))");
+    static const QRegularExpression relayRegex(
+        R"(^TXP (0x[0-9a-fA-F]+) relay (\d+) count (\d+) interval (\d+))");
+    static const QRegularExpression doneRegex(R"(^CFG(READ|SET) (0x[0-9a-fA-F]+) (done|ok|failed))");
+
+    if (!m_waiting || m_current.step == Step::Composition ||
+        (!line.startsWith(QLatin1String("CFG")) && !line.startsWith(QLatin1String("TXP")))) {
+        return;
+    }
+
+    QRegularExpressionMatch match = doneRegex.match(line);
+    if (match.hasMatch()) {
+        if (match.captured(2).toUShort(nullptr, 16) == m_current.node &&
+            (match.captured(1) == QLatin1String("READ")) == (m_current.step == Step::Read)) {
+            commandDone(match.captured(3) != QLatin1String("failed") && !m_readError);
+        }
+        return;
+    }
+
+    bool reading = m_current.step == Step::Read;
+    quint16 node = line.section(' ', 1, 1).toUShort(nullptr, 16);
+    if (node != m_current.node) {
+        return;
+    }
+
+    if ((match = pubRegex.match(line)).hasMatch()) {
+        if (reading && match.captured(6).toInt() == 0) {
+            NetworkSpec::Publication pub;
+            pub.dst = match.captured(3).toUShort(nullptr, 16);
+            pub.appIdx = match.captured(4).toInt();
+            pub.periodS = periodSeconds(match.captured(5).toInt());
+            m_reading.models[match.captured(2).toUInt(nullptr, 16)].pub = pub;
+        } else if (!reading && match.captured(6).toInt() != 0) {
+            m_failed.insert(node);
+        }
+    } else if ((match = hbRegex.match(line)).hasMatch()) {
+        if (reading && match.captured(4).toInt() == 0) {
+            m_reading.heartbeat = NetworkSpec::Heartbeat{ match.captured(2).toUShort(nullptr, 16),
+                                                          match.captured(3).toInt() };
+        } else if (!reading && match.captured(4).toInt() != 0) {
+            m_failed.insert(node);
+        }
+    } else if ((match = statusRegex.match(line)).hasMatch()) {
+        if (match.captured(3).toInt() != 0) {
+            m_failed.insert(node);
+        }
+    } else if ((match = listRegex.match(line)).hasMatch()) {
+        if (!reading) {
+            return;
+        }
+        // A list the dongle could not unpack: the read is incomplete
+        if (match.captured(5) == QLatin1String("error")) {
+            m_readError = true;
+            return;
+        }
+        QSet<quint16> values = parseList(match.captured(5));
+        if (match.captured(2) == QLatin1String("appkeys")) {
+            m_reading.appKeys = toIntSet(values);
+        } else if (!match.captured(3).isEmpty()) {
+            m_reading.models[match.captured(3).toUInt(nullptr, 16)].binds = toIntSet(values);
+        } else {
+            m_reading.models[match.captured(4).toUInt(nullptr, 16)].subs = values;
+        }
+    } else if ((match = relayRegex.match(line)).hasMatch() && reading) {
+        m_reading.relay = NetworkSpec::Relay{ match.captured(2).toInt() != 0,
+                                              match.captured(3).toInt(),
+                                              match.captured(4).toInt() };
+    }
+}
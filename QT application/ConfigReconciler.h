@@ -0,0 +1,82 @@
+#ifndef CONFIGRECONCILER_H
+#define CONFIGRECONCILER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+#include "RequestTimer.h"
+#include "CompositionCache.h"
+#include "NetworkSpec.h"
+
+// Brings nodes to the state a NetworkSpec describes. The state of each
+// node is read back once ("cfgread") and cached; a reconcile then sends
+// every node only the operations that differ, all of them in one
+// aggregated message per node ("cfgset"). Nodes already in the desired
+// state cost nothing, so re-applying a large network after a small
+// change touches only the nodes it changes. Reads and changes are
+// planned from the node's composition: models it does not have are
+// skipped, models on other elements are addressed there.
+class ConfigReconciler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConfigReconciler(CompositionCache *compositions, QObject *parent = nullptr);
+
+    bool reconcile(const NetworkSpec &spec, const QList<quint16> &nodes);
+    void stop();
+    bool isRunning() const;
+
+    // Forget what is known about a node, so the next reconcile reads it.
+    void invalidate(quint16 node);
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void progress(int done, int total);
+    void finished(int changedNodes, int operations, int failedNodes);
+
+private:
+    enum class Step {
+        Composition,
+        Read,
+        Set,
+    };
+
+    struct Command {
+        quint16 node;
+        Step step;
+        QString line;
+    };
+
+    QString readCommand(quint16 node) const;
+    void queueChanges(quint16 node);
+    void sendNext();
+    void commandDone(bool ok);
+    void nodeDone(quint16 node);
+
+    CompositionCache *m_compositions;
+    NetworkSpec m_spec;
+    QHash<quint16, NetworkSpec::NodeConfig> m_actual;
+    NetworkSpec::NodeConfig m_reading;
+    bool m_readError = false;               // a list of m_reading was lost
+    QQueue<Command> m_queue;
+    Command m_current = { 0, Step::Read, QString() };
+    QHash<quint16, int> m_remaining;    // commands not finished per node
+    QSet<quint16> m_failed;
+    int m_total = 0;
+    int m_changedNodes = 0;
+    int m_operations = 0;
+    bool m_running = false;
+    bool m_waiting = false;
+    RequestTimer m_timeout;
+};
+
+#endif // CONFIGRECONCILER_H
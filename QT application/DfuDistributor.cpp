@@ -0,0 +1,183 @@
+#include "DfuDistributor.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QStringList>
+
+// enum bt_mesh_dfu_phase
+enum DfuPhase {
+    PhaseIdle = 0,
+    PhaseTransferErr = 1,
+    PhaseTransferActive = 2,
+    PhaseVerify = 3,
+    PhaseVerifyOk = 4,
+    PhaseVerifyFail = 5,
+    PhaseApplying = 6,
+    PhaseTransferCanceled = 7,
+    PhaseApplySuccess = 8,
+    PhaseApplyFail = 9,
+    PhaseUnknown = 10,
+};
+
+static const int PollIntervalMs = 3000;
+
+// The shell line buffer is 256 bytes in dfu_distributor.conf; keep
+// receivers-add commands well below it.
+static const int MaxReceiversPerCommand = 12;
+
+// A verified image is not running yet: only a node that applied it and
+// came back with the new firmware counts
+static bool phaseSucceeded(int phase)
+{
+    return phase == PhaseApplySuccess;
+}
+
+static bool phaseFailed(int phase)
+{
+    return phase == PhaseTransferErr || phase == PhaseVerifyFail ||
+           phase == PhaseTransferCanceled || phase == PhaseApplyFail;
+}
+
+DfuDistributor::DfuDistributor(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_pollTimer, &QTimer::timeout, this, &DfuDistributor::poll);
+}
+
+bool DfuDistributor::isRunning() const
+{
+    return m_running;
+}
+
+QList<DfuDistributor::Receiver> DfuDistributor::receivers() const
+{
+    return m_receivers.values();
+}
+
+bool DfuDistributor::start(const Options &options, const QList<quint16> &receivers)
+{
+    if (m_running || receivers.isEmpty() || options.imageSize == 0) {
+        return false;
+    }
+
+    m_options = options;
+    m_receivers.clear();
+    for (quint16 address : receivers) {
+        Receiver receiver;
+        receiver.address = address;
+        m_receivers.insert(address, receiver);
+    }
+
+    emit sendCommand(QString("mesh models blob flash-stream set %1 0\n").arg(options.flashAreaId));
+    emit sendCommand(QString("mesh models dfu slot add %1 %2\n").arg(options.imageSize).arg(options.fwid));
+    emit sendCommand("mesh models dfd receivers-delete-all\n");
+
+    QStringList entries;
+    for (quint16 address : receivers) {
+        entries << QString("0x%1,0").arg(address, 4, 16, QChar('0'));
+        if (entries.size() == MaxReceiversPerCommand) {
+            emit sendCommand(QString("mesh models dfd receivers-add %1\n").arg(entries.join(';')));
+            entries.clear();
+        }
+    }
+    if (!entries.isEmpty()) {
+        emit sendCommand(QString("mesh models dfd receivers-add %1\n").arg(entries.join(';')));
+    }
+
+    // start <app_idx> <slot_idx> <group> <policy_apply> <ttl> <timeout_base> <xfer_mode>
+    // The distributor applies the image on every target once it is verified
+    emit sendCommand(QString("mesh models dfd start 0 0 0x%1 1 7 10 %2\n")
+                         .arg(options.group, 4, 16, QChar('0'))
+                         .arg(options.pullMode ? 2 : 1));
+
+    m_running = true;
+    m_elapsed.start();
+    m_pollTimer.start(PollIntervalMs);
+    return true;
+}
+
+void DfuDistributor::cancel()
+{
+    if (!m_running) {
+        return;
+    }
+
+    emit sendCommand("mesh models dfd cancel\n");
+    finish();
+}
+
+void DfuDistributor::poll()
+{
+    emit sendCommand(QString("mesh models dfd receivers-get 0 %1\n").arg(m_receivers.size()));
+}
+
+void DfuDistributor::handleLine(const QString &line)
+{
+    // One receivers-get entry per line:
+    // "0": { "blob_addr": 2, "phase": 2, "status": 0, "blob_status": 0, "progress": 25, "img_idx": 0 }
+    static const QRegularExpression receiverRegex(
+        R"("blob_addr":\s*(0x[0-9a-fA-F]+|\d+),\s*"phase":\s*(\d+).*"progress":\s*(\d+))");
+
+    if (!m_running) {
+        return;
+    }
+
+    QRegularExpressionMatch match = receiverRegex.match(line);
+    if (!match.hasMatch()) {
+        return;
+    }
+
+    quint16 address = match.captured(1).toUShort(nullptr, 0);
+    auto it = m_receivers.find(address);
+    if (it == m_receivers.end()) {
+        return;
+    }
+
+    it->phase = match.captured(2).toInt();
+    // Transfer Progress is reported in 2 % steps (0..50)
+    it->progress = qMin(match.captured(3).toInt() * 2, 100);
+
+    if (it->completedMs < 0 && (phaseSucceeded(it->phase) || phaseFailed(it->phase))) {
+        it->completedMs = m_elapsed.elapsed();
+        emit receiverCompleted(address, phaseSucceeded(it->phase), it->completedMs);
+    }
+
+    int totalProgress = 0;
+    bool allDone = true;
+    for (const Receiver &receiver : std::as_const(m_receivers)) {
+        totalProgress += receiver.progress;
+        allDone = allDone && receiver.completedMs >= 0;
+    }
+
+    int percent = totalProgress / m_receivers.size();
+    double seconds = qMax<qint64>(m_elapsed.elapsed(), 1) / 1000.0;
+    emit progress(percent, m_options.imageSize * (percent / 100.0) / seconds);
+
+    if (allDone) {
+        finish();
+    }
+}
+
+void DfuDistributor::finish()
+{
+    m_pollTimer.stop();
+    m_running = false;
+
+    int succeeded = 0;
+    int failed = 0;
+    qint64 lastCompletion = 1;
+    for (const Receiver &receiver : std::as_const(m_receivers)) {
+        if (phaseSucceeded(receiver.phase)) {
+            succeeded++;
+            lastCompletion = qMax(lastCompletion, receiver.completedMs);
+        } else {
+            failed++;
+        }
+    }
+
+    // Multicast: the image crosses the air once for the whole group
+    double bytesPerSecond = succeeded ? m_options.imageSize / (lastCompletion / 1000.0) : 0.0;
+    qDebug() << "DFU finished:" << succeeded << "ok," << failed << "failed," << bytesPerSecond << "B/s";
+    emit finished(succeeded, failed, m_elapsed.elapsed(), bytesPerSecond);
+}
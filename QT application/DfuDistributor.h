@@ -0,0 +1,64 @@
+#ifndef DFUDISTRIBUTOR_H
+#define DFUDISTRIBUTOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QTimer>
+
+// Multicast firmware update through the dongle's Firmware Distribution
+// Server ("mesh models dfd" shell commands, dfu_distributor.conf build).
+//
+// The image must already be in the dongle's flash area given in Options;
+// one distribution sends it to every receiver through the group address
+// and the receivers list is polled for per-node phase and progress.
+class DfuDistributor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        quint32 imageSize = 0;
+        QString fwid;               // hex, as reported by the targets
+        int flashAreaId = 2;        // slot1_partition on the dongle
+        quint16 group = 0xc000;
+        bool pullMode = true;       // pull-mode chunk recovery for lossy links
+    };
+
+    struct Receiver {
+        quint16 address = 0;
+        int phase = -1;
+        int progress = 0;           // percent
+        qint64 completedMs = -1;    // since start, -1 while running
+    };
+
+    explicit DfuDistributor(QObject *parent = nullptr);
+
+    bool start(const Options &options, const QList<quint16> &receivers);
+    void cancel();
+    bool isRunning() const;
+    QList<Receiver> receivers() const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+
+signals:
+    void sendCommand(const QString &command);
+    void progress(int percent, double bytesPerSecond);
+    void receiverCompleted(quint16 address, bool success, qint64 elapsedMs);
+    void finished(int succeeded, int failed, qint64 elapsedMs, double bytesPerSecond);
+
+private:
+    void poll();
+    void finish();
+
+    Options m_options;
+    QMap<quint16, Receiver> m_receivers;
+    QElapsedTimer m_elapsed;
+    QTimer m_pollTimer;
+    bool m_running = false;
+};
+
+#endif // DFUDISTRIBUTOR_H
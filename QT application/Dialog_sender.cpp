@@ -13,12 +13,20 @@
 #include <QScrollArea>
 #include <QRegularExpression>
 #include <QRegularExpressionMatch>
+#include <QInputDialog>
+#include <QFileDialog>
+#include <QStandardPaths>
+#include <QMessageBox>
+#include <QPixmap>
 
 #include <QScrollArea>
 
 Node nodes(0,0);
 bool Init = false;
 
+// Nodes publish a Beat to the dongle this often; see HeartbeatTracker.
+static const int BeatPeriodSeconds = 10;
+
 // Inside the DialogSender constructor
 DialogSender::DialogSender(QWidget *parent) :
     QDialog(parent),
@@ -39,7 +47,39 @@ DialogSender::DialogSender(QWidget *parent) :
     m_nodeDetailsTextBox(new QTextEdit),
     m_refreshButton(new QPushButton(tr("Refresh"))),
     m_subButton(new QPushButton(tr("Subscribe Node"))),
-    m_unSubButton(new QPushButton(tr("Unsubscribe Node")))
+    m_unSubButton(new QPushButton(tr("Unsubscribe Node"))),
+    m_remoteProvButton(new QPushButton(tr("Remote provision"))),
+    m_remoteProvisioner(new RemoteProvisioner(this)),
+    m_discoveryService(new DiscoveryService(this)),
+    m_dfuButton(new QPushButton(tr("Firmware update"))),
+    m_dfuDistributor(new DfuDistributor(this)),
+    m_tuningButton(new QPushButton(tr("Transport tuning"))),
+    m_transportTuner(new TransportTuner(this)),
+    m_transportDialog(new TransportDialog(m_transportTuner, this)),
+    m_statsButton(new QPushButton(tr("Statistics"))),
+    m_statsPoller(new StatsPoller(this)),
+    m_statsDialog(new StatsDialog(m_statsPoller, this)),
+    m_heartbeatTracker(new HeartbeatTracker(BeatPeriodSeconds, this)),
+    m_relayButton(new QPushButton(tr("Optimize relays"))),
+    m_topologyOptimizer(new TopologyOptimizer(m_transportTuner, m_heartbeatTracker, this)),
+    m_latencyButton(new QPushButton(tr("Latency"))),
+    m_latencyMatrix(new LatencyMatrix(this)),
+    m_latencyDialog(new LatencyDialog(m_latencyMatrix, this)),
+    m_sceneButton(new QPushButton(tr("Scenes"))),
+    m_sceneEditor(new SceneEditor(this)),
+    m_sceneDialog(new SceneDialog(m_sceneEditor, this)),
+    m_locationButton(new QPushButton(tr("Location"))),
+    m_groupManager(new GroupManager(
+        QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/groups.json", this)),
+    m_compositionCache(new CompositionCache(
+        QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/compositions.json", this)),
+    m_configButton(new QPushButton(tr("Apply config"))),
+    m_configReconciler(new ConfigReconciler(m_compositionCache, this)),
+    m_unicastAllocator(new UnicastAllocator(
+        QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/addresses.json", this)),
+    m_resetNodeButton(new QPushButton(tr("Reset node"))),
+    m_scheduler(new CommandScheduler(this)),
+    m_nodeStates(new NodeStateCache(this))
 
 {
     // Set up m_trafficLabel to support word wrapping
@@ -52,6 +92,9 @@ DialogSender::DialogSender(QWidget *parent) :
     trafficScrollArea->setWidgetResizable(true);
     trafficScrollArea->setMinimumHeight(100); // Adjust height as needed
 
+    // Several nodes can be selected to place them or switch them together
+    m_addressListWidget->setSelectionMode(QAbstractItemView::ExtendedSelection);
+
     // Configure the rest of the UI
     const auto infos = QSerialPortInfo::availablePorts();
     for (const QSerialPortInfo &info : infos) {
@@ -81,23 +124,284 @@ DialogSender::DialogSender(QWidget *parent) :
     mainLayout->addWidget(m_refreshButton, 0, 3);
     mainLayout->addWidget(m_subButton, 1, 3);
     mainLayout->addWidget(m_unSubButton, 2, 3);
+    mainLayout->addWidget(m_remoteProvButton, 0, 4);
+    mainLayout->addWidget(m_dfuButton, 1, 4);
+    mainLayout->addWidget(m_tuningButton, 2, 4);
+    mainLayout->addWidget(m_statsButton, 0, 5);
+    mainLayout->addWidget(m_relayButton, 1, 5);
+    mainLayout->addWidget(m_latencyButton, 2, 5);
+    mainLayout->addWidget(m_sceneButton, 0, 6);
+    mainLayout->addWidget(m_locationButton, 1, 6);
+    mainLayout->addWidget(m_configButton, 2, 6);
+    mainLayout->addWidget(m_resetNodeButton, 0, 7);
 
 
     setLayout(mainLayout);
     setWindowTitle(tr("Sender"));
     m_serialPortComboBox->setFocus();
 
-    m_timer.setSingleShot(true);
 
     connect(m_runButton, &QPushButton::clicked, this, &DialogSender::sendRequest);
     connect(&m_serial, &QSerialPort::readyRead, this, &DialogSender::readResponse);
-    connect(&m_timer, &QTimer::timeout, this, &DialogSender::processTimeout);
+    connect(&m_timer, &RequestTimer::timeout, this, &DialogSender::processTimeout);
     connect(m_sendAdvertise, &QPushButton::clicked, this, &DialogSender::sendAdvertisement);
     connect(m_turnOnAllLedsButton, &QPushButton::clicked, this, &DialogSender::turnOnAllLeds);
     connect(m_turnOffAllLedsButton, &QPushButton::clicked, this, &DialogSender::turnOffAllLeds);
     connect(m_addressListWidget, &QListWidget::itemDoubleClicked, this, &DialogSender::onAddressDoubleClicked);
     connect(m_serialPortComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DialogSender::openSerialPort);
     connect(m_refreshButton, &QPushButton::clicked, this, &DialogSender::onRefreshClicked);
+    connect(m_remoteProvButton, &QPushButton::clicked, this, &DialogSender::onRemoteProvisionClicked);
+
+    // All traffic to the dongle leaves through the scheduler
+    connect(m_scheduler, &CommandScheduler::write, this, [this](const QString &command) {
+        if (!m_serial.isOpen()) {
+            return;
+        }
+        m_serial.write(command.toUtf8());
+        m_serial.waitForBytesWritten(100);
+    });
+    // Replies are timed from here, not from when a helper queued them
+    connect(m_scheduler, &CommandScheduler::dispatched, this, &DialogSender::commandDispatched);
+
+    // Each new node gets as many addresses as the largest known firmware
+    // has elements; provisioning then reports the real count
+    auto allocateAddress = [this]() {
+        return m_unicastAllocator->allocate(m_compositionCache->maxElementCount());
+    };
+    auto releaseAddress = [this](quint16 address) {
+        m_unicastAllocator->release(address);
+    };
+
+    m_remoteProvisioner->setAddressAllocator(allocateAddress, releaseAddress);
+    connect(m_remoteProvisioner, &RemoteProvisioner::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Bulk);
+    });
+    connect(m_remoteProvisioner, &RemoteProvisioner::nodeProvisioned, this,
+            [this](quint16 address, const QString &uuid, quint16 server) {
+        QString uniqueAddress = QString("0x%1").arg(address, 4, 16, QChar('0'));
+        addProvisionedNode(uniqueAddress, uuid);
+        configureNode(address);
+
+        m_statusLabel->setText(tr("Node %1 provisioned at %2 through 0x%3.")
+                                   .arg(uuid).arg(uniqueAddress).arg(server, 4, 16, QChar('0')));
+    });
+    connect(m_remoteProvisioner, &RemoteProvisioner::finished, this, [this](int provisioned, int failed) {
+        m_remoteProvButton->setEnabled(true);
+        m_statusLabel->setText(tr("Remote provisioning done: %1 provisioned, %2 failed.")
+                                   .arg(provisioned).arg(failed));
+    });
+
+    m_discoveryService->setAddressAllocator(allocateAddress, releaseAddress);
+    connect(m_discoveryService, &DiscoveryService::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Bulk);
+    });
+    connect(m_discoveryService, &DiscoveryService::deviceDiscovered, this, [this](const QString &uuid, int rssi) {
+        m_statusLabel->setText(tr("Found %1 at %2 dBm.").arg(uuid).arg(rssi));
+    });
+    connect(m_discoveryService, &DiscoveryService::nodeProvisioned, this, [this](quint16 address, const QString &uuid) {
+        QString uniqueAddress = QString("0x%1").arg(address, 4, 16, QChar('0'));
+        addProvisionedNode(uniqueAddress, uuid);
+        configureNode(address);
+
+        m_statusLabel->setText(tr("Node provisioned with UUID %1 at address %2.").arg(uuid).arg(uniqueAddress));
+    });
+    connect(m_discoveryService, &DiscoveryService::provisioningFailed, this, [this](const QString &uuid, int failures) {
+        m_statusLabel->setText(tr("Provisioning %1 failed (%2 times).").arg(uuid).arg(failures));
+    });
+
+    connect(m_dfuButton, &QPushButton::clicked, this, &DialogSender::onFirmwareUpdateClicked);
+    connect(m_dfuDistributor, &DfuDistributor::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Bulk);
+    });
+    connect(m_dfuDistributor, &DfuDistributor::progress, this, [this](int percent, double bytesPerSecond) {
+        m_statusLabel->setText(tr("Firmware update: %1%, %2 B/s").arg(percent).arg(bytesPerSecond, 0, 'f', 0));
+    });
+    connect(m_dfuDistributor, &DfuDistributor::receiverCompleted, this,
+            [this](quint16 address, bool success, qint64 elapsedMs) {
+        m_nodeDetailsTextBox->append(tr("DFU 0x%1: %2 after %3 s")
+                                         .arg(address, 4, 16, QChar('0'))
+                                         .arg(success ? tr("done") : tr("failed"))
+                                         .arg(elapsedMs / 1000.0, 0, 'f', 1));
+    });
+    connect(m_dfuDistributor, &DfuDistributor::finished, this,
+            [this](int succeeded, int failed, qint64 elapsedMs, double bytesPerSecond) {
+        m_dfuButton->setText(tr("Firmware update"));
+        m_statusLabel->setText(tr("Firmware update done: %1 ok, %2 failed in %3 s, %4 B/s.")
+                                   .arg(succeeded).arg(failed)
+                                   .arg(elapsedMs / 1000.0, 0, 'f', 1)
+                                   .arg(bytesPerSecond, 0, 'f', 0));
+    });
+
+    connect(m_tuningButton, &QPushButton::clicked, this, &DialogSender::onTransportTuningClicked);
+    connect(m_transportTuner, &TransportTuner::sendCommand, this, [this](const QString &command) {
+        // Relay writes (relay pruning) change what the reconciler read
+        if (command.startsWith(QLatin1String("txp relay "))) {
+            for (const QString &word : command.split(' ', Qt::SkipEmptyParts)) {
+                if (word.startsWith(QLatin1String("0x"))) {
+                    m_configReconciler->invalidate(word.toUShort(nullptr, 16));
+                }
+            }
+        }
+        m_scheduler->enqueue(command, CommandScheduler::Control);
+    });
+    // Every probe resizes the pace to what the network just delivered
+    connect(m_transportTuner, &TransportTuner::measured, this, [this](const TransportTuner::Measurement &measurement) {
+        m_scheduler->setCapacity(measurement.deliveryRatio(), measurement.avgRttMs());
+    });
+
+    connect(m_statsButton, &QPushButton::clicked, this, &DialogSender::onStatisticsClicked);
+    connect(m_statsPoller, &StatsPoller::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Telemetry);
+    });
+
+    connect(m_relayButton, &QPushButton::clicked, this, &DialogSender::onOptimizeRelaysClicked);
+    connect(m_topologyOptimizer, &TopologyOptimizer::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Control);
+    });
+    connect(m_topologyOptimizer, &TopologyOptimizer::discovered, this, [this](int nodes, int links) {
+        auto toText = [](const QSet<quint16> &set) {
+            QStringList addresses;
+            for (quint16 address : set) {
+                addresses << QString("0x%1").arg(address, 4, 16, QChar('0'));
+            }
+            addresses.sort();
+            return addresses.join(' ');
+        };
+
+        QSet<quint16> pruned = m_topologyOptimizer->pruned();
+        m_nodeDetailsTextBox->clear();
+        m_nodeDetailsTextBox->append(tr("Neighbor graph: %1 nodes, %2 links").arg(nodes).arg(links));
+        m_nodeDetailsTextBox->append(tr("Relays: %1").arg(toText(m_topologyOptimizer->relays())));
+        m_nodeDetailsTextBox->append(tr("Relay off: %1").arg(toText(pruned)));
+
+        if (pruned.isEmpty()) {
+            m_relayButton->setEnabled(true);
+            m_statusLabel->setText(tr("No redundant relays found."));
+            return;
+        }
+
+        if (QMessageBox::question(this, tr("Optimize relays"),
+                                  tr("Disable relaying on %1 nodes and verify delivery?").arg(pruned.size()))
+            != QMessageBox::Yes || !m_topologyOptimizer->apply(20, 500)) {
+            m_relayButton->setEnabled(true);
+            return;
+        }
+        m_statusLabel->setText(tr("Measuring, pruning relays, measuring again..."));
+    });
+    connect(m_topologyOptimizer, &TopologyOptimizer::applied, this,
+            [this](const TransportTuner::Measurement &before, const TransportTuner::Measurement &after, bool rolledBack) {
+        m_relayButton->setEnabled(true);
+        m_statusLabel->setText(tr("Delivery %1% -> %2%, RTT %3 -> %4 ms.%5")
+                                   .arg(before.deliveryRatio() * 100.0, 0, 'f', 1)
+                                   .arg(after.deliveryRatio() * 100.0, 0, 'f', 1)
+                                   .arg(before.avgRttMs(), 0, 'f', 0)
+                                   .arg(after.avgRttMs(), 0, 'f', 0)
+                                   .arg(rolledBack ? tr(" Delivery dropped, relays enabled again.") : QString()));
+    });
+
+    connect(m_latencyButton, &QPushButton::clicked, this, &DialogSender::onLatencyClicked);
+    connect(m_latencyMatrix, &LatencyMatrix::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Telemetry);
+    });
+
+    connect(m_sceneButton, &QPushButton::clicked, this, &DialogSender::onScenesClicked);
+    connect(m_locationButton, &QPushButton::clicked, this, &DialogSender::onLocationClicked);
+    connect(m_groupManager, &GroupManager::sendCommand, this, [this](const QString &command) {
+        m_configReconciler->invalidate(command.section(' ', 1, 1).toUShort(nullptr, 16));
+        // A node moved again before its subscriptions went out
+        m_scheduler->enqueue(command, CommandScheduler::Control, command.section(' ', 0, 1));
+    });
+    connect(m_sceneEditor, &SceneEditor::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Control);
+    });
+
+    connect(m_compositionCache, &CompositionCache::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Bulk);
+    });
+    connect(m_compositionCache, &CompositionCache::compositionReady, this, [this](quint16 address) {
+        if (m_unicastAllocator->contains(address)) {
+            m_unicastAllocator->resize(address, m_compositionCache->composition(address).elements.size());
+        }
+        if (m_unconfiguredNodes.remove(address)) {
+            sendNodeConfig(address);
+        }
+    });
+    connect(m_compositionCache, &CompositionCache::fetchFailed, this, [this](quint16 address) {
+        // Fall back to the layout of this firmware
+        if (m_unconfiguredNodes.remove(address)) {
+            QString text = QString("0x%1").arg(address, 4, 16, QChar('0'));
+            m_configReconciler->invalidate(address);
+            m_scheduler->enqueue(nodeConfigCommand(text), CommandScheduler::Bulk);
+            m_statusLabel->setText(tr("No composition from %1, configured as this firmware.").arg(text));
+        }
+    });
+
+    connect(m_unicastAllocator, &UnicastAllocator::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Control);
+    });
+    connect(m_unicastAllocator, &UnicastAllocator::checked, this, [this](int cdbNodes, int fixed) {
+        if (m_networkPending) {
+            m_networkPending = false;
+            if (!cdbNodes) {
+                createNetwork();
+                m_statusLabel->setText(tr("New network created on the dongle."));
+                return;
+            }
+            m_statusLabel->setText(tr("Network restored from the dongle: %1 nodes.").arg(cdbNodes));
+        }
+        if (fixed) {
+            m_statusLabel->setText(tr("Address allocation matched to the CDB: %1 nodes fixed.").arg(fixed));
+        }
+    });
+    connect(m_resetNodeButton, &QPushButton::clicked, this, &DialogSender::onResetNodeClicked);
+
+    connect(m_configButton, &QPushButton::clicked, this, &DialogSender::onApplyConfigClicked);
+    connect(m_configReconciler, &ConfigReconciler::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Bulk);
+    });
+    connect(m_configReconciler, &ConfigReconciler::progress, this, [this](int done, int total) {
+        m_statusLabel->setText(tr("Applying config: %1/%2 nodes.").arg(done).arg(total));
+    });
+    connect(m_configReconciler, &ConfigReconciler::finished, this,
+            [this](int changedNodes, int operations, int failedNodes) {
+        m_configButton->setText(tr("Apply config"));
+        m_statusLabel->setText(tr("Config applied: %1 operations on %2 nodes, %3 failed.")
+                                   .arg(operations).arg(changedNodes).arg(failedNodes));
+    });
+
+    // Every Set is shown at once; only nodes that do not confirm are asked
+    m_nodeStates->setGroupResolver([this](quint16 group) {
+        return m_groupManager->members(group);
+    });
+    connect(m_nodeStates, &NodeStateCache::sendCommand, this, [this](const QString &command) {
+        m_scheduler->enqueue(command, CommandScheduler::Control, command.trimmed());
+    });
+    connect(m_nodeStates, &NodeStateCache::stateChanged, this, &DialogSender::setLedStatus);
+    connect(m_nodeStates, &NodeStateCache::diverged, this, [this](quint16 address, bool expected, bool reported) {
+        m_statusLabel->setText(tr("Node 0x%1 is %2, expected %3.")
+                                   .arg(address, 4, 16, QChar('0'))
+                                   .arg(reported ? tr("on") : tr("off"))
+                                   .arg(expected ? tr("on") : tr("off")));
+    });
+
+    // Nodes announce themselves through their Beats, including nodes
+    // provisioned by an earlier session of this application
+    connect(m_heartbeatTracker, &HeartbeatTracker::nodeDiscovered, this, [this](quint16 address) {
+        addProvisionedNode(QString("0x%1").arg(address, 4, 16, QChar('0')), QString());
+        if (!m_unicastAllocator->reserve(address, m_compositionCache->composition(address).elements.size())) {
+            qDebug() << "Addresses of" << address << "overlap another node";
+        }
+    });
+    connect(m_heartbeatTracker, &HeartbeatTracker::nodeLost, this, [this](quint16 address) {
+        setNodeAlive(address, false);
+        m_statusLabel->setText(tr("Node 0x%1 stopped responding.").arg(address, 4, 16, QChar('0')));
+    });
+    connect(m_heartbeatTracker, &HeartbeatTracker::nodeAlive, this, [this](quint16 address) {
+        setNodeAlive(address, true);
+        // It may have missed Sets while it was away
+        m_nodeStates->invalidate(address);
+        m_statusLabel->setText(tr("Node 0x%1 is back.").arg(address, 4, 16, QChar('0')));
+    });
 
     connect(m_addressListWidget, &QListWidget::currentItemChanged, this, [this](QListWidgetItem *current, QListWidgetItem *previous) {
         Q_UNUSED(previous);
@@ -177,32 +481,18 @@ void DialogSender::sendAdvertisement()
 
         Node node;
 
-        QStringList commands = {
-            "mesh init\n",
-            "mesh reset-local\n",
-            "mesh prov uuid deadbeaf\n",
-            "mesh cdb create\n",
-            "mesh prov local 0 0x0001\n",
-            "mesh cdb app-key-add 0 0\n",
-            "mesh target dst 0x1\n",
-            "mesh models cfg appkey add 0 0\n",
-            "mesh models cfg model app-bind 0x1 0 0x1001\n",
-            "mesh models cfg model app-bind 0x1 0 0x1000\n",
-            "mesh models cfg model sub-add 0x1 0xc000 0x1001\n",
-            "mesh models cfg model sub-add 0x1 0xc000 0x1000\n"
-        };
-
         node.setAddress("0x0001");
         node.setUuid("deadbeaf");
         m_addressListWidget->addItem(node.address());
-
-        //  "mesh prov local 0 0x0001\n"
+        m_groupManager->addNode(0x0001);
         m_nodeMap["0x0001"] = node;
-        for (const QString &command : commands) {
-            m_serial.write(command.toUtf8());
-            m_serial.waitForBytesWritten(100);
-            QThread::msleep(150);
-        }
+
+        // A dongle that already runs a network keeps it, with the CDB and
+        // the keys of the nodes provisioned in earlier sessions; the
+        // network is only created once the CDB turns out empty
+        m_scheduler->enqueue("mesh init\n", CommandScheduler::Control);
+        m_networkPending = true;
+        m_unicastAllocator->check();
 
         m_statusLabel->setText(tr("Status: Mesh commands sent."));
         qDebug() << "Mesh commands sent to dongle.";
@@ -210,12 +500,35 @@ void DialogSender::sendAdvertisement()
     }
 }
 
+void DialogSender::createNetwork()
+{
+    QStringList commands = {
+        "mesh reset-local\n",
+        "mesh prov uuid deadbeaf\n",
+        "mesh cdb create\n",
+        "mesh prov local 0 0x0001\n",
+        "mesh cdb app-key-add 0 0\n",
+        nodeConfigCommand("0x0001")
+    };
+
+    m_configReconciler->invalidate(0x0001);
+
+    // One lane keeps them in order; the pacing replaces the sleeps
+    for (const QString &command : commands) {
+        m_scheduler->enqueue(command, CommandScheduler::Control);
+    }
+
+    m_unicastAllocator->reserve(0x0001, 1);
+}
+
 void DialogSender::openSerialPort(int index)
 {
     if (index == -1) return;
 
     QString portName = m_serialPortComboBox->itemText(index);
     if (m_serial.portName() != portName) {
+        // Nothing queued for the old dongle makes sense on the new one
+        m_scheduler->clear();
         m_serial.close();
         m_serial.setPortName(portName);
         initializeSerialPort();
@@ -239,7 +552,7 @@ void DialogSender::sendRequest()
     m_statusLabel->setText(tr("Status: Running, connected to port %1.")
                                .arg(m_serialPortComboBox->currentText()));
 
-    m_serial.write((m_requestLineEdit->text() + "\r\n").toUtf8());
+    m_scheduler->enqueue(m_requestLineEdit->text() + "\r\n", CommandScheduler::Interactive);
     m_timer.start(m_waitResponseSpinBox->value());
 }
 
@@ -257,6 +570,17 @@ void DialogSender::readResponse()
     // Add the new data to the existing response buffer
     m_response.append(newData);
 
+    // Hand every complete line to the line handlers, keep the partial tail
+    m_lineBuffer.append(newData);
+    int newline;
+    while ((newline = m_lineBuffer.indexOf('\n')) >= 0) {
+        QString line = QString::fromUtf8(m_lineBuffer.left(newline)).trimmed();
+        m_lineBuffer.remove(0, newline + 1);
+        if (!line.isEmpty()) {
+            handleLine(line);
+        }
+    }
+
     // Convert the byte array to a string for easier processing
     QString responseString = QString::fromUtf8(m_response);
 
@@ -292,13 +616,179 @@ void DialogSender::readResponse()
 }
 
 
-void DialogSender::setLedStatus(const QString &address, bool isOn)
+void DialogSender::handleLine(const QString &line)
+{
+    m_remoteProvisioner->handleLine(line);
+    m_discoveryService->handleLine(line);
+    m_dfuDistributor->handleLine(line);
+    m_transportTuner->handleLine(line);
+    m_statsPoller->handleLine(line);
+    m_heartbeatTracker->handleLine(line);
+    m_topologyOptimizer->handleLine(line);
+    m_latencyMatrix->handleLine(line);
+    m_sceneEditor->handleLine(line);
+    m_compositionCache->handleLine(line);
+    m_configReconciler->handleLine(line);
+    m_unicastAllocator->handleLine(line);
+    m_nodeStates->handleLine(line);
+    m_groupManager->handleLine(line);
+    // Last: a released command lets the next one out, and the helpers
+    // must have seen the reply to the previous one first
+    m_scheduler->handleLine(line);
+
+    static const QRegularExpression addedRegex(
+        R"(Node provisioned, net_idx 0x[0-9a-fA-F]+ address (0x[0-9a-fA-F]+) elements (\d+))");
+    static const QRegularExpression resetRegex(R"(^NODERST (0x[0-9a-fA-F]+) elems \d+ ok)");
+
+    QRegularExpressionMatch match = addedRegex.match(line);
+    if (match.hasMatch()) {
+        // The CDB holds the node's real element count now
+        quint16 address = match.captured(1).toUShort(nullptr, 16);
+        if (!m_unicastAllocator->resize(address, match.captured(2).toInt())) {
+            m_unicastAllocator->check();
+        }
+        return;
+    }
+
+    match = resetRegex.match(line);
+    if (match.hasMatch()) {
+        removeNode(match.captured(1).toUShort(nullptr, 16));
+    }
+}
+
+void DialogSender::commandDispatched(const QString &command)
+{
+    m_remoteProvisioner->commandDispatched(command);
+    m_discoveryService->commandDispatched(command);
+    m_transportTuner->commandDispatched(command);
+    m_topologyOptimizer->commandDispatched(command);
+    m_latencyMatrix->commandDispatched(command);
+    m_sceneEditor->commandDispatched(command);
+    m_compositionCache->commandDispatched(command);
+    m_configReconciler->commandDispatched(command);
+    m_nodeStates->commandDispatched(command);
+    m_groupManager->commandDispatched(command);
+}
+
+QString DialogSender::nodeConfigCommand(const QString &address) const
+{
+    // AppKey 0, group 0xc000, Beats to the dongle
+    return QString("nodecfg %1 0 0xc000 0x0001 %2\n").arg(address).arg(BeatPeriodSeconds);
+}
+
+NetworkSpec::NodeConfig DialogSender::defaultNodeConfig() const
+{
+    // What nodecfg does for this firmware: AppKey 0 bound to every model,
+    // the OnOff models and the Scene Server in 0xc000, Beats and OnOff
+    // state changes to the dongle. The firmware update models are only in
+    // the DFU images; nodes without them skip them (see modelToken).
+    NetworkSpec::NodeConfig config;
+    config.appKeys = QSet<int>{ 0 };
+    for (quint32 model : { CompositionCache::GenOnOffSrv, CompositionCache::GenOnOffCli,
+                           CompositionCache::SceneSrv, CompositionCache::SceneSetupSrv,
+                           CompositionCache::SceneCli, CompositionCache::VendorModel,
+                           CompositionCache::BlobSrv, CompositionCache::DfuSrv,
+                           CompositionCache::BlobCli, CompositionCache::DfuCli,
+                           CompositionCache::DfdSrv }) {
+        config.models[model].binds = QSet<int>{ 0 };
+    }
+    for (quint32 model : { CompositionCache::GenOnOffSrv, CompositionCache::GenOnOffCli,
+                           CompositionCache::SceneSrv }) {
+        config.models[model].subs = QSet<quint16>{ 0xc000 };
+    }
+
+    NetworkSpec::Publication beat;
+    beat.dst = 0x0001;
+    beat.periodS = BeatPeriodSeconds;
+    config.models[CompositionCache::VendorModel].pub = beat;
+
+    NetworkSpec::Publication state;
+    state.dst = 0x0001;
+    config.models[CompositionCache::GenOnOffSrv].pub = state;
+    return config;
+}
+
+void DialogSender::configureNode(quint16 address)
+{
+    // Binds and subscriptions are planned from the composition, read
+    // first unless the registry knows the node's firmware
+    if (m_compositionCache->contains(address)) {
+        sendNodeConfig(address);
+    } else {
+        m_unconfiguredNodes.insert(address);
+        m_compositionCache->fetch(address);
+    }
+}
+
+void DialogSender::sendNodeConfig(quint16 address)
+{
+    // Written past the reconciler, so what it read is stale
+    m_configReconciler->invalidate(address);
+
+    const QStringList ops = NetworkSpec::diff(defaultNodeConfig(), NetworkSpec::NodeConfig(),
+                                              [this, address](quint32 model) {
+        return m_compositionCache->modelToken(address, model);
+    });
+
+    for (const QString &command : NetworkSpec::cfgsetCommands(address, ops)) {
+        m_scheduler->enqueue(command, CommandScheduler::Bulk);
+    }
+}
+
+void DialogSender::removeNode(quint16 address)
+{
+    QString text = QString("0x%1").arg(address, 4, 16, QChar('0'));
+    auto it = m_nodeMap.find(text);
+    if (it != m_nodeMap.end()) {
+        m_provisionedUUIDs.remove(it->second.uuid());
+        m_nodeMap.erase(it);
+    }
+
+    if (m_selectedItem && m_selectedItem->text() == text) {
+        m_selectedItem = nullptr;
+    }
+    qDeleteAll(m_addressListWidget->findItems(text, Qt::MatchExactly));
+    m_groupManager->removeNode(address);
+    m_nodeStates->removeNode(address);
+    m_compositionCache->forget(address);
+    m_configReconciler->invalidate(address);
+    m_unconfiguredNodes.remove(address);
+    m_unicastAllocator->release(address);
+
+    m_statusLabel->setText(tr("Node %1 reset, %2 addresses free.").arg(text).arg(m_unicastAllocator->freeAddresses()));
+}
+
+void DialogSender::setNodeAlive(quint16 address, bool alive)
+{
+    QString text = QString("0x%1").arg(address, 4, 16, QChar('0'));
+    const QList<QListWidgetItem *> items = m_addressListWidget->findItems(text, Qt::MatchExactly);
+    for (QListWidgetItem *item : items) {
+        item->setForeground(alive ? palette().text() : QBrush(Qt::gray));
+    }
+}
+
+// Paint the node's cached OnOff state: a lit or dark square, faded while
+// the node has not confirmed it, none while it is unknown.
+void DialogSender::setLedStatus(quint16 address)
 {
-    QString status = isOn ? "on" : "off";
-    qDebug() << "Setting LED for address" << address << "to" << status;
+    NodeStateCache::NodeState state = m_nodeStates->state(address);
+    QIcon icon;
+    if (state.confirmation != NodeStateCache::Confirmation::Unknown) {
+        QColor color = state.on ? QColor(Qt::yellow) : QColor(Qt::darkGray);
+        if (state.confirmation == NodeStateCache::Confirmation::Pending) {
+            color.setAlpha(96);
+        }
+        QPixmap pixmap(12, 12);
+        pixmap.fill(color);
+        icon = QIcon(pixmap);
+    }
 
-    // Update the UI or internal state for the LED
-    m_statusLabel->setText(tr("LED for %1 set to: %2").arg(address).arg(status));
+    QString text = QString("0x%1").arg(address, 4, 16, QChar('0'));
+    const QList<QListWidgetItem *> items = m_addressListWidget->findItems(text, Qt::MatchExactly);
+    for (QListWidgetItem *item : items) {
+        item->setIcon(icon);
+        item->setToolTip(m_nodeStates->describe(address));
+    }
 }
 
 void DialogSender::processTimeout()
@@ -337,6 +827,33 @@ void DialogSender::setControlsEnabled(bool enable)
     m_requestLineEdit->setEnabled(enable);
 }
 
+// Switch only the selected nodes, through the fewest group and unicast
+// messages that reach exactly them. False if nothing or every node is
+// selected; the all-nodes group does that.
+bool DialogSender::setSelectedLeds(bool on)
+{
+    QSet<quint16> selection;
+    for (QListWidgetItem *item : m_addressListWidget->selectedItems()) {
+        selection.insert(item->text().toUShort(nullptr, 16));
+    }
+
+    if (selection.isEmpty() || selection.size() >= m_addressListWidget->count()) {
+        return false;
+    }
+
+    GroupManager::Destinations destinations = m_groupManager->cover(selection);
+    for (quint16 destination : destinations.all()) {
+        QString target = QString("0x%1").arg(destination, 4, 16, QChar('0'));
+        m_scheduler->enqueue(QString("onoff %1 %2\n").arg(target).arg(on ? 1 : 0),
+                             CommandScheduler::Interactive, "onoff " + target);
+    }
+
+    m_statusLabel->setText(tr("Status: %1 nodes turned %2 with %3 groups and %4 unicasts.")
+                               .arg(selection.size()).arg(on ? tr("on") : tr("off"))
+                               .arg(destinations.groups.size()).arg(destinations.unicasts.size()));
+    return true;
+}
+
 void DialogSender::turnOnAllLeds()
 {
     if (!m_serial.isOpen()) {
@@ -344,15 +861,12 @@ void DialogSender::turnOnAllLeds()
         return;
     }
 
-    QString Command1 = QString("target dst 0xc000\n");
-    m_serial.write(Command1.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
+    if (setSelectedLeds(true)) {
+        return;
+    }
 
-    QString Command2 = QString("test net-send 82030101\n");
-    m_serial.write(Command2.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
+    // A later switch replaces it while it waits
+    m_scheduler->enqueue("onoff 0xc000 1\n", CommandScheduler::Interactive, "onoff 0xc000");
 
 
     m_statusLabel->setText(tr("Status: All LEDs turned on."));
@@ -366,16 +880,11 @@ void DialogSender::turnOffAllLeds()
         return;
     }
 
-    QString Command1 = QString("target dst 0xc000\n");
-    m_serial.write(Command1.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
+    if (setSelectedLeds(false)) {
+        return;
+    }
 
-    QThread::msleep(100);
-    QString Command2 = QString("test net-send 82030000\n");
-    m_serial.write(Command2.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
+    m_scheduler->enqueue("onoff 0xc000 0\n", CommandScheduler::Interactive, "onoff 0xc000");
 
     m_statusLabel->setText(tr("Status: All LEDs turned off."));
     qDebug() << "Command sent to turn off all LEDs.";
@@ -397,6 +906,7 @@ void DialogSender::onAddressDoubleClicked(QListWidgetItem *item)
     // Display address immediately
     m_nodeDetailsTextBox->append(tr("Address: %1").arg(node.address()));
     m_nodeDetailsTextBox->append(tr("UUID: %1").arg(node.uuid()));
+    m_nodeDetailsTextBox->append(tr("Liveness: %1").arg(m_heartbeatTracker->describe(address.toUShort(nullptr, 16))));
 
     m_statusLabel->setText(tr("Fetching UUID for address %1...").arg(address));
 }
@@ -408,134 +918,365 @@ void DialogSender::onRefreshClicked()
         return;
     }
 
-    // Send the "mesh prov beacon-listen on" command to discover nodes
-    QString beaconListenCommand = "mesh prov beacon-listen on\n";
-    m_serial.write(beaconListenCommand.toUtf8());
-    m_serial.waitForBytesWritten(100);
+    // Discovery keeps listening until it is stopped; new devices are
+    // provisioned as soon as their first beacon arrives
+    if (m_discoveryService->isRunning()) {
+        m_discoveryService->stop();
+        m_refreshButton->setText(tr("Refresh"));
+        m_statusLabel->setText(tr("Discovery stopped."));
+        return;
+    }
+
+    m_discoveryService->start(m_provisionedUUIDs);
+    m_refreshButton->setText(tr("Stop discovery"));
+    m_statusLabel->setText(tr("Discovering nodes..."));
+}
 
-    m_statusLabel->setText(tr("Refreshing and discovering nodes..."));
-    // Wait for the response and parse it
 
-    QTimer::singleShot(200, this, [this]() {
-        connect(&m_serial, &QSerialPort::readyRead, this, &DialogSender::handleBeaconResponse, Qt::UniqueConnection);
-    });
+void DialogSender::addProvisionedNode(const QString &address, const QString &uuid)
+{
+    // Add the UUID to the provisioned set; nodes found through their
+    // Beats have no known UUID
+    if (!uuid.isEmpty()) {
+        m_provisionedUUIDs.insert(uuid);
+    }
 
-    QTimer::singleShot(3000, this, [this]() {
-    m_serial.write("mesh prov beacon-listen off\n");
-    m_serial.waitForBytesWritten(100);
-    });
-}
+    // Check if the address is already in the map
+    if (m_nodeMap.find(address) == m_nodeMap.end()) {
+        // Create a new node and add it to the map
+        Node node(address, uuid);
+        m_nodeMap[address] = node;
 
+        // Optionally add the address to the GUI list
+        m_addressListWidget->addItem(address);
+        m_groupManager->addNode(address.toUShort(nullptr, 16));
+        setLedStatus(address.toUShort(nullptr, 16));
+    } else {
+        qDebug() << "Node with address" << address << "is already provisioned.";
+    }
+}
 
-void DialogSender::handleBeaconResponse()
+void DialogSender::onRemoteProvisionClicked()
 {
-    QByteArray data = m_serial.readAll();
-    QString response = QString::fromUtf8(data).trimmed();
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
 
-    qDebug() << "Received beacon response:" << response;
+    if (m_remoteProvisioner->isRunning()) {
+        m_statusLabel->setText(tr("Remote provisioning already running."));
+        return;
+    }
 
-    // Regular expression to extract UUID from the response
-    QRegularExpression uuidRegex(R"(PB-GATT UUID\s([0-9a-fA-F]{32}))");
-    QRegularExpressionMatch match = uuidRegex.match(response);
+    // Every provisioned node, the dongle included, is an RPR server
+    QList<quint16> servers;
+    for (const auto &entry : m_nodeMap) {
+        servers << entry.first.toUShort(nullptr, 16);
+    }
 
-    if (match.hasMatch()) {
-        QString uuid = match.captured(1);  // Extract the UUID
-        qDebug() << "Found UUID:" << uuid;
+    if (servers.isEmpty()) {
+        m_statusLabel->setText(tr("Initialize the provisioner first."));
+        return;
+    }
+
+    m_remoteProvButton->setEnabled(false);
+    m_remoteProvisioner->start(servers, 10, m_provisionedUUIDs);
+    m_statusLabel->setText(tr("Scanning through %1 RPR servers...").arg(servers.size()));
+}
 
-        // Remove trailing zeros from the UUID
-        uuid = uuid.trimmed();
-        uuid.remove(QRegularExpression("0+$")); // Remove trailing zeros using QRegularExpression
+void DialogSender::onFirmwareUpdateClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
 
-        qDebug() << "UUID after trimming zeros:" << uuid;
+    if (m_dfuDistributor->isRunning()) {
+        m_dfuDistributor->cancel();
+        return;
+    }
 
-        // Check if UUID is already provisioned
-        if (m_provisionedUUIDs.contains(uuid)) {
-            qDebug() << "UUID already provisioned. Skipping...";
-            m_statusLabel->setText(tr("Node with UUID %1 is already provisioned.").arg(uuid));
-            return; // Skip further processing for this UUID
+    // Every node except the dongle itself receives the image
+    QList<quint16> receivers;
+    for (const auto &entry : m_nodeMap) {
+        quint16 address = entry.first.toUShort(nullptr, 16);
+        if (address != 0x0001) {
+            receivers << address;
         }
+    }
 
-        // Assign the next available unicast address
-        QString uniqueAddress = QString("0x%1").arg(m_nextUnicastAddress, 4, 16, QChar('0'));
+    if (receivers.isEmpty()) {
+        m_statusLabel->setText(tr("No nodes to update."));
+        return;
+    }
 
-        // Increment the address for the next node
-        m_nextUnicastAddress++;
+    bool ok = false;
+    DfuDistributor::Options options;
+    options.imageSize = QInputDialog::getInt(this, tr("Firmware update"),
+                                             tr("Image size in the distributor slot (bytes):"),
+                                             0, 1, 1024 * 1024, 1, &ok);
+    if (!ok) {
+        return;
+    }
 
-        // Provision the node using the remote GATT command
-        QString provisionCommand = QString("mesh prov remote-gatt %1 0 %2 30\n").arg(uuid).arg(uniqueAddress);
-        m_serial.write(provisionCommand.toUtf8());
-        qDebug() << "Sending REMOTE GATT";
-        m_serial.waitForBytesWritten(100);
+    options.fwid = QInputDialog::getText(this, tr("Firmware update"), tr("Firmware ID (hex):"),
+                                         QLineEdit::Normal, QString(), &ok);
+    if (!ok || options.fwid.isEmpty()) {
+        return;
+    }
 
-        QTimer::singleShot(2000, this, [this, uniqueAddress]() {
-            qDebug() << "RAAAAAAHHHHHHHHHHHHHHHHHHHHHH \n\n\n";
-            QString Command1 = QString("mesh target dst %1\n").arg(uniqueAddress);
-            m_serial.write(Command1.toUtf8());
-            m_serial.waitForBytesWritten(100);
-            m_serial.waitForReadyRead(50);
+    if (m_dfuDistributor->start(options, receivers)) {
+        m_dfuButton->setText(tr("Cancel update"));
+        m_nodeDetailsTextBox->clear();
+        m_statusLabel->setText(tr("Firmware update started for %1 nodes.").arg(receivers.size()));
+    }
+}
 
-            QThread::msleep(100);
-            m_serial.write("mesh models cfg appkey add 0 0\n");
-            m_serial.waitForBytesWritten(100);
-            m_serial.waitForReadyRead(50);
+void DialogSender::onTransportTuningClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
 
-            QThread::msleep(100);
-            QString Command2 = QString("mesh models cfg model app-bind %1 0 0x1001\n").arg(uniqueAddress);
-            m_serial.write(Command2.toUtf8());
-            m_serial.waitForBytesWritten(100);
-            m_serial.waitForReadyRead(50);
+    // Tune every provisioned node, the dongle included
+    QList<quint16> nodes;
+    for (const auto &entry : m_nodeMap) {
+        nodes << entry.first.toUShort(nullptr, 16);
+    }
 
-            QThread::msleep(100);
-            QString Command3 = QString("mesh models cfg model app-bind %1 0 0x1000\n").arg(uniqueAddress);
-            m_serial.write(Command3.toUtf8());
-            m_serial.waitForBytesWritten(100);
-            m_serial.waitForReadyRead(50);
+    if (nodes.isEmpty()) {
+        m_statusLabel->setText(tr("Initialize the provisioner first."));
+        return;
+    }
 
-            QThread::msleep(100);
-            QString Command4 = QString("mesh models cfg model sub-add %1 0xc000 0x1001\n").arg(uniqueAddress);
-            m_serial.write(Command4.toUtf8());
-            m_serial.waitForBytesWritten(100);
-            m_serial.waitForReadyRead(50);
+    m_transportDialog->setNodes(nodes);
+    m_transportDialog->show();
+    m_transportDialog->raise();
+}
 
-            QThread::msleep(100);
-            QString Command5 = QString("mesh models cfg model sub-add %1 0xc000 0x1000\n").arg(uniqueAddress);
-            m_serial.write(Command5.toUtf8());
-            m_serial.waitForBytesWritten(100);
-            m_serial.waitForReadyRead(50);
-        });
+void DialogSender::onStatisticsClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
 
-        // Add the UUID to the provisioned set
-        m_provisionedUUIDs.insert(uuid);
+    QList<quint16> nodes;
+    for (const auto &entry : m_nodeMap) {
+        nodes << entry.first.toUShort(nullptr, 16);
+    }
 
-        // Check if the address is already in the map
-        if (m_nodeMap.find(uniqueAddress) == m_nodeMap.end()) {
-            // Create a new node and add it to the map
-            Node node(uniqueAddress, uuid);
-            m_nodeMap[uniqueAddress] = node;
+    if (nodes.isEmpty()) {
+        m_statusLabel->setText(tr("Initialize the provisioner first."));
+        return;
+    }
 
-            // Optionally add the address to the GUI list
-            m_addressListWidget->addItem(uniqueAddress);
-        } else {
-            qDebug() << "Node with address" << uniqueAddress << "is already provisioned.";
+    // Nodes provisioned since the last start are polled after a restart
+    m_statsDialog->setNodes(nodes);
+    m_statsDialog->show();
+    m_statsDialog->raise();
+}
+
+void DialogSender::onOptimizeRelaysClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
+
+    QList<quint16> nodes;
+    for (const auto &entry : m_nodeMap) {
+        nodes << entry.first.toUShort(nullptr, 16);
+    }
+
+    if (nodes.size() < 3) {
+        m_statusLabel->setText(tr("Relay pruning needs at least three nodes."));
+        return;
+    }
+
+    if (m_topologyOptimizer->discover(nodes)) {
+        m_relayButton->setEnabled(false);
+        m_statusLabel->setText(tr("Discovering neighbors of %1 nodes...").arg(nodes.size()));
+    }
+}
+
+void DialogSender::onLatencyClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
+
+    QList<quint16> nodes;
+    for (const auto &entry : m_nodeMap) {
+        nodes << entry.first.toUShort(nullptr, 16);
+    }
+
+    if (nodes.isEmpty()) {
+        m_statusLabel->setText(tr("Initialize the provisioner first."));
+        return;
+    }
+
+    if (!m_latencyMatrix->isRunning()) {
+        m_latencyDialog->setNodes(nodes);
+    }
+    m_latencyDialog->show();
+    m_latencyDialog->raise();
+}
+
+void DialogSender::onScenesClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
+
+    QList<quint16> nodes;
+    for (const auto &entry : m_nodeMap) {
+        nodes << entry.first.toUShort(nullptr, 16);
+    }
+
+    if (nodes.isEmpty()) {
+        m_statusLabel->setText(tr("Initialize the provisioner first."));
+        return;
+    }
+
+    if (!m_sceneEditor->isRunning()) {
+        m_sceneDialog->setNodes(nodes);
+    }
+    m_sceneDialog->show();
+    m_sceneDialog->raise();
+}
+
+void DialogSender::onLocationClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
+
+    const QList<QListWidgetItem *> items = m_addressListWidget->selectedItems();
+    if (items.isEmpty()) {
+        m_statusLabel->setText(tr("Select the nodes to place first."));
+        return;
+    }
+
+    quint16 first = items.first()->text().toUShort(nullptr, 16);
+    bool ok = false;
+    QString location = QInputDialog::getText(this, tr("Location"),
+                                             tr("Site/floor/zone/room of %1 nodes:").arg(items.size()),
+                                             QLineEdit::Normal,
+                                             m_groupManager->pathOf(first).join('/'), &ok);
+    QStringList path = location.split('/', Qt::SkipEmptyParts);
+    if (!ok || path.isEmpty()) {
+        return;
+    }
+
+    if (path.size() > GroupManager::MaxDepth) {
+        m_statusLabel->setText(tr("At most %1 levels: site/floor/zone/room.").arg(GroupManager::MaxDepth));
+        return;
+    }
+
+    // Subscribe the OnOff and Scene Servers on the elements that hold
+    // them; skip nodes whose composition shows they have none
+    int placed = 0;
+    for (QListWidgetItem *item : items) {
+        quint16 address = item->text().toUShort(nullptr, 16);
+        QStringList models;
+        for (quint32 model : { CompositionCache::GenOnOffSrv, CompositionCache::SceneSrv }) {
+            QString token = m_compositionCache->modelToken(address, model);
+            if (!token.isEmpty()) {
+                models << token;
+            }
         }
+        if (models.isEmpty()) {
+            continue;
+        }
+        placed += m_groupManager->assign(address, path, models) ? 1 : 0;
+    }
 
-        m_statusLabel->setText(tr("Node provisioned with UUID %1 at address %2.").arg(uuid).arg(uniqueAddress));
+    m_statusLabel->setText(tr("Placing %1 nodes in %2 (group 0x%3).")
+                               .arg(placed).arg(path.join('/'))
+                               .arg(m_groupManager->groupOf(path), 4, 16, QChar('0')));
+}
+
+void DialogSender::onApplyConfigClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
 
+    if (m_configReconciler->isRunning()) {
+        m_configReconciler->stop();
+        return;
+    }
 
+    QList<quint16> nodes;
+    for (const auto &entry : m_nodeMap) {
+        quint16 address = entry.first.toUShort(nullptr, 16);
+        if (address != 0x0001) {
+            nodes << address;
+        }
+    }
 
+    if (nodes.isEmpty()) {
+        m_statusLabel->setText(tr("No nodes to configure."));
+        return;
+    }
 
-    } else {
-        m_statusLabel->setText(tr("No nodes discovered."));
+    QString path = QFileDialog::getOpenFileName(this, tr("Apply config"), QString(),
+                                                tr("Network description (*.json)"));
+    if (path.isEmpty()) {
+        return;
     }
 
-    // Optionally disable beacon listen after processing
-    m_serial.write("mesh prov beacon-listen off\n");
-    m_serial.waitForBytesWritten(100);
+    NetworkSpec spec;
+    QString error;
+    if (!spec.load(path, &error)) {
+        m_statusLabel->setText(tr("Invalid config: %1").arg(error));
+        return;
+    }
 
-    // Disconnect the handler after processing the response
-    disconnect(&m_serial, &QSerialPort::readyRead, nullptr, nullptr);
+    if (m_configReconciler->reconcile(spec, nodes)) {
+        m_configButton->setText(tr("Stop config"));
+    }
 }
 
+void DialogSender::onResetNodeClicked()
+{
+    if (!m_serial.isOpen()) {
+        m_statusLabel->setText(tr("Status: Serial port not open."));
+        return;
+    }
+
+    QList<quint16> nodes;
+    for (QListWidgetItem *item : m_addressListWidget->selectedItems()) {
+        quint16 address = item->text().toUShort(nullptr, 16);
+        if (address != 0x0001) {
+            nodes << address;
+        }
+    }
+
+    if (nodes.isEmpty()) {
+        m_statusLabel->setText(tr("Select the nodes to reset first."));
+        return;
+    }
+
+    QMessageBox::StandardButton answer = QMessageBox::question(
+        this, tr("Reset node"),
+        tr("Reset %1 nodes and free their addresses? Nodes that do not answer are removed anyway.")
+            .arg(nodes.size()));
+    if (answer != QMessageBox::Yes) {
+        return;
+    }
+
+    for (quint16 address : nodes) {
+        m_scheduler->enqueue(QString("noderst 0x%1 force\n").arg(address, 4, 16, QChar('0')),
+                             CommandScheduler::Control);
+    }
+}
 
 void DialogSender::SubToNode(QListWidgetItem *item){
 
@@ -549,35 +1290,7 @@ void DialogSender::SubToNode(QListWidgetItem *item){
     Node node;
     node = m_nodeMap[address];
 
-    QString Command1 = QString("mesh target dst %1\n").arg(node.address());
-    m_serial.write(Command1.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-    QThread::msleep(100);
-
-    QThread::msleep(100);
-    QString Command2 = QString("mesh models cfg model app-bind %1 0 0x1001\n").arg(node.address());
-    m_serial.write(Command2.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-
-    QThread::msleep(100);
-    QString Command3 = QString("mesh models cfg model app-bind %1 0 0x1000\n").arg(node.address());
-    m_serial.write(Command3.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-
-    QString Command4 = QString("mesh models cfg model sub-add %1 0 0x1001\n").arg(node.address());
-    m_serial.write(Command4.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-    QThread::msleep(100);
-
-    QString Command5 = QString("mesh models cfg model sub-add %1 0 0x1000\n").arg(node.address());
-    m_serial.write(Command5.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-    QThread::msleep(100);
+    configureNode(node.address().toUShort(nullptr, 16));
 
     qDebug() << "Node subscribed";
 }
@@ -594,35 +1307,32 @@ void DialogSender::UnSubToNode(QListWidgetItem *item){
     Node node;
     node = m_nodeMap[address];
 
-    QString Command1 = QString("mesh target dst %1\n").arg(node.address());
-    m_serial.write(Command1.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-    QThread::msleep(100);
-
-    QString Command2 = QString("mesh models cfg model sub-del-all %1 0x1001\n").arg(node.address());
-    m_serial.write(Command2.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-    QThread::msleep(100);
-
-    QString Command3 = QString("mesh models cfg model sub-del-all %1 0x1000\n").arg(node.address());
-    m_serial.write(Command3.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-    QThread::msleep(100);
-
-    QString Command4 = QString("mesh models cfg model app-unbind %1 0 0x1001\n").arg(node.address());
-    m_serial.write(Command4.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-    QThread::msleep(100);
-
-    QString Command5 = QString("mesh models cfg model app-unbind %1 0 0x1000\n").arg(node.address());
-    m_serial.write(Command5.toUtf8());
-    m_serial.waitForBytesWritten(100);
-    m_serial.waitForReadyRead(50);
-    QThread::msleep(100);
+    quint16 target = node.address().toUShort(nullptr, 16);
+    m_configReconciler->invalidate(target);
+
+    // Undo the group part of what Sub configured: every model it
+    // subscribes leaves its groups, is unbound and stops publishing.
+    // Beats and the update models stay, so the node is still watched
+    const NetworkSpec::NodeConfig configured = defaultNodeConfig();
+    NetworkSpec::NodeConfig desired;
+    for (auto it = configured.models.cbegin(); it != configured.models.cend(); ++it) {
+        if (it->subs && !it->subs->isEmpty()) {
+            NetworkSpec::ModelConfig &model = desired.models[it.key()];
+            model.binds = QSet<int>();
+            model.subs = QSet<quint16>();
+            if (it->pub) {
+                model.pub = NetworkSpec::Publication();
+            }
+        }
+    }
+
+    const QStringList ops = NetworkSpec::diff(desired, configured, [this, target](quint32 model) {
+        return m_compositionCache->modelToken(target, model);
+    });
+
+    for (const QString &command : NetworkSpec::cfgsetCommands(target, ops)) {
+        m_scheduler->enqueue(command, CommandScheduler::Control);
+    }
 
     qDebug() << "Node unsubscribed";
 }
@@ -3,7 +3,6 @@
 
 #include <QDialog>
 #include <QSerialPort>
-#include <QTimer>
 #include <qlabel.h>
 #include <qlistwidget.h>
 #include <qprocess.h>
@@ -11,6 +10,26 @@
 #include <qtextedit.h>
 #include <QSet>
 #include "NODE.h"
+#include "RemoteProvisioner.h"
+#include "DiscoveryService.h"
+#include "DfuDistributor.h"
+#include "TransportTuner.h"
+#include "TransportDialog.h"
+#include "StatsPoller.h"
+#include "StatsDialog.h"
+#include "HeartbeatTracker.h"
+#include "TopologyOptimizer.h"
+#include "LatencyMatrix.h"
+#include "LatencyDialog.h"
+#include "SceneEditor.h"
+#include "SceneDialog.h"
+#include "GroupManager.h"
+#include "CompositionCache.h"
+#include "ConfigReconciler.h"
+#include "UnicastAllocator.h"
+#include "CommandScheduler.h"
+#include "RequestTimer.h"
+#include "NodeStateCache.h"
 
 QT_BEGIN_NAMESPACE
 class QLabel;
@@ -37,15 +56,35 @@ private slots:
     void turnOnAllLeds();
     void onAddressDoubleClicked(QListWidgetItem *item);
     void onRefreshClicked();
-    void handleBeaconResponse();
     void turnOffAllLeds();
-    void SubToNode();
-    void UnSubToNode();
+    void SubToNode(QListWidgetItem *item);
+    void UnSubToNode(QListWidgetItem *item);
+    void onRemoteProvisionClicked();
+    void onFirmwareUpdateClicked();
+    void onTransportTuningClicked();
+    void onStatisticsClicked();
+    void onOptimizeRelaysClicked();
+    void onLatencyClicked();
+    void onScenesClicked();
+    void onLocationClicked();
+    void onApplyConfigClicked();
+    void onResetNodeClicked();
 
 private:
     void setControlsEnabled(bool enable);
     void processError(const QString &error);
-    void setLedStatus(const QString&, bool);
+    void setLedStatus(quint16 address);
+    void handleLine(const QString &line);
+    void commandDispatched(const QString &command);
+    void addProvisionedNode(const QString &address, const QString &uuid);
+    QString nodeConfigCommand(const QString &address) const;
+    NetworkSpec::NodeConfig defaultNodeConfig() const;
+    void configureNode(quint16 address);
+    void sendNodeConfig(quint16 address);
+    void createNetwork();
+    void setNodeAlive(quint16 address, bool alive);
+    void removeNode(quint16 address);
+    bool setSelectedLeds(bool on);
 
 
 private:
@@ -64,6 +103,7 @@ private:
     QLabel *m_led2Label = nullptr;
     QLabel *m_led3Label = nullptr;
     QListWidget *m_addressListWidget;
+    QListWidgetItem *m_selectedItem = nullptr;
     QPushButton *m_turnOnAllLedsButton;
     QPushButton *m_turnOffAllLedsButton;
     QTextEdit *m_nodeDetailsTextBox; // To display node details
@@ -71,15 +111,46 @@ private:
     QPushButton *m_refreshButton = nullptr;
     QList<Node> m_nodes;
     std::map<QString, Node> m_nodeMap;
-    quint16 m_nextUnicastAddress = 0x0002;
     QSet<QString> m_provisionedUUIDs;
     QPushButton *m_subButton;
     QPushButton *m_unSubButton;
+    QPushButton *m_remoteProvButton;
+    RemoteProvisioner *m_remoteProvisioner;
+    DiscoveryService *m_discoveryService;
+    QPushButton *m_dfuButton;
+    DfuDistributor *m_dfuDistributor;
+    QPushButton *m_tuningButton;
+    TransportTuner *m_transportTuner;
+    TransportDialog *m_transportDialog;
+    QPushButton *m_statsButton;
+    StatsPoller *m_statsPoller;
+    StatsDialog *m_statsDialog;
+    HeartbeatTracker *m_heartbeatTracker;
+    QPushButton *m_relayButton;
+    TopologyOptimizer *m_topologyOptimizer;
+    QPushButton *m_latencyButton;
+    LatencyMatrix *m_latencyMatrix;
+    LatencyDialog *m_latencyDialog;
+    QPushButton *m_sceneButton;
+    SceneEditor *m_sceneEditor;
+    SceneDialog *m_sceneDialog;
+    QPushButton *m_locationButton;
+    GroupManager *m_groupManager;
+    CompositionCache *m_compositionCache;
+    QSet<quint16> m_unconfiguredNodes;      // waiting for their composition
+    QPushButton *m_configButton;
+    ConfigReconciler *m_configReconciler;
+    UnicastAllocator *m_unicastAllocator;
+    bool m_networkPending = false;          // init waits for the CDB check
+    QPushButton *m_resetNodeButton;
+    CommandScheduler *m_scheduler;
+    NodeStateCache *m_nodeStates;
+    QByteArray m_lineBuffer;
 
 
     QSerialPort m_serial;
     QByteArray m_response;
-    QTimer m_timer;
+    RequestTimer m_timer;
     QProcess *m_process;
 };
 
@@ -0,0 +1,255 @@
+#include "DiscoveryService.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <algorithm>
+
+// Attention timer passed to the provisioning commands, in seconds.
+static const int AttentionSeconds = 30;
+
+// A provisioning link that has not completed by then is given up.
+static const int ProvisionTimeoutMs = 30000;
+
+// The link closes shortly after the node is added.
+static const int LinkCloseTimeoutMs = 2000;
+
+// A device that failed is retried after this, at most MaxAttempts times.
+static const int RetryDelayMs = 10000;
+static const int MaxAttempts = 3;
+
+// Beacons of a batch arrive over about one beacon interval (1 s on the
+// nodes); collect for that long before picking the strongest device.
+static const int CollectMs = 1500;
+
+// Every failure counts like this much less signal when ranking.
+static const int FailurePenaltyDb = 10;
+
+// Devices kept in the cache; the least recently heard one is evicted.
+static const int MaxDevices = 256;
+
+DiscoveryService::DiscoveryService(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_collectTimer, &RequestTimer::timeout, this, &DiscoveryService::provisionNext);
+
+    connect(&m_provTimer, &RequestTimer::timeout, this, [this]() {
+        if (m_closing) {
+            m_closing = false;
+            provisionNext();
+            return;
+        }
+        qDebug() << "Provisioning of" << m_current << "timed out";
+        finishCurrent(false);
+    });
+}
+
+void DiscoveryService::setAddressAllocator(std::function<quint16()> allocator,
+                                           std::function<void(quint16)> release)
+{
+    m_allocateAddress = std::move(allocator);
+    m_releaseAddress = std::move(release);
+}
+
+void DiscoveryService::start(const QSet<QString> &knownUuids)
+{
+    m_knownUuids = knownUuids;
+    if (m_running) {
+        return;
+    }
+
+    m_running = true;
+    emit sendCommand("unprov on\n");
+}
+
+void DiscoveryService::stop()
+{
+    if (!m_running) {
+        return;
+    }
+
+    // A link in progress finishes; nothing new is started
+    m_running = false;
+    m_pending.clear();
+    m_collectTimer.stop();
+    emit sendCommand("unprov off\n");
+}
+
+bool DiscoveryService::isRunning() const
+{
+    return m_running;
+}
+
+QList<DiscoveryService::Device> DiscoveryService::devices() const
+{
+    QList<Device> devices = m_devices.values();
+    std::sort(devices.begin(), devices.end(), [](const Device &a, const Device &b) {
+        return a.rssi > b.rssi;
+    });
+    return devices;
+}
+
+int DiscoveryService::score(const Device &device) const
+{
+    return device.rssi - device.failures * FailurePenaltyDb;
+}
+
+void DiscoveryService::commandDispatched(const QString &command)
+{
+    m_provTimer.dispatched(command);
+}
+
+void DiscoveryService::handleLine(const QString &line)
+{
+    static const QRegularExpression unprovRegex(
+        R"(^UNPROV uuid ([0-9a-fA-F]{32}) oob 0x([0-9a-fA-F]+) rssi (-?\d+) bearer (adv|gatt))");
+    static const QRegularExpression addedRegex(
+        R"(Node provisioned, net_idx 0x[0-9a-fA-F]+ address (0x[0-9a-fA-F]+))");
+
+    QRegularExpressionMatch match = unprovRegex.match(line);
+    if (match.hasMatch()) {
+        if (!m_running) {
+            return;
+        }
+
+        QString uuid = match.captured(1);
+        uuid.remove(QRegularExpression("0+$")); // The form the rest of the application uses
+        if (m_knownUuids.contains(uuid)) {
+            return;
+        }
+
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        auto it = m_devices.find(uuid);
+        if (it == m_devices.end()) {
+            if (m_devices.size() >= MaxDevices) {
+                auto oldest = std::min_element(m_devices.begin(), m_devices.end(),
+                                               [](const Device &a, const Device &b) {
+                    return a.lastSeenMs < b.lastSeenMs;
+                });
+                m_pending.remove(oldest->uuid);
+                m_devices.erase(oldest);
+            }
+            it = m_devices.insert(uuid, Device());
+            it->uuid = uuid;
+            it->fullUuid = match.captured(1);
+            emit deviceDiscovered(uuid, match.captured(3).toInt());
+        }
+
+        it->oob = match.captured(2).toUShort(nullptr, 16);
+        it->rssi = match.captured(3).toInt();
+        it->lastSeenMs = now;
+        if (match.captured(4) == QLatin1String("adv")) {
+            it->advBearer = true;
+        } else {
+            it->gattBearer = true;
+        }
+
+        if (uuid != m_current && it->failures < MaxAttempts && now >= it->retryAfterMs) {
+            m_pending.insert(uuid);
+            schedule();
+        }
+        return;
+    }
+
+    // The next link is only opened once the previous one closed, so a
+    // close is never taken for a failure of the next device.
+    if (m_closing) {
+        if (line.contains("Provisioning link closed")) {
+            m_provTimer.stop();
+            m_closing = false;
+            provisionNext();
+        }
+        return;
+    }
+
+    if (m_current.isEmpty()) {
+        return;
+    }
+
+    match = addedRegex.match(line);
+    if (match.hasMatch()) {
+        if (match.captured(1).toUShort(nullptr, 16) == m_currentAddress) {
+            finishCurrent(true);
+        }
+        return;
+    }
+
+    if (line.contains("Provisioning failed") || line.contains("Provisioning link closed")) {
+        finishCurrent(false);
+    }
+}
+
+void DiscoveryService::schedule()
+{
+    if (m_current.isEmpty() && !m_closing && !m_collectTimer.isActive()) {
+        m_collectTimer.start(CollectMs);
+    }
+}
+
+void DiscoveryService::provisionNext()
+{
+    if (m_pending.isEmpty() || !m_running || !m_current.isEmpty()) {
+        return;
+    }
+
+    auto best = std::max_element(m_pending.cbegin(), m_pending.cend(),
+                                 [this](const QString &a, const QString &b) {
+        return score(m_devices.value(a)) < score(m_devices.value(b));
+    });
+    m_current = *best;
+    m_pending.remove(m_current);
+
+    m_currentAddress = m_allocateAddress ? m_allocateAddress() : 0;
+    if (m_currentAddress == 0) {
+        qDebug() << "No unicast address available for" << m_current;
+        m_current.clear();
+        m_pending.clear();
+        return;
+    }
+
+    // PB-ADV needs no connection setup, so prefer it when the device has both
+    const Device &device = m_devices[m_current];
+    qDebug() << "Provisioning" << m_current << "rssi" << device.rssi << "oob" << device.oob;
+    // Stripped to an odd number of digits, the UUID would be read with a
+    // leading zero nibble: the command always carries all 32
+    const QString command = QString("mesh prov remote-%1 %2 0 0x%3 %4\n")
+                                .arg(device.advBearer ? "adv" : "gatt")
+                                .arg(device.fullUuid)
+                                .arg(m_currentAddress, 4, 16, QChar('0'))
+                                .arg(AttentionSeconds);
+    m_provTimer.startOnDispatch(command, ProvisionTimeoutMs);
+    emit sendCommand(command);
+}
+
+void DiscoveryService::finishCurrent(bool success)
+{
+    m_provTimer.stop();
+
+    if (success) {
+        m_knownUuids.insert(m_current);
+        m_devices.remove(m_current);
+        emit nodeProvisioned(m_currentAddress, m_current);
+    } else {
+        if (m_releaseAddress) {
+            m_releaseAddress(m_currentAddress);
+        }
+
+        auto it = m_devices.find(m_current);
+        if (it != m_devices.end()) {
+            it->failures++;
+            it->retryAfterMs = QDateTime::currentMSecsSinceEpoch() + RetryDelayMs;
+            emit provisioningFailed(m_current, it->failures);
+        }
+    }
+
+    m_current.clear();
+    m_currentAddress = 0;
+
+    if (success) {
+        m_closing = true;
+        m_provTimer.start(LinkCloseTimeoutMs);
+    } else {
+        schedule();
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef DISCOVERYSERVICE_H
+#define DISCOVERYSERVICE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <functional>
+#include "RequestTimer.h"
+
+// Continuous discovery of unprovisioned devices in direct range of the
+// dongle. The dongle's "unprov" reports stay on; every UUID goes into a
+// bounded cache (least recently heard evicted first) with its last RSSI
+// and OOB information. New devices are provisioned one after another
+// (the dongle has a single provisioning link), strongest first, so the
+// links most likely to succeed go first.
+class DiscoveryService : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Device {
+        QString uuid;               // trailing zeros stripped, for display and lookup
+        QString fullUuid;           // all 32 digits, for the provisioning command
+        bool advBearer = false;     // heard on PB-ADV
+        bool gattBearer = false;    // heard on PB-GATT
+        int rssi = -128;            // last report
+        quint16 oob = 0;
+        qint64 lastSeenMs = 0;
+        int failures = 0;
+        qint64 retryAfterMs = 0;    // failed: not provisioned again before
+    };
+
+    explicit DiscoveryService(QObject *parent = nullptr);
+
+    // release gets back the address of a device that failed to provision
+    void setAddressAllocator(std::function<quint16()> allocator,
+                             std::function<void(quint16)> release = nullptr);
+    void start(const QSet<QString> &knownUuids);
+    void stop();
+    bool isRunning() const;
+
+    // Cached devices not provisioned yet, strongest first.
+    QList<Device> devices() const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void deviceDiscovered(const QString &uuid, int rssi);
+    void nodeProvisioned(quint16 address, const QString &uuid);
+    void provisioningFailed(const QString &uuid, int failures);
+
+private:
+    void schedule();
+    void provisionNext();
+    void finishCurrent(bool success);
+    int score(const Device &device) const;
+
+    QHash<QString, Device> m_devices;
+    QSet<QString> m_knownUuids;
+    QSet<QString> m_pending;
+    QString m_current;
+    quint16 m_currentAddress = 0;
+    bool m_running = false;
+    bool m_closing = false;         // node added, waiting for the link to close
+    RequestTimer m_collectTimer;
+    RequestTimer m_provTimer;
+    std::function<quint16()> m_allocateAddress;
+    std::function<void(quint16)> m_releaseAddress;
+};
+
+#endif // DISCOVERYSERVICE_H
@@ -0,0 +1,307 @@
+#include "GroupManager.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+
+// Last group address; 0xff00 and up are the fixed group addresses.
+static const quint16 LastGroup = 0xfeff;
+
+static QString hex(quint16 value)
+{
+    return QString("0x%1").arg(value, 4, 16, QChar('0'));
+}
+
+GroupManager::GroupManager(const QString &path, QObject *parent)
+    : QObject(parent),
+      m_path(path)
+{
+    m_groups.insert(AllNodesGroup, Group());
+    load();
+}
+
+void GroupManager::addNode(quint16 node)
+{
+    if (m_placement.contains(node)) {
+        return;
+    }
+
+    m_placement.insert(node, AllNodesGroup);
+    m_groups[AllNodesGroup].nodes.insert(node);
+    m_members[AllNodesGroup].insert(node);
+    save();
+}
+
+void GroupManager::removeNode(quint16 node)
+{
+    m_moving.remove(node);
+    if (!m_placement.contains(node)) {
+        return;
+    }
+
+    quint16 group = m_placement.take(node);
+    m_groups[group].nodes.remove(node);
+    for (; group != AllNodesGroup; group = m_groups[group].parent) {
+        m_members[group].remove(node);
+    }
+    m_members[AllNodesGroup].remove(node);
+    save();
+}
+
+quint16 GroupManager::child(quint16 parent, const QString &name)
+{
+    for (quint16 address : std::as_const(m_groups[parent].children)) {
+        if (m_groups[address].name == name) {
+            return address;
+        }
+    }
+
+    if (m_nextGroup > LastGroup) {
+        return 0;
+    }
+
+    quint16 address = m_nextGroup++;
+    Group group;
+    group.name = name;
+    group.parent = parent;
+    m_groups.insert(address, group);
+    m_groups[parent].children << address;
+    return address;
+}
+
+bool GroupManager::assign(quint16 node, const QStringList &path, const QStringList &models)
+{
+    if (path.isEmpty() || path.size() > MaxDepth) {
+        return false;
+    }
+
+    addNode(node);
+
+    QList<quint16> chain = { AllNodesGroup };
+    for (const QString &name : path) {
+        quint16 address = child(chain.last(), name.trimmed());
+        if (!address) {
+            qDebug() << "Out of group addresses for" << path.join('/');
+            return false;
+        }
+        chain << address;
+    }
+
+    // The new groups are kept even if the node never gets there
+    save();
+
+    // Models first, so the last word stays the deepest group
+    QStringList args = models;
+    for (quint16 group : std::as_const(chain)) {
+        args << hex(group);
+    }
+
+    emit sendCommand(QString("groupsub %1 %2\n").arg(hex(node), args.join(' ')));
+    return true;
+}
+
+void GroupManager::place(quint16 node, quint16 group)
+{
+    // Leave the old location, including the groups on the way to it
+    quint16 old = m_placement.value(node, AllNodesGroup);
+    m_groups[old].nodes.remove(node);
+    for (; old != AllNodesGroup; old = m_groups[old].parent) {
+        m_members[old].remove(node);
+    }
+
+    m_placement[node] = group;
+    m_groups[group].nodes.insert(node);
+    for (; group != AllNodesGroup; group = m_groups[group].parent) {
+        m_members[group].insert(node);
+    }
+    m_members[AllNodesGroup].insert(node);
+}
+
+QStringList GroupManager::pathOf(quint16 node) const
+{
+    QStringList path;
+    for (quint16 group = m_placement.value(node, AllNodesGroup); group != AllNodesGroup;
+         group = m_groups.value(group).parent) {
+        path.prepend(m_groups.value(group).name);
+    }
+    return path;
+}
+
+quint16 GroupManager::groupOf(const QStringList &path) const
+{
+    quint16 group = AllNodesGroup;
+    for (const QString &name : path) {
+        quint16 found = 0;
+        for (quint16 address : m_groups.value(group).children) {
+            if (m_groups.value(address).name == name.trimmed()) {
+                found = address;
+                break;
+            }
+        }
+        if (!found) {
+            return 0;
+        }
+        group = found;
+    }
+    return group;
+}
+
+QSet<quint16> GroupManager::members(quint16 group) const
+{
+    return m_members.value(group);
+}
+
+GroupManager::Destinations GroupManager::cover(const QSet<quint16> &selection) const
+{
+    Destinations out;
+    coverFrom(AllNodesGroup, selection, out);
+
+    // Selected nodes this manager does not know can only be reached directly
+    QSet<quint16> known = m_members.value(AllNodesGroup);
+    for (quint16 node : selection) {
+        if (!known.contains(node)) {
+            out.unicasts << node;
+        }
+    }
+    return out;
+}
+
+// The groups form a tree, so taking the highest groups that lie wholly
+// inside the selection and sending the rest as unicasts is optimal: any
+// other group inside the selection is below one already taken, and a
+// group reaching an unselected node can never be used.
+void GroupManager::coverFrom(quint16 group, const QSet<quint16> &selection, Destinations &out) const
+{
+    const QSet<quint16> reached = m_members.value(group);
+    if (reached.isEmpty() || !reached.intersects(selection)) {
+        return;
+    }
+
+    if (selection.contains(reached)) {
+        out.groups << group;
+        return;
+    }
+
+    const Group entry = m_groups.value(group);
+    for (quint16 child : entry.children) {
+        coverFrom(child, selection, out);
+    }
+    for (quint16 node : entry.nodes) {
+        if (selection.contains(node)) {
+            out.unicasts << node;
+        }
+    }
+}
+
+void GroupManager::commandDispatched(const QString &command)
+{
+    // "groupsub <node> [models] 0xc000 ... <group>": the last group is
+    // where it goes
+    const QStringList words = command.trimmed().split(' ', Qt::SkipEmptyParts);
+    if (words.size() < 3 || words.first() != QLatin1String("groupsub")) {
+        return;
+    }
+
+    quint16 group = words.last().toUShort(nullptr, 16);
+    if (m_groups.contains(group)) {
+        m_moving.insert(words[1].toUShort(nullptr, 16), group);
+    }
+}
+
+void GroupManager::handleLine(const QString &line)
+{
+    static const QRegularExpression doneRegex(R"(^GROUPSUB (0x[0-9a-fA-F]+) (\d+ groups|failed))");
+
+    QRegularExpressionMatch match = doneRegex.match(line);
+    if (!match.hasMatch()) {
+        return;
+    }
+
+    quint16 node = match.captured(1).toUShort(nullptr, 16);
+    auto it = m_moving.find(node);
+    if (it == m_moving.end()) {
+        return;
+    }
+
+    quint16 group = *it;
+    m_moving.erase(it);
+    if (match.captured(2) == QLatin1String("failed")) {
+        qDebug() << "Node" << hex(node) << "stays in" << hex(m_placement.value(node));
+        return;
+    }
+
+    if (m_placement.contains(node)) {
+        place(node, group);
+        save();
+    }
+}
+
+void GroupManager::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+
+    // Keys are fixed-width hex, so parents come before their children
+    const QJsonObject groups = root.value("groups").toObject();
+    for (auto it = groups.begin(); it != groups.end(); ++it) {
+        quint16 address = it.key().toUShort(nullptr, 16);
+        const QJsonObject entry = it.value().toObject();
+        quint16 parent = entry.value("parent").toString().toUShort(nullptr, 16);
+        if (address <= AllNodesGroup || address > LastGroup || m_groups.contains(address) ||
+            !m_groups.contains(parent)) {
+            qDebug() << "Ignoring group" << it.key();
+            continue;
+        }
+
+        Group group;
+        group.name = entry.value("name").toString();
+        group.parent = parent;
+        m_groups.insert(address, group);
+        m_groups[parent].children << address;
+        m_nextGroup = qMax<quint32>(m_nextGroup, quint32(address) + 1);
+    }
+    m_nextGroup = qMax<quint32>(m_nextGroup, root.value("next").toString().toUShort(nullptr, 16));
+
+    const QJsonObject nodes = root.value("nodes").toObject();
+    for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        quint16 node = it.key().toUShort(nullptr, 16);
+        quint16 group = it.value().toString().toUShort(nullptr, 16);
+        if (node) {
+            place(node, m_groups.contains(group) ? group : AllNodesGroup);
+        }
+    }
+}
+
+void GroupManager::save() const
+{
+    QJsonObject groups;
+    for (auto it = m_groups.cbegin(); it != m_groups.cend(); ++it) {
+        if (it.key() != AllNodesGroup) {
+            groups.insert(hex(it.key()), QJsonObject{ { "name", it->name }, { "parent", hex(it->parent) } });
+        }
+    }
+
+    QJsonObject nodes;
+    for (auto it = m_placement.cbegin(); it != m_placement.cend(); ++it) {
+        nodes.insert(hex(it.key()), hex(it.value()));
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Cannot write" << m_path << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject{ { "next", hex(m_nextGroup) },
+                                          { "groups", groups },
+                                          { "nodes", nodes } }).toJson());
+}
@@ -0,0 +1,94 @@
+#ifndef GROUPMANAGER_H
+#define GROUPMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// Hierarchical group addresses: every site, floor, zone and room gets a
+// group of its own below the all-nodes group, and a node placed in a
+// room subscribes to the room and all its ancestors. A reverse index
+// keeps the nodes reachable through every group, so any selection of
+// nodes can be addressed with the fewest messages.
+//
+// Nodes keep their subscriptions across sessions, so the groups, the
+// next group address and the placements are saved to a file after every
+// change. A node's placement only changes once the dongle reports its
+// groupsub done; until then cover() uses the groups the node is in.
+class GroupManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Site, floor, zone, room
+    static constexpr int MaxDepth = 4;
+
+    // Group every node subscribes to (see nodecfg)
+    static constexpr quint16 AllNodesGroup = 0xc000;
+
+    struct Destinations {
+        QList<quint16> groups;
+        QList<quint16> unicasts;
+
+        int count() const { return groups.size() + unicasts.size(); }
+        QList<quint16> all() const { return groups + unicasts; }
+    };
+
+    explicit GroupManager(const QString &path, QObject *parent = nullptr);
+
+    // A provisioned node; it is reachable through the all-nodes group.
+    void addNode(quint16 node);
+
+    // A node that was reset; it leaves every group.
+    void removeNode(quint16 node);
+
+    // Place a node at a location path of up to MaxDepth names, allocating
+    // the groups on the way, and send the node its subscriptions. models
+    // are groupsub model arguments ("0x1000", "0x1203@0x0006"); without
+    // them the firmware subscribes its primary element's servers. The
+    // node moves once they are set (see handleLine).
+    bool assign(quint16 node, const QStringList &path, const QStringList &models = QStringList());
+
+    QStringList pathOf(quint16 node) const;
+    quint16 groupOf(const QStringList &path) const;
+    QSet<quint16> members(quint16 group) const;
+
+    // The smallest set of group and unicast destinations that reaches
+    // exactly the selected nodes.
+    Destinations cover(const QSet<quint16> &selection) const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+
+private:
+    struct Group {
+        QString name;
+        quint16 parent = 0;
+        QList<quint16> children;
+        QSet<quint16> nodes;        // placed here, not in a child
+    };
+
+    quint16 child(quint16 parent, const QString &name);
+    void place(quint16 node, quint16 group);
+    void coverFrom(quint16 group, const QSet<quint16> &selection, Destinations &out) const;
+    void load();
+    void save() const;
+
+    QString m_path;
+
+    QHash<quint16, Group> m_groups;
+    QHash<quint16, QSet<quint16>> m_members;    // group -> every node below it
+    QHash<quint16, quint16> m_placement;        // node -> group it is placed in
+    QHash<quint16, quint16> m_moving;           // node -> group of the groupsub in flight
+    quint16 m_nextGroup = AllNodesGroup + 1;
+};
+
+#endif // GROUPMANAGER_H
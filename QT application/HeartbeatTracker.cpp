@@ -0,0 +1,121 @@
+#include "HeartbeatTracker.h"
+#include "TimingWheel.h"
+
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QStringList>
+
+HeartbeatTracker::HeartbeatTracker(int periodSeconds, QObject *parent)
+    : QObject(parent),
+      m_periodSeconds(periodSeconds)
+{
+    m_elapsed.start();
+}
+
+HeartbeatTracker::~HeartbeatTracker()
+{
+    for (quint64 handle : std::as_const(m_deadlines)) {
+        TimingWheel::shared()->cancel(handle);
+    }
+}
+
+int HeartbeatTracker::periodSeconds() const
+{
+    return m_periodSeconds;
+}
+
+bool HeartbeatTracker::contains(quint16 address) const
+{
+    return m_nodes.contains(address);
+}
+
+HeartbeatTracker::NodeLiveness HeartbeatTracker::node(quint16 address) const
+{
+    return m_nodes.value(address);
+}
+
+QList<quint16> HeartbeatTracker::nodes() const
+{
+    return m_nodes.keys();
+}
+
+QString HeartbeatTracker::describe(quint16 address) const
+{
+    auto it = m_nodes.constFind(address);
+    if (it == m_nodes.constEnd()) {
+        return tr("No beat received");
+    }
+
+    QStringList features;
+    if (it->features & FeatureRelay) {
+        features << tr("relay");
+    }
+    if (it->features & FeatureProxy) {
+        features << tr("proxy");
+    }
+    if (it->features & FeatureFriend) {
+        features << tr("friend");
+    }
+
+    return tr("%1, last seen %2 s ago, %3 beats, hops %4 (min %5, max %6), TTL %7, RSSI %8 dBm, features: %9")
+        .arg(it->alive ? tr("alive") : tr("lost"))
+        .arg((m_elapsed.elapsed() - it->lastSeenMs) / 1000)
+        .arg(it->beats)
+        .arg(it->hops).arg(it->minHops).arg(it->maxHops)
+        .arg(it->initTtl)
+        .arg(it->rssi)
+        .arg(features.isEmpty() ? tr("none") : features.join(", "));
+}
+
+void HeartbeatTracker::handleLine(const QString &line)
+{
+    static const QRegularExpression beatRegex(
+        R"(^HB (0x[0-9a-fA-F]+) hops (\d+) ttl (\d+) feat (0x[0-9a-fA-F]+) rssi (-?\d+))");
+
+    QRegularExpressionMatch match = beatRegex.match(line);
+    if (!match.hasMatch()) {
+        return;
+    }
+
+    quint16 address = match.captured(1).toUShort(nullptr, 16);
+    int hops = match.captured(2).toInt();
+    bool known = m_nodes.contains(address);
+    NodeLiveness &node = m_nodes[address];
+    bool wasAlive = node.alive;
+
+    node.alive = true;
+    node.lastSeenMs = m_elapsed.elapsed();
+    node.hops = hops;
+    node.minHops = node.beats ? qMin(node.minHops, hops) : hops;
+    node.maxHops = node.beats ? qMax(node.maxHops, hops) : hops;
+    node.beats++;
+    node.initTtl = match.captured(3).toInt();
+    node.features = match.captured(4).toInt(nullptr, 16);
+    node.rssi = match.captured(5).toInt();
+
+    TimingWheel *wheel = TimingWheel::shared();
+    wheel->cancel(m_deadlines.value(address));
+    m_deadlines.insert(address, wheel->schedule(qint64(m_periodSeconds) * MissedBeats * 1000, [this, address]() {
+        m_deadlines.remove(address);
+        onExpired(address);
+    }));
+
+    if (!known) {
+        emit nodeDiscovered(address);
+    } else if (!wasAlive) {
+        emit nodeAlive(address);
+    }
+    emit nodeUpdated(address);
+}
+
+void HeartbeatTracker::onExpired(quint16 address)
+{
+    auto it = m_nodes.find(address);
+    if (it == m_nodes.end() || !it->alive) {
+        return;
+    }
+
+    it->alive = false;
+    emit nodeLost(address);
+    emit nodeUpdated(address);
+}
@@ -0,0 +1,69 @@
+#ifndef HEARTBEATTRACKER_H
+#define HEARTBEATTRACKER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Liveness and hop count of every node from the Beats the nodes publish
+// to the dongle ("HB <addr> hops .. ttl .. feat .. rssi .." lines).
+//
+// A node is lost when no Beat arrives for MissedBeats periods. Each Beat
+// only moves the node's deadline on the shared timing wheel, so tracking
+// costs O(1) per Beat however many nodes there are.
+class HeartbeatTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Same bits as the Heartbeat Features field
+    enum Feature {
+        FeatureRelay = 0x1,
+        FeatureProxy = 0x2,
+        FeatureFriend = 0x4,
+    };
+
+    struct NodeLiveness {
+        bool alive = false;
+        qint64 lastSeenMs = -1;     // since the tracker started
+        int beats = 0;
+        int hops = 0;
+        int minHops = 0;
+        int maxHops = 0;
+        int initTtl = 0;
+        int features = 0;
+        int rssi = 0;               // of the last hop only
+    };
+
+    explicit HeartbeatTracker(int periodSeconds, QObject *parent = nullptr);
+    ~HeartbeatTracker() override;
+
+    int periodSeconds() const;
+    bool contains(quint16 address) const;
+    NodeLiveness node(quint16 address) const;
+    QList<quint16> nodes() const;
+    QString describe(quint16 address) const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+
+signals:
+    void nodeDiscovered(quint16 address);   // first Beat of an unknown node
+    void nodeAlive(quint16 address);        // a lost node is back
+    void nodeLost(quint16 address);
+    void nodeUpdated(quint16 address);
+
+private:
+    static const int MissedBeats = 3;
+
+    void onExpired(quint16 address);
+
+    int m_periodSeconds;
+    QHash<quint16, NodeLiveness> m_nodes;
+    QHash<quint16, quint64> m_deadlines;    // wheel handles
+    QElapsedTimer m_elapsed;
+};
+
+#endif // HEARTBEATTRACKER_H
@@ -0,0 +1,146 @@
+#include "LatencyDialog.h"
+
+#include <QBrush>
+#include <QColor>
+#include <QGridLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QStringList>
+#include <QTableWidget>
+
+// Payload limits of the firmware's Echo message (VND_ECHO_SIZE_MIN/MAX).
+// The minimum fits one unsegmented message; larger sizes are segmented.
+static const int MinPayloadSize = 8;
+static const int MaxPayloadSize = 128;
+
+// Cells losing more than this share of their requests are highlighted.
+static const double LossWarning = 0.1;
+
+LatencyDialog::LatencyDialog(LatencyMatrix *matrix, QWidget *parent) :
+    QDialog(parent),
+    m_matrix(matrix),
+    m_sizesLineEdit(new QLineEdit(QStringLiteral("8,32,64,128"))),
+    m_roundsSpinBox(new QSpinBox),
+    m_intervalSpinBox(new QSpinBox),
+    m_startButton(new QPushButton(tr("Start"))),
+    m_latencyTable(new QTableWidget),
+    m_summaryLabel(new QLabel)
+{
+    m_sizesLineEdit->setToolTip(tr("Payload sizes in bytes (%1-%2), comma separated")
+                                    .arg(MinPayloadSize).arg(MaxPayloadSize));
+
+    m_roundsSpinBox->setRange(1, 200);
+    m_roundsSpinBox->setValue(20);
+    m_roundsSpinBox->setSuffix(tr(" rounds"));
+
+    m_intervalSpinBox->setRange(20, 10000);
+    m_intervalSpinBox->setValue(100);
+    m_intervalSpinBox->setSuffix(tr(" ms between requests"));
+
+    m_latencyTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_latencyTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    auto layout = new QGridLayout;
+    layout->addWidget(new QLabel(tr("Sizes:")), 0, 0);
+    layout->addWidget(m_sizesLineEdit, 0, 1);
+    layout->addWidget(m_roundsSpinBox, 0, 2);
+    layout->addWidget(m_intervalSpinBox, 0, 3);
+    layout->addWidget(m_startButton, 0, 4);
+    layout->addWidget(m_latencyTable, 1, 0, 1, 5);
+    layout->addWidget(m_summaryLabel, 2, 0, 1, 5);
+
+    setLayout(layout);
+    setWindowTitle(tr("Latency matrix"));
+    resize(800, 400);
+
+    connect(m_startButton, &QPushButton::clicked, this, &LatencyDialog::onStartClicked);
+    connect(m_matrix, &LatencyMatrix::cellUpdated, this, &LatencyDialog::updateCell);
+    connect(m_matrix, &LatencyMatrix::finished, this, [this]() {
+        m_startButton->setText(tr("Start"));
+        m_summaryLabel->setText(tr("Done. Cells show p50 / p90 / p99 RTT and loss."));
+    });
+}
+
+void LatencyDialog::setNodes(const QList<quint16> &nodes)
+{
+    m_nodes = nodes;
+}
+
+void LatencyDialog::onStartClicked()
+{
+    if (m_matrix->isRunning()) {
+        m_matrix->stop();
+        return;
+    }
+
+    QList<int> sizes;
+    for (const QString &text : m_sizesLineEdit->text().split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        int size = text.trimmed().toInt(&ok);
+        if (!ok || size < MinPayloadSize || size > MaxPayloadSize) {
+            m_summaryLabel->setText(tr("Invalid size \"%1\".").arg(text.trimmed()));
+            return;
+        }
+        if (!sizes.contains(size)) {
+            sizes << size;
+        }
+    }
+
+    if (sizes.isEmpty() || m_nodes.isEmpty()) {
+        m_summaryLabel->setText(tr("Nothing to measure."));
+        return;
+    }
+
+    QStringList rows;
+    for (quint16 address : std::as_const(m_nodes)) {
+        rows << QString("0x%1").arg(address, 4, 16, QChar('0'));
+    }
+    QStringList columns;
+    for (int size : std::as_const(sizes)) {
+        columns << tr("%1 B").arg(size);
+    }
+
+    m_latencyTable->clear();
+    m_latencyTable->setRowCount(rows.size());
+    m_latencyTable->setColumnCount(columns.size());
+    m_latencyTable->setVerticalHeaderLabels(rows);
+    m_latencyTable->setHorizontalHeaderLabels(columns);
+
+    if (!m_matrix->start(m_nodes, sizes, m_roundsSpinBox->value(), m_intervalSpinBox->value())) {
+        m_summaryLabel->setText(tr("Could not start the sweep."));
+        return;
+    }
+
+    m_startButton->setText(tr("Stop"));
+    m_summaryLabel->setText(tr("Sweeping %1 nodes at %2 sizes...").arg(m_nodes.size()).arg(sizes.size()));
+}
+
+void LatencyDialog::updateCell(quint16 address, int size)
+{
+    int row = m_nodes.indexOf(address);
+    int column = m_matrix->sizes().indexOf(size);
+    if (row < 0 || column < 0) {
+        return;
+    }
+
+    LatencyMatrix::Cell cell = m_matrix->cell(address, size);
+    QString text = cell.rttUs.isEmpty()
+        ? tr("no reply")
+        : tr("%1 / %2 / %3 ms").arg(cell.percentileMs(50), 0, 'f', 1)
+                                .arg(cell.percentileMs(90), 0, 'f', 1)
+                                .arg(cell.percentileMs(99), 0, 'f', 1);
+    if (cell.sent) {
+        text += tr(", %1% loss").arg(cell.loss() * 100.0, 0, 'f', 0);
+    }
+
+    auto item = new QTableWidgetItem(text);
+    item->setToolTip(tr("%1 replies, hops %2 out, %3 back")
+                         .arg(cell.rttUs.size()).arg(cell.hops).arg(cell.backHops));
+    if (cell.sent && cell.loss() > LossWarning) {
+        item->setBackground(QBrush(QColor(255, 200, 200)));
+    }
+    m_latencyTable->setItem(row, column, item);
+}
@@ -0,0 +1,44 @@
+#ifndef LATENCYDIALOG_H
+#define LATENCYDIALOG_H
+
+#include <QDialog>
+#include <QList>
+#include "LatencyMatrix.h"
+
+QT_BEGIN_NAMESPACE
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QSpinBox;
+class QTableWidget;
+QT_END_NAMESPACE
+
+// Round-trip latency matrix: one row per node, one column per payload
+// size. Each cell shows the RTT percentiles and the loss of that sweep.
+class LatencyDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit LatencyDialog(LatencyMatrix *matrix, QWidget *parent = nullptr);
+
+    void setNodes(const QList<quint16> &nodes);
+
+private slots:
+    void onStartClicked();
+
+private:
+    void updateCell(quint16 address, int size);
+
+    LatencyMatrix *m_matrix;
+    QList<quint16> m_nodes;
+
+    QLineEdit *m_sizesLineEdit;
+    QSpinBox *m_roundsSpinBox;
+    QSpinBox *m_intervalSpinBox;
+    QPushButton *m_startButton;
+    QTableWidget *m_latencyTable;
+    QLabel *m_summaryLabel;
+};
+
+#endif // LATENCYDIALOG_H
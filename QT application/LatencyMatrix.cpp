@@ -0,0 +1,157 @@
+#include "LatencyMatrix.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+
+// The dongle sweeps at most 16 targets; twelve also keep the command
+// inside the 128-byte shell buffer.
+static const int MaxNodesPerSweep = 12;
+
+// Matches PING_GRACE_MS in the firmware plus the UART round trip.
+static const int SweepGraceMs = 4000;
+
+double LatencyMatrix::Cell::percentileMs(double percentile) const
+{
+    if (rttUs.isEmpty()) {
+        return 0.0;
+    }
+
+    // Nearest rank
+    QVector<quint32> sorted = rttUs;
+    std::sort(sorted.begin(), sorted.end());
+    int rank = int(std::ceil(percentile / 100.0 * sorted.size()));
+    return sorted.at(qBound(1, rank, int(sorted.size())) - 1) / 1000.0;
+}
+
+double LatencyMatrix::Cell::loss() const
+{
+    return sent ? 1.0 - qMin(1.0, double(rttUs.size()) / sent) : 0.0;
+}
+
+LatencyMatrix::LatencyMatrix(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_timeout, &RequestTimer::timeout, this, [this]() {
+        qDebug() << "Ping sweep did not finish, moving on";
+        sendNext();
+    });
+}
+
+bool LatencyMatrix::start(const QList<quint16> &nodes, const QList<int> &sizes, int rounds, int intervalMs)
+{
+    if (m_running || nodes.isEmpty() || sizes.isEmpty()) {
+        return false;
+    }
+
+    m_nodes = nodes;
+    m_sizes = sizes;
+    m_rounds = rounds;
+    m_intervalMs = intervalMs;
+    m_cells.clear();
+    m_queue.clear();
+
+    for (int size : sizes) {
+        for (int i = 0; i < nodes.size(); i += MaxNodesPerSweep) {
+            QStringList addresses;
+            for (quint16 address : nodes.mid(i, MaxNodesPerSweep)) {
+                addresses << QString("0x%1").arg(address, 4, 16, QChar('0'));
+            }
+            m_queue.enqueue(QString("ping %1 %2 %3 %4\n")
+                                .arg(rounds).arg(size).arg(intervalMs)
+                                .arg(addresses.join(' ')));
+        }
+    }
+
+    m_running = true;
+    sendNext();
+    return true;
+}
+
+void LatencyMatrix::stop()
+{
+    m_queue.clear();
+    m_timeout.stop();
+    if (m_running) {
+        m_running = false;
+        emit finished();
+    }
+}
+
+bool LatencyMatrix::isRunning() const
+{
+    return m_running;
+}
+
+QList<quint16> LatencyMatrix::nodes() const
+{
+    return m_nodes;
+}
+
+QList<int> LatencyMatrix::sizes() const
+{
+    return m_sizes;
+}
+
+LatencyMatrix::Cell LatencyMatrix::cell(quint16 address, int size) const
+{
+    return m_cells.value(Key(address, size));
+}
+
+void LatencyMatrix::sendNext()
+{
+    if (m_queue.isEmpty()) {
+        stop();
+        return;
+    }
+
+    QString command = m_queue.dequeue();
+    m_sweepNodes = command.count(QStringLiteral("0x"));
+    m_timeout.startOnDispatch(command, m_rounds * m_sweepNodes * m_intervalMs + SweepGraceMs);
+    emit sendCommand(command);
+}
+
+void LatencyMatrix::commandDispatched(const QString &command)
+{
+    m_timeout.dispatched(command);
+}
+
+void LatencyMatrix::handleLine(const QString &line)
+{
+    static const QRegularExpression replyRegex(
+        R"(^PING (0x[0-9a-fA-F]+) seq \d+ size (\d+) rtt_us (\d+) ttl \d+ hops (\d+) back (\d+))");
+    static const QRegularExpression sentRegex(R"(^PING (0x[0-9a-fA-F]+) size (\d+) sent (\d+))");
+
+    if (!m_running) {
+        return;
+    }
+
+    QRegularExpressionMatch match = replyRegex.match(line);
+    if (match.hasMatch()) {
+        quint16 address = match.captured(1).toUShort(nullptr, 16);
+        int size = match.captured(2).toInt();
+        Cell &cell = m_cells[Key(address, size)];
+        cell.rttUs << match.captured(3).toUInt();
+        cell.hops = match.captured(4).toInt();
+        cell.backHops = match.captured(5).toInt();
+        emit cellUpdated(address, size);
+        return;
+    }
+
+    match = sentRegex.match(line);
+    if (match.hasMatch()) {
+        quint16 address = match.captured(1).toUShort(nullptr, 16);
+        int size = match.captured(2).toInt();
+        m_cells[Key(address, size)].sent = match.captured(3).toInt();
+        emit cellUpdated(address, size);
+        return;
+    }
+
+    if (line.startsWith("PING done")) {
+        m_timeout.stop();
+        sendNext();
+    }
+}
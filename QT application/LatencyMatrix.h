@@ -0,0 +1,68 @@
+#ifndef LATENCYMATRIX_H
+#define LATENCYMATRIX_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QQueue>
+#include <QString>
+#include <QVector>
+#include "RequestTimer.h"
+
+// Round-trip latency per node and payload size from the dongle's "ping"
+// sweeps (vendor Echo requests, pipelined). One sweep runs per payload
+// size and group of targets; the replies are kept so any percentile can
+// be read afterwards.
+class LatencyMatrix : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Cell {
+        QVector<quint32> rttUs;
+        int sent = 0;
+        int hops = 0;               // request path, last reply
+        int backHops = 0;           // reply path, last reply
+
+        double percentileMs(double percentile) const;
+        double loss() const;
+    };
+
+    explicit LatencyMatrix(QObject *parent = nullptr);
+
+    bool start(const QList<quint16> &nodes, const QList<int> &sizes, int rounds, int intervalMs);
+    void stop();
+    bool isRunning() const;
+
+    QList<quint16> nodes() const;
+    QList<int> sizes() const;
+    Cell cell(quint16 address, int size) const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void cellUpdated(quint16 address, int size);
+    void finished();
+
+private:
+    void sendNext();
+
+    using Key = QPair<quint16, int>;
+
+    QList<quint16> m_nodes;
+    QList<int> m_sizes;
+    QHash<Key, Cell> m_cells;
+    QQueue<QString> m_queue;
+    int m_rounds = 0;
+    int m_intervalMs = 0;
+    int m_sweepNodes = 0;
+    bool m_running = false;
+    RequestTimer m_timeout;
+};
+
+#endif // LATENCYMATRIX_H
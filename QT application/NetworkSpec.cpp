@@ -0,0 +1,280 @@
+#include "NetworkSpec.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QObject>
+#include <algorithm>
+
+// One shell line is at most 128 bytes and 12 arguments.
+static const int MaxCommandLength = 120;
+static const int MaxOpsPerCommand = 10;
+
+static quint32 parseNumber(const QJsonValue &value, bool *ok)
+{
+    if (value.isDouble()) {
+        *ok = value.toDouble() >= 0;
+        return quint32(value.toDouble());
+    }
+    return value.toString().toUInt(ok, 0);
+}
+
+static QString hex(quint32 value)
+{
+    return QString("0x%1").arg(value, 4, 16, QChar('0'));
+}
+
+template <typename T>
+static bool parseSet(const QJsonValue &value, QSet<T> *out)
+{
+    out->clear();
+    for (const QJsonValue &entry : value.toArray()) {
+        bool ok = false;
+        out->insert(T(parseNumber(entry, &ok)));
+        if (!ok) {
+            return false;
+        }
+    }
+    return value.isArray();
+}
+
+// Fill in the keys present in object; keys left out keep their value,
+// so a node entry parsed over the network-wide config overrides it.
+static bool parseConfig(const QJsonObject &object, NetworkSpec::NodeConfig *config, QString *error)
+{
+    bool ok = true;
+
+    if (object.contains("appKeys")) {
+        QSet<int> keys;
+        if (!parseSet(object.value("appKeys"), &keys)) {
+            *error = QObject::tr("appKeys must be a list of key indexes");
+            return false;
+        }
+        config->appKeys = keys;
+    }
+
+    if (object.contains("relay")) {
+        QJsonObject relay = object.value("relay").toObject();
+        NetworkSpec::Relay value;
+        value.enabled = relay.value("enabled").toBool(true);
+        value.count = relay.value("count").toInt(value.count);
+        value.intervalMs = relay.value("intervalMs").toInt(value.intervalMs);
+        config->relay = value;
+    }
+
+    if (object.contains("heartbeat")) {
+        QJsonObject heartbeat = object.value("heartbeat").toObject();
+        NetworkSpec::Heartbeat value;
+        value.dst = quint16(parseNumber(heartbeat.value("dst"), &ok));
+        value.periodLog = heartbeat.value("periodLog").toInt();
+        if (!ok) {
+            *error = QObject::tr("heartbeat.dst must be an address");
+            return false;
+        }
+        config->heartbeat = value;
+    }
+
+    const QJsonObject models = object.value("models").toObject();
+    for (auto it = models.begin(); it != models.end(); ++it) {
+        quint32 model = it.key().toUInt(&ok, 0);
+        if (!ok) {
+            *error = QObject::tr("Bad model id \"%1\"").arg(it.key());
+            return false;
+        }
+
+        QJsonObject entry = it.value().toObject();
+        NetworkSpec::ModelConfig &modelConfig = config->models[model];
+        if (entry.contains("bind")) {
+            QSet<int> binds;
+            if (!parseSet(entry.value("bind"), &binds)) {
+                *error = QObject::tr("%1.bind must be a list of key indexes").arg(it.key());
+                return false;
+            }
+            modelConfig.binds = binds;
+        }
+        if (entry.contains("sub")) {
+            QSet<quint16> subs;
+            if (!parseSet(entry.value("sub"), &subs)) {
+                *error = QObject::tr("%1.sub must be a list of group addresses").arg(it.key());
+                return false;
+            }
+            modelConfig.subs = subs;
+        }
+        if (entry.contains("pub")) {
+            QJsonObject pub = entry.value("pub").toObject();
+            NetworkSpec::Publication value;
+            value.dst = quint16(parseNumber(pub.value("dst"), &ok));
+            value.appIdx = pub.value("app").toInt();
+            value.periodS = pub.value("periodS").toInt();
+            if (!ok) {
+                *error = QObject::tr("%1.pub.dst must be an address").arg(it.key());
+                return false;
+            }
+            modelConfig.pub = value;
+        }
+    }
+
+    return true;
+}
+
+bool NetworkSpec::load(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        *error = parseError.errorString();
+        return false;
+    }
+
+    NodeConfig network;
+    QHash<quint16, NodeConfig> nodes;
+    QJsonObject root = document.object();
+    if (!parseConfig(root, &network, error)) {
+        return false;
+    }
+
+    const QJsonObject nodeObjects = root.value("nodes").toObject();
+    for (auto it = nodeObjects.begin(); it != nodeObjects.end(); ++it) {
+        bool ok = false;
+        quint16 node = quint16(it.key().toUInt(&ok, 0));
+        NodeConfig config = network;
+        if (!ok || !parseConfig(it.value().toObject(), &config, error)) {
+            *error = QObject::tr("Node %1: %2").arg(it.key(), ok ? *error : QObject::tr("bad address"));
+            return false;
+        }
+        nodes.insert(node, config);
+    }
+
+    m_network = network;
+    m_nodes = nodes;
+    return true;
+}
+
+NetworkSpec::NodeConfig NetworkSpec::configFor(quint16 node) const
+{
+    return m_nodes.value(node, m_network);
+}
+
+QStringList NetworkSpec::diff(const NodeConfig &desired, const NodeConfig &actual,
+                              const ModelToken &modelToken)
+{
+    QStringList adds;
+    QStringList removes;
+
+    if (desired.appKeys) {
+        const QSet<int> have = actual.appKeys.value_or(QSet<int>());
+        for (int key : *desired.appKeys - have) {
+            adds << QString("ak:%1").arg(key);
+        }
+        for (int key : have - *desired.appKeys) {
+            removes << QString("ak-:%1").arg(key);
+        }
+    }
+
+    for (auto it = desired.models.cbegin(); it != desired.models.cend(); ++it) {
+        const ModelConfig have = actual.models.value(it.key());
+        const QString model = modelToken ? modelToken(it.key()) : hex(it.key());
+        if (model.isEmpty()) {
+            continue;
+        }
+
+        if (it->binds) {
+            const QSet<int> bound = have.binds.value_or(QSet<int>());
+            for (int key : *it->binds - bound) {
+                adds << QString("bind:%1:%2").arg(model).arg(key);
+            }
+            for (int key : bound - *it->binds) {
+                removes << QString("unbind:%1:%2").arg(model).arg(key);
+            }
+        }
+
+        if (it->subs) {
+            const QSet<quint16> subscribed = have.subs.value_or(QSet<quint16>());
+            for (quint16 group : *it->subs - subscribed) {
+                adds << QString("sub:%1:%2").arg(model, hex(group));
+            }
+            for (quint16 group : subscribed - *it->subs) {
+                removes << QString("unsub:%1:%2").arg(model, hex(group));
+            }
+        }
+
+        if (it->pub && !(have.pub && *have.pub == *it->pub)) {
+            adds << QString("pub:%1:%2:%3:%4").arg(model, hex(it->pub->dst))
+                        .arg(it->pub->appIdx).arg(it->pub->periodS);
+        }
+    }
+
+    if (desired.relay && !(actual.relay && *actual.relay == *desired.relay)) {
+        adds << QString("relay:%1:%2:%3").arg(desired.relay->enabled ? 1 : 0)
+                    .arg(desired.relay->count).arg(desired.relay->intervalMs);
+    }
+
+    if (desired.heartbeat && !(actual.heartbeat && *actual.heartbeat == *desired.heartbeat)) {
+        adds << QString("hb:%1:%2").arg(hex(desired.heartbeat->dst)).arg(desired.heartbeat->periodLog);
+    }
+
+    // Unbinds and unsubscribes before the AppKey deletes
+    std::stable_sort(removes.begin(), removes.end(), [](const QString &a, const QString &b) {
+        return !a.startsWith("ak-:") && b.startsWith("ak-:");
+    });
+
+    return adds + removes;
+}
+
+QStringList NetworkSpec::cfgsetCommands(quint16 node, const QStringList &ops)
+{
+    QStringList commands;
+    const QString prefix = QString("cfgset %1").arg(hex(node));
+    QStringList chunk;
+    int length = prefix.size();
+
+    for (const QString &op : ops) {
+        if (!chunk.isEmpty() &&
+            (chunk.size() >= MaxOpsPerCommand || length + 1 + op.size() > MaxCommandLength)) {
+            commands << QString("%1 %2\n").arg(prefix, chunk.join(' '));
+            chunk.clear();
+            length = prefix.size();
+        }
+        chunk << op;
+        length += 1 + op.size();
+    }
+    if (!chunk.isEmpty()) {
+        commands << QString("%1 %2\n").arg(prefix, chunk.join(' '));
+    }
+
+    return commands;
+}
+
+NetworkSpec::NodeConfig NetworkSpec::applied(const NodeConfig &desired, NodeConfig actual)
+{
+    if (desired.appKeys) {
+        actual.appKeys = desired.appKeys;
+    }
+    for (auto it = desired.models.cbegin(); it != desired.models.cend(); ++it) {
+        ModelConfig &model = actual.models[it.key()];
+        if (it->binds) {
+            model.binds = it->binds;
+        }
+        if (it->subs) {
+            model.subs = it->subs;
+        }
+        if (it->pub) {
+            model.pub = it->pub;
+        }
+    }
+    if (desired.relay) {
+        actual.relay = desired.relay;
+    }
+    if (desired.heartbeat) {
+        actual.heartbeat = desired.heartbeat;
+    }
+    return actual;
+}
@@ -0,0 +1,104 @@
+#ifndef NETWORKSPEC_H
+#define NETWORKSPEC_H
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <optional>
+
+// Declarative description of how every node should be configured,
+// loaded from JSON:
+//
+//   {
+//     "appKeys": [0],
+//     "relay": { "enabled": true, "count": 2, "intervalMs": 20 },
+//     "heartbeat": { "dst": "0x0001", "periodLog": 0 },
+//     "models": {
+//       "0x1000": { "bind": [0], "sub": ["0xc000"] },
+//       "0x05f10001": { "bind": [0], "pub": { "dst": "0x0001", "app": 0, "periodS": 10 } }
+//     },
+//     "nodes": { "0x0005": { "relay": { "enabled": false } } }
+//   }
+//
+// Per-node entries override the network-wide ones key by key. Anything
+// the description leaves out is not managed. Vendor models are written
+// as 0xCCCCMMMM with the company id in the upper half.
+class NetworkSpec
+{
+public:
+    struct Publication {
+        quint16 dst = 0;
+        int appIdx = 0;
+        int periodS = 0;
+
+        bool operator==(const Publication &other) const
+        {
+            return dst == other.dst && (!dst || (appIdx == other.appIdx && periodS == other.periodS));
+        }
+    };
+
+    struct Relay {
+        bool enabled = true;
+        int count = 2;
+        int intervalMs = 20;
+
+        bool operator==(const Relay &other) const
+        {
+            return enabled == other.enabled && (!enabled ||
+                   (count == other.count && intervalMs == other.intervalMs));
+        }
+    };
+
+    struct Heartbeat {
+        quint16 dst = 0;
+        int periodLog = 0;
+
+        bool operator==(const Heartbeat &other) const
+        {
+            return dst == other.dst && (!dst || periodLog == other.periodLog);
+        }
+    };
+
+    struct ModelConfig {
+        std::optional<QSet<int>> binds;
+        std::optional<QSet<quint16>> subs;
+        std::optional<Publication> pub;
+    };
+
+    // Desired state of a node, or the state read back from it.
+    struct NodeConfig {
+        std::optional<QSet<int>> appKeys;
+        QMap<quint32, ModelConfig> models;
+        std::optional<Relay> relay;
+        std::optional<Heartbeat> heartbeat;
+    };
+
+    bool load(const QString &path, QString *error);
+
+    NodeConfig configFor(quint16 node) const;
+
+    // How a node's model is written in cfgset operations, empty if the
+    // node does not have it (see CompositionCache::modelToken).
+    using ModelToken = std::function<QString(quint32 model)>;
+
+    // The "cfgset" operations that take a node from actual to desired,
+    // AppKeys added before they are bound and deleted last. Models the
+    // node does not have are left out.
+    static QStringList diff(const NodeConfig &desired, const NodeConfig &actual,
+                            const ModelToken &modelToken = ModelToken());
+
+    // The operations as "cfgset" commands that fit the dongle's shell.
+    static QStringList cfgsetCommands(quint16 node, const QStringList &ops);
+
+    // actual once every operation of diff() has been applied.
+    static NodeConfig applied(const NodeConfig &desired, NodeConfig actual);
+
+private:
+    NodeConfig m_network;
+    QHash<quint16, NodeConfig> m_nodes;
+};
+
+#endif // NETWORKSPEC_H
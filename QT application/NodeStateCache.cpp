@@ -0,0 +1,210 @@
+#include "NodeStateCache.h"
+#include "TimingWheel.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+
+// A node publishes its change 20-500 ms after the Set. This leaves room
+// for relaying and the network retransmissions.
+static const int ConfirmTimeoutMs = 3000;
+
+// A Get is acknowledged; the client gives up after a few seconds
+static const int GetTimeoutMs = 4000;
+
+static QString hex(quint16 address)
+{
+    return QString("0x%1").arg(address, 4, 16, QChar('0'));
+}
+
+static bool isUnicast(quint16 address)
+{
+    return address && address < 0x8000;
+}
+
+NodeStateCache::NodeStateCache(QObject *parent)
+    : QObject(parent)
+{
+    m_elapsed.start();
+}
+
+NodeStateCache::~NodeStateCache()
+{
+    for (quint64 handle : std::as_const(m_deadlines)) {
+        TimingWheel::shared()->cancel(handle);
+    }
+}
+
+void NodeStateCache::setGroupResolver(std::function<QSet<quint16>(quint16)> resolver)
+{
+    m_resolveGroup = std::move(resolver);
+}
+
+void NodeStateCache::invalidate(quint16 address)
+{
+    if (!m_queried.contains(address)) {
+        query(address);
+    }
+}
+
+void NodeStateCache::removeNode(quint16 address)
+{
+    disarm(address);
+    m_queried.remove(address);
+    if (m_nodes.remove(address)) {
+        emit stateChanged(address);
+    }
+}
+
+bool NodeStateCache::contains(quint16 address) const
+{
+    return m_nodes.contains(address);
+}
+
+NodeStateCache::NodeState NodeStateCache::state(quint16 address) const
+{
+    return m_nodes.value(address);
+}
+
+QList<quint16> NodeStateCache::nodes() const
+{
+    return m_nodes.keys();
+}
+
+QString NodeStateCache::describe(quint16 address) const
+{
+    auto it = m_nodes.constFind(address);
+    if (it == m_nodes.constEnd() || it->confirmation == Confirmation::Unknown) {
+        return tr("%1: state unknown").arg(hex(address));
+    }
+
+    return tr("%1: %2, %3 %4 s ago%5")
+        .arg(hex(address))
+        .arg(it->on ? tr("on") : tr("off"))
+        .arg(it->confirmation == Confirmation::Pending ? tr("set") : tr("reported"))
+        .arg((m_elapsed.elapsed() - it->updatedMs) / 1000)
+        .arg(it->tid >= 0 ? tr(", TID %1").arg(it->tid) : QString());
+}
+
+void NodeStateCache::expect(quint16 address, bool on, int tid)
+{
+    NodeState &state = m_nodes[address];
+    state.on = on;
+    state.tid = tid;
+    state.updatedMs = m_elapsed.elapsed();
+    state.confirmation = Confirmation::Pending;
+
+    m_queried.remove(address);
+    arm(address, ConfirmTimeoutMs);
+    emit stateChanged(address);
+}
+
+void NodeStateCache::report(quint16 address, bool on)
+{
+    NodeState &state = m_nodes[address];
+
+    if (state.confirmation == Confirmation::Pending && state.on != on) {
+        // Possibly a publication of an earlier change still on its way:
+        // the node's answer to a Get decides
+        if (!m_queried.contains(address)) {
+            query(address);
+            return;
+        }
+        emit diverged(address, state.on, on);
+    }
+
+    disarm(address);
+    m_queried.remove(address);
+
+    state.on = on;
+    state.updatedMs = m_elapsed.elapsed();
+    state.confirmation = Confirmation::Confirmed;
+    emit stateChanged(address);
+}
+
+void NodeStateCache::query(quint16 address)
+{
+    // Timed once the Get is written, it may wait behind other commands
+    disarm(address);
+    m_queried.insert(address);
+    emit sendCommand(QString("onoff %1 get\n").arg(hex(address)));
+}
+
+void NodeStateCache::arm(quint16 address, int delayMs)
+{
+    TimingWheel *wheel = TimingWheel::shared();
+    wheel->cancel(m_deadlines.value(address));
+    m_deadlines.insert(address, wheel->schedule(delayMs, [this, address]() {
+        m_deadlines.remove(address);
+        onDeadline(address);
+    }));
+}
+
+void NodeStateCache::disarm(quint16 address)
+{
+    auto it = m_deadlines.find(address);
+    if (it != m_deadlines.end()) {
+        TimingWheel::shared()->cancel(*it);
+        m_deadlines.erase(it);
+    }
+}
+
+void NodeStateCache::onDeadline(quint16 address)
+{
+    if (!m_queried.contains(address)) {
+        // Set but never reported back
+        query(address);
+        return;
+    }
+
+    qDebug() << "No OnOff state from" << hex(address);
+    m_queried.remove(address);
+
+    auto it = m_nodes.find(address);
+    if (it != m_nodes.end() && it->confirmation != Confirmation::Unknown) {
+        it->confirmation = Confirmation::Unknown;
+        emit stateChanged(address);
+    }
+}
+
+void NodeStateCache::commandDispatched(const QString &command)
+{
+    static const QRegularExpression getRegex(R"(^onoff (0x[0-9a-fA-F]+) get)");
+
+    QRegularExpressionMatch match = getRegex.match(command);
+    if (match.hasMatch()) {
+        quint16 address = match.captured(1).toUShort(nullptr, 16);
+        if (m_queried.contains(address)) {
+            arm(address, GetTimeoutMs);
+        }
+    }
+}
+
+void NodeStateCache::handleLine(const QString &line)
+{
+    static const QRegularExpression sentRegex(R"(^Sending OnOff=(\d) to (0x[0-9a-fA-F]+) tid (\d+))");
+    static const QRegularExpression statusRegex(R"(^Received Led Status from (0x[0-9a-fA-F]+): (\d))");
+
+    QRegularExpressionMatch match = statusRegex.match(line);
+    if (match.hasMatch()) {
+        report(match.captured(1).toUShort(nullptr, 16), match.captured(2).toInt() != 0);
+        return;
+    }
+
+    match = sentRegex.match(line);
+    if (!match.hasMatch()) {
+        return;
+    }
+
+    bool on = match.captured(1).toInt() != 0;
+    quint16 target = match.captured(2).toUShort(nullptr, 16);
+    int tid = match.captured(3).toInt();
+
+    if (isUnicast(target)) {
+        expect(target, on, tid);
+    } else if (m_resolveGroup) {
+        for (quint16 address : m_resolveGroup(target)) {
+            expect(address, on, tid);
+        }
+    }
+}
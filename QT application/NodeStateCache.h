@@ -0,0 +1,81 @@
+#ifndef NODESTATECACHE_H
+#define NODESTATECACHE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <functional>
+
+// Last known OnOff state of every node, so the whole network can be
+// shown without asking it.
+//
+// Every Set the dongle sends ("Sending OnOff=.. to .. tid .." lines) is
+// applied at once to each node it reaches, and that node is marked
+// pending. The node's OnOff Status confirms it, whether the Status is
+// the reply to a unicast Set or the publication of the change. Only
+// nodes that diverge are asked with a Get:
+// - a node still pending after ConfirmTimeoutMs
+// - a node that reports another state while pending
+// - a node that is invalidated, for example after it was lost
+class NodeStateCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Confirmation {
+        Unknown,
+        Pending,                    // set, not reported back yet
+        Confirmed,                  // reported by the node
+    };
+
+    struct NodeState {
+        bool on = false;
+        int tid = -1;               // of the last Set sent to the node
+        qint64 updatedMs = -1;      // since the cache started
+        Confirmation confirmation = Confirmation::Unknown;
+    };
+
+    explicit NodeStateCache(QObject *parent = nullptr);
+    ~NodeStateCache() override;
+
+    // The nodes a group address reaches
+    void setGroupResolver(std::function<QSet<quint16>(quint16)> resolver);
+
+    // The node may have missed Sets: ask it for its state.
+    void invalidate(quint16 address);
+    void removeNode(quint16 address);
+
+    bool contains(quint16 address) const;
+    NodeState state(quint16 address) const;
+    QList<quint16> nodes() const;
+    QString describe(quint16 address) const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void stateChanged(quint16 address);
+    void diverged(quint16 address, bool expected, bool reported);
+
+private:
+    void expect(quint16 address, bool on, int tid);
+    void report(quint16 address, bool on);
+    void query(quint16 address);
+    void arm(quint16 address, int delayMs);
+    void disarm(quint16 address);
+    void onDeadline(quint16 address);
+
+    std::function<QSet<quint16>(quint16)> m_resolveGroup;
+    QHash<quint16, NodeState> m_nodes;
+    QHash<quint16, quint64> m_deadlines;    // wheel handles
+    QSet<quint16> m_queried;                // Get outstanding
+    QElapsedTimer m_elapsed;
+};
+
+#endif // NODESTATECACHE_H
@@ -0,0 +1,198 @@
+#include "RemoteProvisioner.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <algorithm>
+
+// Same limit the dongle uses for "mesh prov remote-gatt ... 30".
+static const int ProvisionTimeoutMs = 30000;
+
+// SHELL_CMD_BUFF_SIZE is 128 in prj.conf; twelve servers keep a scan
+// command inside it and under the shell's argument limit.
+static const int MaxServersPerCommand = 12;
+
+// The dongle starts the servers one after another and waits for each
+// Scan Status; only used if its "started" line is lost.
+static const int ScanStartTimeoutMs = 5000;
+
+RemoteProvisioner::RemoteProvisioner(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_scanTimer, &RequestTimer::timeout, this, &RemoteProvisioner::onScanFinished);
+    connect(&m_provTimer, &RequestTimer::timeout, this, [this]() {
+        qDebug() << "RPR provisioning timed out for" << m_current.uuid;
+        finishCurrent(false);
+    });
+}
+
+void RemoteProvisioner::setAddressAllocator(std::function<quint16()> allocator,
+                                            std::function<void(quint16)> release)
+{
+    m_allocateAddress = std::move(allocator);
+    m_releaseAddress = std::move(release);
+}
+
+bool RemoteProvisioner::isRunning() const
+{
+    return m_scanning || m_provisioning || !m_queue.isEmpty();
+}
+
+void RemoteProvisioner::start(const QList<quint16> &servers, int scanSeconds, const QSet<QString> &knownUuids)
+{
+    if (isRunning() || servers.isEmpty()) {
+        return;
+    }
+
+    m_candidates.clear();
+    m_queue.clear();
+    m_knownUuids = knownUuids;
+    m_provisioned = 0;
+    m_failed = 0;
+    m_scanning = true;
+
+    // Leave a second for the last reports to travel back through the mesh.
+    m_scanMs = (scanSeconds + 1) * 1000;
+
+    // A few commands start the scan on every server; they then run in
+    // parallel. The scan is timed from the last "started" line.
+    QStringList commands;
+    QStringList addresses;
+    for (int i = 0; i < servers.size(); i++) {
+        addresses << QString("0x%1").arg(servers[i], 4, 16, QChar('0'));
+        if (addresses.size() == MaxServersPerCommand || i == servers.size() - 1) {
+            commands << QString("rpr scan %1 %2\n").arg(scanSeconds).arg(addresses.join(' '));
+            addresses.clear();
+        }
+    }
+    m_scanStartsLeft = commands.size();
+
+    // The chunks leave in order, so the last one bounds all the starts
+    m_scanTimer.startOnDispatch(commands.last(),
+                                MaxServersPerCommand * ScanStartTimeoutMs + m_scanMs);
+    for (const QString &command : commands) {
+        emit sendCommand(command);
+    }
+}
+
+void RemoteProvisioner::commandDispatched(const QString &command)
+{
+    m_scanTimer.dispatched(command);
+    m_provTimer.dispatched(command);
+}
+
+void RemoteProvisioner::handleLine(const QString &line)
+{
+    static const QRegularExpression scanRegex(
+        R"(RPR scan: srv (0x[0-9a-fA-F]+) uuid ([0-9a-fA-F]{32}) oob 0x[0-9a-fA-F]+ rssi (-?\d+))");
+    static const QRegularExpression addedRegex(
+        R"(Node provisioned, net_idx 0x[0-9a-fA-F]+ address (0x[0-9a-fA-F]+))");
+
+    if (m_scanning && m_scanStartsLeft > 0 && line.startsWith(QLatin1String("RPR scan: started on"))) {
+        // Every server scans now
+        if (--m_scanStartsLeft == 0) {
+            m_scanTimer.start(m_scanMs);
+        }
+        return;
+    }
+
+    QRegularExpressionMatch match = scanRegex.match(line);
+    if (match.hasMatch()) {
+        if (!m_scanning) {
+            return;
+        }
+
+        QString uuid = match.captured(2);
+        uuid.remove(QRegularExpression("0+$")); // Same form as the PB-GATT beacon path
+        if (m_knownUuids.contains(uuid)) {
+            return;
+        }
+
+        Candidate candidate;
+        candidate.uuid = uuid;
+        candidate.fullUuid = match.captured(2);
+        candidate.server = match.captured(1).toUShort(nullptr, 16);
+        candidate.rssi = match.captured(3).toInt();
+
+        // Keep the server that hears the device best.
+        auto it = m_candidates.find(uuid);
+        if (it == m_candidates.end() || candidate.rssi > it->rssi) {
+            m_candidates[uuid] = candidate;
+        }
+        return;
+    }
+
+    if (!m_provisioning) {
+        return;
+    }
+
+    match = addedRegex.match(line);
+    if (match.hasMatch()) {
+        if (match.captured(1).toUShort(nullptr, 16) == m_currentAddress) {
+            finishCurrent(true);
+        }
+        return;
+    }
+
+    if (line.contains("RPR prov:") && line.contains("failed")) {
+        finishCurrent(false);
+    }
+}
+
+void RemoteProvisioner::onScanFinished()
+{
+    m_scanning = false;
+
+    m_queue = m_candidates.values();
+    std::sort(m_queue.begin(), m_queue.end(), [](const Candidate &a, const Candidate &b) {
+        return a.rssi > b.rssi;
+    });
+
+    qDebug() << "RPR scan found" << m_queue.size() << "devices";
+    provisionNext();
+}
+
+void RemoteProvisioner::provisionNext()
+{
+    if (m_queue.isEmpty()) {
+        emit finished(m_provisioned, m_failed);
+        return;
+    }
+
+    m_current = m_queue.takeFirst();
+    m_currentAddress = m_allocateAddress ? m_allocateAddress() : 0;
+    if (m_currentAddress == 0) {
+        qDebug() << "No unicast address available for" << m_current.uuid;
+        m_queue.clear();
+        emit finished(m_provisioned, m_failed);
+        return;
+    }
+
+    m_provisioning = true;
+    const QString command = QString("rpr prov 0x%1 %2 0 0x%3\n")
+                                .arg(m_current.server, 4, 16, QChar('0'))
+                                .arg(m_current.fullUuid)
+                                .arg(m_currentAddress, 4, 16, QChar('0'));
+    m_provTimer.startOnDispatch(command, ProvisionTimeoutMs);
+    emit sendCommand(command);
+}
+
+void RemoteProvisioner::finishCurrent(bool success)
+{
+    m_provTimer.stop();
+    m_provisioning = false;
+
+    if (success) {
+        m_provisioned++;
+        m_knownUuids.insert(m_current.uuid);
+        emit nodeProvisioned(m_currentAddress, m_current.uuid, m_current.server);
+    } else {
+        m_failed++;
+        if (m_releaseAddress) {
+            m_releaseAddress(m_currentAddress);
+        }
+        emit provisioningFailed(m_current.uuid, m_current.server);
+    }
+
+    provisionNext();
+}
@@ -0,0 +1,71 @@
+#ifndef REMOTEPROVISIONER_H
+#define REMOTEPROVISIONER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <functional>
+#include "RequestTimer.h"
+
+// Remote Provisioning through already provisioned nodes.
+//
+// All RPR servers scan at the same time, each discovered device is
+// assigned to the server that heard it with the best RSSI, and the
+// devices are then provisioned over the mesh one after another (the
+// dongle has a single provisioning link), strongest first.
+class RemoteProvisioner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RemoteProvisioner(QObject *parent = nullptr);
+
+    // release gets back the address of a device that failed to provision
+    void setAddressAllocator(std::function<quint16()> allocator,
+                             std::function<void(quint16)> release = nullptr);
+    void start(const QList<quint16> &servers, int scanSeconds, const QSet<QString> &knownUuids);
+    bool isRunning() const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void nodeProvisioned(quint16 address, const QString &uuid, quint16 server);
+    void provisioningFailed(const QString &uuid, quint16 server);
+    void finished(int provisioned, int failed);
+
+private:
+    struct Candidate {
+        QString uuid;               // trailing zeros stripped, for display and lookup
+        QString fullUuid;           // all 32 digits, for rpr prov
+        quint16 server = 0;
+        int rssi = -128;
+    };
+
+    void onScanFinished();
+    void provisionNext();
+    void finishCurrent(bool success);
+
+    QHash<QString, Candidate> m_candidates;
+    QSet<QString> m_knownUuids;
+    QList<Candidate> m_queue;
+    Candidate m_current;
+    quint16 m_currentAddress = 0;
+    bool m_scanning = false;
+    int m_scanStartsLeft = 0;       // scan commands not reported started
+    int m_scanMs = 0;
+    bool m_provisioning = false;
+    int m_provisioned = 0;
+    int m_failed = 0;
+    RequestTimer m_scanTimer;
+    RequestTimer m_provTimer;
+    std::function<quint16()> m_allocateAddress;
+    std::function<void(quint16)> m_releaseAddress;
+};
+
+#endif // REMOTEPROVISIONER_H
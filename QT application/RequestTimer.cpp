@@ -0,0 +1,92 @@
+#include "RequestTimer.h"
+#include "TimingWheel.h"
+
+// Backoff stops doubling here
+static const qint64 MaxTimeoutMs = 60000;
+
+RequestTimer::RequestTimer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+RequestTimer::~RequestTimer()
+{
+    stop();
+}
+
+void RequestTimer::setRetries(int retries)
+{
+    m_retries = qMax(retries, 0);
+}
+
+void RequestTimer::start(int timeoutMs)
+{
+    stop();
+    m_attempt = 0;
+    m_timeoutMs = timeoutMs;
+    arm();
+}
+
+void RequestTimer::startOnDispatch(const QString &command, int timeoutMs)
+{
+    stop();
+    m_attempt = 0;
+    m_timeoutMs = timeoutMs;
+    m_command = command;
+    m_waiting = true;
+}
+
+void RequestTimer::stop()
+{
+    m_command.clear();
+    m_waiting = false;
+    if (m_handle) {
+        TimingWheel::shared()->cancel(m_handle);
+        m_handle = 0;
+    }
+}
+
+bool RequestTimer::isActive() const
+{
+    return m_handle != 0 || m_waiting;
+}
+
+int RequestTimer::attempt() const
+{
+    return m_attempt;
+}
+
+void RequestTimer::dispatched(const QString &command)
+{
+    if (m_waiting && command == m_command) {
+        m_waiting = false;
+        arm();
+    }
+}
+
+void RequestTimer::arm()
+{
+    m_handle = TimingWheel::shared()->schedule(m_timeoutMs, [this]() { expire(); });
+}
+
+void RequestTimer::expire()
+{
+    m_handle = 0;
+
+    if (m_attempt < m_retries) {
+        // Armed (or waiting for the resend) first, so a handler that
+        // answers or gives up can stop it
+        m_attempt++;
+        m_timeoutMs = qMax(m_timeoutMs, qMin(m_timeoutMs * 2, MaxTimeoutMs));
+        if (m_command.isEmpty()) {
+            arm();
+        } else {
+            m_waiting = true;
+        }
+        emit retry(m_attempt);
+        return;
+    }
+
+    m_command.clear();
+    emit timeout();
+}
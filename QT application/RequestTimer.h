@@ -0,0 +1,55 @@
+#ifndef REQUESTTIMER_H
+#define REQUESTTIMER_H
+
+#include <QObject>
+#include <QString>
+
+// The deadline of one outstanding request, on the shared timing wheel:
+// a drop-in for a single-shot QTimer that costs no timer of its own.
+//
+// With retries set, an expiry first emits retry() so the request can be
+// sent again, and re-arms with twice the previous timeout; timeout()
+// follows once the retries are used up.
+//
+// A request that waits in the CommandScheduler is timed with
+// startOnDispatch(): the deadline only runs once the command is written
+// to the dongle (see dispatched()), and so does that of every resend.
+class RequestTimer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RequestTimer(QObject *parent = nullptr);
+    ~RequestTimer() override;
+
+    // Takes effect at the next start()
+    void setRetries(int retries);
+
+    void start(int timeoutMs);
+    void startOnDispatch(const QString &command, int timeoutMs);
+    void stop();
+    bool isActive() const;
+
+    // 0 until the first retry
+    int attempt() const;
+
+    // Feed every command the scheduler writes.
+    void dispatched(const QString &command);
+
+signals:
+    void retry(int attempt);
+    void timeout();
+
+private:
+    void arm();
+    void expire();
+
+    int m_retries = 0;
+    int m_attempt = 0;
+    qint64 m_timeoutMs = 0;
+    quint64 m_handle = 0;
+    QString m_command;              // armed when this is dispatched
+    bool m_waiting = false;
+};
+
+#endif // REQUESTTIMER_H
@@ -0,0 +1,115 @@
+#include "SceneDialog.h"
+
+#include <QBrush>
+#include <QColor>
+#include <QGridLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QStringList>
+#include <QTableWidget>
+
+// Group every node subscribes to (see nodecfg)
+static const quint16 SceneGroup = 0xc000;
+
+// Scene number 0 is prohibited. Each node keeps up to 16 scenes (SCENE_COUNT).
+static const int MaxSceneNumber = 0xffff;
+
+SceneDialog::SceneDialog(SceneEditor *editor, QWidget *parent) :
+    QDialog(parent),
+    m_editor(editor),
+    m_sceneSpinBox(new QSpinBox),
+    m_storeButton(new QPushButton(tr("Store"))),
+    m_recallButton(new QPushButton(tr("Recall"))),
+    m_nodeTable(new QTableWidget(0, 2)),
+    m_summaryLabel(new QLabel)
+{
+    m_sceneSpinBox->setRange(1, MaxSceneNumber);
+    m_sceneSpinBox->setPrefix(tr("Scene "));
+
+    m_nodeTable->setHorizontalHeaderLabels({ tr("On"), tr("Stored") });
+    m_nodeTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+
+    auto layout = new QGridLayout;
+    layout->addWidget(m_sceneSpinBox, 0, 0);
+    layout->addWidget(m_storeButton, 0, 1);
+    layout->addWidget(m_recallButton, 0, 2);
+    layout->addWidget(m_nodeTable, 1, 0, 1, 3);
+    layout->addWidget(m_summaryLabel, 2, 0, 1, 3);
+
+    setLayout(layout);
+    setWindowTitle(tr("Scenes"));
+    resize(400, 400);
+
+    connect(m_storeButton, &QPushButton::clicked, this, &SceneDialog::onStoreClicked);
+    connect(m_recallButton, &QPushButton::clicked, this, &SceneDialog::onRecallClicked);
+    connect(m_editor, &SceneEditor::nodeStored, this, [this](quint16 address, bool ok) {
+        int row = m_nodes.indexOf(address);
+        if (row < 0) {
+            return;
+        }
+        auto item = new QTableWidgetItem(ok ? tr("yes") : tr("failed"));
+        if (!ok) {
+            item->setBackground(QBrush(QColor(255, 200, 200)));
+        }
+        m_nodeTable->setItem(row, 1, item);
+    });
+    connect(m_editor, &SceneEditor::finished, this, [this](int stored, int failed) {
+        m_storeButton->setText(tr("Store"));
+        m_recallButton->setEnabled(true);
+        m_summaryLabel->setText(tr("Scene %1 stored on %2 nodes, %3 failed.")
+                                    .arg(m_sceneSpinBox->value()).arg(stored).arg(failed));
+    });
+}
+
+void SceneDialog::setNodes(const QList<quint16> &nodes)
+{
+    m_nodes = nodes;
+
+    QStringList rows;
+    for (quint16 address : std::as_const(m_nodes)) {
+        rows << QString("0x%1").arg(address, 4, 16, QChar('0'));
+    }
+
+    m_nodeTable->clearContents();
+    m_nodeTable->setRowCount(rows.size());
+    m_nodeTable->setVerticalHeaderLabels(rows);
+    for (int row = 0; row < rows.size(); row++) {
+        auto item = new QTableWidgetItem;
+        item->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
+        item->setCheckState(Qt::Unchecked);
+        m_nodeTable->setItem(row, 0, item);
+    }
+}
+
+void SceneDialog::onStoreClicked()
+{
+    if (m_editor->isRunning()) {
+        m_editor->stop();
+        return;
+    }
+
+    QList<QPair<quint16, bool>> states;
+    for (int row = 0; row < m_nodes.size(); row++) {
+        states << qMakePair(m_nodes.at(row), m_nodeTable->item(row, 0)->checkState() == Qt::Checked);
+        m_nodeTable->setItem(row, 1, nullptr);
+    }
+
+    if (!m_editor->store(states, m_sceneSpinBox->value())) {
+        m_summaryLabel->setText(tr("Nothing to store."));
+        return;
+    }
+
+    m_storeButton->setText(tr("Stop"));
+    m_recallButton->setEnabled(false);
+    m_summaryLabel->setText(tr("Storing scene %1 on %2 nodes...")
+                                .arg(m_sceneSpinBox->value()).arg(states.size()));
+}
+
+void SceneDialog::onRecallClicked()
+{
+    m_editor->recall(SceneGroup, m_sceneSpinBox->value());
+    m_summaryLabel->setText(tr("Recalled scene %1 on group 0x%2.")
+                                .arg(m_sceneSpinBox->value()).arg(SceneGroup, 4, 16, QChar('0')));
+}
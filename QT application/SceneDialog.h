@@ -0,0 +1,41 @@
+#ifndef SCENEDIALOG_H
+#define SCENEDIALOG_H
+
+#include <QDialog>
+#include <QList>
+#include "SceneEditor.h"
+
+QT_BEGIN_NAMESPACE
+class QLabel;
+class QPushButton;
+class QSpinBox;
+class QTableWidget;
+QT_END_NAMESPACE
+
+// Scene editor: pick the OnOff state of every node, store it under a
+// scene number and recall the whole scene on the group with one message.
+class SceneDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SceneDialog(SceneEditor *editor, QWidget *parent = nullptr);
+
+    void setNodes(const QList<quint16> &nodes);
+
+private slots:
+    void onStoreClicked();
+    void onRecallClicked();
+
+private:
+    SceneEditor *m_editor;
+    QList<quint16> m_nodes;
+
+    QSpinBox *m_sceneSpinBox;
+    QPushButton *m_storeButton;
+    QPushButton *m_recallButton;
+    QTableWidget *m_nodeTable;
+    QLabel *m_summaryLabel;
+};
+
+#endif // SCENEDIALOG_H
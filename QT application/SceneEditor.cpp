@@ -0,0 +1,128 @@
+#include "SceneEditor.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+
+// OnOff Set and Scene Store are acknowledged; the client retransmits for
+// a while before giving up, so wait a little longer than that.
+static const int OnOffTimeoutMs = 2000;
+static const int StoreTimeoutMs = 3000;
+
+// Both set the same state again, so a step is safe to repeat
+static const int StepRetries = 1;
+
+static QString hexAddress(quint16 address)
+{
+    return QString("0x%1").arg(address, 4, 16, QChar('0'));
+}
+
+SceneEditor::SceneEditor(QObject *parent)
+    : QObject(parent)
+{
+    m_timeout.setRetries(StepRetries);
+    connect(&m_timeout, &RequestTimer::retry, this, [this]() {
+        emit sendCommand(m_current.command);
+    });
+    connect(&m_timeout, &RequestTimer::timeout, this, [this]() {
+        qDebug() << "No reply from" << hexAddress(m_current.address) << "to" << m_current.command.trimmed();
+        stepDone(false);
+    });
+}
+
+bool SceneEditor::store(const QList<QPair<quint16, bool>> &states, int scene)
+{
+    if (m_running || states.isEmpty() || scene < 1 || scene > 0xffff) {
+        return false;
+    }
+
+    m_steps.clear();
+    for (const auto &state : states) {
+        m_steps.enqueue({ state.first,
+                          QString("onoff %1 %2\n").arg(hexAddress(state.first)).arg(state.second ? 1 : 0),
+                          false, OnOffTimeoutMs });
+        m_steps.enqueue({ state.first,
+                          QString("scene store %1 %2\n").arg(hexAddress(state.first)).arg(scene),
+                          true, StoreTimeoutMs });
+    }
+
+    m_stored = 0;
+    m_failed = 0;
+    m_running = true;
+    sendNext();
+    return true;
+}
+
+void SceneEditor::recall(quint16 address, int scene)
+{
+    emit sendCommand(QString("scene recall %1 %2\n").arg(hexAddress(address)).arg(scene));
+}
+
+void SceneEditor::stop()
+{
+    m_steps.clear();
+    m_timeout.stop();
+    if (m_running) {
+        m_running = false;
+        emit finished(m_stored, m_failed);
+    }
+}
+
+bool SceneEditor::isRunning() const
+{
+    return m_running;
+}
+
+void SceneEditor::sendNext()
+{
+    if (m_steps.isEmpty()) {
+        stop();
+        return;
+    }
+
+    m_current = m_steps.dequeue();
+    m_timeout.startOnDispatch(m_current.command, m_current.timeoutMs);
+    emit sendCommand(m_current.command);
+}
+
+void SceneEditor::stepDone(bool ok)
+{
+    m_timeout.stop();
+
+    if (!ok) {
+        // The node did not take its state, so do not store the scene on it
+        if (!m_current.storing && !m_steps.isEmpty()) {
+            m_steps.dequeue();
+        }
+        m_failed++;
+        emit nodeStored(m_current.address, false);
+    } else if (m_current.storing) {
+        m_stored++;
+        emit nodeStored(m_current.address, true);
+    }
+
+    sendNext();
+}
+
+void SceneEditor::commandDispatched(const QString &command)
+{
+    m_timeout.dispatched(command);
+}
+
+void SceneEditor::handleLine(const QString &line)
+{
+    static const QRegularExpression ledRegex(R"(^Received Led Status from (0x[0-9a-fA-F]+))");
+    static const QRegularExpression sceneRegex(R"(^SCENE (0x[0-9a-fA-F]+) (status (\d+)|failed))");
+
+    if (!m_running) {
+        return;
+    }
+
+    QRegularExpressionMatch match = (m_current.storing ? sceneRegex : ledRegex).match(line);
+    if (!match.hasMatch() || match.captured(1).toUShort(nullptr, 16) != m_current.address) {
+        return;
+    }
+
+    // Scene Store status 0 is success, anything else (register full) is not
+    stepDone(!m_current.storing || (!match.captured(3).isEmpty() && match.captured(3).toInt() == 0));
+}
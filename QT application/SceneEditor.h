@@ -0,0 +1,55 @@
+#ifndef SCENEEDITOR_H
+#define SCENEEDITOR_H
+
+#include <QObject>
+#include <QList>
+#include <QPair>
+#include <QQueue>
+#include <QString>
+#include "RequestTimer.h"
+
+// Builds a scene node by node: every node is first set to its OnOff state
+// and then asked to store that state under the scene number. Recalling
+// the scene afterwards is a single group message from the dongle.
+class SceneEditor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SceneEditor(QObject *parent = nullptr);
+
+    bool store(const QList<QPair<quint16, bool>> &states, int scene);
+    void recall(quint16 address, int scene);
+    void stop();
+    bool isRunning() const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void nodeStored(quint16 address, bool ok);
+    void finished(int stored, int failed);
+
+private:
+    struct Step {
+        quint16 address;
+        QString command;
+        bool storing;               // scene store, otherwise OnOff set
+        int timeoutMs;
+    };
+
+    void sendNext();
+    void stepDone(bool ok);
+
+    QQueue<Step> m_steps;
+    Step m_current;
+    int m_stored = 0;
+    int m_failed = 0;
+    bool m_running = false;
+    RequestTimer m_timeout;
+};
+
+#endif // SCENEEDITOR_H
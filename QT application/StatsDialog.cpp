@@ -0,0 +1,168 @@
+#include "StatsDialog.h"
+
+#include <QBrush>
+#include <QColor>
+#include <QGridLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QStringList>
+#include <QTableWidget>
+
+enum Column {
+    ColumnNode,
+    ColumnRxAdv,
+    ColumnRxOther,
+    ColumnRelayed,
+    ColumnRelayDrops,
+    ColumnLocalDrops,
+    ColumnFriendDrops,
+    ColumnNoBuffers,
+    ColumnReplies,
+    ColumnCount,
+};
+
+// A relay dropping more than this share of what it planned is congested.
+static const double RelayDropWarning = 0.05;
+
+StatsDialog::StatsDialog(StatsPoller *poller, QWidget *parent) :
+    QDialog(parent),
+    m_poller(poller),
+    m_periodSpinBox(new QSpinBox),
+    m_startButton(new QPushButton(tr("Start polling"))),
+    m_resetButton(new QPushButton(tr("Reset totals"))),
+    m_statsTable(new QTableWidget(0, ColumnCount)),
+    m_summaryLabel(new QLabel)
+{
+    m_periodSpinBox->setRange(1, 600);
+    m_periodSpinBox->setValue(30);
+    m_periodSpinBox->setSuffix(tr(" s per round"));
+
+    m_statsTable->setHorizontalHeaderLabels({tr("Node"), tr("RX adv"), tr("RX loop/proxy"),
+                                             tr("Relayed"), tr("Relay drops"), tr("Local drops"),
+                                             tr("Friend drops"), tr("No buffers"), tr("Replies")});
+    m_statsTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_statsTable->verticalHeader()->hide();
+    m_statsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    auto layout = new QGridLayout;
+    layout->addWidget(new QLabel(tr("Poll period:")), 0, 0);
+    layout->addWidget(m_periodSpinBox, 0, 1);
+    layout->addWidget(m_startButton, 0, 2);
+    layout->addWidget(m_resetButton, 0, 3);
+    layout->addWidget(m_statsTable, 1, 0, 1, 4);
+    layout->addWidget(m_summaryLabel, 2, 0, 1, 4);
+
+    setLayout(layout);
+    setWindowTitle(tr("Mesh statistics"));
+    resize(800, 400);
+
+    connect(m_startButton, &QPushButton::clicked, this, &StatsDialog::onStartClicked);
+    connect(m_resetButton, &QPushButton::clicked, this, &StatsDialog::onResetClicked);
+    connect(m_poller, &StatsPoller::nodeUpdated, this, [this](quint16 address) {
+        updateNode(address);
+        updateTotal();
+    });
+}
+
+void StatsDialog::setNodes(const QList<quint16> &nodes)
+{
+    m_nodes = nodes;
+
+    // One row per node plus the network total in the last row
+    m_statsTable->setRowCount(nodes.size() + 1);
+    for (quint16 address : nodes) {
+        updateNode(address);
+    }
+    updateTotal();
+}
+
+void StatsDialog::onStartClicked()
+{
+    if (m_poller->isRunning()) {
+        m_poller->stop();
+        m_startButton->setText(tr("Start polling"));
+        return;
+    }
+
+    m_poller->start(m_nodes, m_periodSpinBox->value() * 1000);
+    m_startButton->setText(tr("Stop polling"));
+}
+
+void StatsDialog::onResetClicked()
+{
+    m_poller->clear();
+    setNodes(m_nodes);
+}
+
+void StatsDialog::updateRow(int row, const QString &name, const StatsPoller::Counters &counters,
+                            const QString &replies)
+{
+    quint64 relayPlanned = counters.value("relay_planned");
+    quint64 relayDrops = StatsPoller::drops(counters, "relay");
+    quint64 noBuffers = counters.value("enobufs");
+
+    QStringList values = {
+        name,
+        QString::number(counters.value("rx_adv")),
+        QString("%1/%2").arg(counters.value("rx_loopback")).arg(counters.value("rx_proxy")),
+        QString("%1/%2").arg(counters.value("relay_succeeded")).arg(relayPlanned),
+        QString::number(relayDrops),
+        QString::number(StatsPoller::drops(counters, "local")),
+        QString::number(StatsPoller::drops(counters, "friend")),
+        QString::number(noBuffers),
+        replies,
+    };
+
+    bool congested = relayPlanned && double(relayDrops) / relayPlanned > RelayDropWarning;
+    bool starved = noBuffers > 0;
+
+    for (int column = 0; column < ColumnCount; column++) {
+        auto item = new QTableWidgetItem(values.at(column));
+        if (congested || starved) {
+            item->setBackground(QBrush(starved ? QColor(255, 200, 200) : QColor(255, 235, 180)));
+        }
+        m_statsTable->setItem(row, column, item);
+    }
+}
+
+void StatsDialog::updateNode(quint16 address)
+{
+    int row = m_nodes.indexOf(address);
+    if (row < 0) {
+        return;
+    }
+
+    StatsPoller::NodeStats stats = m_poller->node(address);
+    updateRow(row, QString("0x%1").arg(address, 4, 16, QChar('0')), stats.total,
+              QString("%1/%2").arg(stats.replies).arg(stats.requests));
+}
+
+void StatsDialog::updateTotal()
+{
+    StatsPoller::Counters total = m_poller->networkTotal();
+    updateRow(m_nodes.size(), tr("Network"), total, QString());
+
+    // Worst relay by drop count, the first place to look for congestion
+    quint16 worst = 0;
+    quint64 worstDrops = 0;
+    for (quint16 address : std::as_const(m_nodes)) {
+        quint64 drops = StatsPoller::drops(m_poller->node(address).total, "relay");
+        if (drops > worstDrops) {
+            worst = address;
+            worstDrops = drops;
+        }
+    }
+
+    if (worstDrops) {
+        m_summaryLabel->setText(tr("Most relay drops: 0x%1 (%2). Network: %3 relay drops, %4 buffer exhaustions.")
+                                    .arg(worst, 4, 16, QChar('0'))
+                                    .arg(worstDrops)
+                                    .arg(StatsPoller::drops(total, "relay"))
+                                    .arg(total.value("enobufs")));
+    } else {
+        m_summaryLabel->setText(tr("No relay drops. Network: %1 buffer exhaustions.")
+                                    .arg(total.value("enobufs")));
+    }
+}
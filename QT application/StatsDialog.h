@@ -0,0 +1,46 @@
+#ifndef STATSDIALOG_H
+#define STATSDIALOG_H
+
+#include <QDialog>
+#include <QList>
+#include "StatsPoller.h"
+
+QT_BEGIN_NAMESPACE
+class QLabel;
+class QPushButton;
+class QSpinBox;
+class QTableWidget;
+QT_END_NAMESPACE
+
+// Per-node and network-wide mesh statistics. Nodes that drop relayed
+// messages or run out of advertising buffers are highlighted.
+class StatsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit StatsDialog(StatsPoller *poller, QWidget *parent = nullptr);
+
+    void setNodes(const QList<quint16> &nodes);
+
+private slots:
+    void onStartClicked();
+    void onResetClicked();
+
+private:
+    void updateRow(int row, const QString &name, const StatsPoller::Counters &counters,
+                   const QString &replies);
+    void updateNode(quint16 address);
+    void updateTotal();
+
+    StatsPoller *m_poller;
+    QList<quint16> m_nodes;
+
+    QSpinBox *m_periodSpinBox;
+    QPushButton *m_startButton;
+    QPushButton *m_resetButton;
+    QTableWidget *m_statsTable;
+    QLabel *m_summaryLabel;
+};
+
+#endif // STATSDIALOG_H
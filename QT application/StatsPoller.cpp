@@ -0,0 +1,115 @@
+#include "StatsPoller.h"
+
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+
+// Keep at least this much time between two requests on the mesh.
+static const int MinRequestSpacingMs = 250;
+
+StatsPoller::StatsPoller(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_timer, &QTimer::timeout, this, &StatsPoller::pollNext);
+}
+
+void StatsPoller::start(const QList<quint16> &nodes, int periodMs)
+{
+    if (nodes.isEmpty()) {
+        return;
+    }
+
+    m_nodes = nodes;
+    m_next = 0;
+    if (!m_elapsed.isValid()) {
+        m_elapsed.start();
+    }
+
+    m_timer.start(qMax(periodMs / int(nodes.size()), MinRequestSpacingMs));
+    pollNext();
+}
+
+void StatsPoller::stop()
+{
+    m_timer.stop();
+}
+
+bool StatsPoller::isRunning() const
+{
+    return m_timer.isActive();
+}
+
+void StatsPoller::clear()
+{
+    m_stats.clear();
+    m_elapsed.invalidate();
+}
+
+QList<quint16> StatsPoller::nodes() const
+{
+    return m_nodes;
+}
+
+StatsPoller::NodeStats StatsPoller::node(quint16 address) const
+{
+    return m_stats.value(address);
+}
+
+StatsPoller::Counters StatsPoller::networkTotal() const
+{
+    Counters total;
+    for (const NodeStats &stats : m_stats) {
+        for (auto it = stats.total.cbegin(); it != stats.total.cend(); ++it) {
+            total[it.key()] += it.value();
+        }
+    }
+    return total;
+}
+
+// Messages a node planned to send on a path ("relay", "local", "friend")
+// but did not get on air.
+quint64 StatsPoller::drops(const Counters &counters, const QString &path)
+{
+    quint64 planned = counters.value(path + "_planned");
+    quint64 succeeded = counters.value(path + "_succeeded");
+    return planned > succeeded ? planned - succeeded : 0;
+}
+
+void StatsPoller::pollNext()
+{
+    if (m_nodes.isEmpty()) {
+        return;
+    }
+
+    quint16 address = m_nodes.at(m_next);
+    m_next = (m_next + 1) % m_nodes.size();
+
+    m_stats[address].requests++;
+    emit sendCommand(QString("stats 0x%1 1\n").arg(address, 4, 16, QChar('0')));
+}
+
+void StatsPoller::handleLine(const QString &line)
+{
+    static const QRegularExpression statsRegex(R"(^STATS (0x[0-9a-fA-F]+)((?: \w+=\d+)+))");
+    static const QRegularExpression counterRegex(R"((\w+)=(\d+))");
+
+    QRegularExpressionMatch match = statsRegex.match(line);
+    if (!match.hasMatch()) {
+        return;
+    }
+
+    quint16 address = match.captured(1).toUShort(nullptr, 16);
+    NodeStats &stats = m_stats[address];
+
+    stats.last.clear();
+    auto counters = counterRegex.globalMatch(match.captured(2));
+    while (counters.hasNext()) {
+        QRegularExpressionMatch counter = counters.next();
+        quint64 value = counter.captured(2).toULongLong();
+        stats.last[counter.captured(1)] = value;
+        stats.total[counter.captured(1)] += value;
+    }
+
+    stats.replies++;
+    stats.lastReplyMs = m_elapsed.isValid() ? m_elapsed.elapsed() : 0;
+    emit nodeUpdated(address);
+}
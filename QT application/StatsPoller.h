@@ -0,0 +1,63 @@
+#ifndef STATSPOLLER_H
+#define STATSPOLLER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QTimer>
+
+// Network-wide collection of the nodes' mesh statistics through the
+// vendor diagnostics model ("stats <addr> 1" on the dongle).
+//
+// One node is asked per tick so the requests are spread over the poll
+// period instead of bursting; every request resets the node's counters
+// and the replies are accumulated here per node and for the network.
+class StatsPoller : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Counter name as reported by the firmware ("relay_planned", ...) to value
+    using Counters = QMap<QString, quint64>;
+
+    struct NodeStats {
+        Counters total;
+        Counters last;              // counts since the previous reply
+        int requests = 0;
+        int replies = 0;
+        qint64 lastReplyMs = -1;    // since start
+    };
+
+    explicit StatsPoller(QObject *parent = nullptr);
+
+    void start(const QList<quint16> &nodes, int periodMs);
+    void stop();
+    bool isRunning() const;
+    void clear();
+
+    QList<quint16> nodes() const;
+    NodeStats node(quint16 address) const;
+    Counters networkTotal() const;
+
+    static quint64 drops(const Counters &counters, const QString &path);
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+
+signals:
+    void sendCommand(const QString &command);
+    void nodeUpdated(quint16 address);
+
+private:
+    void pollNext();
+
+    QList<quint16> m_nodes;
+    QMap<quint16, NodeStats> m_stats;
+    int m_next = 0;
+    QTimer m_timer;
+    QElapsedTimer m_elapsed;
+};
+
+#endif // STATSPOLLER_H
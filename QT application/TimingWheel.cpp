@@ -0,0 +1,146 @@
+#include "TimingWheel.h"
+
+#include <QCoreApplication>
+
+// Request timeouts are seconds, so 50 ms is plenty of resolution.
+// Four levels of 64 slots then reach about nine days.
+static const int SharedTickMs = 50;
+
+TimingWheel::TimingWheel(int tickMs, QObject *parent)
+    : QObject(parent),
+      m_tickMs(qMax(tickMs, 1)),
+      m_slots(Levels * SlotsPerLevel)
+{
+    m_clock.start();
+    connect(&m_timer, &QTimer::timeout, this, &TimingWheel::tick);
+}
+
+TimingWheel *TimingWheel::shared()
+{
+    static TimingWheel *wheel = new TimingWheel(SharedTickMs, QCoreApplication::instance());
+    return wheel;
+}
+
+quint64 TimingWheel::schedule(qint64 delayMs, Callback callback)
+{
+    qint64 nowMs = m_clock.elapsed();
+
+    // Nothing is waiting, so the idle time need not be stepped through
+    if (m_entries.isEmpty()) {
+        m_now = quint64(nowMs / m_tickMs);
+    }
+
+    // The tick that starts at or after the deadline, counted from the
+    // clock rather than m_now, which lags when the event loop is late.
+    // Beyond the reach of the top level the deadline is clamped.
+    static const quint64 Reach = (quint64(1) << (SlotBits * Levels)) - 1;
+    quint64 deadline = quint64((nowMs + qMax<qint64>(delayMs, 0) + m_tickMs - 1) / m_tickMs);
+    deadline = qBound(m_now + 1, deadline, m_now + Reach);
+
+    quint64 handle = m_nextHandle++;
+    Entry &entry = m_entries[handle];
+    entry.deadline = deadline;
+    entry.callback = std::move(callback);
+    place(handle, entry);
+
+    if (!m_timer.isActive()) {
+        m_timer.start(m_tickMs);
+    }
+    return handle;
+}
+
+void TimingWheel::cancel(quint64 handle)
+{
+    auto it = m_entries.find(handle);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    m_slots[it->slot].remove(handle);
+    m_entries.erase(it);
+
+    if (m_entries.isEmpty()) {
+        m_timer.stop();
+    }
+}
+
+bool TimingWheel::contains(quint64 handle) const
+{
+    return m_entries.contains(handle);
+}
+
+int TimingWheel::size() const
+{
+    return m_entries.size();
+}
+
+int TimingWheel::tickMs() const
+{
+    return m_tickMs;
+}
+
+void TimingWheel::place(quint64 handle, Entry &entry)
+{
+    // The lowest level whose revolution still reaches the deadline. An
+    // entry that is already due goes to the current level 0 slot.
+    quint64 delta = entry.deadline > m_now ? entry.deadline - m_now : 0;
+    int level = 0;
+    while (level < Levels - 1 && delta >= (quint64(1) << (SlotBits * (level + 1)))) {
+        level++;
+    }
+
+    int index = int((qMax(entry.deadline, m_now) >> (SlotBits * level)) & (SlotsPerLevel - 1));
+    entry.slot = level * SlotsPerLevel + index;
+    m_slots[entry.slot].insert(handle);
+}
+
+void TimingWheel::cascade(int level)
+{
+    int index = int((m_now >> (SlotBits * level)) & (SlotsPerLevel - 1));
+    QSet<quint64> handles;
+    handles.swap(m_slots[level * SlotsPerLevel + index]);
+
+    for (quint64 handle : std::as_const(handles)) {
+        place(handle, m_entries[handle]);
+    }
+}
+
+void TimingWheel::advance()
+{
+    m_now++;
+
+    // Each level wraps once per revolution of the level above it
+    for (int level = 1; level < Levels; level++) {
+        if (m_now & ((quint64(1) << (SlotBits * level)) - 1)) {
+            break;
+        }
+        cascade(level);
+    }
+
+    QSet<quint64> due;
+    due.swap(m_slots[int(m_now & (SlotsPerLevel - 1))]);
+
+    // A callback may cancel or schedule others, so look each one up again
+    for (quint64 handle : std::as_const(due)) {
+        auto it = m_entries.find(handle);
+        if (it == m_entries.end()) {
+            continue;
+        }
+        Callback callback = std::move(it->callback);
+        m_entries.erase(it);
+        callback();
+    }
+}
+
+void TimingWheel::tick()
+{
+    // Catch up when the event loop delivered the tick late
+    quint64 target = quint64(m_clock.elapsed() / m_tickMs);
+    while (m_now < target && !m_entries.isEmpty()) {
+        advance();
+    }
+
+    if (m_entries.isEmpty()) {
+        m_timer.stop();
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+// Deadlines for any number of outstanding requests on one timer tick.
+// Scheduling and cancelling are O(1) whatever the number of deadlines.
+//
+// The wheel is hierarchical: level 0 has one slot per tick, and each
+// higher level has slots as wide as a whole revolution of the level
+// below. A deadline goes to the lowest level that reaches it. When a
+// lower level wraps around, the entries of the next slot above cascade
+// down. A tick therefore only touches deadlines that are due or about to
+// become due, and never walks the far ones.
+//
+// Expiry is accurate to one tick, and a deadline never expires early.
+class TimingWheel : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void()>;
+
+    explicit TimingWheel(int tickMs, QObject *parent = nullptr);
+
+    // The wheel every request deadline of the application runs on. It is
+    // owned by the application object.
+    static TimingWheel *shared();
+
+    // Runs callback once, delayMs from now. Returns a handle for cancel();
+    // handles are never reused.
+    quint64 schedule(qint64 delayMs, Callback callback);
+    void cancel(quint64 handle);
+    bool contains(quint64 handle) const;
+    int size() const;
+    int tickMs() const;
+
+private:
+    static const int Levels = 4;
+    static const int SlotBits = 6;
+    static const int SlotsPerLevel = 1 << SlotBits;
+
+    struct Entry {
+        quint64 deadline = 0;       // in ticks
+        int slot = 0;               // level * SlotsPerLevel + index
+        Callback callback;
+    };
+
+    void place(quint64 handle, Entry &entry);
+    void cascade(int level);
+    void advance();
+    void tick();
+
+    int m_tickMs;
+    quint64 m_now = 0;              // ticks processed so far
+    quint64 m_nextHandle = 1;
+    QVector<QSet<quint64>> m_slots;
+    QHash<quint64, Entry> m_entries;
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+};
+
+#endif // TIMINGWHEEL_H
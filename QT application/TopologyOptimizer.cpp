@@ -0,0 +1,242 @@
+#include "TopologyOptimizer.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+
+// The dongle's own address; it hears the one-hop Beats itself.
+static const quint16 ProvisionerAddress = 0x0001;
+
+// Weaker links are too lossy to count as neighbors.
+static const int MinLinkRssi = -90;
+
+// Hello window on the nodes, then one neighbor table request per step.
+static const int HelloSpreadMs = 2000;
+static const int RequestSpacingMs = 400;
+static const int ReplyWaitMs = 3000;
+
+// Relay parameters restored on the relay set and after a rollback.
+static const int RelayCount = 2;
+static const int RelayIntervalMs = 20;
+
+// Delivery may drop this much (ratio) before pruning is rolled back.
+static const double DeliveryTolerance = 0.02;
+
+TopologyOptimizer::TopologyOptimizer(TransportTuner *tuner, HeartbeatTracker *heartbeats, QObject *parent)
+    : QObject(parent),
+      m_tuner(tuner),
+      m_heartbeats(heartbeats)
+{
+    connect(&m_timer, &RequestTimer::timeout, this, &TopologyOptimizer::requestNext);
+    connect(m_tuner, &TransportTuner::tuned, this, &TopologyOptimizer::onTuned);
+}
+
+bool TopologyOptimizer::isBusy() const
+{
+    return m_discovering || m_applying;
+}
+
+QHash<quint16, QHash<quint16, int>> TopologyOptimizer::graph() const
+{
+    return m_graph;
+}
+
+QSet<quint16> TopologyOptimizer::relays() const
+{
+    return m_relays;
+}
+
+QSet<quint16> TopologyOptimizer::pruned() const
+{
+    return m_pruned;
+}
+
+bool TopologyOptimizer::discover(const QList<quint16> &nodes)
+{
+    if (isBusy() || nodes.isEmpty()) {
+        return false;
+    }
+
+    m_nodes = nodes;
+    m_pending = nodes;
+    m_answered.clear();
+    m_graph.clear();
+    m_relays.clear();
+    m_pruned.clear();
+    m_discovering = true;
+
+    const QString command = QString("nbr hello %1\n").arg(HelloSpreadMs);
+    m_timer.startOnDispatch(command, HelloSpreadMs + ReplyWaitMs);
+    emit sendCommand(command);
+    return true;
+}
+
+void TopologyOptimizer::requestNext()
+{
+    if (!m_pending.isEmpty()) {
+        quint16 address = m_pending.takeFirst();
+        const QString command = QString("nbr get 0x%1\n").arg(address, 4, 16, QChar('0'));
+        m_timer.startOnDispatch(command, m_pending.isEmpty() ? ReplyWaitMs : RequestSpacingMs);
+        emit sendCommand(command);
+        return;
+    }
+
+    // The dongle hears one-hop Beats directly
+    for (quint16 address : std::as_const(m_nodes)) {
+        HeartbeatTracker::NodeLiveness beat = m_heartbeats->node(address);
+        if (address != ProvisionerAddress && beat.beats && beat.minHops == 1) {
+            addLink(ProvisionerAddress, address, beat.rssi);
+        }
+    }
+
+    m_discovering = false;
+    computeRelays();
+
+    int links = 0;
+    for (const auto &neighbors : std::as_const(m_graph)) {
+        links += neighbors.size();
+    }
+    emit discovered(m_graph.size(), links / 2);
+}
+
+void TopologyOptimizer::addLink(quint16 a, quint16 b, int rssi)
+{
+    if (a == b || rssi < MinLinkRssi) {
+        return;
+    }
+
+    // Undirected; keep the better direction's RSSI
+    int best = qMax(rssi, m_graph[a].value(b, rssi));
+    m_graph[a][b] = best;
+    m_graph[b][a] = best;
+}
+
+// Greedy connected dominating set (Guha & Khuller): start at the node
+// with most neighbors, then keep promoting the covered node that covers
+// the most uncovered nodes. Each promoted node is next to a relay, so the
+// relays stay connected. Repeated per connected component.
+void TopologyOptimizer::computeRelays()
+{
+    QSet<quint16> uncovered;
+    for (auto it = m_graph.cbegin(); it != m_graph.cend(); ++it) {
+        uncovered.insert(it.key());
+    }
+
+    QSet<quint16> covered;
+
+    auto promote = [&](quint16 node) {
+        m_relays.insert(node);
+        covered.remove(node);
+        uncovered.remove(node);
+        for (auto it = m_graph[node].cbegin(); it != m_graph[node].cend(); ++it) {
+            if (uncovered.remove(it.key())) {
+                covered.insert(it.key());
+            }
+        }
+    };
+
+    auto gain = [&](quint16 node) {
+        int count = 0;
+        for (auto it = m_graph[node].cbegin(); it != m_graph[node].cend(); ++it) {
+            count += uncovered.contains(it.key());
+        }
+        return count;
+    };
+
+    while (!uncovered.isEmpty()) {
+        // Seed of a new component
+        quint16 seed = *uncovered.cbegin();
+        for (quint16 node : std::as_const(uncovered)) {
+            if (m_graph[node].size() > m_graph[seed].size()) {
+                seed = node;
+            }
+        }
+        promote(seed);
+
+        for (;;) {
+            quint16 best = 0;
+            int bestGain = 0;
+            for (quint16 node : std::as_const(covered)) {
+                int nodeGain = gain(node);
+                if (nodeGain > bestGain) {
+                    best = node;
+                    bestGain = nodeGain;
+                }
+            }
+            if (bestGain == 0) {
+                break;
+            }
+            promote(best);
+        }
+    }
+
+    // Only nodes whose own table came back are pruned; a node with
+    // unknown neighbors keeps relaying.
+    for (quint16 address : std::as_const(m_nodes)) {
+        if (m_graph.contains(address) && !m_relays.contains(address) && m_answered.contains(address)) {
+            m_pruned.insert(address);
+        }
+    }
+}
+
+bool TopologyOptimizer::apply(int rounds, int intervalMs)
+{
+    if (isBusy() || m_pruned.isEmpty()) {
+        return false;
+    }
+
+    QList<quint16> pruned(m_pruned.cbegin(), m_pruned.cend());
+    QList<quint16> relays(m_relays.cbegin(), m_relays.cend());
+
+    m_applying = m_tuner->tune([this, pruned, relays]() {
+        m_tuner->setRelay(relays, true, RelayCount, RelayIntervalMs);
+        m_tuner->setRelay(pruned, false, RelayCount, RelayIntervalMs);
+    }, m_nodes, rounds, intervalMs);
+
+    return m_applying;
+}
+
+void TopologyOptimizer::onTuned(const TransportTuner::Measurement &before, const TransportTuner::Measurement &after)
+{
+    if (!m_applying) {
+        return;
+    }
+    m_applying = false;
+
+    bool rollBack = after.deliveryRatio() + DeliveryTolerance < before.deliveryRatio();
+    if (rollBack) {
+        qDebug() << "Relay pruning lowered delivery, enabling relays again";
+        m_tuner->setRelay(QList<quint16>(m_pruned.cbegin(), m_pruned.cend()), true, RelayCount, RelayIntervalMs);
+    }
+
+    emit applied(before, after, rollBack);
+}
+
+void TopologyOptimizer::commandDispatched(const QString &command)
+{
+    m_timer.dispatched(command);
+}
+
+void TopologyOptimizer::handleLine(const QString &line)
+{
+    static const QRegularExpression tableRegex(R"(^NBR (0x[0-9a-fA-F]+) round \d+(.*)$)");
+    static const QRegularExpression entryRegex(R"((0x[0-9a-fA-F]+):(-?\d+):(\d+))");
+
+    if (!m_discovering) {
+        return;
+    }
+
+    QRegularExpressionMatch match = tableRegex.match(line);
+    if (!match.hasMatch()) {
+        return;
+    }
+
+    quint16 address = match.captured(1).toUShort(nullptr, 16);
+    m_answered.insert(address);
+
+    auto entries = entryRegex.globalMatch(match.captured(2));
+    while (entries.hasNext()) {
+        QRegularExpressionMatch entry = entries.next();
+        addLink(address, entry.captured(1).toUShort(nullptr, 16), entry.captured(2).toInt());
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef TOPOLOGYOPTIMIZER_H
+#define TOPOLOGYOPTIMIZER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include "RequestTimer.h"
+#include "HeartbeatTracker.h"
+#include "TransportTuner.h"
+
+// Relay pruning. Every node relays by default, so each message is
+// rebroadcast by every node that hears it. This builds the neighbor graph
+// from single-hop Hellos ("nbr" commands, RSSI measured by the receiving
+// node) and the one-hop Beats heard by the dongle. It then picks a small
+// connected dominating set as the relays: every node is a relay or next
+// to one, and the relays stay connected. Relay is disabled on the other
+// nodes, and delivery is measured before and after. If delivery gets
+// worse, relaying is enabled on them again.
+class TopologyOptimizer : public QObject
+{
+    Q_OBJECT
+
+public:
+    TopologyOptimizer(TransportTuner *tuner, HeartbeatTracker *heartbeats, QObject *parent = nullptr);
+
+    bool discover(const QList<quint16> &nodes);
+    bool apply(int rounds, int intervalMs);
+    bool isBusy() const;
+
+    QHash<quint16, QHash<quint16, int>> graph() const;    // node -> neighbor -> RSSI
+    QSet<quint16> relays() const;
+    QSet<quint16> pruned() const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void discovered(int nodes, int links);
+    void applied(const TransportTuner::Measurement &before,
+                 const TransportTuner::Measurement &after, bool rolledBack);
+
+private:
+    void addLink(quint16 a, quint16 b, int rssi);
+    void requestNext();
+    void computeRelays();
+    void onTuned(const TransportTuner::Measurement &before, const TransportTuner::Measurement &after);
+
+    TransportTuner *m_tuner;
+    HeartbeatTracker *m_heartbeats;
+
+    QList<quint16> m_nodes;
+    QList<quint16> m_pending;
+    QSet<quint16> m_answered;
+    QHash<quint16, QHash<quint16, int>> m_graph;
+    QSet<quint16> m_relays;
+    QSet<quint16> m_pruned;
+    bool m_discovering = false;
+    bool m_applying = false;
+    RequestTimer m_timer;
+};
+
+#endif // TOPOLOGYOPTIMIZER_H
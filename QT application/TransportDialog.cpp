@@ -0,0 +1,228 @@
+#include "TransportDialog.h"
+
+#include <QCheckBox>
+#include <QGridLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QTextEdit>
+
+enum Column {
+    ColumnNode,
+    ColumnNetTransmit,
+    ColumnRelay,
+    ColumnSarTx,
+    ColumnSarRx,
+    ColumnDelivery,
+    ColumnRtt,
+    ColumnCount,
+};
+
+static QString transmitText(int count, int intervalMs)
+{
+    if (count < 0) {
+        return QString("?");
+    }
+    return QString("%1 x %2 ms").arg(count + 1).arg(intervalMs);
+}
+
+TransportDialog::TransportDialog(TransportTuner *tuner, QWidget *parent) :
+    QDialog(parent),
+    m_tuner(tuner),
+    m_netCountSpinBox(new QSpinBox),
+    m_netIntervalSpinBox(new QSpinBox),
+    m_relayCheckBox(new QCheckBox(tr("Relay"))),
+    m_relayCountSpinBox(new QSpinBox),
+    m_relayIntervalSpinBox(new QSpinBox),
+    m_sarTxLineEdit(new QLineEdit),
+    m_sarRxLineEdit(new QLineEdit),
+    m_roundsSpinBox(new QSpinBox),
+    m_probeIntervalSpinBox(new QSpinBox),
+    m_readButton(new QPushButton(tr("Read"))),
+    m_measureButton(new QPushButton(tr("Measure"))),
+    m_applyButton(new QPushButton(tr("Apply and compare"))),
+    m_nodeTable(new QTableWidget(0, ColumnCount)),
+    m_logTextBox(new QTextEdit)
+{
+    TransportTuner::Params defaults;
+
+    // Count is the number of retransmissions, the interval is in 10 ms steps
+    for (QSpinBox *count : {m_netCountSpinBox, m_relayCountSpinBox}) {
+        count->setRange(0, 7);
+    }
+    for (QSpinBox *interval : {m_netIntervalSpinBox, m_relayIntervalSpinBox}) {
+        interval->setRange(10, 320);
+        interval->setSingleStep(10);
+        interval->setSuffix(tr(" ms"));
+    }
+    m_netCountSpinBox->setValue(defaults.netCount);
+    m_netIntervalSpinBox->setValue(defaults.netIntervalMs);
+    m_relayCheckBox->setChecked(defaults.relay);
+    m_relayCountSpinBox->setValue(defaults.relayCount);
+    m_relayIntervalSpinBox->setValue(defaults.relayIntervalMs);
+
+    m_sarTxLineEdit->setPlaceholderText(tr("unchanged (7 values, e.g. 1,7,2,7,1,1,3)"));
+    m_sarRxLineEdit->setPlaceholderText(tr("unchanged (5 values, e.g. 3,1,1,1,0)"));
+
+    m_roundsSpinBox->setRange(1, 200);
+    m_roundsSpinBox->setValue(20);
+    m_probeIntervalSpinBox->setRange(50, 10000);
+    m_probeIntervalSpinBox->setSingleStep(50);
+    m_probeIntervalSpinBox->setValue(500);
+    m_probeIntervalSpinBox->setSuffix(tr(" ms"));
+
+    m_nodeTable->setHorizontalHeaderLabels({tr("Node"), tr("Net transmit"), tr("Relay"),
+                                            tr("SAR TX"), tr("SAR RX"), tr("Delivery"), tr("RTT avg/max")});
+    m_nodeTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_nodeTable->verticalHeader()->hide();
+    m_nodeTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_logTextBox->setReadOnly(true);
+
+    auto layout = new QGridLayout;
+    layout->addWidget(new QLabel(tr("Network transmit:")), 0, 0);
+    layout->addWidget(m_netCountSpinBox, 0, 1);
+    layout->addWidget(m_netIntervalSpinBox, 0, 2);
+    layout->addWidget(m_relayCheckBox, 1, 0);
+    layout->addWidget(m_relayCountSpinBox, 1, 1);
+    layout->addWidget(m_relayIntervalSpinBox, 1, 2);
+    layout->addWidget(new QLabel(tr("SAR transmitter:")), 2, 0);
+    layout->addWidget(m_sarTxLineEdit, 2, 1, 1, 2);
+    layout->addWidget(new QLabel(tr("SAR receiver:")), 3, 0);
+    layout->addWidget(m_sarRxLineEdit, 3, 1, 1, 2);
+    layout->addWidget(new QLabel(tr("Probe rounds / interval:")), 4, 0);
+    layout->addWidget(m_roundsSpinBox, 4, 1);
+    layout->addWidget(m_probeIntervalSpinBox, 4, 2);
+    layout->addWidget(m_readButton, 0, 3);
+    layout->addWidget(m_measureButton, 1, 3);
+    layout->addWidget(m_applyButton, 2, 3);
+    layout->addWidget(m_nodeTable, 5, 0, 1, 4);
+    layout->addWidget(new QLabel(tr("Measurements:")), 6, 0, 1, 4);
+    layout->addWidget(m_logTextBox, 7, 0, 1, 4);
+
+    setLayout(layout);
+    setWindowTitle(tr("Transport tuning"));
+
+    connect(m_readButton, &QPushButton::clicked, this, &TransportDialog::onReadClicked);
+    connect(m_measureButton, &QPushButton::clicked, this, &TransportDialog::onMeasureClicked);
+    connect(m_applyButton, &QPushButton::clicked, this, &TransportDialog::onApplyClicked);
+
+    connect(m_tuner, &TransportTuner::stateChanged, this, &TransportDialog::updateState);
+    connect(m_tuner, &TransportTuner::measured, this, &TransportDialog::showMeasurement);
+    connect(m_tuner, &TransportTuner::tuned, this,
+            [this](const TransportTuner::Measurement &before, const TransportTuner::Measurement &after) {
+        m_logTextBox->append(tr("Before: %1").arg(summary(before)));
+        m_logTextBox->append(tr("After:  %1").arg(summary(after)));
+        m_logTextBox->append(QString());
+    });
+}
+
+void TransportDialog::setNodes(const QList<quint16> &nodes)
+{
+    m_nodes = nodes;
+
+    m_nodeTable->setRowCount(nodes.size());
+    for (int row = 0; row < nodes.size(); row++) {
+        m_nodeTable->setItem(row, ColumnNode,
+                             new QTableWidgetItem(QString("0x%1").arg(nodes[row], 4, 16, QChar('0'))));
+        updateState(nodes[row]);
+    }
+}
+
+TransportTuner::Params TransportDialog::params() const
+{
+    TransportTuner::Params params;
+    params.netCount = m_netCountSpinBox->value();
+    params.netIntervalMs = m_netIntervalSpinBox->value() / 10 * 10;
+    params.relay = m_relayCheckBox->isChecked();
+    params.relayCount = m_relayCountSpinBox->value();
+    params.relayIntervalMs = m_relayIntervalSpinBox->value() / 10 * 10;
+    params.sarTx = m_sarTxLineEdit->text().remove(' ');
+    params.sarRx = m_sarRxLineEdit->text().remove(' ');
+    return params;
+}
+
+int TransportDialog::rowFor(quint16 address) const
+{
+    return m_nodes.indexOf(address);
+}
+
+void TransportDialog::onReadClicked()
+{
+    m_tuner->readState(m_nodes);
+}
+
+void TransportDialog::onMeasureClicked()
+{
+    if (!m_tuner->measure(m_nodes, m_roundsSpinBox->value(), m_probeIntervalSpinBox->value())) {
+        m_logTextBox->append(tr("Tuner busy or no nodes."));
+    }
+}
+
+void TransportDialog::onApplyClicked()
+{
+    TransportTuner::Params newParams = params();
+
+    if (!m_tuner->tune(newParams, m_nodes, m_roundsSpinBox->value(), m_probeIntervalSpinBox->value())) {
+        m_logTextBox->append(tr("Tuner busy or no nodes."));
+        return;
+    }
+
+    m_logTextBox->append(tr("Applying net %1, relay %2 %3, SAR TX %4, SAR RX %5")
+                             .arg(transmitText(newParams.netCount, newParams.netIntervalMs))
+                             .arg(newParams.relay ? tr("on") : tr("off"))
+                             .arg(transmitText(newParams.relayCount, newParams.relayIntervalMs))
+                             .arg(newParams.sarTx.isEmpty() ? tr("unchanged") : newParams.sarTx)
+                             .arg(newParams.sarRx.isEmpty() ? tr("unchanged") : newParams.sarRx));
+}
+
+void TransportDialog::updateState(quint16 address)
+{
+    int row = rowFor(address);
+    if (row < 0) {
+        return;
+    }
+
+    TransportTuner::NodeState state = m_tuner->state(address);
+    QString relay = state.relay < 0 ? QString("?")
+                                    : QString("%1, %2").arg(state.relay == 1 ? tr("on") : tr("off"),
+                                                            transmitText(state.relayCount, state.relayIntervalMs));
+
+    m_nodeTable->setItem(row, ColumnNetTransmit, new QTableWidgetItem(transmitText(state.netCount, state.netIntervalMs)));
+    m_nodeTable->setItem(row, ColumnRelay, new QTableWidgetItem(relay));
+    m_nodeTable->setItem(row, ColumnSarTx, new QTableWidgetItem(state.sarTx.isEmpty() ? QString("?") : state.sarTx));
+    m_nodeTable->setItem(row, ColumnSarRx, new QTableWidgetItem(state.sarRx.isEmpty() ? QString("?") : state.sarRx));
+}
+
+void TransportDialog::showMeasurement(const TransportTuner::Measurement &measurement)
+{
+    for (auto it = measurement.links.cbegin(); it != measurement.links.cend(); ++it) {
+        int row = rowFor(it.key());
+        if (row < 0) {
+            continue;
+        }
+
+        const TransportTuner::Link &link = it.value();
+        double ratio = link.sent ? 100.0 * link.received / link.sent : 0.0;
+        m_nodeTable->setItem(row, ColumnDelivery,
+                             new QTableWidgetItem(QString("%1/%2 (%3%)")
+                                                      .arg(link.received).arg(link.sent)
+                                                      .arg(ratio, 0, 'f', 1)));
+        m_nodeTable->setItem(row, ColumnRtt,
+                             new QTableWidgetItem(QString("%1/%2 ms").arg(link.avgRttMs).arg(link.maxRttMs)));
+    }
+
+    m_logTextBox->append(tr("Measured: %1").arg(summary(measurement)));
+}
+
+QString TransportDialog::summary(const TransportTuner::Measurement &measurement) const
+{
+    return tr("%1/%2 delivered (%3%), RTT avg %4 ms, max %5 ms")
+        .arg(measurement.received())
+        .arg(measurement.sent())
+        .arg(measurement.deliveryRatio() * 100.0, 0, 'f', 1)
+        .arg(measurement.avgRttMs(), 0, 'f', 0)
+        .arg(measurement.maxRttMs());
+}
@@ -0,0 +1,60 @@
+#ifndef TRANSPORTDIALOG_H
+#define TRANSPORTDIALOG_H
+
+#include <QDialog>
+#include <QList>
+#include "TransportTuner.h"
+
+QT_BEGIN_NAMESPACE
+class QCheckBox;
+class QLineEdit;
+class QPushButton;
+class QSpinBox;
+class QTableWidget;
+class QTextEdit;
+QT_END_NAMESPACE
+
+// Field tuning of Network Transmit, Relay and SAR parameters on the
+// provisioned nodes, with a delivery/latency measurement before and
+// after every change.
+class TransportDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit TransportDialog(TransportTuner *tuner, QWidget *parent = nullptr);
+
+    void setNodes(const QList<quint16> &nodes);
+
+private slots:
+    void onReadClicked();
+    void onMeasureClicked();
+    void onApplyClicked();
+
+private:
+    TransportTuner::Params params() const;
+    int rowFor(quint16 address) const;
+    void updateState(quint16 address);
+    void showMeasurement(const TransportTuner::Measurement &measurement);
+    QString summary(const TransportTuner::Measurement &measurement) const;
+
+    TransportTuner *m_tuner;
+    QList<quint16> m_nodes;
+
+    QSpinBox *m_netCountSpinBox;
+    QSpinBox *m_netIntervalSpinBox;
+    QCheckBox *m_relayCheckBox;
+    QSpinBox *m_relayCountSpinBox;
+    QSpinBox *m_relayIntervalSpinBox;
+    QLineEdit *m_sarTxLineEdit;
+    QLineEdit *m_sarRxLineEdit;
+    QSpinBox *m_roundsSpinBox;
+    QSpinBox *m_probeIntervalSpinBox;
+    QPushButton *m_readButton;
+    QPushButton *m_measureButton;
+    QPushButton *m_applyButton;
+    QTableWidget *m_nodeTable;
+    QTextEdit *m_logTextBox;
+};
+
+#endif // TRANSPORTDIALOG_H
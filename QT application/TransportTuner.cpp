@@ -0,0 +1,304 @@
+#include "TransportTuner.h"
+
+#include <QDebug>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+#include <QStringList>
+
+// SHELL_CMD_BUFF_SIZE is 128 in prj.conf; twelve addresses keep the
+// longest txp command (sar-tx) below it.
+static const int MaxNodesPerCommand = 12;
+
+// SAR states are exchanged one node at a time, each with its own timeout.
+static const int TxpTimeoutPerNodeMs = 5000;
+
+// Time for the new parameters to take effect before measuring again.
+static const int SettleMs = 2000;
+
+static QString addressList(const QList<quint16> &nodes)
+{
+    QStringList addresses;
+    for (quint16 address : nodes) {
+        addresses << QString("0x%1").arg(address, 4, 16, QChar('0'));
+    }
+    return addresses.join(' ');
+}
+
+int TransportTuner::Measurement::sent() const
+{
+    int total = 0;
+    for (const Link &link : links) {
+        total += link.sent;
+    }
+    return total;
+}
+
+int TransportTuner::Measurement::received() const
+{
+    int total = 0;
+    for (const Link &link : links) {
+        total += link.received;
+    }
+    return total;
+}
+
+double TransportTuner::Measurement::deliveryRatio() const
+{
+    return sent() ? double(received()) / sent() : 0.0;
+}
+
+double TransportTuner::Measurement::avgRttMs() const
+{
+    // Weighted by the replies each node returned
+    double sum = 0.0;
+    for (const Link &link : links) {
+        sum += double(link.avgRttMs) * link.received;
+    }
+    return received() ? sum / received() : 0.0;
+}
+
+int TransportTuner::Measurement::maxRttMs() const
+{
+    int max = 0;
+    for (const Link &link : links) {
+        max = qMax(max, link.maxRttMs);
+    }
+    return max;
+}
+
+TransportTuner::TransportTuner(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_commandTimer, &RequestTimer::timeout, this, [this]() {
+        qDebug() << "No completion for" << m_current.command.trimmed();
+        completeCurrent();
+    });
+    connect(&m_settleTimer, &RequestTimer::timeout, this, [this]() {
+        m_phase = After;
+        enqueueProbe(m_nodes);
+    });
+}
+
+bool TransportTuner::isBusy() const
+{
+    return m_phase != Idle || m_waiting || !m_queue.isEmpty();
+}
+
+TransportTuner::NodeState TransportTuner::state(quint16 address) const
+{
+    return m_states.value(address);
+}
+
+void TransportTuner::readState(const QList<quint16> &nodes)
+{
+    enqueuePerChunk("txp get", nodes);
+}
+
+void TransportTuner::apply(const Params &params, const QList<quint16> &nodes)
+{
+    enqueuePerChunk(QString("txp net %1 %2").arg(params.netCount).arg(params.netIntervalMs), nodes);
+    setRelay(nodes, params.relay, params.relayCount, params.relayIntervalMs);
+    if (!params.sarTx.isEmpty()) {
+        enqueuePerChunk(QString("txp sar-tx %1").arg(params.sarTx), nodes);
+    }
+    if (!params.sarRx.isEmpty()) {
+        enqueuePerChunk(QString("txp sar-rx %1").arg(params.sarRx), nodes);
+    }
+
+    // Read back what the nodes actually accepted
+    readState(nodes);
+}
+
+void TransportTuner::setRelay(const QList<quint16> &nodes, bool enabled, int count, int intervalMs)
+{
+    enqueuePerChunk(QString("txp relay %1 %2 %3").arg(enabled ? 1 : 0).arg(count).arg(intervalMs), nodes);
+}
+
+bool TransportTuner::measure(const QList<quint16> &nodes, int rounds, int intervalMs)
+{
+    if (isBusy() || nodes.isEmpty()) {
+        return false;
+    }
+
+    m_phase = Measuring;
+    m_rounds = rounds;
+    m_intervalMs = intervalMs;
+    enqueueProbe(nodes);
+    return true;
+}
+
+bool TransportTuner::tune(const Params &params, const QList<quint16> &nodes, int rounds, int intervalMs)
+{
+    return tune([this, params, nodes]() { apply(params, nodes); }, nodes, rounds, intervalMs);
+}
+
+bool TransportTuner::tune(std::function<void()> change, const QList<quint16> &nodes, int rounds, int intervalMs)
+{
+    if (isBusy() || nodes.isEmpty()) {
+        return false;
+    }
+
+    m_phase = Before;
+    m_change = std::move(change);
+    m_nodes = nodes;
+    m_rounds = rounds;
+    m_intervalMs = intervalMs;
+    enqueueProbe(nodes);
+    return true;
+}
+
+void TransportTuner::enqueue(const QString &command, const QString &doneMarker, int timeoutMs)
+{
+    Pending pending;
+    pending.command = command;
+    pending.doneMarker = doneMarker;
+    pending.timeoutMs = timeoutMs;
+    m_queue.enqueue(pending);
+
+    if (!m_waiting) {
+        sendNext();
+    }
+}
+
+void TransportTuner::enqueuePerChunk(const QString &prefix, const QList<quint16> &nodes)
+{
+    for (int i = 0; i < nodes.size(); i += MaxNodesPerCommand) {
+        QList<quint16> chunk = nodes.mid(i, MaxNodesPerCommand);
+        enqueue(QString("%1 %2\n").arg(prefix, addressList(chunk)), "TXP done",
+                TxpTimeoutPerNodeMs * (chunk.size() + 1));
+    }
+}
+
+void TransportTuner::enqueueProbe(const QList<quint16> &nodes)
+{
+    m_measurement = Measurement();
+    m_probesLeft = 0;
+
+    // The dongle probes one chunk at a time; chunks run back to back so
+    // only one probe loads the network at any moment.
+    for (int i = 0; i < nodes.size(); i += MaxNodesPerCommand) {
+        QList<quint16> chunk = nodes.mid(i, MaxNodesPerCommand);
+        m_probesLeft++;
+        enqueue(QString("probe %1 %2 %3\n").arg(m_rounds).arg(m_intervalMs).arg(addressList(chunk)),
+                "PROBE done", (m_rounds + 1) * m_intervalMs + 5000);
+    }
+}
+
+void TransportTuner::sendNext()
+{
+    if (m_waiting) {
+        return;
+    }
+
+    if (m_queue.isEmpty()) {
+        onQueueIdle();
+        return;
+    }
+
+    m_current = m_queue.dequeue();
+    m_waiting = true;
+    m_commandTimer.startOnDispatch(m_current.command, m_current.timeoutMs);
+    emit sendCommand(m_current.command);
+}
+
+void TransportTuner::completeCurrent()
+{
+    m_waiting = false;
+
+    if (m_current.doneMarker == "PROBE done" && --m_probesLeft == 0) {
+        finishMeasurement();
+    }
+
+    sendNext();
+}
+
+void TransportTuner::onQueueIdle()
+{
+    if (m_phase == Applying) {
+        m_settleTimer.start(SettleMs);
+    }
+}
+
+void TransportTuner::finishMeasurement()
+{
+    Measurement measurement = m_measurement;
+    emit measured(measurement);
+
+    switch (m_phase) {
+    case Before:
+        m_before = measurement;
+        m_phase = Applying;
+        m_change();
+        break;
+    case After:
+        m_phase = Idle;
+        emit tuned(m_before, measurement);
+        break;
+    default:
+        m_phase = Idle;
+        break;
+    }
+}
+
+void TransportTuner::commandDispatched(const QString &command)
+{
+    m_commandTimer.dispatched(command);
+}
+
+void TransportTuner::handleLine(const QString &line)
+{
+    static const QRegularExpression stateRegex(
+        R"(TXP (0x[0-9a-fA-F]+) (net|relay|sar-tx|sar-rx) (.*)$)");
+    static const QRegularExpression netRegex(R"(count (\d+) interval (\d+))");
+    static const QRegularExpression relayRegex(R"((\d+) count (\d+) interval (\d+))");
+    static const QRegularExpression probeRegex(
+        R"(PROBE (0x[0-9a-fA-F]+) sent (\d+) recv (\d+) avg (\d+) max (\d+))");
+
+    QRegularExpressionMatch match = stateRegex.match(line);
+    if (match.hasMatch()) {
+        quint16 address = match.captured(1).toUShort(nullptr, 16);
+        QString kind = match.captured(2);
+        QString value = match.captured(3).trimmed();
+        NodeState &node = m_states[address];
+
+        if (kind == "net") {
+            QRegularExpressionMatch values = netRegex.match(value);
+            if (values.hasMatch()) {
+                node.netCount = values.captured(1).toInt();
+                node.netIntervalMs = values.captured(2).toInt();
+            }
+        } else if (kind == "relay") {
+            QRegularExpressionMatch values = relayRegex.match(value);
+            if (values.hasMatch()) {
+                node.relay = values.captured(1).toInt();
+                node.relayCount = values.captured(2).toInt();
+                node.relayIntervalMs = values.captured(3).toInt();
+            }
+        } else if (kind == "sar-tx") {
+            node.sarTx = value;
+        } else {
+            node.sarRx = value;
+        }
+
+        emit stateChanged(address);
+        return;
+    }
+
+    match = probeRegex.match(line);
+    if (match.hasMatch()) {
+        Link link;
+        link.sent = match.captured(2).toInt();
+        link.received = match.captured(3).toInt();
+        link.avgRttMs = match.captured(4).toInt();
+        link.maxRttMs = match.captured(5).toInt();
+        m_measurement.links.insert(match.captured(1).toUShort(nullptr, 16), link);
+        return;
+    }
+
+    if (!m_waiting || !line.contains(m_current.doneMarker)) {
+        return;
+    }
+
+    m_commandTimer.stop();
+    completeCurrent();
+}
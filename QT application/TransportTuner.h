@@ -0,0 +1,126 @@
+#ifndef TRANSPORTTUNER_H
+#define TRANSPORTTUNER_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QQueue>
+#include <QString>
+#include <functional>
+#include "RequestTimer.h"
+
+// Runtime tuning of the transport parameters of a set of nodes through
+// the dongle's "txp" and "probe" shell commands.
+//
+// Network Transmit, Relay and SAR Transmitter/Receiver states are read
+// and set on all selected nodes at once; a probe run (OnOff Get round
+// trips) measures delivery ratio and latency so a change can be compared
+// before and after it is applied.
+class TransportTuner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Params {
+        int netCount = 2;           // retransmissions, 0..7
+        int netIntervalMs = 20;     // 10..320 in 10 ms steps
+        bool relay = true;
+        int relayCount = 2;
+        int relayIntervalMs = 20;
+        QString sarTx;              // "v1,...,v7", empty leaves it unchanged
+        QString sarRx;              // "v1,...,v5", empty leaves it unchanged
+    };
+
+    struct NodeState {
+        int netCount = -1;
+        int netIntervalMs = -1;
+        int relay = -1;
+        int relayCount = -1;
+        int relayIntervalMs = -1;
+        QString sarTx;
+        QString sarRx;
+    };
+
+    struct Link {
+        int sent = 0;
+        int received = 0;
+        int avgRttMs = 0;
+        int maxRttMs = 0;
+    };
+
+    struct Measurement {
+        QMap<quint16, Link> links;
+
+        int sent() const;
+        int received() const;
+        double deliveryRatio() const;
+        double avgRttMs() const;
+        int maxRttMs() const;
+    };
+
+    explicit TransportTuner(QObject *parent = nullptr);
+
+    void readState(const QList<quint16> &nodes);
+    void apply(const Params &params, const QList<quint16> &nodes);
+    void setRelay(const QList<quint16> &nodes, bool enabled, int count, int intervalMs);
+    bool measure(const QList<quint16> &nodes, int rounds, int intervalMs);
+    // Measure, apply, let the network settle and measure again.
+    bool tune(const Params &params, const QList<quint16> &nodes, int rounds, int intervalMs);
+    // Same with any change made through this tuner's commands
+    bool tune(std::function<void()> change, const QList<quint16> &nodes, int rounds, int intervalMs);
+    bool isBusy() const;
+
+    NodeState state(quint16 address) const;
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+    // Feed every command the scheduler writes.
+    void commandDispatched(const QString &command);
+
+signals:
+    void sendCommand(const QString &command);
+    void stateChanged(quint16 address);
+    void measured(const Measurement &measurement);
+    void tuned(const Measurement &before, const Measurement &after);
+
+private:
+    enum Phase {
+        Idle,
+        Measuring,
+        Before,
+        Applying,
+        After,
+    };
+
+    struct Pending {
+        QString command;
+        QString doneMarker;
+        int timeoutMs = 0;
+    };
+
+    void enqueue(const QString &command, const QString &doneMarker, int timeoutMs);
+    void enqueuePerChunk(const QString &prefix, const QList<quint16> &nodes);
+    void enqueueProbe(const QList<quint16> &nodes);
+    void sendNext();
+    void completeCurrent();
+    void onQueueIdle();
+    void finishMeasurement();
+
+    QMap<quint16, NodeState> m_states;
+    QQueue<Pending> m_queue;
+    Pending m_current;
+    bool m_waiting = false;
+    RequestTimer m_commandTimer;
+    RequestTimer m_settleTimer;
+
+    Phase m_phase = Idle;
+    std::function<void()> m_change;
+    QList<quint16> m_nodes;
+    int m_rounds = 0;
+    int m_intervalMs = 0;
+    int m_probesLeft = 0;
+    Measurement m_measurement;
+    Measurement m_before;
+};
+
+#endif // TRANSPORTTUNER_H
@@ -0,0 +1,291 @@
+#include "UnicastAllocator.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QRegularExpressionMatch>
+
+static QString hex(quint16 value)
+{
+    return QString("0x%1").arg(value, 4, 16, QChar('0'));
+}
+
+UnicastAllocator::UnicastAllocator(const QString &path, QObject *parent)
+    : QObject(parent),
+      m_path(path)
+{
+    addFree(FirstAddress, quint32(LastAddress) + 1);
+    load();
+}
+
+void UnicastAllocator::addFree(quint32 first, quint32 end)
+{
+    m_free += end - first;
+
+    // Merge with the free intervals on either side
+    auto next = m_freeByStart.find(end);
+    if (next != m_freeByStart.end()) {
+        end = next->second;
+        m_freeBySize.erase({ next->second - next->first, next->first });
+        m_freeByStart.erase(next);
+    }
+
+    auto prev = m_freeByStart.lower_bound(first);
+    if (prev != m_freeByStart.begin() && (--prev)->second == first) {
+        first = prev->first;
+        m_freeBySize.erase({ prev->second - prev->first, prev->first });
+        m_freeByStart.erase(prev);
+    }
+
+    m_freeByStart.emplace(first, end);
+    m_freeBySize.emplace(end - first, first);
+}
+
+bool UnicastAllocator::takeFree(quint32 first, quint32 end)
+{
+    auto it = m_freeByStart.upper_bound(first);
+    if (it == m_freeByStart.begin()) {
+        return false;
+    }
+    --it;
+
+    quint32 freeFirst = it->first;
+    quint32 freeEnd = it->second;
+    if (end > freeEnd) {
+        return false;
+    }
+
+    m_freeBySize.erase({ freeEnd - freeFirst, freeFirst });
+    m_freeByStart.erase(it);
+    if (freeFirst < first) {
+        m_freeByStart.emplace(freeFirst, first);
+        m_freeBySize.emplace(first - freeFirst, freeFirst);
+    }
+    if (end < freeEnd) {
+        m_freeByStart.emplace(end, freeEnd);
+        m_freeBySize.emplace(freeEnd - end, end);
+    }
+
+    m_free -= end - first;
+    return true;
+}
+
+quint16 UnicastAllocator::allocate(int elements)
+{
+    quint32 count = quint32(qMax(1, elements));
+
+    // Smallest free interval that fits, lowest address among equals
+    auto it = m_freeBySize.lower_bound({ count, 0 });
+    if (it == m_freeBySize.end()) {
+        return 0;
+    }
+
+    quint16 address = quint16(it->second);
+    takeFree(address, address + count);
+    m_nodes[address] = int(count);
+    if (m_checking) {
+        m_takenWhileChecking.insert(address);
+    }
+    save();
+    return address;
+}
+
+bool UnicastAllocator::reserve(quint16 address, int elements)
+{
+    // Seen by the caller itself, whatever the CDB listed before
+    if (m_checking) {
+        m_takenWhileChecking.insert(address);
+    }
+
+    if (contains(address)) {
+        return resize(address, elements);
+    }
+
+    int count = qMax(1, elements);
+    if (!takeFree(address, quint32(address) + count)) {
+        return false;
+    }
+
+    m_nodes[address] = count;
+    save();
+    return true;
+}
+
+bool UnicastAllocator::resize(quint16 address, int elements)
+{
+    auto it = m_nodes.find(address);
+    if (it == m_nodes.end()) {
+        return reserve(address, elements);
+    }
+
+    int count = qMax(1, elements);
+    if (count < it->second) {
+        addFree(quint32(address) + count, quint32(address) + it->second);
+    } else if (count > it->second && !takeFree(quint32(address) + it->second, quint32(address) + count)) {
+        return false;
+    }
+
+    it->second = count;
+    save();
+    return true;
+}
+
+void UnicastAllocator::removeNode(quint16 address)
+{
+    auto it = m_nodes.find(address);
+    if (it != m_nodes.end()) {
+        addFree(address, quint32(address) + it->second);
+        m_nodes.erase(it);
+    }
+}
+
+int UnicastAllocator::removeOverlapping(quint32 first, quint32 end)
+{
+    int removed = 0;
+
+    // Only the block before first can reach into the range
+    auto it = m_nodes.lower_bound(quint16(first));
+    if (it != m_nodes.begin() && quint32(std::prev(it)->first) + std::prev(it)->second > first) {
+        --it;
+    }
+
+    while (it != m_nodes.end() && it->first < end) {
+        quint16 address = it->first;
+        ++it;
+        removeNode(address);
+        removed++;
+    }
+
+    return removed;
+}
+
+void UnicastAllocator::release(quint16 address)
+{
+    if (contains(address)) {
+        removeNode(address);
+        save();
+    }
+}
+
+bool UnicastAllocator::contains(quint16 address) const
+{
+    return m_nodes.count(address) > 0;
+}
+
+int UnicastAllocator::elementCount(quint16 address) const
+{
+    auto it = m_nodes.find(address);
+    return it != m_nodes.end() ? it->second : 0;
+}
+
+int UnicastAllocator::freeAddresses() const
+{
+    return m_free;
+}
+
+void UnicastAllocator::check()
+{
+    m_checking = true;
+    m_cdbNodes.clear();
+    m_takenWhileChecking.clear();
+    emit sendCommand("cdbnodes\n");
+}
+
+void UnicastAllocator::handleLine(const QString &line)
+{
+    static const QRegularExpression nodeRegex(R"(^CDB node (0x[0-9a-fA-F]+) elems (\d+))");
+
+    if (!m_checking) {
+        return;
+    }
+
+    QRegularExpressionMatch match = nodeRegex.match(line);
+    if (match.hasMatch()) {
+        m_cdbNodes.insert(match.captured(1).toUShort(nullptr, 16), match.captured(2).toInt());
+    } else if (line.startsWith(QLatin1String("CDB done"))) {
+        m_checking = false;
+        finishCheck();
+    }
+}
+
+void UnicastAllocator::finishCheck()
+{
+    int fixed = 0;
+
+    // A new network: the nodes of earlier sessions may still be around
+    if (m_cdbNodes.isEmpty()) {
+        qDebug() << "CDB empty, allocation kept";
+        m_takenWhileChecking.clear();
+        emit checked(0, 0);
+        return;
+    }
+
+    // Blocks the CDB does not know were never provisioned or were reset
+    for (auto it = m_nodes.begin(); it != m_nodes.end();) {
+        quint16 address = it->first;
+        ++it;
+        if (!m_cdbNodes.contains(address) && !m_takenWhileChecking.contains(address)) {
+            qDebug() << "Address" << hex(address) << "not in the CDB, released";
+            removeNode(address);
+            fixed++;
+        }
+    }
+
+    // The CDB wins over anything overlapping its nodes
+    for (auto it = m_cdbNodes.cbegin(); it != m_cdbNodes.cend(); ++it) {
+        int count = qMax(1, it.value());
+        if (elementCount(it.key()) == count) {
+            continue;
+        }
+
+        qDebug() << "CDB node" << hex(it.key()) << "has" << count << "elements, allocation fixed";
+        removeOverlapping(it.key(), quint32(it.key()) + count);
+        if (takeFree(it.key(), quint32(it.key()) + count)) {
+            m_nodes[it.key()] = count;
+        }
+        fixed++;
+    }
+
+    m_takenWhileChecking.clear();
+    save();
+    emit checked(m_cdbNodes.size(), fixed);
+}
+
+void UnicastAllocator::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject nodes = QJsonDocument::fromJson(file.readAll()).object().value("nodes").toObject();
+    for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+        quint16 address = it.key().toUShort(nullptr, 16);
+        int count = qMax(1, it.value().toInt());
+        if (address && takeFree(address, quint32(address) + count)) {
+            m_nodes[address] = count;
+        } else {
+            qDebug() << "Ignoring overlapping allocation" << it.key();
+        }
+    }
+}
+
+void UnicastAllocator::save() const
+{
+    QJsonObject nodes;
+    for (const auto &node : m_nodes) {
+        nodes.insert(hex(node.first), node.second);
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Cannot write" << m_path << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject{ { "nodes", nodes } }).toJson());
+}
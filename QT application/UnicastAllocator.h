@@ -0,0 +1,82 @@
+#ifndef UNICASTALLOCATOR_H
+#define UNICASTALLOCATOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <map>
+#include <set>
+#include <utility>
+
+// Unicast addresses of the network, one contiguous block per node with
+// one address per element. The free addresses are kept as intervals,
+// indexed both by start (to merge a released block with its neighbors)
+// and by length (to find the smallest interval that fits), so allocation
+// and release are O(log n) in the number of intervals however many
+// elements the network has.
+//
+// The allocation is saved to a file after every change and checked
+// against the provisioner's CDB ("cdbnodes"), which wins on conflicts.
+// An empty CDB belongs to a network that is not set up yet and says
+// nothing about the nodes of earlier sessions, so their addresses stay
+// allocated. Blocks taken while a check is running are kept as well.
+class UnicastAllocator : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint16 FirstAddress = 0x0001;
+    static constexpr quint16 LastAddress = 0x7fff;
+
+    UnicastAllocator(const QString &path, QObject *parent = nullptr);
+
+    // Primary address of a free block of elements addresses, or 0.
+    quint16 allocate(int elements);
+
+    // Take a block at a given address, e.g. a node found through its
+    // Beats. Fails if any address of it is in use by another node.
+    bool reserve(quint16 address, int elements);
+
+    // Change a node's element count once provisioning reports it.
+    bool resize(quint16 address, int elements);
+
+    void release(quint16 address);
+
+    bool contains(quint16 address) const;
+    int elementCount(quint16 address) const;
+    int freeAddresses() const;
+
+    // Compare with the CDB; the result comes as checked(), with the
+    // number of nodes in the CDB.
+    void check();
+
+    // Feed every line received from the dongle.
+    void handleLine(const QString &line);
+
+signals:
+    void sendCommand(const QString &command);
+    void checked(int cdbNodes, int fixed);
+
+private:
+    // Free intervals are [first, end)
+    void addFree(quint32 first, quint32 end);
+    bool takeFree(quint32 first, quint32 end);
+    void removeNode(quint16 address);
+    int removeOverlapping(quint32 first, quint32 end);
+    void finishCheck();
+    void load();
+    void save() const;
+
+    std::map<quint32, quint32> m_freeByStart;           // first -> end
+    std::set<std::pair<quint32, quint32>> m_freeBySize; // (length, first)
+    std::map<quint16, int> m_nodes;                     // primary -> elements
+    int m_free = 0;
+
+    QString m_path;
+    bool m_checking = false;
+    QHash<quint16, int> m_cdbNodes;
+    QSet<quint16> m_takenWhileChecking;
+};
+
+#endif // UNICASTALLOCATOR_H